@@ -80,9 +80,12 @@ import {
 } from './interpolation/interpolationChannels';
 import {
   createSpriteDrawProgram,
+  createSpriteInstanceProgram,
   createBorderOutlineRenderer,
   createLeaderLineRenderer,
+  measureInstanceRun,
   type SpriteDrawProgram,
+  type SpriteInstanceProgram,
   type BorderOutlineRenderer,
   type LeaderLineRenderer,
   resolveTextureFilteringOptions,
@@ -114,6 +117,7 @@ import {
 } from './const';
 import {
   SL_DEBUG,
+  ENABLE_INSTANCE_OUTPUT,
   ATLAS_QUEUE_CHUNK_SIZE,
   ATLAS_QUEUE_TIME_BUDGET_MS,
   TEXT_GLYPH_QUEUE_CHUNK_SIZE,
@@ -589,6 +593,7 @@ export const createSpriteLayer = <T = any>(
         imageHandleBuffersController,
         originReference,
         spriteIdHandler,
+        instancedBillboards: spriteInstanceProgram !== undefined,
       });
     }
     return createCalculationHost<T>(params);
@@ -601,6 +606,8 @@ export const createSpriteLayer = <T = any>(
   let map: MapLibreMap | undefined;
   /** Sprite drawing helper encapsulating shader state. */
   let spriteDrawProgram: SpriteDrawProgram<T> | undefined;
+  /** Instanced billboard program, when instance output is enabled and supported. */
+  let spriteInstanceProgram: SpriteInstanceProgram<T> | undefined;
   /** Cached anisotropic filtering extension instance (when available). */
   let anisotropyExtension: EXT_texture_filter_anisotropic | undefined;
   /** Maximum anisotropy supported by the current context. */
@@ -1434,6 +1441,9 @@ export const createSpriteLayer = <T = any>(
     canvasElement = mouseEventsController.canvasElement;
 
     spriteDrawProgram = createSpriteDrawProgram<T>(glContext);
+    spriteInstanceProgram = ENABLE_INSTANCE_OUTPUT
+      ? createSpriteInstanceProgram<T>(glContext)
+      : undefined;
 
     // Request a render pass.
     scheduleRender();
@@ -1463,6 +1473,10 @@ export const createSpriteLayer = <T = any>(
         spriteDrawProgram.release();
         spriteDrawProgram = undefined;
       }
+      if (spriteInstanceProgram) {
+        spriteInstanceProgram.release();
+        spriteInstanceProgram = undefined;
+      }
       if (borderOutlineRenderer) {
         borderOutlineRenderer.release();
         borderOutlineRenderer = undefined;
@@ -1597,14 +1611,9 @@ export const createSpriteLayer = <T = any>(
       const drawProgram = spriteDrawProgram;
 
       let drawOrderCounter = 0;
-      const drawPreparedSprite = (
+      const registerDrawnSprite = (
         prepared: PreparedDrawSpriteImageParams<T>
       ): void => {
-        const didDraw = drawProgram.draw(prepared);
-        if (!didDraw) {
-          return;
-        }
-
         prepared.imageEntry.surfaceShaderInputs =
           prepared.surfaceShaderInputs ?? undefined;
 
@@ -1624,6 +1633,13 @@ export const createSpriteLayer = <T = any>(
 
         drawOrderCounter += 1;
       };
+      const drawPreparedSprite = (
+        prepared: PreparedDrawSpriteImageParams<T>
+      ): void => {
+        if (drawProgram.draw(prepared)) {
+          registerDrawnSprite(prepared);
+        }
+      };
 
       const sortedSubLayerBuckets =
         buildSortedSubLayerBuckets(renderTargetEntries);
@@ -1769,7 +1785,20 @@ export const createSpriteLayer = <T = any>(
         }
 
         drawProgram.beginFrame();
-        drawProgram.uploadVertexBatch(preparedItems);
+        drawProgram.uploadVertexBatch(
+          preparedItems,
+          processResult.vertexBatch?.()
+        );
+
+        const instanceBatch = spriteInstanceProgram
+          ? processResult.instanceBatch?.()
+          : undefined;
+        const instanceProgram = instanceBatch
+          ? spriteInstanceProgram
+          : undefined;
+        if (instanceProgram && instanceBatch) {
+          instanceProgram.uploadInstanceBatch(preparedItems, instanceBatch);
+        }
 
         const preparedBySubLayer = new Map<
           number,
@@ -1785,6 +1814,7 @@ export const createSpriteLayer = <T = any>(
           list.push(prepared);
         }
 
+        const drawList: PreparedDrawSpriteImageParams<T>[] = [];
         for (const [subLayer, bucket] of sortedSubLayerBuckets) {
           const preparedBucket = preparedBySubLayer.get(subLayer);
           if (!preparedBucket) {
@@ -1799,7 +1829,44 @@ export const createSpriteLayer = <T = any>(
               continue;
             }
             bucketImages.delete(prepared.imageEntry);
+            drawList.push(prepared);
+          }
+        }
+
+        if (!instanceProgram) {
+          for (const prepared of drawList) {
+            drawPreparedSprite(prepared);
+          }
+        } else {
+          // Consecutive shader billboards sharing a texture become one
+          // instanced draw; everything else keeps the per-item path.
+          let instancing = false;
+          let index = 0;
+          while (index < drawList.length) {
+            const prepared = drawList[index]!;
+            const runLength = measureInstanceRun(drawList, index);
+            if (runLength > 0) {
+              if (!instancing) {
+                instanceProgram.begin();
+                instancing = true;
+              }
+              instanceProgram.drawRun(prepared, runLength);
+              for (let offset = 0; offset < runLength; offset++) {
+                registerDrawnSprite(drawList[index + offset]!);
+              }
+              index += runLength;
+              continue;
+            }
+            if (instancing) {
+              instanceProgram.end();
+              drawProgram.resume();
+              instancing = false;
+            }
             drawPreparedSprite(prepared);
+            index++;
+          }
+          if (instancing) {
+            instanceProgram.end();
           }
         }
       } else if (interpolationParams) {
@@ -16,6 +16,52 @@ export const USE_SHADER_SURFACE_GEOMETRY = true;
 /** Whether to enable the NDC bias for surface rendering (disabled by default). */
 export const ENABLE_NDC_BIAS_SURFACE = true;
 
+/** Whether the WASM host drops images outside the viewport before depth sorting. */
+export const ENABLE_VIEWPORT_CULLING = false;
+
+/** Extra margin (CSS pixels) around the viewport kept by viewport culling. */
+export const VIEWPORT_CULLING_GUARD_BAND_PIXELS = 64;
+
+/**
+ * Whether the WASM host uses polynomial approximations for the mercator
+ * conversions (error below 1e-4 pixels at zoom 22).
+ */
+export const ENABLE_FAST_MERCATOR_MATH = false;
+
+/**
+ * Whether the WASM host writes result items as float32, halving the result
+ * buffer. Billboard quads are computed in float32 as well. Geographic surface
+ * inputs are encoded relative to a per-frame anchor, so they stay precise at
+ * high zoom.
+ */
+export const ENABLE_FLOAT32_RESULT = false;
+
+/**
+ * Whether the WASM host writes the interleaved vertices of every prepared image
+ * into one float32 region, uploaded to the GPU as is, instead of into each
+ * result item.
+ */
+export const ENABLE_VERTEX_OUTPUT = false;
+
+/**
+ * Whether the WASM host also writes one compact record per prepared image so
+ * shader billboards are drawn instanced (needs WebGL2 or ANGLE_instanced_arrays).
+ */
+export const ENABLE_INSTANCE_OUTPUT = false;
+
+/**
+ * Whether the WASM host moves surface shader inputs out of the result items
+ * into a trailing stream, so billboard items stay compact.
+ */
+export const ENABLE_SURFACE_STREAM = false;
+
+/**
+ * Whether the WASM host eases fractional-power ease, exponential, sine and
+ * bounce presets through cached lookup tables (error below 1e-4) instead of
+ * evaluating them exactly.
+ */
+export const ENABLE_EASING_TABLES = false;
+
 /** Maximum number of atlas operations handled per processing pass. */
 export const ATLAS_QUEUE_CHUNK_SIZE = 64;
 
@@ -32,7 +32,7 @@ import type {
   AtlasOperationQueue,
   AtlasPageState,
 } from './atlas';
-import { DEG2RAD, UV_CORNERS } from '../const';
+import { DEG2RAD, TRIANGLE_INDICES, UV_CORNERS } from '../const';
 import { DEFAULT_TEXTURE_FILTERING_OPTIONS } from '../default';
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -62,6 +62,24 @@ export const QUAD_VERTEX_SCRATCH = new Float32Array(
   QUAD_VERTEX_COUNT * VERTEX_COMPONENT_COUNT
 );
 
+/**
+ * Number of components per billboard instance record, mirroring
+ * `RESULT_INSTANCE_RECORD_LENGTH` in wasm/calculation_host_layouts.h.
+ */
+export const INSTANCE_COMPONENT_COUNT = 16;
+/** Stride per instance record in bytes. */
+export const INSTANCE_STRIDE = INSTANCE_COMPONENT_COUNT * FLOAT_SIZE;
+/** Byte offset of center.xy + halfSize.xy inside an instance record. */
+const INSTANCE_CENTER_HALF_SIZE_OFFSET = 0;
+/** Byte offset of anchor.xy + sin/cos inside an instance record. */
+const INSTANCE_ANCHOR_SIN_COS_OFFSET = 4 * FLOAT_SIZE;
+/** Byte offset of the atlas UV rect (u0, v0, u1, v1) inside an instance record. */
+const INSTANCE_UV_RECT_OFFSET = 8 * FLOAT_SIZE;
+/** Component index of the opacity inside an instance record. */
+export const INSTANCE_OPACITY_INDEX = 12;
+/** Components per corner template vertex (corner.xy + uv.xy). */
+const INSTANCE_TEMPLATE_COMPONENT_COUNT = 4;
+
 //////////////////////////////////////////////////////////////////////////////////////
 
 /** Shared vertex shader that converts screen-space vertices when requested. */
@@ -131,6 +149,51 @@ void main() {
 }
 ` as const;
 
+/** Vertex shader expanding billboard instance records against a static corner template. */
+const INSTANCE_VERTEX_SHADER_SOURCE = `
+attribute vec4 a_corner;
+attribute vec4 a_centerHalfSize;
+attribute vec4 a_anchorSinCos;
+attribute vec4 a_uvRect;
+attribute float a_opacity;
+uniform vec2 u_screenToClipScale;
+uniform vec2 u_screenToClipOffset;
+varying vec2 v_uv;
+varying float v_opacity;
+void main() {
+  vec2 shifted = (a_corner.xy - a_anchorSinCos.xy) * a_centerHalfSize.zw;
+  float sinR = a_anchorSinCos.z;
+  float cosR = a_anchorSinCos.w;
+  vec2 rotated = vec2(
+    shifted.x * cosR - shifted.y * sinR,
+    shifted.x * sinR + shifted.y * cosR
+  );
+  vec2 screenPosition = vec2(
+    a_centerHalfSize.x + rotated.x,
+    a_centerHalfSize.y - rotated.y
+  );
+  v_uv = mix(a_uvRect.xy, a_uvRect.zw, a_corner.zw);
+  v_opacity = a_opacity;
+  gl_Position = vec4(
+    screenPosition * u_screenToClipScale + u_screenToClipOffset,
+    0.0,
+    1.0
+  );
+}
+` as const;
+
+/** Fragment shader for instanced billboards, taking the opacity per instance. */
+const INSTANCE_FRAGMENT_SHADER_SOURCE = `
+precision mediump float;
+uniform sampler2D u_texture;
+varying vec2 v_uv;
+varying float v_opacity;
+void main() {
+  vec4 texel = texture2D(u_texture, v_uv);
+  gl_FragColor = vec4(texel.rgb, texel.a) * v_opacity;
+}
+` as const;
+
 /** Vertex shader for sprite-border outline rendering using screen coordinates. */
 const BORDER_OUTLINE_VERTEX_SHADER_SOURCE = `
 attribute vec4 a_position;
@@ -200,6 +263,14 @@ export const SURFACE_BASE_CORNERS: ReadonlyArray<readonly [number, number]> = [
   [1, -1],
 ] as const;
 
+/** Billboard corner template (corner.xy + uv.xy per vertex) shared by every instance. */
+const BILLBOARD_INSTANCE_TEMPLATE = new Float32Array(
+  TRIANGLE_INDICES.flatMap((index) => [
+    ...BILLBOARD_BASE_CORNERS[index]!,
+    ...UV_CORNERS[index]!,
+  ])
+);
+
 //////////////////////////////////////////////////////////////////////////////////////
 
 export const computeBillboardCornersShaderModel = ({
@@ -318,7 +389,12 @@ const FLOATS_PER_SPRITE = QUAD_VERTEX_COUNT * VERTEX_COMPONENT_COUNT;
 
 export interface SpriteDrawProgram<TTag> extends Releasable {
   beginFrame(): void;
-  uploadVertexBatch(items: PreparedDrawSpriteImageParams<TTag>[]): void;
+  /** Rebinds the program and vertex buffer after another program was used. */
+  resume(): void;
+  uploadVertexBatch(
+    items: PreparedDrawSpriteImageParams<TTag>[],
+    vertexBatch?: Float32Array
+  ): void;
   draw(prepared: PreparedDrawSpriteImageParams<TTag>): boolean;
 }
 
@@ -617,7 +693,7 @@ export const createSpriteDrawProgram = <TTag>(
     }
   };
 
-  const beginFrame = (): void => {
+  const bindProgram = (): void => {
     glContext.useProgram(program);
     glContext.bindBuffer(glContext.ARRAY_BUFFER, vertexBuffer);
     glContext.enableVertexAttribArray(attribPositionLocation);
@@ -638,16 +714,46 @@ export const createSpriteDrawProgram = <TTag>(
       VERTEX_STRIDE,
       UV_OFFSET
     );
+  };
+
+  const beginFrame = (): void => {
+    bindProgram();
     resetFrameState();
   };
 
+  const resume = (): void => {
+    bindProgram();
+    currentBoundTexture = null;
+  };
+
   const uploadVertexBatch = (
-    items: PreparedDrawSpriteImageParams<TTag>[]
+    items: PreparedDrawSpriteImageParams<TTag>[],
+    vertexBatch?: Float32Array
   ): void => {
     vertexBatchOffsets.clear();
     if (items.length === 0) {
       return;
     }
+    // The calculation host already laid out every item: upload it as is.
+    // Instanced billboards have no vertices there and are drawn elsewhere.
+    if (
+      vertexBatch &&
+      items.every(
+        (prepared) =>
+          prepared.vertexBatchOffset !== undefined ||
+          prepared.instanceBatchIndex !== undefined
+      )
+    ) {
+      for (const prepared of items) {
+        if (prepared.vertexBatchOffset !== undefined) {
+          vertexBatchOffsets.set(prepared, prepared.vertexBatchOffset);
+        }
+      }
+      ensureVertexBufferCapacity(vertexBatch.length);
+      orphanVertexBuffer();
+      glContext.bufferSubData(glContext.ARRAY_BUFFER, 0, vertexBatch);
+      return;
+    }
     let requiredFloatCount = 0;
     for (const prepared of items) {
       requiredFloatCount += prepared.vertexData.length;
@@ -657,6 +763,9 @@ export const createSpriteDrawProgram = <TTag>(
     let vertexOffset = 0;
     for (const prepared of items) {
       const data = prepared.vertexData;
+      if (data.length === 0) {
+        continue;
+      }
       batchedVertexScratch.set(data, floatOffset);
       vertexBatchOffsets.set(prepared, vertexOffset);
       floatOffset += data.length;
@@ -786,12 +895,363 @@ export const createSpriteDrawProgram = <TTag>(
 
   return {
     beginFrame,
+    resume,
     uploadVertexBatch,
     draw,
     release,
   };
 };
 
+/** Instanced drawing entry points of WebGL2 or `ANGLE_instanced_arrays`. */
+interface InstancingFunctions {
+  readonly vertexAttribDivisor: (index: number, divisor: number) => void;
+  readonly drawArraysInstanced: (
+    mode: number,
+    first: number,
+    count: number,
+    instanceCount: number
+  ) => void;
+}
+
+const resolveInstancingFunctions = (
+  glContext: WebGLRenderingContext
+): InstancingFunctions | undefined => {
+  if (
+    typeof WebGL2RenderingContext !== 'undefined' &&
+    glContext instanceof WebGL2RenderingContext
+  ) {
+    const gl2 = glContext;
+    return {
+      vertexAttribDivisor: (index, divisor) =>
+        gl2.vertexAttribDivisor(index, divisor),
+      drawArraysInstanced: (mode, first, count, instanceCount) =>
+        gl2.drawArraysInstanced(mode, first, count, instanceCount),
+    };
+  }
+  const extension = glContext.getExtension('ANGLE_instanced_arrays');
+  if (!extension) {
+    return undefined;
+  }
+  return {
+    vertexAttribDivisor: (index, divisor) =>
+      extension.vertexAttribDivisorANGLE(index, divisor),
+    drawArraysInstanced: (mode, first, count, instanceCount) =>
+      extension.drawArraysInstancedANGLE(mode, first, count, instanceCount),
+  };
+};
+
+/**
+ * Counts the items from `start` that can be drawn as one instanced run: shader
+ * billboards with consecutive instance records, one texture and one screen-to-clip.
+ * @param items Prepared items in draw order.
+ * @param start Index of the first item of the run.
+ * @returns Run length, or 0 when the item at `start` has no instance record.
+ */
+export const measureInstanceRun = <TTag>(
+  items: readonly PreparedDrawSpriteImageParams<TTag>[],
+  start: number
+): number => {
+  const first = items[start];
+  if (
+    !first ||
+    first.instanceBatchIndex === undefined ||
+    !first.imageResource.texture
+  ) {
+    return 0;
+  }
+  const texture = first.imageResource.texture;
+  const screenToClip = first.screenToClip;
+  let length = 1;
+  for (let index = start + 1; index < items.length; index++) {
+    const prepared = items[index]!;
+    if (
+      prepared.instanceBatchIndex !== first.instanceBatchIndex + length ||
+      prepared.imageResource.texture !== texture ||
+      prepared.screenToClip.scaleX !== screenToClip.scaleX ||
+      prepared.screenToClip.scaleY !== screenToClip.scaleY ||
+      prepared.screenToClip.offsetX !== screenToClip.offsetX ||
+      prepared.screenToClip.offsetY !== screenToClip.offsetY
+    ) {
+      break;
+    }
+    length++;
+  }
+  return length;
+};
+
+export interface SpriteInstanceProgram<TTag> extends Releasable {
+  uploadInstanceBatch(
+    items: readonly PreparedDrawSpriteImageParams<TTag>[],
+    instanceBatch: Float32Array
+  ): void;
+  begin(): void;
+  drawRun(
+    first: PreparedDrawSpriteImageParams<TTag>,
+    instanceCount: number
+  ): void;
+  end(): void;
+}
+
+/**
+ * Creates the instanced billboard program.
+ * @param {WebGLRenderingContext} glContext - Active WebGL context.
+ * @returns Program, or `undefined` when the context cannot draw instanced.
+ */
+export const createSpriteInstanceProgram = <TTag>(
+  glContext: WebGLRenderingContext
+): SpriteInstanceProgram<TTag> | undefined => {
+  const instancing = resolveInstancingFunctions(glContext);
+  if (!instancing) {
+    return undefined;
+  }
+
+  const program = createShaderProgram(
+    glContext,
+    INSTANCE_VERTEX_SHADER_SOURCE,
+    INSTANCE_FRAGMENT_SHADER_SOURCE
+  );
+
+  const attribCornerLocation = glContext.getAttribLocation(
+    program,
+    'a_corner'
+  );
+  const attribCenterHalfSizeLocation = glContext.getAttribLocation(
+    program,
+    'a_centerHalfSize'
+  );
+  const attribAnchorSinCosLocation = glContext.getAttribLocation(
+    program,
+    'a_anchorSinCos'
+  );
+  const attribUvRectLocation = glContext.getAttribLocation(
+    program,
+    'a_uvRect'
+  );
+  const attribOpacityLocation = glContext.getAttribLocation(
+    program,
+    'a_opacity'
+  );
+  const uniformTextureLocation = glContext.getUniformLocation(
+    program,
+    'u_texture'
+  );
+  const uniformScreenToClipScaleLocation = glContext.getUniformLocation(
+    program,
+    'u_screenToClipScale'
+  );
+  const uniformScreenToClipOffsetLocation = glContext.getUniformLocation(
+    program,
+    'u_screenToClipOffset'
+  );
+  if (
+    attribCornerLocation === -1 ||
+    attribCenterHalfSizeLocation === -1 ||
+    attribAnchorSinCosLocation === -1 ||
+    attribUvRectLocation === -1 ||
+    attribOpacityLocation === -1 ||
+    !uniformTextureLocation ||
+    !uniformScreenToClipScaleLocation ||
+    !uniformScreenToClipOffsetLocation
+  ) {
+    glContext.deleteProgram(program);
+    throw new Error('Failed to acquire instance program locations.');
+  }
+  const instanceAttribLocations = [
+    attribCenterHalfSizeLocation,
+    attribAnchorSinCosLocation,
+    attribUvRectLocation,
+    attribOpacityLocation,
+  ] as const;
+
+  const templateBuffer = glContext.createBuffer();
+  const instanceBuffer = glContext.createBuffer();
+  if (!templateBuffer || !instanceBuffer) {
+    glContext.deleteBuffer(templateBuffer);
+    glContext.deleteBuffer(instanceBuffer);
+    glContext.deleteProgram(program);
+    throw new Error('Failed to create instance buffers.');
+  }
+  glContext.bindBuffer(glContext.ARRAY_BUFFER, templateBuffer);
+  glContext.bufferData(
+    glContext.ARRAY_BUFFER,
+    BILLBOARD_INSTANCE_TEMPLATE,
+    glContext.STATIC_DRAW
+  );
+  glContext.bindBuffer(glContext.ARRAY_BUFFER, instanceBuffer);
+  glContext.bufferData(
+    glContext.ARRAY_BUFFER,
+    INSTANCE_STRIDE,
+    glContext.DYNAMIC_DRAW
+  );
+  glContext.bindBuffer(glContext.ARRAY_BUFFER, null);
+
+  let instanceBufferCapacityFloats = INSTANCE_COMPONENT_COUNT;
+  let active = false;
+  let currentBoundTexture: WebGLTexture | null = null;
+  let currentScaleX = Number.NaN;
+  let currentScaleY = Number.NaN;
+  let currentOffsetX = Number.NaN;
+  let currentOffsetY = Number.NaN;
+
+  const uploadInstanceBatch = (
+    items: readonly PreparedDrawSpriteImageParams<TTag>[],
+    instanceBatch: Float32Array
+  ): void => {
+    // Opacity is finalized on the JS side after wasm wrote the records.
+    for (const prepared of items) {
+      const recordIndex = prepared.instanceBatchIndex;
+      if (recordIndex !== undefined) {
+        instanceBatch[
+          recordIndex * INSTANCE_COMPONENT_COUNT + INSTANCE_OPACITY_INDEX
+        ] = prepared.opacity;
+      }
+    }
+    glContext.bindBuffer(glContext.ARRAY_BUFFER, instanceBuffer);
+    if (instanceBatch.length > instanceBufferCapacityFloats) {
+      let capacity = instanceBufferCapacityFloats;
+      while (capacity < instanceBatch.length) {
+        capacity *= 2;
+      }
+      instanceBufferCapacityFloats = capacity;
+    }
+    glContext.bufferData(
+      glContext.ARRAY_BUFFER,
+      instanceBufferCapacityFloats * FLOAT_SIZE,
+      glContext.DYNAMIC_DRAW
+    );
+    glContext.bufferSubData(glContext.ARRAY_BUFFER, 0, instanceBatch);
+  };
+
+  const begin = (): void => {
+    glContext.useProgram(program);
+    glContext.uniform1i(uniformTextureLocation, 0);
+    glContext.bindBuffer(glContext.ARRAY_BUFFER, templateBuffer);
+    glContext.enableVertexAttribArray(attribCornerLocation);
+    glContext.vertexAttribPointer(
+      attribCornerLocation,
+      INSTANCE_TEMPLATE_COMPONENT_COUNT,
+      glContext.FLOAT,
+      false,
+      INSTANCE_TEMPLATE_COMPONENT_COUNT * FLOAT_SIZE,
+      0
+    );
+    glContext.bindBuffer(glContext.ARRAY_BUFFER, instanceBuffer);
+    for (const location of instanceAttribLocations) {
+      glContext.enableVertexAttribArray(location);
+      instancing.vertexAttribDivisor(location, 1);
+    }
+    currentBoundTexture = null;
+    active = true;
+  };
+
+  const drawRun = (
+    first: PreparedDrawSpriteImageParams<TTag>,
+    instanceCount: number
+  ): void => {
+    const texture = first.imageResource.texture;
+    if (!active || first.instanceBatchIndex === undefined || !texture) {
+      return;
+    }
+
+    const { screenToClip } = first;
+    if (
+      screenToClip.scaleX !== currentScaleX ||
+      screenToClip.scaleY !== currentScaleY ||
+      screenToClip.offsetX !== currentOffsetX ||
+      screenToClip.offsetY !== currentOffsetY
+    ) {
+      glContext.uniform2f(
+        uniformScreenToClipScaleLocation,
+        screenToClip.scaleX,
+        screenToClip.scaleY
+      );
+      glContext.uniform2f(
+        uniformScreenToClipOffsetLocation,
+        screenToClip.offsetX,
+        screenToClip.offsetY
+      );
+      currentScaleX = screenToClip.scaleX;
+      currentScaleY = screenToClip.scaleY;
+      currentOffsetX = screenToClip.offsetX;
+      currentOffsetY = screenToClip.offsetY;
+    }
+    if (currentBoundTexture !== texture) {
+      glContext.activeTexture(glContext.TEXTURE0);
+      glContext.bindTexture(glContext.TEXTURE_2D, texture);
+      currentBoundTexture = texture;
+    }
+
+    // WebGL1 has no base instance, so offset the attribute pointers instead.
+    const baseOffset = first.instanceBatchIndex * INSTANCE_STRIDE;
+    glContext.vertexAttribPointer(
+      attribCenterHalfSizeLocation,
+      4,
+      glContext.FLOAT,
+      false,
+      INSTANCE_STRIDE,
+      baseOffset + INSTANCE_CENTER_HALF_SIZE_OFFSET
+    );
+    glContext.vertexAttribPointer(
+      attribAnchorSinCosLocation,
+      4,
+      glContext.FLOAT,
+      false,
+      INSTANCE_STRIDE,
+      baseOffset + INSTANCE_ANCHOR_SIN_COS_OFFSET
+    );
+    glContext.vertexAttribPointer(
+      attribUvRectLocation,
+      4,
+      glContext.FLOAT,
+      false,
+      INSTANCE_STRIDE,
+      baseOffset + INSTANCE_UV_RECT_OFFSET
+    );
+    glContext.vertexAttribPointer(
+      attribOpacityLocation,
+      1,
+      glContext.FLOAT,
+      false,
+      INSTANCE_STRIDE,
+      baseOffset + INSTANCE_OPACITY_INDEX * FLOAT_SIZE
+    );
+    instancing.drawArraysInstanced(
+      glContext.TRIANGLES,
+      0,
+      QUAD_VERTEX_COUNT,
+      instanceCount
+    );
+  };
+
+  const end = (): void => {
+    if (!active) {
+      return;
+    }
+    // Divisors are context state: restore them for the other programs.
+    for (const location of instanceAttribLocations) {
+      instancing.vertexAttribDivisor(location, 0);
+      glContext.disableVertexAttribArray(location);
+    }
+    glContext.disableVertexAttribArray(attribCornerLocation);
+    active = false;
+  };
+
+  const release = (): void => {
+    end();
+    glContext.deleteBuffer(templateBuffer);
+    glContext.deleteBuffer(instanceBuffer);
+    glContext.deleteProgram(program);
+  };
+
+  return {
+    uploadInstanceBatch,
+    begin,
+    drawRun,
+    end,
+    release,
+  };
+};
+
 export interface BorderOutlineRenderer extends Releasable {
   begin(
     screenToClipScaleX: number,
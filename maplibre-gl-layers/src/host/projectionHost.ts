@@ -539,6 +539,26 @@ export const createProjectionHost = (
     };
   };
 
+  /**
+   * Project many locations.
+   * @param locations Locations.
+   * @returns Projected points.
+   */
+  const projectMany = (
+    locations: readonly Readonly<SpriteLocation>[]
+  ): (SpritePoint | undefined)[] =>
+    locations.map((location) => project(location));
+
+  /**
+   * Unproject many points.
+   * @param points Projected points.
+   * @returns Locations.
+   */
+  const unprojectMany = (
+    points: readonly Readonly<SpritePoint>[]
+  ): (SpriteLocation | undefined)[] =>
+    points.map((point) => unproject(point));
+
   /**
    * Calculate perspective ratio.
    * @param location Location.
@@ -582,6 +602,8 @@ export const createProjectionHost = (
     fromLngLat,
     project,
     unproject,
+    projectMany,
+    unprojectMany,
     calculatePerspectiveRatio,
     getCameraLocation,
     release,
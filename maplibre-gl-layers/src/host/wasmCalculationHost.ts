@@ -86,15 +86,27 @@ import {
   DEG2RAD,
 } from '../const';
 import {
+  ENABLE_EASING_TABLES,
+  ENABLE_FAST_MERCATOR_MATH,
+  ENABLE_FLOAT32_RESULT,
+  ENABLE_INSTANCE_OUTPUT,
+  ENABLE_SURFACE_STREAM,
   ENABLE_NDC_BIAS_SURFACE,
+  ENABLE_VERTEX_OUTPUT,
+  ENABLE_VIEWPORT_CULLING,
   USE_SHADER_BILLBOARD_GEOMETRY,
   USE_SHADER_SURFACE_GEOMETRY,
+  VIEWPORT_CULLING_GUARD_BAND_PIXELS,
 } from '../config';
 import {
   SPRITE_ORIGIN_REFERENCE_INDEX_NONE,
   SPRITE_ORIGIN_REFERENCE_KEY_NONE,
 } from '../internalTypes';
-import { QUAD_VERTEX_COUNT, VERTEX_COMPONENT_COUNT } from '../gl/shader';
+import {
+  INSTANCE_COMPONENT_COUNT,
+  QUAD_VERTEX_COUNT,
+  VERTEX_COMPONENT_COUNT,
+} from '../gl/shader';
 import { reportWasmRuntimeFailure } from './runtime';
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -111,7 +123,8 @@ const WASM_DEGREE_INTERPOLATION_ITEM_LENGTH = 11;
 const WASM_DEGREE_INTERPOLATION_RESULT_LENGTH = 4;
 const WASM_SPRITE_INTERPOLATION_ITEM_LENGTH = 14;
 const WASM_SPRITE_INTERPOLATION_RESULT_LENGTH = 6;
-const WASM_PROCESS_INTERPOLATIONS_HEADER_LENGTH = 3;
+const WASM_PROCESS_INTERPOLATIONS_HEADER_LENGTH = 4;
+const WASM_PROCESS_INTERPOLATIONS_FLAG_EASING_TABLES = 1 << 0;
 
 //////////////////////////////////////////////////////////////////////////////////////
 
@@ -366,7 +379,8 @@ const resolveDegreeInterpolationChannel = (
 const internalProcessInterpolationsCore = (
   wasm: WasmHost,
   requests: ProcessInterpolationPresetRequests,
-  timestamp: number
+  timestamp: number,
+  useEasingTables: boolean = ENABLE_EASING_TABLES
 ): WasmProcessInterpolationResults => {
   const distanceCount = requests.distance.length;
   const degreeCount = requests.degree.length;
@@ -403,6 +417,9 @@ const internalProcessInterpolationsCore = (
     paramsBuffer[0] = distanceCount;
     paramsBuffer[1] = degreeCount;
     paramsBuffer[2] = spriteCount;
+    paramsBuffer[3] = useEasingTables
+      ? WASM_PROCESS_INTERPOLATIONS_FLAG_EASING_TABLES
+      : 0;
     let cursor = WASM_PROCESS_INTERPOLATIONS_HEADER_LENGTH;
     for (const request of requests.distance) {
       cursor = encodeDistanceInterpolationRequest(
@@ -938,9 +955,32 @@ export const createWasmCalculateSurfaceDepthKey = (
  *
  * ## Result buffer layout (Float64Array)
  *
- * - Header (`RESULT_HEADER_LENGTH`): prepared count, stride, feature flags。
+ * - Header (`RESULT_HEADER_LENGTH`): prepared count, stride, feature flags, culled count。
  * - Item result (`RESULT_ITEM_STRIDE`): `spriteHandle`, `imageIndex`, `resourceIndex`,
  *   Screen-to-Clip, vertex attributes, hit-test corners, surface/billboard uniforms。
+ * - With `FLOAT32_ITEMS`, each item (`RESULT_FLOAT32_ITEM_STRIDE` doubles) holds the
+ *   same components as float32 (ids as int32). The absolute surface coordinates
+ *   (mercator center, lng/lat) are relative to the anchor in the result header.
+ * - With `SURFACE_STREAM`, items (`RESULT_STREAM_ITEM_STRIDE`) drop the surface block.
+ *   Surface records (`RESULT_SURFACE_RECORD_STRIDE`: item index, then the surface block)
+ *   follow the item table at the header's surface offset, in item order. Float32 records
+ *   store the index as int32 and pad to whole doubles. The buffer is sized for one record
+ *   per surface-mode item.
+ *
+ * ## Vertex output region (Float32Array)
+ *
+ * With `VERTEX_OUTPUT`, the input header points at a separate region that receives
+ * the interleaved vertices (`RESULT_VERTEX_COMPONENT_LENGTH` floats per item) of every
+ * prepared item in result order, ready to upload as the sprite vertex buffer. Items
+ * then drop their vertex block (`RESULT_*VERTEXLESS*` strides).
+ *
+ * ## Instance record region (Float32Array)
+ *
+ * With `INSTANCE_OUTPUT`, another region receives one record per prepared item
+ * (`RESULT_INSTANCE_RECORD_LENGTH` floats, result order): billboard center, half size,
+ * anchor, sin/cos, atlas UV rect, opacity, atlas page and a billboard flag. Records
+ * flagged as billboards are drawn instanced against a static corner template, so
+ * those items get no vertices (their vertex block is zero, their region slot unused).
  *
  * Since these struct definitions assume the same order in the Wasm side as well,
  * if you change any constants, you must simultaneously update the Wasm implementation.
@@ -955,9 +995,10 @@ const ITEM_STRIDE = 27;
 const INPUT_BASE_LENGTH =
   INPUT_HEADER_LENGTH + INPUT_FRAME_CONSTANT_LENGTH + INPUT_MATRIX_LENGTH;
 
-const RESULT_HEADER_LENGTH = 7;
+const RESULT_HEADER_LENGTH = 13;
 const RESULT_VERTEX_COMPONENT_LENGTH =
   QUAD_VERTEX_COUNT * VERTEX_COMPONENT_COUNT;
+const RESULT_INSTANCE_RECORD_LENGTH = INSTANCE_COMPONENT_COUNT;
 const RESULT_HIT_TEST_COMPONENT_LENGTH = 8; // 4 corners * 2 components
 const RESULT_SURFACE_CORNER_COMPONENT_LENGTH = 4 /* corners */ * 4; /* xyzw */
 const RESULT_SURFACE_CORNER_MODEL_COMPONENT_LENGTH = 4 /* corners */ * 4; // east,north,lng,lat
@@ -991,11 +1032,39 @@ const RESULT_ITEM_STRIDE =
   RESULT_VERTEX_COMPONENT_LENGTH +
   RESULT_HIT_TEST_COMPONENT_LENGTH +
   RESULT_SURFACE_BLOCK_LENGTH;
+const RESULT_FLOAT32_COMPONENT_LENGTH =
+  RESULT_COMMON_ITEM_LENGTH +
+  RESULT_VERTEX_COMPONENT_LENGTH +
+  RESULT_HIT_TEST_COMPONENT_LENGTH;
+const RESULT_FLOAT32_ITEM_STRIDE =
+  (RESULT_FLOAT32_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH) / 2;
+const RESULT_STREAM_ITEM_STRIDE = RESULT_FLOAT32_COMPONENT_LENGTH;
+const RESULT_FLOAT32_STREAM_ITEM_STRIDE = RESULT_FLOAT32_COMPONENT_LENGTH / 2;
+const RESULT_VERTEXLESS_COMPONENT_LENGTH =
+  RESULT_COMMON_ITEM_LENGTH + RESULT_HIT_TEST_COMPONENT_LENGTH;
+const RESULT_VERTEXLESS_ITEM_STRIDE =
+  RESULT_VERTEXLESS_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH;
+const RESULT_FLOAT32_VERTEXLESS_ITEM_STRIDE = RESULT_VERTEXLESS_ITEM_STRIDE / 2;
+const RESULT_VERTEXLESS_STREAM_ITEM_STRIDE = RESULT_VERTEXLESS_COMPONENT_LENGTH;
+const RESULT_FLOAT32_VERTEXLESS_STREAM_ITEM_STRIDE =
+  RESULT_VERTEXLESS_COMPONENT_LENGTH / 2;
+const RESULT_SURFACE_RECORD_STRIDE = 1 + RESULT_SURFACE_BLOCK_LENGTH;
+const RESULT_FLOAT32_SURFACE_RECORD_STRIDE =
+  (1 + RESULT_SURFACE_BLOCK_LENGTH + 1) / 2; // int32 index + block + pad
+
+/** Shared `vertexData` of items without vertices of their own. */
+const EMPTY_VERTEX_DATA = new Float32Array(0);
 
 const enum InputHeaderFlags {
   USE_SHADER_SURFACE_GEOMETRY = 1 << 0,
   USE_SHADER_BILLBOARD_GEOMETRY = 1 << 1,
   ENABLE_NDC_BIAS_SURFACE = 1 << 2,
+  ENABLE_VIEWPORT_CULLING = 1 << 3,
+  FAST_MERCATOR_MATH = 1 << 4,
+  FLOAT32_RESULT = 1 << 5,
+  VERTEX_OUTPUT = 1 << 6,
+  INSTANCE_OUTPUT = 1 << 7,
+  SURFACE_STREAM = 1 << 8,
 }
 
 const enum InputHeaderIndex {
@@ -1009,11 +1078,11 @@ const enum InputHeaderIndex {
   ITEM_COUNT = 7,
   ITEM_OFFSET = 8,
   FLAGS = 9,
-  RESERVED0 = 10,
-  RESERVED1 = 11,
-  RESERVED2 = 12,
-  RESERVED3 = 13,
-  RESERVED4 = 14,
+  CULL_GUARD_BAND_PIXELS = 10,
+  VERTEX_OUTPUT_PTR = 11,
+  VERTEX_OUTPUT_CAPACITY = 12,
+  INSTANCE_OUTPUT_PTR = 13,
+  INSTANCE_OUTPUT_CAPACITY = 14,
 }
 
 const enum ResultHeaderIndex {
@@ -1022,13 +1091,23 @@ const enum ResultHeaderIndex {
   VERTEX_COMPONENT_COUNT = 2,
   SURFACE_CORNER_COUNT = 3,
   FLAGS = 4,
-  RESERVED0 = 5,
-  RESERVED1 = 6,
+  CULLED_COUNT = 5,
+  ANCHOR_MERCATOR_X = 6,
+  ANCHOR_MERCATOR_Y = 7,
+  ANCHOR_LNG = 8,
+  ANCHOR_LAT = 9,
+  SURFACE_COUNT = 10,
+  SURFACE_OFFSET = 11,
+  SURFACE_STRIDE = 12,
 }
 
 const enum ResultHeaderFlags {
   HAS_HIT_TEST = 1 << 0,
   HAS_SURFACE_INPUTS = 1 << 1,
+  FLOAT32_ITEMS = 1 << 2,
+  VERTEX_OUTPUT = 1 << 3,
+  INSTANCE_OUTPUT = 1 << 4,
+  SURFACE_STREAM = 1 << 5,
 }
 
 const toFiniteOr = (value: number | undefined, fallback: number): number =>
@@ -1049,8 +1128,94 @@ const computeInputElementCount = (
   return INPUT_BASE_LENGTH + resourceLength + spriteLength + itemLength;
 };
 
-const computeResultElementCount = (itemCount: number): number =>
-  RESULT_HEADER_LENGTH + itemCount * RESULT_ITEM_STRIDE;
+/**
+ * Result buffer length for `itemCount` items, of which `surfaceItemCount` are
+ * surfaces. Only surfaces can produce a surface stream record. With
+ * `vertexOutput` the caller must also hand wasm a vertex region for every item.
+ */
+const computeResultElementCount = (
+  itemCount: number,
+  surfaceItemCount: number,
+  surfaceStream = ENABLE_SURFACE_STREAM,
+  float32Result = ENABLE_FLOAT32_RESULT,
+  vertexOutput = ENABLE_VERTEX_OUTPUT
+): number => {
+  if (surfaceStream) {
+    const itemStride = vertexOutput
+      ? float32Result
+        ? RESULT_FLOAT32_VERTEXLESS_STREAM_ITEM_STRIDE
+        : RESULT_VERTEXLESS_STREAM_ITEM_STRIDE
+      : float32Result
+        ? RESULT_FLOAT32_STREAM_ITEM_STRIDE
+        : RESULT_STREAM_ITEM_STRIDE;
+    const recordStride = float32Result
+      ? RESULT_FLOAT32_SURFACE_RECORD_STRIDE
+      : RESULT_SURFACE_RECORD_STRIDE;
+    return (
+      RESULT_HEADER_LENGTH +
+      itemCount * itemStride +
+      surfaceItemCount * recordStride
+    );
+  }
+  const itemStride = vertexOutput
+    ? float32Result
+      ? RESULT_FLOAT32_VERTEXLESS_ITEM_STRIDE
+      : RESULT_VERTEXLESS_ITEM_STRIDE
+    : float32Result
+      ? RESULT_FLOAT32_ITEM_STRIDE
+      : RESULT_ITEM_STRIDE;
+  return RESULT_HEADER_LENGTH + itemCount * itemStride;
+};
+
+/**
+ * Creates the surface stream lookup of a result buffer. Records are in item
+ * order, so the returned function walks them alongside ascending item
+ * indices (skipping records of items that were never asked for) and returns
+ * the component index of the item's surface block, or -1 without a record.
+ * @param buffer Result buffer.
+ * @param componentScale Components per double (2 for float32 items).
+ * @param readId Reads an id component (item index) at a component index.
+ */
+const createStreamSurfaceResolver = (
+  buffer: Float64Array,
+  componentScale: number,
+  readId: (index: number) => number
+): ((itemIndex: number) => number) => {
+  let surfaceRecordCount = Math.max(
+    0,
+    Math.trunc(buffer[ResultHeaderIndex.SURFACE_COUNT] ?? 0)
+  );
+  const surfaceRecordOffset = Math.trunc(
+    buffer[ResultHeaderIndex.SURFACE_OFFSET] ?? 0
+  );
+  const surfaceRecordStride = Math.trunc(
+    buffer[ResultHeaderIndex.SURFACE_STRIDE] ?? 0
+  );
+  if (
+    surfaceRecordStride <= 0 ||
+    buffer.length <
+      surfaceRecordOffset + surfaceRecordCount * surfaceRecordStride
+  ) {
+    surfaceRecordCount = 0;
+  }
+  let surfaceRecordIndex = 0;
+  return (itemIndex: number): number => {
+    while (surfaceRecordIndex < surfaceRecordCount) {
+      const recordBase =
+        (surfaceRecordOffset + surfaceRecordIndex * surfaceRecordStride) *
+        componentScale;
+      const recordItemIndex = readId(recordBase);
+      if (recordItemIndex > itemIndex) {
+        break;
+      }
+      surfaceRecordIndex++;
+      if (recordItemIndex === itemIndex) {
+        return recordBase + 1;
+      }
+    }
+    return -1;
+  };
+};
 
 const ensureHitTestCorners = (
   imageEntry: InternalSpriteImageState
@@ -1074,6 +1239,8 @@ const ensureHitTestCorners = (
 interface PreparedInputBuffer extends Releasable {
   readonly parameterHolder: BufferHolder<Float64Array>;
   readonly resultItemCount: number;
+  /** Items encoded in surface mode. */
+  readonly surfaceItemCount: number;
 }
 
 interface WritableWasmProjectionState<TTag> {
@@ -1087,6 +1254,14 @@ interface WritableWasmProjectionState<TTag> {
   ) => PreparedInputBuffer;
   readonly getImageRefs: () => readonly InternalSpriteImageState[];
   readonly getResourceRefs: () => readonly (RegisteredImage | undefined)[];
+  /** Vertex output region of the latest prepare, kept until the next one. */
+  vertexOutput: BufferHolder<Float32Array> | undefined;
+  /** Float count written to `vertexOutput` by the latest prepare. */
+  vertexOutputLength: number;
+  /** Instance record region of the latest prepare, kept until the next one. */
+  instanceOutput: BufferHolder<Float32Array> | undefined;
+  /** Float count written to `instanceOutput` by the latest prepare. */
+  instanceOutputLength: number;
 }
 
 /**
@@ -1098,8 +1273,17 @@ export interface WasmCalculationInteropDependencies<TTag> {
   readonly imageHandleBuffersController: ImageHandleBufferController;
   readonly originReference: SpriteOriginReference;
   readonly spriteIdHandler: IdHandler<InternalSpriteCurrentState<TTag>>;
+  /**
+   * Whether the renderer draws shader billboards from instance records. Unless it
+   * is false, `ENABLE_INSTANCE_OUTPUT` lets wasm skip their vertices.
+   */
+  readonly instancedBillboards?: boolean;
 }
 
+const isInstanceOutputEnabled = <TTag>(
+  deps: WasmCalculationInteropDependencies<TTag>
+): boolean => ENABLE_INSTANCE_OUTPUT && deps.instancedBillboards !== false;
+
 /**
  * Create prepared image parameters from wasm calculation.
  * @param inputBuffer Input buffer
@@ -1125,6 +1309,16 @@ const converToPreparedDrawImageParams = <TTag>(
   const flags = Math.trunc(buffer[ResultHeaderIndex.FLAGS] ?? 0);
   const hasHitTest = (flags & ResultHeaderFlags.HAS_HIT_TEST) !== 0;
   const hasSurfaceInputs = (flags & ResultHeaderFlags.HAS_SURFACE_INPUTS) !== 0;
+  const float32Items = (flags & ResultHeaderFlags.FLOAT32_ITEMS) !== 0;
+  const hasVertexOutput = (flags & ResultHeaderFlags.VERTEX_OUTPUT) !== 0;
+  state.vertexOutputLength = hasVertexOutput
+    ? preparedCount * RESULT_VERTEX_COMPONENT_LENGTH
+    : 0;
+  const hasInstanceOutput = (flags & ResultHeaderFlags.INSTANCE_OUTPUT) !== 0;
+  const surfaceStream = (flags & ResultHeaderFlags.SURFACE_STREAM) !== 0;
+  state.instanceOutputLength = hasInstanceOutput
+    ? preparedCount * RESULT_INSTANCE_RECORD_LENGTH
+    : 0;
 
   if (
     itemStride <= 0 ||
@@ -1133,6 +1327,29 @@ const converToPreparedDrawImageParams = <TTag>(
     return [];
   }
 
+  // Float32 items keep their components in float32 (ids in int32);
+  // `components` indexes them in either format. Their absolute surface
+  // coordinates are relative to the header anchor, which is zero otherwise.
+  const components: Float32Array | Float64Array = float32Items
+    ? new Float32Array(buffer.buffer, buffer.byteOffset, buffer.length * 2)
+    : buffer;
+  const ids = float32Items
+    ? new Int32Array(buffer.buffer, buffer.byteOffset, buffer.length * 2)
+    : undefined;
+  const componentScale = float32Items ? 2 : 1;
+  const readAnchor = (index: ResultHeaderIndex): number =>
+    float32Items ? (buffer[index] ?? 0) : 0;
+  const anchorMercatorX = readAnchor(ResultHeaderIndex.ANCHOR_MERCATOR_X);
+  const anchorMercatorY = readAnchor(ResultHeaderIndex.ANCHOR_MERCATOR_Y);
+  const anchorLng = readAnchor(ResultHeaderIndex.ANCHOR_LNG);
+  const anchorLat = readAnchor(ResultHeaderIndex.ANCHOR_LAT);
+  const readId = (index: number): number =>
+    ids ? (ids[index] ?? -1) : Math.trunc(buffer[index] ?? -1);
+
+  const resolveStreamSurfaceStart = surfaceStream
+    ? createStreamSurfaceResolver(buffer, componentScale, readId)
+    : undefined;
+
   const { spriteIdHandler } = deps;
   const imageRefs = state.getImageRefs();
   const resourceRefs = state.getResourceRefs();
@@ -1240,11 +1457,12 @@ const converToPreparedDrawImageParams = <TTag>(
 
   for (let itemIndex = 0; itemIndex < preparedCount; itemIndex++) {
     const base = RESULT_HEADER_LENGTH + itemIndex * itemStride;
-    let cursor = base;
+    const componentBase = base * componentScale;
+    let cursor = componentBase;
 
-    const spriteHandle = Math.trunc(buffer[cursor++] ?? -1);
-    const imageIndex = Math.trunc(buffer[cursor++] ?? -1);
-    const resourceIndex = Math.trunc(buffer[cursor++] ?? -1);
+    const spriteHandle = readId(cursor++);
+    const imageIndex = readId(cursor++);
+    const resourceIndex = readId(cursor++);
 
     const spriteEntry =
       spriteHandle >= 0 ? spriteIdHandler.get(spriteHandle) : undefined;
@@ -1254,57 +1472,64 @@ const converToPreparedDrawImageParams = <TTag>(
       continue;
     }
 
-    const opacity = buffer[cursor++] ?? 0;
+    const opacity = components[cursor++] ?? 0;
     const screenToClip = {
-      scaleX: buffer[cursor++] ?? 0,
-      scaleY: buffer[cursor++] ?? 0,
-      offsetX: buffer[cursor++] ?? 0,
-      offsetY: buffer[cursor++] ?? 0,
+      scaleX: components[cursor++] ?? 0,
+      scaleY: components[cursor++] ?? 0,
+      offsetX: components[cursor++] ?? 0,
+      offsetY: components[cursor++] ?? 0,
     };
-    const useShaderSurface = (buffer[cursor++] ?? 0) !== 0;
-    const surfaceClipEnabled = (buffer[cursor++] ?? 0) !== 0;
-    const useShaderBillboard = (buffer[cursor++] ?? 0) !== 0;
+    const useShaderSurface = (components[cursor++] ?? 0) !== 0;
+    const surfaceClipEnabled = (components[cursor++] ?? 0) !== 0;
+    const useShaderBillboard = (components[cursor++] ?? 0) !== 0;
 
     const billboardCenter: SpritePoint = {
-      x: buffer[cursor++] ?? 0,
-      y: buffer[cursor++] ?? 0,
+      x: components[cursor++] ?? 0,
+      y: components[cursor++] ?? 0,
     };
-    const halfWidth = buffer[cursor++] ?? 0;
-    const halfHeight = buffer[cursor++] ?? 0;
+    const halfWidth = components[cursor++] ?? 0;
+    const halfHeight = components[cursor++] ?? 0;
     const billboardAnchor: SpriteAnchor = {
-      x: buffer[cursor++] ?? 0,
-      y: buffer[cursor++] ?? 0,
+      x: components[cursor++] ?? 0,
+      y: components[cursor++] ?? 0,
     };
-    const billboardSin = buffer[cursor++] ?? 0;
-    const billboardCos = buffer[cursor++] ?? 0;
-    const cameraDistance = buffer[cursor++] ?? Number.POSITIVE_INFINITY;
-
-    const vertexStart = base + RESULT_COMMON_ITEM_LENGTH;
-    const vertexEnd = vertexStart + RESULT_VERTEX_COMPONENT_LENGTH;
+    const billboardSin = components[cursor++] ?? 0;
+    const billboardCos = components[cursor++] ?? 0;
+    const cameraDistance = components[cursor++] ?? Number.POSITIVE_INFINITY;
+
+    // Items written with a vertex region carry no vertex block, and instanced
+    // billboards get no vertices at all.
+    const instanced = hasInstanceOutput && useShaderBillboard;
+    const vertexStart = componentBase + RESULT_COMMON_ITEM_LENGTH;
+    const vertexEnd = hasVertexOutput
+      ? vertexStart
+      : vertexStart + RESULT_VERTEX_COMPONENT_LENGTH;
     const hitTestStart = vertexEnd;
     const hitTestEnd = hitTestStart + RESULT_HIT_TEST_COMPONENT_LENGTH;
-    const surfaceStart = hitTestEnd;
+    const surfaceStart = resolveStreamSurfaceStart
+      ? resolveStreamSurfaceStart(itemIndex)
+      : hitTestEnd;
 
-    if (vertexEnd > buffer.length) {
+    if (vertexEnd > components.length) {
       break;
     }
 
-    const vertexSlice = buffer.subarray(vertexStart, vertexEnd);
-    const vertexData = new Float32Array(RESULT_VERTEX_COMPONENT_LENGTH);
-    for (let i = 0; i < vertexSlice.length; i++) {
-      vertexData[i] = vertexSlice[i] ?? 0;
-    }
+    // Float32Array conversion narrows double items; float32 items copy as is.
+    const vertexData =
+      hasVertexOutput || instanced
+        ? EMPTY_VERTEX_DATA
+        : new Float32Array(components.subarray(vertexStart, vertexEnd));
 
     let hitTestCorners: PreparedDrawSpriteImageParams<TTag>['hitTestCorners'] =
       null;
     if (hasHitTest) {
-      if (hitTestEnd > buffer.length) {
+      if (hitTestEnd > components.length) {
         break;
       }
       const corners = ensureHitTestCorners(imageEntry);
       for (let i = 0; i < 4; i++) {
-        const x = buffer[hitTestStart + i * 2] ?? 0;
-        const y = buffer[hitTestStart + i * 2 + 1] ?? 0;
+        const x = components[hitTestStart + i * 2] ?? 0;
+        const y = components[hitTestStart + i * 2 + 1] ?? 0;
         corners[i]!.x = x;
         corners[i]!.y = y;
       }
@@ -1312,57 +1537,57 @@ const converToPreparedDrawImageParams = <TTag>(
     }
 
     let surfaceShaderInputs: SurfaceShaderInputs | undefined;
-    if (useShaderSurface && hasSurfaceInputs) {
-      if (surfaceStart + RESULT_SURFACE_BLOCK_LENGTH > buffer.length) {
+    if (useShaderSurface && hasSurfaceInputs && surfaceStart >= 0) {
+      if (surfaceStart + RESULT_SURFACE_BLOCK_LENGTH > components.length) {
         break;
       }
       let surfaceCursor = surfaceStart;
       const mercatorCenter = {
-        x: buffer[surfaceCursor++] ?? 0,
-        y: buffer[surfaceCursor++] ?? 0,
-        z: buffer[surfaceCursor++] ?? 0,
+        x: (components[surfaceCursor++] ?? 0) + anchorMercatorX,
+        y: (components[surfaceCursor++] ?? 0) + anchorMercatorY,
+        z: components[surfaceCursor++] ?? 0,
       };
       const worldToMercatorScale: SurfaceCorner = {
-        east: buffer[surfaceCursor++] ?? 0,
-        north: buffer[surfaceCursor++] ?? 0,
+        east: components[surfaceCursor++] ?? 0,
+        north: components[surfaceCursor++] ?? 0,
       };
       const halfSizeMeters: SurfaceCorner = {
-        east: buffer[surfaceCursor++] ?? 0,
-        north: buffer[surfaceCursor++] ?? 0,
+        east: components[surfaceCursor++] ?? 0,
+        north: components[surfaceCursor++] ?? 0,
       };
       const surfaceAnchor: SpriteAnchor = {
-        x: buffer[surfaceCursor++] ?? 0,
-        y: buffer[surfaceCursor++] ?? 0,
+        x: components[surfaceCursor++] ?? 0,
+        y: components[surfaceCursor++] ?? 0,
       };
       const offsetMeters: SurfaceCorner = {
-        east: buffer[surfaceCursor++] ?? 0,
-        north: buffer[surfaceCursor++] ?? 0,
+        east: components[surfaceCursor++] ?? 0,
+        north: components[surfaceCursor++] ?? 0,
       };
-      const sin = buffer[surfaceCursor++] ?? 0;
-      const cos = buffer[surfaceCursor++] ?? 0;
-      const totalRotateDeg = buffer[surfaceCursor++] ?? 0;
-      const depthBiasNdc = buffer[surfaceCursor++] ?? 0;
+      const sin = components[surfaceCursor++] ?? 0;
+      const cos = components[surfaceCursor++] ?? 0;
+      const totalRotateDeg = components[surfaceCursor++] ?? 0;
+      const depthBiasNdc = components[surfaceCursor++] ?? 0;
       const centerDisplacement: SurfaceCorner = {
-        east: buffer[surfaceCursor++] ?? 0,
-        north: buffer[surfaceCursor++] ?? 0,
+        east: components[surfaceCursor++] ?? 0,
+        north: components[surfaceCursor++] ?? 0,
       };
       const clipCenter = {
-        x: buffer[surfaceCursor++] ?? 0,
-        y: buffer[surfaceCursor++] ?? 0,
-        z: buffer[surfaceCursor++] ?? 0,
-        w: buffer[surfaceCursor++] ?? 0,
+        x: components[surfaceCursor++] ?? 0,
+        y: components[surfaceCursor++] ?? 0,
+        z: components[surfaceCursor++] ?? 0,
+        w: components[surfaceCursor++] ?? 0,
       };
       const clipBasisEast = {
-        x: buffer[surfaceCursor++] ?? 0,
-        y: buffer[surfaceCursor++] ?? 0,
-        z: buffer[surfaceCursor++] ?? 0,
-        w: buffer[surfaceCursor++] ?? 0,
+        x: components[surfaceCursor++] ?? 0,
+        y: components[surfaceCursor++] ?? 0,
+        z: components[surfaceCursor++] ?? 0,
+        w: components[surfaceCursor++] ?? 0,
       };
       const clipBasisNorth = {
-        x: buffer[surfaceCursor++] ?? 0,
-        y: buffer[surfaceCursor++] ?? 0,
-        z: buffer[surfaceCursor++] ?? 0,
-        w: buffer[surfaceCursor++] ?? 0,
+        x: components[surfaceCursor++] ?? 0,
+        y: components[surfaceCursor++] ?? 0,
+        z: components[surfaceCursor++] ?? 0,
+        w: components[surfaceCursor++] ?? 0,
       };
       const clipCorners: Array<{
         readonly x: number;
@@ -1372,31 +1597,31 @@ const converToPreparedDrawImageParams = <TTag>(
       }> = [];
       for (let i = 0; i < 4; i++) {
         clipCorners.push({
-          x: buffer[surfaceCursor++] ?? 0,
-          y: buffer[surfaceCursor++] ?? 0,
-          z: buffer[surfaceCursor++] ?? 0,
-          w: buffer[surfaceCursor++] ?? 0,
+          x: components[surfaceCursor++] ?? 0,
+          y: components[surfaceCursor++] ?? 0,
+          z: components[surfaceCursor++] ?? 0,
+          w: components[surfaceCursor++] ?? 0,
         });
       }
       const baseLngLat: SpriteLocation = {
-        lng: buffer[surfaceCursor++] ?? 0,
-        lat: buffer[surfaceCursor++] ?? 0,
-        z: buffer[surfaceCursor++] ?? 0,
+        lng: (components[surfaceCursor++] ?? 0) + anchorLng,
+        lat: (components[surfaceCursor++] ?? 0) + anchorLat,
+        z: components[surfaceCursor++] ?? 0,
       };
       const displacedCenter: SpriteLocation = {
-        lng: buffer[surfaceCursor++] ?? 0,
-        lat: buffer[surfaceCursor++] ?? 0,
-        z: buffer[surfaceCursor++] ?? 0,
+        lng: (components[surfaceCursor++] ?? 0) + anchorLng,
+        lat: (components[surfaceCursor++] ?? 0) + anchorLat,
+        z: components[surfaceCursor++] ?? 0,
       };
-      const scaleAdjustment = buffer[surfaceCursor++] ?? 0;
+      const scaleAdjustment = components[surfaceCursor++] ?? 0;
 
       const corners: SurfaceShaderCornerState[] = [];
       for (let i = 0; i < 4; i++) {
         corners.push({
-          east: buffer[surfaceCursor++] ?? 0,
-          north: buffer[surfaceCursor++] ?? 0,
-          lng: buffer[surfaceCursor++] ?? 0,
-          lat: buffer[surfaceCursor++] ?? 0,
+          east: components[surfaceCursor++] ?? 0,
+          north: components[surfaceCursor++] ?? 0,
+          lng: (components[surfaceCursor++] ?? 0) + anchorLng,
+          lat: (components[surfaceCursor++] ?? 0) + anchorLat,
         });
       }
 
@@ -1504,12 +1729,36 @@ const converToPreparedDrawImageParams = <TTag>(
       surfaceClipEnabled,
       useShaderBillboard,
       billboardUniforms,
+      vertexBatchOffset:
+        hasVertexOutput && !instanced
+          ? itemIndex * QUAD_VERTEX_COUNT
+          : undefined,
+      instanceBatchIndex: instanced ? itemIndex : undefined,
     });
   }
 
   return items;
 };
 
+/**
+ * Reserve a float32 output region, reusing the current one when it is large enough.
+ * @param wasm Wasm host.
+ * @param region Region reserved by the previous prepare.
+ * @param requiredLength Required float count.
+ * @returns Output region to hand to wasm.
+ */
+const ensureOutputRegion = (
+  wasm: WasmHost,
+  region: BufferHolder<Float32Array> | undefined,
+  requiredLength: number
+): BufferHolder<Float32Array> => {
+  if (region && region.length >= requiredLength) {
+    return region;
+  }
+  region?.release();
+  return wasm.allocateTypedBuffer(Float32Array, requiredLength);
+};
+
 /**
  * Invoke `prepareDrawSpriteImages` wasm entry point. Marshals both input parameters and output results.
  * @param wasm Wasm host.
@@ -1529,17 +1778,57 @@ const prepareDrawSpriteImagesInternal = <TTag>(
   try {
     // Construct wasm result buffer
     const resultElementCount = computeResultElementCount(
-      inputBuffer.resultItemCount
+      inputBuffer.resultItemCount,
+      inputBuffer.surfaceItemCount
     );
     const resultBuffer = wasm.allocateTypedBuffer(
       Float64Array,
       resultElementCount
     );
+    const resultItemCount = inputBuffer.resultItemCount;
+    if (ENABLE_VERTEX_OUTPUT && resultItemCount > 0) {
+      wasmState.vertexOutput = ensureOutputRegion(
+        wasm,
+        wasmState.vertexOutput,
+        resultItemCount * RESULT_VERTEX_COMPONENT_LENGTH
+      );
+    }
+    const instanceOutputEnabled = isInstanceOutputEnabled(deps);
+    if (instanceOutputEnabled && resultItemCount > 0) {
+      wasmState.instanceOutput = ensureOutputRegion(
+        wasm,
+        wasmState.instanceOutput,
+        resultItemCount * RESULT_INSTANCE_RECORD_LENGTH
+      );
+    }
+    const vertexOutput = ENABLE_VERTEX_OUTPUT
+      ? wasmState.vertexOutput
+      : undefined;
+    const instanceOutput = instanceOutputEnabled
+      ? wasmState.instanceOutput
+      : undefined;
+    wasmState.vertexOutputLength = 0;
+    wasmState.instanceOutputLength = 0;
 
     try {
       // Get the pointers of parameters.
-      const { ptr: paramsPtr } = inputBuffer.parameterHolder.prepare();
+      const { ptr: paramsPtr, buffer: paramsBuffer } =
+        inputBuffer.parameterHolder.prepare();
       const { ptr: resultPtr } = resultBuffer.prepare();
+      if (vertexOutput) {
+        const { ptr: vertexOutputPtr, buffer: vertexOutputBuffer } =
+          vertexOutput.prepare();
+        paramsBuffer[InputHeaderIndex.VERTEX_OUTPUT_PTR] = vertexOutputPtr;
+        paramsBuffer[InputHeaderIndex.VERTEX_OUTPUT_CAPACITY] =
+          vertexOutputBuffer.length;
+      }
+      if (instanceOutput) {
+        const { ptr: instanceOutputPtr, buffer: instanceOutputBuffer } =
+          instanceOutput.prepare();
+        paramsBuffer[InputHeaderIndex.INSTANCE_OUTPUT_PTR] = instanceOutputPtr;
+        paramsBuffer[InputHeaderIndex.INSTANCE_OUTPUT_CAPACITY] =
+          instanceOutputBuffer.length;
+      }
 
       // Invoke wasm entry point.
       const success = wasm.prepareDrawSpriteImages(paramsPtr, resultPtr);
@@ -1651,6 +1940,24 @@ const convertToWasmProjectionState = <TTag>(
     if (ENABLE_NDC_BIAS_SURFACE) {
       inputFlags |= InputHeaderFlags.ENABLE_NDC_BIAS_SURFACE;
     }
+    if (ENABLE_VIEWPORT_CULLING) {
+      inputFlags |= InputHeaderFlags.ENABLE_VIEWPORT_CULLING;
+    }
+    if (ENABLE_FAST_MERCATOR_MATH) {
+      inputFlags |= InputHeaderFlags.FAST_MERCATOR_MATH;
+    }
+    if (ENABLE_FLOAT32_RESULT) {
+      inputFlags |= InputHeaderFlags.FLOAT32_RESULT;
+    }
+    if (ENABLE_VERTEX_OUTPUT) {
+      inputFlags |= InputHeaderFlags.VERTEX_OUTPUT;
+    }
+    if (isInstanceOutputEnabled(deps)) {
+      inputFlags |= InputHeaderFlags.INSTANCE_OUTPUT;
+    }
+    if (ENABLE_SURFACE_STREAM) {
+      inputFlags |= InputHeaderFlags.SURFACE_STREAM;
+    }
 
     parameterBuffer[InputHeaderIndex.TOTAL_LENGTH] = requiredElements;
     parameterBuffer[InputHeaderIndex.FRAME_CONST_COUNT] =
@@ -1663,6 +1970,8 @@ const convertToWasmProjectionState = <TTag>(
     parameterBuffer[InputHeaderIndex.ITEM_COUNT] = resultItemCount;
     parameterBuffer[InputHeaderIndex.ITEM_OFFSET] = itemOffset;
     parameterBuffer[InputHeaderIndex.FLAGS] = inputFlags;
+    parameterBuffer[InputHeaderIndex.CULL_GUARD_BAND_PIXELS] =
+      VIEWPORT_CULLING_GUARD_BAND_PIXELS;
 
     const zoomScaleFactor = 1;
     const spriteMinPixel = 0;
@@ -1783,6 +2092,7 @@ const convertToWasmProjectionState = <TTag>(
       callParams.bucketBuffers?.originTargetIndices ?? null;
 
     cursor = itemOffset;
+    let surfaceItemCount = 0;
     bucket.forEach(([sprite, image], index) => {
       const imageHandle = image.imageHandle;
       const spriteHandle = sprite.handle;
@@ -1819,6 +2129,9 @@ const convertToWasmProjectionState = <TTag>(
         originLocation?.useResolvedAnchor ?? false
       );
       parameterBuffer[cursor++] = modeToNumber(image.mode);
+      if (image.mode === 'surface') {
+        surfaceItemCount++;
+      }
       parameterBuffer[cursor++] = scaledImageScale;
       parameterBuffer[cursor++] = image.finalOpacity.current;
       const anchor = image.anchor ?? { x: 0, y: 0 };
@@ -1856,6 +2169,7 @@ const convertToWasmProjectionState = <TTag>(
     return {
       parameterHolder,
       resultItemCount,
+      surfaceItemCount,
       release: () => parameterHolder.release(),
     };
   };
@@ -1866,6 +2180,10 @@ const convertToWasmProjectionState = <TTag>(
     prepareInputBuffer,
     getImageRefs: () => imageRefs,
     getResourceRefs: () => resourceRefs,
+    vertexOutput: undefined,
+    vertexOutputLength: 0,
+    instanceOutput: undefined,
+    instanceOutputLength: 0,
   };
 
   return state;
@@ -1956,15 +2274,37 @@ export const createWasmCalculationHost = <TTag>(
           syncPreparedOpacities(preparedItems);
           const visiblePreparedItems =
             filterVisiblePreparedItems(preparedItems);
+          const vertexOutput = wasmState.vertexOutput;
+          const vertexOutputLength = wasmState.vertexOutputLength;
+          const instanceOutput = wasmState.instanceOutput;
+          const instanceOutputLength = wasmState.instanceOutputLength;
           return {
             interpolationResult,
             preparedItems: visiblePreparedItems,
+            vertexBatch:
+              vertexOutput && vertexOutputLength > 0
+                ? () =>
+                    vertexOutput
+                      .prepare()
+                      .buffer.subarray(0, vertexOutputLength)
+                : undefined,
+            instanceBatch:
+              instanceOutput && instanceOutputLength > 0
+                ? () =>
+                    instanceOutput
+                      .prepare()
+                      .buffer.subarray(0, instanceOutputLength)
+                : undefined,
           };
         },
         () => ensureFallbackHost().processDrawSpriteImages(params)
       ),
     release: () => {
       releaseFallbackHost();
+      wasmState.vertexOutput?.release();
+      wasmState.vertexOutput = undefined;
+      wasmState.instanceOutput?.release();
+      wasmState.instanceOutput = undefined;
     },
   };
 };
@@ -1975,6 +2315,8 @@ export const createWasmCalculationHost = <TTag>(
 export const __wasmCalculationTestInternals = {
   convertToWasmProjectionState,
   converToPreparedDrawImageParams,
+  computeResultElementCount,
+  createStreamSurfaceResolver,
   prepareDrawSpriteImagesInternal,
   internalProcessInterpolationsCore,
   internalProcessInterpolations,
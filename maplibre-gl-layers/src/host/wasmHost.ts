@@ -49,6 +49,35 @@ export type WasmUnproject = (
   outPtr: number
 ) => boolean;
 
+/**
+ * `projectMany`/`unprojectMany` flag: use the approximated (polynomial)
+ * mercator conversion.
+ */
+export const WASM_BATCH_FLAG_FAST_MERCATOR_MATH = 1 << 0;
+
+/**
+ * `projectMany` function parameter.
+ * Reads `count` points of `stride` doubles (lng, lat, altitude), writes
+ * `count` x/y pairs (NaN when rejected) and `ceil(count / 32)` validity
+ * mask words. `flags` takes `WASM_BATCH_FLAG_*` bits.
+ */
+export type WasmProjectMany = (
+  inputPtr: number,
+  count: number,
+  stride: number,
+  worldSize: number,
+  matrixPtr: number,
+  outPtr: number,
+  validMaskPtr: number,
+  flags: number
+) => boolean;
+
+/**
+ * `unprojectMany` function parameter.
+ * Same layout as `projectMany` with x, y input and lng/lat output.
+ */
+export type WasmUnprojectMany = WasmProjectMany;
+
 /**
  * `calculatePerspectiveRatio` function parameter
  */
@@ -99,11 +128,95 @@ export type WasmPrepareDrawSpriteImages = (
   resultPtr: number
 ) => boolean;
 
+/**
+ * prepareDrawSpriteImages that also evaluates sprite location interpolations
+ * inside the projection pass.
+ * Layout is described at `prepareInterpolatedSpriteImages` in
+ * wasm/calculation_host.cpp.
+ */
+export type WasmPrepareInterpolatedSpriteImages = (
+  paramsPtr: number,
+  interpolationParamsPtr: number,
+  interpolationResultPtr: number,
+  resultPtr: number
+) => boolean;
+
 export type WasmProcessInterpolations = (
   paramsPtr: number,
   resultPtr: number
 ) => boolean;
 
+export type WasmResidentBatch = (paramsPtr: number) => boolean;
+
+/**
+ * Sorts packed depth keys and writes the sorted indices.
+ * Layout is described at `sortDepthKeys` in wasm/calculation_host.cpp.
+ */
+export type WasmSortDepthKeys = (
+  paramsPtr: number,
+  resultPtr: number
+) => boolean;
+
+/**
+ * Frame-to-frame depth sort used by prepareDrawSpriteImages when enabled.
+ */
+export interface WasmTemporalDepthSort {
+  /** Enables or disables the mode; either way clears history and counters. */
+  readonly setEnabled: (enabled: boolean) => void;
+  /**
+   * Writes 6 counters: frames, fastPathHits, inversionFallbacks, coldFrames,
+   * lastMoves, lastFreshItems.
+   */
+  readonly getStats: (resultPtr: number) => boolean;
+}
+
+/**
+ * Writes 7 per-frame arena counters: frames, slabCount, reservedBytes,
+ * highWaterBytes, lastFrameBytes, peakFrameBytes, blockAllocations.
+ * Useful for sizing WASM_PTHREAD_MEMORY_MB.
+ */
+export type WasmGetFrameArenaStats = (resultPtr: number) => boolean;
+
+/**
+ * Entry points of the module-resident sprite store.
+ * Batch layouts are described in wasm/sprite_store.h.
+ */
+export interface WasmResidentSpriteStore {
+  readonly upsertResources: WasmResidentBatch;
+  readonly upsertSprites: WasmResidentBatch;
+  readonly removeSprites: WasmResidentBatch;
+  readonly upsertImages: WasmResidentBatch;
+  readonly removeImages: WasmResidentBatch;
+  readonly patchImages: WasmResidentBatch;
+  readonly clear: () => void;
+  readonly getImageCount: () => number;
+  /** Prepares the stored images, taking only frame constants and matrices. */
+  readonly prepare: WasmPrepareDrawSpriteImages;
+}
+
+/**
+ * Advances the resident interpolations and writes the finished keys.
+ * A non-finite timestamp uses the module's current time.
+ */
+export type WasmAdvanceResidentInterpolations = (
+  timestamp: number,
+  resultPtr: number
+) => boolean;
+
+/**
+ * Entry points of the module-resident interpolation table, which animates
+ * the resident sprite store in place.
+ * Batch layouts are described in wasm/interpolation_store.h.
+ */
+export interface WasmResidentInterpolations {
+  readonly upsertLocations: WasmResidentBatch;
+  readonly upsertChannels: WasmResidentBatch;
+  readonly cancel: WasmResidentBatch;
+  readonly getCount: () => number;
+  /** Result buffer needs 1 + getCount() * 4 elements. */
+  readonly advance: WasmAdvanceResidentInterpolations;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -187,11 +300,33 @@ export interface WasmHost {
   readonly calculatePerspectiveRatio: WasmCalculatePerspectiveRatio;
   readonly projectLngLatToClipSpace: WasmProjectLngLatToClipSpace;
 
+  // Batch projections, when the module exports them.
+  readonly projectMany?: WasmProjectMany;
+  readonly unprojectMany?: WasmUnprojectMany;
+
   // CalculationHost related functions.
   readonly calculateBillboardDepthKey: WasmCalculateBillboardDepthKey;
   readonly calculateSurfaceDepthKey: WasmCalculateSurfaceDepthKey;
   readonly prepareDrawSpriteImages: WasmPrepareDrawSpriteImages;
   readonly processInterpolations: WasmProcessInterpolations;
+
+  // Prepare pass with fused sprite interpolations, when the module exports it.
+  readonly prepareInterpolatedSpriteImages?: WasmPrepareInterpolatedSpriteImages;
+
+  // Resident sprite store, when the module exports it.
+  readonly residentSpriteStore?: WasmResidentSpriteStore;
+  readonly residentInterpolations?: WasmResidentInterpolations;
+
+  // Depth sort used by prepareDrawSpriteImages, when the module exports it.
+  readonly sortDepthKeys?: WasmSortDepthKeys;
+  readonly temporalDepthSort?: WasmTemporalDepthSort;
+
+  // Per-frame arena usage, when the module exports it.
+  readonly getFrameArenaStats?: WasmGetFrameArenaStats;
+
+  // Switches simd-mt between the resident worker pool and per-dispatch
+  // spawn/join, when the module exports it. Benchmark use only.
+  readonly setWorkerPoolEnabled?: (enabled: boolean) => void;
 }
 
 export type WasmVariant = SpriteLayerCalculationVariant;
@@ -377,6 +512,8 @@ interface RawProjectionWasmExports {
   readonly project?: WasmProject;
   readonly _unproject?: WasmUnproject;
   readonly unproject?: WasmUnproject;
+  readonly _projectMany?: WasmProjectMany;
+  readonly _unprojectMany?: WasmUnprojectMany;
   readonly _calculatePerspectiveRatio?: WasmCalculatePerspectiveRatio;
   readonly calculatePerspectiveRatio?: WasmCalculatePerspectiveRatio;
   readonly _projectLngLatToClipSpace?: WasmProjectLngLatToClipSpace;
@@ -387,9 +524,29 @@ interface RawProjectionWasmExports {
   readonly calculateSurfaceDepthKey?: WasmCalculateSurfaceDepthKey;
   readonly _prepareDrawSpriteImages?: WasmPrepareDrawSpriteImages;
   readonly prepareDrawSpriteImages?: WasmPrepareDrawSpriteImages;
+  readonly _prepareInterpolatedSpriteImages?: WasmPrepareInterpolatedSpriteImages;
   readonly _processInterpolations?: WasmProcessInterpolations;
   readonly processInterpolations?: WasmProcessInterpolations;
   readonly _setThreadPoolSize?: (count: number) => void;
+  readonly _setWorkerPoolEnabled?: (enabled: boolean) => void;
+  readonly _upsertResidentResources?: WasmResidentBatch;
+  readonly _upsertResidentSprites?: WasmResidentBatch;
+  readonly _removeResidentSprites?: WasmResidentBatch;
+  readonly _upsertResidentImages?: WasmResidentBatch;
+  readonly _removeResidentImages?: WasmResidentBatch;
+  readonly _patchResidentImages?: WasmResidentBatch;
+  readonly _clearResidentStore?: () => void;
+  readonly _getResidentImageCount?: () => number;
+  readonly _prepareResidentSpriteImages?: WasmPrepareDrawSpriteImages;
+  readonly _upsertResidentLocationInterpolations?: WasmResidentBatch;
+  readonly _upsertResidentChannelInterpolations?: WasmResidentBatch;
+  readonly _cancelResidentInterpolations?: WasmResidentBatch;
+  readonly _getResidentInterpolationCount?: () => number;
+  readonly _advanceResidentInterpolations?: WasmAdvanceResidentInterpolations;
+  readonly _sortDepthKeys?: WasmSortDepthKeys;
+  readonly _setTemporalDepthSortEnabled?: (enabled: boolean) => void;
+  readonly _getTemporalDepthSortStats?: (resultPtr: number) => boolean;
+  readonly _getFrameArenaStats?: WasmGetFrameArenaStats;
 }
 
 /**
@@ -595,6 +752,60 @@ const createWasmHostFromExports = (
     throw new Error('Projection host WASM exports are incomplete.');
   }
 
+  const residentSpriteStore: WasmResidentSpriteStore | undefined =
+    exports._upsertResidentResources &&
+    exports._upsertResidentSprites &&
+    exports._removeResidentSprites &&
+    exports._upsertResidentImages &&
+    exports._removeResidentImages &&
+    exports._patchResidentImages &&
+    exports._clearResidentStore &&
+    exports._getResidentImageCount &&
+    exports._prepareResidentSpriteImages
+      ? {
+          upsertResources: exports._upsertResidentResources,
+          upsertSprites: exports._upsertResidentSprites,
+          removeSprites: exports._removeResidentSprites,
+          upsertImages: exports._upsertResidentImages,
+          removeImages: exports._removeResidentImages,
+          patchImages: exports._patchResidentImages,
+          clear: exports._clearResidentStore,
+          getImageCount: exports._getResidentImageCount,
+          prepare: exports._prepareResidentSpriteImages,
+        }
+      : undefined;
+  const residentInterpolations: WasmResidentInterpolations | undefined =
+    residentSpriteStore &&
+    exports._upsertResidentLocationInterpolations &&
+    exports._upsertResidentChannelInterpolations &&
+    exports._cancelResidentInterpolations &&
+    exports._getResidentInterpolationCount &&
+    exports._advanceResidentInterpolations
+      ? {
+          upsertLocations: exports._upsertResidentLocationInterpolations,
+          upsertChannels: exports._upsertResidentChannelInterpolations,
+          cancel: exports._cancelResidentInterpolations,
+          getCount: exports._getResidentInterpolationCount,
+          advance: exports._advanceResidentInterpolations,
+        }
+      : undefined;
+
+  const prepareInterpolatedSpriteImages =
+    exports._prepareInterpolatedSpriteImages;
+  const projectMany = exports._projectMany;
+  const unprojectMany = exports._unprojectMany;
+
+  const sortDepthKeys = exports._sortDepthKeys;
+  const temporalDepthSort: WasmTemporalDepthSort | undefined =
+    exports._setTemporalDepthSortEnabled && exports._getTemporalDepthSortStats
+      ? {
+          setEnabled: exports._setTemporalDepthSortEnabled,
+          getStats: exports._getTemporalDepthSortStats,
+        }
+      : undefined;
+  const getFrameArenaStats = exports._getFrameArenaStats;
+  const setWorkerPoolEnabled = exports._setWorkerPoolEnabled;
+
   //====================================================================
 
   /** Pooled BufferHolder, grouping by the type and length. */
@@ -869,10 +1080,19 @@ const createWasmHostFromExports = (
     unproject,
     calculatePerspectiveRatio,
     projectLngLatToClipSpace,
+    projectMany,
+    unprojectMany,
     calculateBillboardDepthKey,
     calculateSurfaceDepthKey,
     prepareDrawSpriteImages,
     processInterpolations,
+    prepareInterpolatedSpriteImages,
+    residentSpriteStore,
+    residentInterpolations,
+    sortDepthKeys,
+    temporalDepthSort,
+    getFrameArenaStats,
+    setWorkerPoolEnabled,
     release,
   };
 };
@@ -15,8 +15,14 @@ import type {
   SpriteMercatorCoordinate,
 } from '../internalTypes';
 import type { SpriteLocation, SpritePoint } from '../types';
-import { prepareWasmHost, type WasmHost } from './wasmHost';
+import {
+  prepareWasmHost,
+  WASM_BATCH_FLAG_FAST_MERCATOR_MATH,
+  type WasmHost,
+  type WasmProjectMany,
+} from './wasmHost';
 import { reportWasmRuntimeFailure } from './runtime';
+import { ENABLE_FAST_MERCATOR_MATH } from '../config';
 
 //////////////////////////////////////////////////////////////////////////////////////
 
@@ -212,6 +218,210 @@ const createUnproject = (
 
 //////////////////////////////////////////////////////////////////////////////////////
 
+const WASM_ProjectMany_INPUT_STRIDE = 3;
+const WASM_UnprojectMany_INPUT_STRIDE = 2;
+const WASM_Batch_RESULT_STRIDE = 2;
+const WASM_Batch_MASK_WORD_POINTS = 32;
+
+/**
+ * Run a batch projection entry point over the given points.
+ * @param wasm Wasm hosted reference.
+ * @param matrixPtr Matrix pointer.
+ * @param worldSize World size.
+ * @param points Input points.
+ * @param stride Doubles per input point.
+ * @param writePoint Writes one point into the input buffer.
+ * @param invoke Batch entry point.
+ * @param readPoint Builds one output from its result pair.
+ * @returns Output pairs, `undefined` where the point was rejected.
+ */
+const invokeBatch = <TInput, TOutput>(
+  wasm: WasmHost,
+  matrixPtr: number,
+  worldSize: number,
+  points: readonly TInput[],
+  stride: number,
+  writePoint: (buffer: Float64Array, offset: number, point: TInput) => void,
+  invoke: WasmProjectMany,
+  readPoint: (first: number, second: number) => TOutput
+): (TOutput | undefined)[] => {
+  const count = points.length;
+  if (count === 0) {
+    return [];
+  }
+
+  const inputHolder = wasm.allocateTypedBuffer(Float64Array, count * stride);
+  const resultHolder = wasm.allocateTypedBuffer(
+    Float64Array,
+    count * WASM_Batch_RESULT_STRIDE
+  );
+  const maskHolder = wasm.allocateTypedBuffer(
+    Uint32Array,
+    Math.ceil(count / WASM_Batch_MASK_WORD_POINTS)
+  );
+  try {
+    // Prepare the input buffer.
+    const { ptr: inputPtr, buffer: input } = inputHolder.prepare();
+    points.forEach((point, index) => writePoint(input, index * stride, point));
+    const { ptr: resultPtr } = resultHolder.prepare();
+    const { ptr: maskPtr } = maskHolder.prepare();
+
+    // Call wasm entry point.
+    const flags = ENABLE_FAST_MERCATOR_MATH
+      ? WASM_BATCH_FLAG_FAST_MERCATOR_MATH
+      : 0;
+    if (
+      !invoke(
+        inputPtr,
+        count,
+        stride,
+        worldSize,
+        matrixPtr,
+        resultPtr,
+        maskPtr,
+        flags
+      )
+    ) {
+      return points.map(() => undefined);
+    }
+
+    // Extract results from the wasm buffer.
+    const { buffer: result } = resultHolder.prepare();
+    const { buffer: mask } = maskHolder.prepare();
+    const outputs: (TOutput | undefined)[] = new Array(count);
+    for (let index = 0; index < count; index++) {
+      const word = mask[Math.floor(index / WASM_Batch_MASK_WORD_POINTS)]!;
+      const bit = 1 << index % WASM_Batch_MASK_WORD_POINTS;
+      const offset = index * WASM_Batch_RESULT_STRIDE;
+      outputs[index] =
+        (word & bit) !== 0
+          ? readPoint(result[offset]!, result[offset + 1]!)
+          : undefined;
+    }
+    return outputs;
+  } finally {
+    inputHolder.release();
+    resultHolder.release();
+    maskHolder.release();
+  }
+};
+
+/**
+ * Create `projectMany` delegator.
+ * @param wasm Wasm hosted reference.
+ * @param preparedState Prepared projection state.
+ * @param project Single point delegator, used when the module has no batch entry.
+ * @returns projectMany function object.
+ */
+const createProjectMany = (
+  wasm: WasmHost,
+  preparedState: PreparedProjectionState,
+  project: (location: Readonly<SpriteLocation>) => SpritePoint | undefined
+) => {
+  const projectMany = wasm.projectMany;
+
+  // Short-circuit.
+  if (
+    !projectMany ||
+    !preparedState.pixelMatrix ||
+    preparedState.pixelMatrix.length !== WASM_Project_CONTEXT_ELEMENT_COUNT
+  ) {
+    const d = (locations: readonly Readonly<SpriteLocation>[]) =>
+      locations.map((location) => project(location));
+    d.release = () => {};
+    return d;
+  }
+
+  // Allocate a matrix buffer.
+  const matrixHolder = wasm.allocateTypedBuffer(
+    Float64Array,
+    preparedState.pixelMatrix
+  );
+
+  // `projectMany` delegation body
+  const delegate = (
+    locations: readonly Readonly<SpriteLocation>[]
+  ): (SpritePoint | undefined)[] =>
+    invokeBatch(
+      wasm,
+      matrixHolder.prepare().ptr,
+      preparedState.worldSize,
+      locations,
+      WASM_ProjectMany_INPUT_STRIDE,
+      (buffer, offset, location) => {
+        buffer[offset] = location.lng;
+        buffer[offset + 1] = location.lat;
+        buffer[offset + 2] = location.z ?? 0;
+      },
+      projectMany,
+      (x, y) => ({ x, y })
+    );
+
+  // Attach releaser
+  delegate.release = matrixHolder.release;
+
+  return delegate;
+};
+
+/**
+ * Create `unprojectMany` delegator.
+ * @param wasm Wasm hosted reference.
+ * @param preparedState Prepared projection state.
+ * @param unproject Single point delegator, used when the module has no batch entry.
+ * @returns unprojectMany function object.
+ */
+const createUnprojectMany = (
+  wasm: WasmHost,
+  preparedState: PreparedProjectionState,
+  unproject: (point: Readonly<SpritePoint>) => SpriteLocation | undefined
+) => {
+  const unprojectMany = wasm.unprojectMany;
+
+  // Short-circuit.
+  if (
+    !unprojectMany ||
+    !preparedState.pixelMatrixInverse ||
+    preparedState.pixelMatrixInverse.length !==
+      WASM_Unproject_CONTEXT_ELEMENT_COUNT
+  ) {
+    const d = (points: readonly Readonly<SpritePoint>[]) =>
+      points.map((point) => unproject(point));
+    d.release = () => {};
+    return d;
+  }
+
+  // Allocate a matrix buffer.
+  const matrixHolder = wasm.allocateTypedBuffer(
+    Float64Array,
+    preparedState.pixelMatrixInverse
+  );
+
+  // `unprojectMany` delegation body
+  const delegate = (
+    points: readonly Readonly<SpritePoint>[]
+  ): (SpriteLocation | undefined)[] =>
+    invokeBatch(
+      wasm,
+      matrixHolder.prepare().ptr,
+      preparedState.worldSize,
+      points,
+      WASM_UnprojectMany_INPUT_STRIDE,
+      (buffer, offset, point) => {
+        buffer[offset] = point.x;
+        buffer[offset + 1] = point.y;
+      },
+      unprojectMany,
+      (lng, lat) => ({ lng, lat })
+    );
+
+  // Attach releaser
+  delegate.release = matrixHolder.release;
+
+  return delegate;
+};
+
+//////////////////////////////////////////////////////////////////////////////////////
+
 const WASM_CalculatePerspectiveRatio_CONTEXT_ELEMENT_COUNT = 16;
 const WASM_CalculatePerspectiveRatio_CACHED_MERCATOR_ELEMENT_COUNT = 3;
 const WASM_CalculatePerspectiveRatio_RESULT_ELEMENT_COUNT = 1;
@@ -349,6 +559,16 @@ export const createWasmProjectionHost = (
   // Member: unproject
   const wasmUnproject = createUnproject(wasm, preparedState);
 
+  // Member: projectMany
+  const wasmProjectMany = createProjectMany(wasm, preparedState, wasmProject);
+
+  // Member: unprojectMany
+  const wasmUnprojectMany = createUnprojectMany(
+    wasm,
+    preparedState,
+    wasmUnproject
+  );
+
   // Member: calculatePerspectiveRatio
   const wasmCalculatePerspectiveRatio = createCalculatePerspectiveRatio(
     wasm,
@@ -374,6 +594,8 @@ export const createWasmProjectionHost = (
     wasmFromLngLat.release();
     wasmProject.release();
     wasmUnproject.release();
+    wasmProjectMany.release();
+    wasmUnprojectMany.release();
     wasmCalculatePerspectiveRatio.release();
   };
 
@@ -417,6 +639,20 @@ export const createWasmProjectionHost = (
       () => ensureFallbackHost().unproject(point)
     );
 
+  const projectMany: NonNullable<ProjectionHost['projectMany']> = (locations) =>
+    runWithFallback(
+      () => wasmProjectMany(locations),
+      () => locations.map((location) => ensureFallbackHost().project(location))
+    );
+
+  const unprojectMany: NonNullable<ProjectionHost['unprojectMany']> = (
+    points
+  ) =>
+    runWithFallback(
+      () => wasmUnprojectMany(points),
+      () => points.map((point) => ensureFallbackHost().unproject(point))
+    );
+
   const calculatePerspectiveRatio: ProjectionHost['calculatePerspectiveRatio'] =
     (location, cachedMercator) =>
       runWithFallback(
@@ -449,6 +685,8 @@ export const createWasmProjectionHost = (
     fromLngLat, // Overrided
     project, // Overrided
     unproject, // Overrided
+    projectMany, // Overrided
+    unprojectMany, // Overrided
     calculatePerspectiveRatio, // Overrided
     release,
   };
@@ -294,6 +294,24 @@ export interface ProjectionHost extends Releasable {
   readonly unproject: (
     point: Readonly<SpritePoint>
   ) => SpriteLocation | undefined;
+  /**
+   * Project many locations at once.
+   * @param locations Locations.
+   * @returns Projected points, `undefined` where `project` would return it.
+   * @remarks Optional; callers fall back to `project` per location.
+   */
+  readonly projectMany?: (
+    locations: readonly Readonly<SpriteLocation>[]
+  ) => (SpritePoint | undefined)[];
+  /**
+   * Unproject many points at once.
+   * @param points Projected points.
+   * @returns Locations, `undefined` where `unproject` would return it.
+   * @remarks Optional; callers fall back to `unproject` per point.
+   */
+  readonly unprojectMany?: (
+    points: readonly Readonly<SpritePoint>[]
+  ) => (SpriteLocation | undefined)[];
   /**
    * Calculate perspective ratio.
    * @param location Location.
@@ -349,7 +367,12 @@ export interface PreparedDrawSpriteImageParams<T> {
   readonly spriteEntry: InternalSpriteCurrentState<T>;
   readonly imageEntry: InternalSpriteImageState;
   readonly imageResource: RegisteredImage;
+  /** Interleaved vertices, empty when they are addressed by `vertexBatchOffset`. */
   readonly vertexData: Float32Array;
+  /** First vertex of this item inside `ProcessDrawSpriteImagesResult.vertexBatch`. */
+  readonly vertexBatchOffset?: number;
+  /** Record index inside `ProcessDrawSpriteImagesResult.instanceBatch`, set for shader billboards. */
+  readonly instanceBatchIndex?: number;
   opacity: number;
   readonly cameraDistanceMeters: number;
   readonly hitTestCorners:
@@ -418,6 +441,16 @@ export interface ProcessDrawSpriteImagesParams<TTag> {
 export interface ProcessDrawSpriteImagesResult<TTag> {
   readonly preparedItems: PreparedDrawSpriteImageParams<TTag>[];
   readonly interpolationResult: RenderInterpolationResult;
+  /**
+   * Interleaved vertices of every prepared item, addressed by `vertexBatchOffset`.
+   * Resolve it right before uploading; the view is only valid for the current frame.
+   */
+  readonly vertexBatch?: () => Float32Array;
+  /**
+   * Per-instance records of every prepared item, addressed by `instanceBatchIndex`.
+   * Resolve it right before uploading; the view is only valid for the current frame.
+   */
+  readonly instanceBatch?: () => Float32Array;
 }
 
 /**
@@ -0,0 +1,54 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { describe, expect, it } from 'vitest';
+
+import { measureInstanceRun } from '../../src/gl/shader';
+import type { PreparedDrawSpriteImageParams } from '../../src/internalTypes';
+
+const textureA = {} as WebGLTexture;
+const textureB = {} as WebGLTexture;
+
+const createItem = (
+  instanceBatchIndex: number | undefined,
+  texture: WebGLTexture | undefined = textureA,
+  scaleX = 2
+): PreparedDrawSpriteImageParams<null> =>
+  ({
+    instanceBatchIndex,
+    imageResource: { texture },
+    screenToClip: { scaleX, scaleY: -2, offsetX: -1, offsetY: 1 },
+  }) as unknown as PreparedDrawSpriteImageParams<null>;
+
+describe('measureInstanceRun', () => {
+  it('groups consecutive records sharing a texture', () => {
+    const items = [
+      createItem(0),
+      createItem(1),
+      createItem(2),
+      createItem(3, textureB),
+      createItem(4, textureB),
+    ];
+    expect(measureInstanceRun(items, 0)).toBe(3);
+    expect(measureInstanceRun(items, 1)).toBe(2);
+    expect(measureInstanceRun(items, 3)).toBe(2);
+    expect(measureInstanceRun(items, 5)).toBe(0);
+  });
+
+  it('breaks runs on gaps, screen-to-clip changes and non-instanced items', () => {
+    const items = [
+      createItem(0),
+      createItem(2),
+      createItem(3, textureA, 4),
+      createItem(undefined),
+      createItem(5, undefined),
+    ];
+    expect(measureInstanceRun(items, 0)).toBe(1);
+    expect(measureInstanceRun(items, 1)).toBe(1);
+    expect(measureInstanceRun(items, 3)).toBe(0);
+    expect(measureInstanceRun(items, 4)).toBe(0);
+  });
+});
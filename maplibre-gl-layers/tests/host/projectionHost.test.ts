@@ -16,7 +16,7 @@ import { createWasmProjectionHost } from '../../src/host/wasmProjectionHost';
 import { initializeWasmHost } from '../../src/host/wasmHost';
 import { createMapLibreProjectionHost } from '../../src/host/mapLibreProjectionHost';
 import type { ProjectionHost } from '../../src/internalTypes';
-import type { SpriteLocation } from '../../src/types';
+import type { SpriteLocation, SpritePoint } from '../../src/types';
 import { DEG2RAD, TILE_SIZE } from '../../src/const';
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -365,6 +365,41 @@ describe.each(hostVariants)('ProjectionHost via %s', ({ name, host }) => {
       }
     });
 
+    it('projects and unprojects batches like single points', () => {
+      if (!host.projectMany || !host.unprojectMany) {
+        return;
+      }
+      // Enough points to span several validity mask words with an odd tail.
+      const locations: SpriteLocation[] = [
+        ...TEST_LOCATIONS,
+        { lng: Number.NaN, lat: 35.685 },
+      ];
+      for (let index = 0; index < 70; index++) {
+        locations.push({
+          lng: 139.74 + (index % 10) * 0.003,
+          lat: 35.675 + Math.floor(index / 10) * 0.003,
+          z: index,
+        });
+      }
+
+      const projected = host.projectMany(locations);
+      expect(projected).toHaveLength(locations.length);
+      projected.forEach((point, index) => {
+        expect(point).toEqual(host.project(locations[index]!));
+      });
+
+      const points = projected.filter(
+        (point): point is SpritePoint => point !== undefined
+      );
+      expect(points.length).toBeGreaterThan(0);
+      const unprojected = host.unprojectMany(points);
+      expect(unprojected).toHaveLength(points.length);
+      unprojected.forEach((location, index) => {
+        expect(location).toEqual(host.unproject(points[index]!));
+      });
+      expect(host.projectMany([])).toEqual([]);
+    });
+
     it('calculates perspective ratio similar to reference', () => {
       for (const location of TEST_LOCATIONS) {
         const actual = host.calculatePerspectiveRatio(location);
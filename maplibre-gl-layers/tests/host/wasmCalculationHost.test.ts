@@ -38,7 +38,7 @@ import type { ProjectionHostParams } from '../../src/host/projectionHost';
 
 type TestSpriteOffset = { offsetMeters: number; offsetDeg: number };
 
-const RESULT_HEADER_LENGTH = 7;
+const RESULT_HEADER_LENGTH = 13;
 const RESULT_VERTEX_COMPONENT_LENGTH = 36;
 const RESULT_HIT_TEST_COMPONENT_LENGTH = 8;
 const RESULT_SURFACE_BLOCK_LENGTH = 68;
@@ -49,10 +49,28 @@ const RESULT_ITEM_STRIDE =
   RESULT_VERTEX_COMPONENT_LENGTH +
   RESULT_HIT_TEST_COMPONENT_LENGTH +
   RESULT_SURFACE_BLOCK_LENGTH;
+const RESULT_FLOAT32_COMPONENT_LENGTH =
+  RESULT_COMMON_ITEM_LENGTH +
+  RESULT_VERTEX_COMPONENT_LENGTH +
+  RESULT_HIT_TEST_COMPONENT_LENGTH;
+const RESULT_FLOAT32_ITEM_STRIDE =
+  (RESULT_FLOAT32_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH) / 2;
+const RESULT_STREAM_ITEM_STRIDE = RESULT_FLOAT32_COMPONENT_LENGTH;
+const RESULT_FLOAT32_STREAM_ITEM_STRIDE = RESULT_FLOAT32_COMPONENT_LENGTH / 2;
+const RESULT_SURFACE_RECORD_STRIDE = 1 + RESULT_SURFACE_BLOCK_LENGTH;
+const RESULT_FLOAT32_SURFACE_RECORD_STRIDE =
+  (1 + RESULT_SURFACE_BLOCK_LENGTH + 1) / 2;
+const RESULT_VERTEXLESS_ITEM_STRIDE =
+  RESULT_COMMON_ITEM_LENGTH +
+  RESULT_HIT_TEST_COMPONENT_LENGTH +
+  RESULT_SURFACE_BLOCK_LENGTH;
+const RESULT_FLAG_FLOAT32_ITEMS = 1 << 2;
+const RESULT_FLAG_VERTEX_OUTPUT = 1 << 3;
+const RESULT_FLAG_INSTANCE_OUTPUT = 1 << 4;
 const DISTANCE_INTERPOLATION_ITEM_LENGTH = 11;
 const DEGREE_INTERPOLATION_ITEM_LENGTH = 11;
 const SPRITE_INTERPOLATION_ITEM_LENGTH = 14;
-const PROCESS_INTERPOLATIONS_HEADER_LENGTH = 3;
+const PROCESS_INTERPOLATIONS_HEADER_LENGTH = 4;
 
 interface WasmProcessInterpolationResults {
   distance: (SpriteInterpolationEvaluationResult<number> & {
@@ -195,6 +213,7 @@ class MockWasmHost implements WasmHost {
     view[writeCursor++] = distanceCount;
     view[writeCursor++] = degreeCount;
     view[writeCursor++] = spriteCount;
+    view[writeCursor++] = view[start + 3] ?? 0; // flags
 
     for (const entry of response.distance) {
       view[writeCursor++] = entry.value;
@@ -452,6 +471,7 @@ describe('convertToWasmProjectionState', () => {
     const result = state.prepareInputBuffer(params);
     try {
       expect(result.resultItemCount).toBe(1);
+      expect(result.surfaceItemCount).toBe(1);
       const { buffer } = result.parameterHolder.prepare();
       expect(buffer[0]).toBeGreaterThan(0); // total length
       expect(buffer[3]).toBe(2); // resource count (handles 0..1)
@@ -619,6 +639,245 @@ describe('converToDrawImageParams', () => {
         expect(item.useShaderBillboard).toBe(true);
         expect(item.billboardUniforms?.center.x).toBe(10);
         expect(item.cameraDistanceMeters).toBe(1234);
+        // No vertex output or instance record region was requested.
+        expect(item.vertexBatchOffset).toBeUndefined();
+        expect(item.instanceBatchIndex).toBeUndefined();
+      } finally {
+        resultBuffer.release();
+      }
+    } finally {
+      parameterHolder.release();
+    }
+  });
+});
+
+describe('converToDrawImageParams float32 items', () => {
+  it('reads float32 components and rebases the surface block', () => {
+    const wasm = new MockWasmHost();
+    const { deps, resourcesByHandle, spriteIdHandler } =
+      createMockDependencies();
+    const spriteHandle = spriteIdHandler.allocate('sprite-1');
+    const sprite = createSprite('sprite-1', spriteHandle);
+    spriteIdHandler.store(spriteHandle, sprite);
+    const image = createImage();
+    const resource = createRegisteredImage();
+    const params = createPrepareParams(sprite, image, resource);
+    resourcesByHandle[resource.handle] = resource;
+
+    const state =
+      __wasmCalculationTestInternals.convertToWasmProjectionState<null>(
+        wasm,
+        PROJECTION_PARAMS,
+        deps
+      );
+    const { parameterHolder } = state.prepareInputBuffer(params);
+    try {
+      const resultBuffer = wasm.allocateTypedBuffer(
+        Float64Array,
+        RESULT_HEADER_LENGTH + RESULT_FLOAT32_ITEM_STRIDE
+      );
+      try {
+        const { buffer } = resultBuffer.prepare();
+        buffer.fill(0);
+        buffer[0] = 1; // prepared count
+        buffer[1] = RESULT_FLOAT32_ITEM_STRIDE;
+        buffer[2] = RESULT_VERTEX_COMPONENT_LENGTH;
+        buffer[3] = 4;
+        buffer[4] = 0b11 | RESULT_FLAG_FLOAT32_ITEMS;
+        // Relative-to-center anchor: mercator x/y, lng/lat
+        buffer[6] = 0.8876543210123;
+        buffer[7] = 0.3956789012345;
+        buffer[8] = 139.7514123456;
+        buffer[9] = 35.685123456;
+
+        const componentBase = RESULT_HEADER_LENGTH * 2;
+        const floats = new Float32Array(
+          buffer.buffer,
+          buffer.byteOffset,
+          buffer.length * 2
+        );
+        const ids = new Int32Array(
+          buffer.buffer,
+          buffer.byteOffset,
+          buffer.length * 2
+        );
+        ids[componentBase] = spriteHandle;
+        ids[componentBase + 1] = 0; // image index
+        ids[componentBase + 2] = 1; // resource index
+        floats.set(
+          [
+            0.5, // opacity
+            1, // scaleX
+            1, // scaleY
+            0, // offsetX
+            0, // offsetY
+            1, // use shader surface
+            1, // surface clip
+            1, // use shader billboard
+            10.25, // center.x
+            20.5, // center.y
+            2, // half width
+            3, // half height
+            0, // anchor.x
+            0, // anchor.y
+            0.5, // sin
+            0.5, // cos
+            1234, // camera distance
+          ],
+          componentBase + 3
+        );
+        const vertexStart = componentBase + RESULT_COMMON_ITEM_LENGTH;
+        for (let i = 0; i < RESULT_VERTEX_COMPONENT_LENGTH; i++) {
+          floats[vertexStart + i] = i + 0.5;
+        }
+        const hitTestStart = vertexStart + RESULT_VERTEX_COMPONENT_LENGTH;
+        for (let i = 0; i < RESULT_HIT_TEST_COMPONENT_LENGTH; i++) {
+          floats[hitTestStart + i] = i + 1;
+        }
+        // Surface block: mercator center and base lng/lat as anchor deltas.
+        const surfaceStart = componentBase + RESULT_FLOAT32_COMPONENT_LENGTH;
+        floats[surfaceStart] = 0.125;
+        floats[surfaceStart + 1] = -0.25;
+        floats[surfaceStart + 2] = 0.5; // mercator z stays absolute
+        floats[surfaceStart + 45] = 0.0625;
+        floats[surfaceStart + 46] = -0.03125;
+
+        const prepared =
+          __wasmCalculationTestInternals.converToPreparedDrawImageParams(
+            state,
+            deps,
+            resultBuffer
+          );
+        expect(prepared).toHaveLength(1);
+        const item = prepared[0]!;
+        expect(item.spriteEntry).toBe(sprite);
+        expect(item.imageEntry).toBe(image);
+        expect(item.imageResource).toBe(resource);
+        expect(item.opacity).toBe(0.5);
+        expect(Array.from(item.vertexData)).toEqual(
+          Array.from({ length: RESULT_VERTEX_COMPONENT_LENGTH }, (_, i) => i + 0.5)
+        );
+        expect(item.hitTestCorners?.[3]).toMatchObject({ x: 7, y: 8 });
+        expect(item.billboardUniforms?.center).toEqual({ x: 10.25, y: 20.5 });
+        expect(item.cameraDistanceMeters).toBe(1234);
+        expect(item.surfaceShaderInputs!.mercatorCenter).toEqual({
+          x: 0.8876543210123 + 0.125,
+          y: 0.3956789012345 - 0.25,
+          z: 0.5,
+        });
+        expect(item.surfaceShaderInputs!.baseLngLat).toEqual({
+          lng: 139.7514123456 + 0.0625,
+          lat: 35.685123456 - 0.03125,
+          z: 0,
+        });
+      } finally {
+        resultBuffer.release();
+      }
+    } finally {
+      parameterHolder.release();
+    }
+  });
+});
+
+describe('vertex output', () => {
+  it('sizes items without the vertex block', () => {
+    const { computeResultElementCount } = __wasmCalculationTestInternals;
+    expect(computeResultElementCount(10, 3, false, false, true)).toBe(
+      RESULT_HEADER_LENGTH + 10 * RESULT_VERTEXLESS_ITEM_STRIDE
+    );
+    expect(computeResultElementCount(10, 3, false, true, true)).toBe(
+      RESULT_HEADER_LENGTH + (10 * RESULT_VERTEXLESS_ITEM_STRIDE) / 2
+    );
+    expect(computeResultElementCount(10, 3, true, false, true)).toBe(
+      RESULT_HEADER_LENGTH +
+        10 * (RESULT_COMMON_ITEM_LENGTH + RESULT_HIT_TEST_COMPONENT_LENGTH) +
+        3 * RESULT_SURFACE_RECORD_STRIDE
+    );
+  });
+
+  it('reads vertexless items and addresses the vertex region', () => {
+    const wasm = new MockWasmHost();
+    const { deps, resourcesByHandle, spriteIdHandler } =
+      createMockDependencies();
+    const spriteHandle = spriteIdHandler.allocate('sprite-1');
+    const sprite = createSprite('sprite-1', spriteHandle);
+    spriteIdHandler.store(spriteHandle, sprite);
+    const image = createImage();
+    const resource = createRegisteredImage();
+    const params = createPrepareParams(sprite, image, resource);
+    resourcesByHandle[resource.handle] = resource;
+
+    const state =
+      __wasmCalculationTestInternals.convertToWasmProjectionState<null>(
+        wasm,
+        PROJECTION_PARAMS,
+        deps
+      );
+    const { parameterHolder } = state.prepareInputBuffer(params);
+    try {
+      const resultBuffer = wasm.allocateTypedBuffer(
+        Float64Array,
+        RESULT_HEADER_LENGTH + 2 * RESULT_VERTEXLESS_ITEM_STRIDE
+      );
+      try {
+        const { buffer } = resultBuffer.prepare();
+        buffer.fill(0);
+        buffer[0] = 2; // prepared count
+        buffer[1] = RESULT_VERTEXLESS_ITEM_STRIDE;
+        buffer[2] = RESULT_VERTEX_COMPONENT_LENGTH;
+        buffer[3] = 4;
+        buffer[4] = 0b01 | RESULT_FLAG_VERTEX_OUTPUT;
+        for (let index = 0; index < 2; index++) {
+          const itemBase =
+            RESULT_HEADER_LENGTH + index * RESULT_VERTEXLESS_ITEM_STRIDE;
+          buffer[itemBase] = spriteHandle;
+          buffer[itemBase + 1] = 0; // image index
+          buffer[itemBase + 2] = 1; // resource index
+          buffer[itemBase + 3] = 1; // opacity
+          buffer[itemBase + 4] = 1; // scaleX
+          buffer[itemBase + 5] = 1; // scaleY
+          // Hit test corners follow the common block directly.
+          for (let i = 0; i < RESULT_HIT_TEST_COMPONENT_LENGTH; i++) {
+            buffer[itemBase + RESULT_COMMON_ITEM_LENGTH + i] = index * 10 + i;
+          }
+        }
+
+        const prepared =
+          __wasmCalculationTestInternals.converToPreparedDrawImageParams(
+            state,
+            deps,
+            resultBuffer
+          );
+        expect(prepared).toHaveLength(2);
+        const [first, second] = prepared;
+        expect(first!.vertexData.length).toBe(0);
+        expect(second!.vertexData).toBe(first!.vertexData);
+        expect(first!.vertexBatchOffset).toBe(0);
+        expect(second!.vertexBatchOffset).toBe(
+          RESULT_VERTEX_COMPONENT_LENGTH / 6
+        );
+        expect(second!.hitTestCorners?.[0]).toMatchObject({ x: 10, y: 11 });
+        expect(second!.hitTestCorners?.[3]).toMatchObject({ x: 16, y: 17 });
+        expect(state.vertexOutputLength).toBe(
+          2 * RESULT_VERTEX_COMPONENT_LENGTH
+        );
+
+        // With instance records, shader billboards have no vertices at all.
+        buffer[4] =
+          0b01 | RESULT_FLAG_VERTEX_OUTPUT | RESULT_FLAG_INSTANCE_OUTPUT;
+        buffer[RESULT_HEADER_LENGTH + RESULT_VERTEXLESS_ITEM_STRIDE + 10] = 1;
+        const instanced =
+          __wasmCalculationTestInternals.converToPreparedDrawImageParams(
+            state,
+            deps,
+            resultBuffer
+          );
+        expect(instanced).toHaveLength(2);
+        expect(instanced[0]!.vertexBatchOffset).toBe(0);
+        expect(instanced[0]!.instanceBatchIndex).toBeUndefined();
+        expect(instanced[1]!.vertexData.length).toBe(0);
+        expect(instanced[1]!.vertexBatchOffset).toBeUndefined();
+        expect(instanced[1]!.instanceBatchIndex).toBe(1);
       } finally {
         resultBuffer.release();
       }
@@ -628,6 +887,111 @@ describe('converToDrawImageParams', () => {
   });
 });
 
+describe('surface stream', () => {
+  it('sizes the result buffer from the surface item count', () => {
+    const { computeResultElementCount } = __wasmCalculationTestInternals;
+    expect(computeResultElementCount(10, 3, true, false)).toBe(
+      RESULT_HEADER_LENGTH +
+        10 * RESULT_STREAM_ITEM_STRIDE +
+        3 * RESULT_SURFACE_RECORD_STRIDE
+    );
+    expect(computeResultElementCount(10, 3, true, true)).toBe(
+      RESULT_HEADER_LENGTH +
+        10 * RESULT_FLOAT32_STREAM_ITEM_STRIDE +
+        3 * RESULT_FLOAT32_SURFACE_RECORD_STRIDE
+    );
+    // Billboards alone never need more than the plain layout.
+    expect(computeResultElementCount(10, 0, true, false)).toBeLessThan(
+      computeResultElementCount(10, 0, false, false)
+    );
+    expect(computeResultElementCount(10, 3, false, false)).toBe(
+      RESULT_HEADER_LENGTH + 10 * RESULT_ITEM_STRIDE
+    );
+  });
+
+  // Candidates billboard, surface, surface (fails late), billboard, surface.
+  // The kernel compacts them to 4 items and 2 records, shifting the last
+  // record's item index from 4 to 3; the records still start after the 5
+  // candidate slots.
+  const CANDIDATE_COUNT = 5;
+  const PREPARED_COUNT = 4;
+  const RECORD_ITEM_INDICES = [1, 3];
+
+  const createStreamResult = (float32Items: boolean) => {
+    const itemStride = float32Items
+      ? RESULT_FLOAT32_STREAM_ITEM_STRIDE
+      : RESULT_STREAM_ITEM_STRIDE;
+    const recordStride = float32Items
+      ? RESULT_FLOAT32_SURFACE_RECORD_STRIDE
+      : RESULT_SURFACE_RECORD_STRIDE;
+    const surfaceOffset = RESULT_HEADER_LENGTH + CANDIDATE_COUNT * itemStride;
+    const buffer = new Float64Array(
+      surfaceOffset + RECORD_ITEM_INDICES.length * recordStride
+    );
+    buffer[0] = PREPARED_COUNT;
+    buffer[1] = itemStride;
+    buffer[10] = RECORD_ITEM_INDICES.length;
+    buffer[11] = surfaceOffset;
+    buffer[12] = recordStride;
+    const ids = new Int32Array(buffer.buffer);
+    RECORD_ITEM_INDICES.forEach((itemIndex, record) => {
+      const recordBase = surfaceOffset + record * recordStride;
+      if (float32Items) {
+        ids[recordBase * 2] = itemIndex;
+      } else {
+        buffer[recordBase] = itemIndex;
+      }
+    });
+    const componentScale = float32Items ? 2 : 1;
+    const readId = (index: number): number =>
+      float32Items ? (ids[index] ?? -1) : Math.trunc(buffer[index] ?? -1);
+    const recordStart = (record: number): number =>
+      (surfaceOffset + record * recordStride) * componentScale + 1;
+    return { buffer, componentScale, readId, recordStart };
+  };
+
+  for (const float32Items of [false, true]) {
+    const format = float32Items ? 'float32' : 'float64';
+
+    it(`resolves records of mixed and compacted items (${format})`, () => {
+      const { buffer, componentScale, readId, recordStart } =
+        createStreamResult(float32Items);
+      const resolve = __wasmCalculationTestInternals.createStreamSurfaceResolver(
+        buffer,
+        componentScale,
+        readId
+      );
+      expect(
+        Array.from({ length: PREPARED_COUNT }, (_, i) => resolve(i))
+      ).toEqual([-1, recordStart(0), -1, recordStart(1)]);
+    });
+
+    it(`skips records of items that are never resolved (${format})`, () => {
+      const { buffer, componentScale, readId, recordStart } =
+        createStreamResult(float32Items);
+      const resolve = __wasmCalculationTestInternals.createStreamSurfaceResolver(
+        buffer,
+        componentScale,
+        readId
+      );
+      expect(resolve(2)).toBe(-1);
+      expect(resolve(3)).toBe(recordStart(1));
+      expect(resolve(4)).toBe(-1);
+    });
+  }
+
+  it('ignores records that do not fit in the buffer', () => {
+    const { buffer, componentScale, readId } = createStreamResult(false);
+    buffer[10] = RECORD_ITEM_INDICES.length + 1;
+    const resolve = __wasmCalculationTestInternals.createStreamSurfaceResolver(
+      buffer,
+      componentScale,
+      readId
+    );
+    expect(resolve(1)).toBe(-1);
+  });
+});
+
 describe('internalProcessInterpolationsCore', () => {
   it('encodes requests and decodes wasm responses', () => {
     const wasm = new MockWasmHost();
@@ -0,0 +1,99 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, bench, describe } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmVariant,
+} from '../../src/host/wasmHost';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+const ITEM_COUNTS = [10_000, 100_000, 1_000_000] as const;
+
+// Matches DepthSortMode in wasm/depth_sort.h.
+const SORT_MODES = [
+  ['comparison', 1],
+  ['radix', 2],
+] as const;
+
+const DEPTH_SORT_HEADER_LENGTH = 2;
+const DEPTH_SORT_KEY_STRIDE = 4;
+
+/**
+ * Keys shaped like a real frame: sprites with three images each, a few
+ * orders, and depth keys within a narrow clip-space range.
+ */
+const createDepthKeys = (count: number): Float64Array => {
+  const keys = new Float64Array(count * DEPTH_SORT_KEY_STRIDE);
+  let seed = 0x2545f491;
+  const random = () => {
+    seed = (seed * 1103515245 + 12345) >>> 0;
+    return seed / 0x100000000;
+  };
+  for (let index = 0; index < count; index++) {
+    const base = index * DEPTH_SORT_KEY_STRIDE;
+    keys[base + 0] = 0.2 + random() * 0.7;
+    keys[base + 1] = Math.floor(random() * 4);
+    keys[base + 2] = Math.floor(index / 3);
+    keys[base + 3] = index;
+  }
+  return keys;
+};
+
+const defineDepthSortBenches = (variant: WasmVariant) => {
+  describe(`depth sort (${variant})`, () => {
+    beforeAll(async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      if (initialized !== variant) {
+        throw new Error(`WASM host failed to initialize ${variant}.`);
+      }
+    });
+
+    afterAll(() => {
+      releaseWasmHost();
+    });
+
+    for (const count of ITEM_COUNTS) {
+      const keys = createDepthKeys(count);
+      for (const [modeName, mode] of SORT_MODES) {
+        bench(`${modeName} ${count} items`, () => {
+          const wasm = prepareWasmHost();
+          if (!wasm.sortDepthKeys) {
+            throw new Error('sortDepthKeys is not exported.');
+          }
+          const params = wasm.allocateTypedBuffer(
+            Float64Array,
+            DEPTH_SORT_HEADER_LENGTH + keys.length
+          );
+          const result = wasm.allocateTypedBuffer(Float64Array, count);
+          try {
+            const { ptr: paramsPtr, buffer } = params.prepare();
+            buffer[0] = count;
+            buffer[1] = mode;
+            buffer.set(keys, DEPTH_SORT_HEADER_LENGTH);
+            const { ptr: resultPtr } = result.prepare();
+            if (!wasm.sortDepthKeys(paramsPtr, resultPtr)) {
+              throw new Error('sortDepthKeys failed.');
+            }
+          } finally {
+            result.release();
+            params.release();
+          }
+        });
+      }
+    }
+  });
+};
+
+defineDepthSortBenches('simd');
+defineDepthSortBenches('simd-mt');
@@ -0,0 +1,253 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, describe, expect, it } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmHost,
+} from '../../src/host/wasmHost';
+import {
+  createPrepareInput,
+  ITEM_STRIDE,
+  RESULT_HEADER_LENGTH,
+  RESULT_ITEM_STRIDE,
+} from './wasmPrepareInput';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Mirrors DepthSortMode in wasm/depth_sort.h
+const SORT_MODE_COMPARISON = 1;
+const SORT_MODE_RADIX = 2;
+const SORT_MODE_TEMPORAL = 3;
+
+const DEPTH_SORT_HEADER_LENGTH = 2;
+const DEPTH_SORT_KEY_STRIDE = 4;
+const TEMPORAL_STATS_LENGTH = 6;
+
+interface DepthKey {
+  depthKey: number;
+  order: number;
+  spriteHandle: number;
+  imageHandle: number;
+}
+
+const createRandom = (seed: number) => () => {
+  seed = (seed * 1103515245 + 12345) >>> 0;
+  return seed / 0x100000000;
+};
+
+const createKeys = (
+  count: number,
+  random: () => number,
+  coarse: boolean
+): DepthKey[] => {
+  const keys: DepthKey[] = [];
+  for (let index = 0; index < count; index++) {
+    const depth = random();
+    keys.push({
+      // Coarse depth makes ties fall through to order/sprite/image.
+      depthKey: coarse ? Math.round(depth * 64) / 64 : depth,
+      order: Math.floor(random() * 3),
+      spriteHandle: Math.floor(index / 2),
+      imageHandle: index % 2,
+    });
+  }
+  return keys;
+};
+
+const sortKeys = (
+  wasm: WasmHost,
+  keys: readonly DepthKey[],
+  mode: number
+): number[] => {
+  const params = wasm.allocateTypedBuffer(
+    Float64Array,
+    DEPTH_SORT_HEADER_LENGTH + keys.length * DEPTH_SORT_KEY_STRIDE
+  );
+  const result = wasm.allocateTypedBuffer(Float64Array, keys.length);
+  try {
+    const { ptr: paramsPtr, buffer } = params.prepare();
+    buffer[0] = keys.length;
+    buffer[1] = mode;
+    keys.forEach((key, index) => {
+      const base = DEPTH_SORT_HEADER_LENGTH + index * DEPTH_SORT_KEY_STRIDE;
+      buffer[base + 0] = key.depthKey;
+      buffer[base + 1] = key.order;
+      buffer[base + 2] = key.spriteHandle;
+      buffer[base + 3] = key.imageHandle;
+    });
+    const { ptr: resultPtr } = result.prepare();
+    expect(wasm.sortDepthKeys!(paramsPtr, resultPtr)).toBe(true);
+    return Array.from(result.prepare().buffer);
+  } finally {
+    result.release();
+    params.release();
+  }
+};
+
+const readTemporalStats = (wasm: WasmHost) => {
+  const holder = wasm.allocateTypedBuffer(Float64Array, TEMPORAL_STATS_LENGTH);
+  try {
+    const { ptr } = holder.prepare();
+    expect(wasm.temporalDepthSort!.getStats(ptr)).toBe(true);
+    const { buffer } = holder.prepare();
+    return {
+      frames: buffer[0]!,
+      fastPathHits: buffer[1]!,
+      inversionFallbacks: buffer[2]!,
+      coldFrames: buffer[3]!,
+    };
+  } finally {
+    holder.release();
+  }
+};
+
+// Item fields of the sprite location, see createPrepareInput.
+const ITEM_SPRITE_LOCATION = 20;
+
+const prepare = (wasm: WasmHost, input: Float64Array, itemCount: number) => {
+  const params = wasm.allocateTypedBuffer(Float64Array, input);
+  const result = wasm.allocateTypedBuffer(
+    Float64Array,
+    RESULT_HEADER_LENGTH + itemCount * RESULT_ITEM_STRIDE
+  );
+  try {
+    const { ptr: paramsPtr } = params.prepare();
+    const { ptr: resultPtr } = result.prepare();
+    expect(wasm.prepareDrawSpriteImages(paramsPtr, resultPtr)).toBe(true);
+  } finally {
+    result.release();
+    params.release();
+  }
+};
+
+const expectedOrder = (keys: readonly DepthKey[]): number[] =>
+  keys
+    .map((key, index) => ({ key, index }))
+    .sort(
+      (a, b) =>
+        a.key.depthKey - b.key.depthKey ||
+        a.key.order - b.key.order ||
+        a.key.spriteHandle - b.key.spriteHandle ||
+        a.key.imageHandle - b.key.imageHandle ||
+        a.index - b.index
+    )
+    .map((entry) => entry.index);
+
+describe('wasm depth sort', () => {
+  beforeAll(async () => {
+    const initialized = await initializeWasmHost('nosimd', {
+      force: true,
+      wasmBaseUrl: undefined,
+    });
+    if (initialized === 'disabled') {
+      throw new Error('WASM host failed to initialize.');
+    }
+  });
+
+  afterAll(() => {
+    releaseWasmHost();
+  });
+
+  it('orders keys identically in comparison and radix modes', () => {
+    const wasm = prepareWasmHost();
+    const keys = createKeys(5000, createRandom(1), true);
+    const expected = expectedOrder(keys);
+    expect(sortKeys(wasm, keys, SORT_MODE_COMPARISON)).toEqual(expected);
+    expect(sortKeys(wasm, keys, SORT_MODE_RADIX)).toEqual(expected);
+  });
+
+  it('repairs the previous order across frames', () => {
+    const wasm = prepareWasmHost();
+    wasm.temporalDepthSort!.setEnabled(false);
+    const random = createRandom(2);
+    let keys = createKeys(2000, random, false);
+
+    for (let frame = 0; frame < 8; frame++) {
+      keys = keys.map((key) => ({
+        ...key,
+        depthKey: key.depthKey + (random() - 0.5) / 100000,
+      }));
+      if (frame === 4) {
+        // A new sprite appears and another one leaves.
+        keys = keys.slice(2).concat([
+          { depthKey: 0.5, order: 0, spriteHandle: 5000, imageHandle: 0 },
+          { depthKey: 0.25, order: 1, spriteHandle: 5000, imageHandle: 1 },
+        ]);
+      }
+      expect(sortKeys(wasm, keys, SORT_MODE_TEMPORAL)).toEqual(
+        expectedOrder(keys)
+      );
+    }
+  });
+
+  it('falls back to a full sort when the order is reshuffled', () => {
+    const wasm = prepareWasmHost();
+    wasm.temporalDepthSort!.setEnabled(false);
+    const random = createRandom(3);
+    const keys = createKeys(2000, random, true);
+    sortKeys(wasm, keys, SORT_MODE_TEMPORAL);
+
+    const reversed = keys.map((key) => ({ ...key, depthKey: -key.depthKey }));
+    expect(sortKeys(wasm, reversed, SORT_MODE_TEMPORAL)).toEqual(
+      expectedOrder(reversed)
+    );
+  });
+
+  it('counts temporal prepare passes apart from standalone sorts', () => {
+    const wasm = prepareWasmHost();
+    const spriteCount = 400;
+    const input = createPrepareInput({
+      spriteCount,
+      flags: 0,
+      zoom: 16,
+      enableSurfaceBias: false,
+      resourceWidth: 32,
+      resourceHeight: 32,
+      spanLng: 0.01,
+      spanLat: 0.01,
+      item: () => ({ mode: 1, rotateDeg: 0, order: 0 }),
+    });
+    wasm.temporalDepthSort!.setEnabled(true);
+    try {
+      for (let frame = 0; frame < 3; frame++) {
+        prepare(wasm, input, spriteCount);
+      }
+      let stats = readTemporalStats(wasm);
+      expect(stats.frames).toBe(3);
+      expect(stats.coldFrames).toBe(1);
+      expect(stats.fastPathHits).toBe(2);
+
+      // Standalone sorts keep their own history.
+      const keys = createKeys(2000, createRandom(4), false);
+      sortKeys(wasm, keys, SORT_MODE_TEMPORAL);
+      sortKeys(wasm, keys, SORT_MODE_TEMPORAL);
+      expect(readTemporalStats(wasm)).toEqual(stats);
+
+      // Sprites trade places end to end, which reverses the depth order.
+      const itemOffset = input[8]!;
+      const reversed = input.slice();
+      for (let index = 0; index < spriteCount; index++) {
+        const from = itemOffset + index * ITEM_STRIDE + ITEM_SPRITE_LOCATION;
+        const to =
+          itemOffset +
+          (spriteCount - 1 - index) * ITEM_STRIDE +
+          ITEM_SPRITE_LOCATION;
+        reversed.set(input.subarray(from, from + 3), to);
+      }
+      prepare(wasm, reversed, spriteCount);
+      stats = readTemporalStats(wasm);
+      expect(stats.frames).toBe(4);
+      expect(stats.inversionFallbacks).toBe(1);
+      expect(stats.fastPathHits).toBe(2);
+    } finally {
+      wasm.temporalDepthSort!.setEnabled(false);
+    }
+  });
+});
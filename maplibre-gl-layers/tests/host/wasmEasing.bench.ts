@@ -0,0 +1,139 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, bench, describe } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmVariant,
+} from '../../src/host/wasmHost';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Every bench eases ITEM_COUNT distance channels, so items per second is the
+// reported hz multiplied by ITEM_COUNT.
+const ITEM_COUNT = 16_384;
+
+// Mirrors wasm/interpolation_layouts.h
+const PROCESS_INTERPOLATIONS_HEADER_LENGTH = 4;
+const DISTANCE_INTERPOLATION_ITEM_LENGTH = 11;
+const DISTANCE_INTERPOLATION_RESULT_LENGTH = 4;
+const PROCESS_INTERPOLATIONS_FLAG_EASING_TABLES = 1 << 0;
+
+// Encoded presets: id, param0..2 (see encodeEasingPreset).
+const PRESETS = [
+  ['linear', [0, 0, 0, 0]],
+  ['ease in-out (power 3)', [1, 3, 0, 0]],
+  ['ease in-out (power 2.5)', [1, 2.5, 0, 0]],
+  ['exponential in-out', [4, 5, 0, 0]],
+  ['quadratic in', [5, 1, 0, 0]],
+  ['cubic out', [6, 2, 0, 0]],
+  ['sine in-out', [7, 0, 1, 0]],
+  ['bounce', [8, 3, 0.5, 0]],
+  ['back', [9, 1.70158, 0, 0]],
+] as const;
+
+// Presets evaluated through easing tables when the flag is set.
+const TABLE_PRESETS = [
+  ['ease in-out (power 2.5)', [1, 2.5, 0, 0]],
+  ['exponential in-out', [4, 5, 0, 0]],
+  ['sine in-out', [7, 0, 1, 0]],
+  ['bounce', [8, 3, 0.5, 0]],
+] as const;
+
+const TIMESTAMP = 1000;
+
+/**
+ * Distance channels cycling through `presets`, with start timestamps spread
+ * so progress covers [0, 1).
+ */
+const createInput = (
+  presets: readonly (readonly number[])[],
+  flags = 0
+): Float64Array => {
+  const buffer = new Float64Array(
+    PROCESS_INTERPOLATIONS_HEADER_LENGTH +
+      ITEM_COUNT * DISTANCE_INTERPOLATION_ITEM_LENGTH
+  );
+  buffer.set([ITEM_COUNT, 0, 0, flags], 0);
+  for (let index = 0; index < ITEM_COUNT; index++) {
+    const preset = presets[index % presets.length]!;
+    buffer.set(
+      [
+        0, // offsetMeters
+        1000,
+        index,
+        index + 10,
+        index + 10,
+        ((index * 7) % 1000) + 1,
+        TIMESTAMP,
+        ...preset,
+      ],
+      PROCESS_INTERPOLATIONS_HEADER_LENGTH +
+        index * DISTANCE_INTERPOLATION_ITEM_LENGTH
+    );
+  }
+  return buffer;
+};
+
+const defineEasingBenches = (variant: WasmVariant) => {
+  describe(`easing presets (${variant})`, () => {
+    beforeAll(async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      if (initialized !== variant) {
+        throw new Error(`WASM host failed to initialize ${variant}.`);
+      }
+    });
+
+    afterAll(() => {
+      releaseWasmHost();
+    });
+
+    const inputs: (readonly [string, Float64Array])[] = [
+      ...PRESETS.map(
+        ([name, preset]) => [name, createInput([preset])] as const
+      ),
+      ['mixed presets', createInput(PRESETS.map(([, preset]) => preset))],
+      ...TABLE_PRESETS.map(
+        ([name, preset]) =>
+          [
+            `${name} (tables)`,
+            createInput([preset], PROCESS_INTERPOLATIONS_FLAG_EASING_TABLES),
+          ] as const
+      ),
+    ];
+    for (const [name, input] of inputs) {
+      bench(`${name} ${ITEM_COUNT} items`, () => {
+        const wasm = prepareWasmHost();
+        const params = wasm.allocateTypedBuffer(Float64Array, input);
+        const result = wasm.allocateTypedBuffer(
+          Float64Array,
+          PROCESS_INTERPOLATIONS_HEADER_LENGTH +
+            ITEM_COUNT * DISTANCE_INTERPOLATION_RESULT_LENGTH
+        );
+        try {
+          const { ptr: paramsPtr } = params.prepare();
+          const { ptr: resultPtr } = result.prepare();
+          if (!wasm.processInterpolations(paramsPtr, resultPtr)) {
+            throw new Error('processInterpolations failed.');
+          }
+        } finally {
+          result.release();
+          params.release();
+        }
+      });
+    }
+  });
+};
+
+// `nosimd` runs the same kernels one lane at a time.
+defineEasingBenches('simd');
+defineEasingBenches('nosimd');
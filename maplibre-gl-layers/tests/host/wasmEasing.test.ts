@@ -12,7 +12,9 @@ import {
   releaseWasmHost,
 } from '../../src/host/wasmHost';
 import { __wasmCalculationTestInternals } from '../../src/host/wasmCalculationHost';
+import { resolveEasing } from '../../src/interpolation/easing';
 import type { SpriteInterpolationState } from '../../src/internalTypes';
+import type { SpriteEasingParam } from '../../src/types';
 
 describe('wasm easing presets', () => {
   beforeAll(async () => {
@@ -94,4 +96,200 @@ describe('wasm easing presets', () => {
     expect(result.distance[0]?.value).toBeCloseTo(expectedBounce);
     expect(result.distance[0]?.completed).toBe(false);
   });
+
+  it('eases a mixed batch of presets like the host easing functions', () => {
+    const wasm = prepareWasmHost();
+    const presets: readonly SpriteEasingParam[] = [
+      { type: 'linear' },
+      { type: 'ease', mode: 'in-out', power: 3 },
+      { type: 'ease', mode: 'in', power: 2.5 },
+      { type: 'exponential', mode: 'out', exponent: 4 },
+      { type: 'quadratic', mode: 'in-out' },
+      { type: 'cubic', mode: 'out' },
+      { type: 'sine', mode: 'in', amplitude: 0.8 },
+      { type: 'bounce', bounces: 3, decay: 0.5 },
+      { type: 'back', overshoot: 1.70158 },
+    ];
+    // Spans several easing batches so bucket ordering is exercised.
+    const count = 600;
+    const timestamp = 1000;
+    const states: SpriteInterpolationState<number>[] = [];
+    for (let index = 0; index < count; index++) {
+      states.push({
+        mode: 'feedback',
+        durationMs: 1000,
+        easingFunc: (t: number) => t,
+        easingParam: presets[(index * 5) % presets.length]!,
+        from: 0,
+        to: 1,
+        startTimestamp: ((index * 37) % 999) + 1,
+      });
+    }
+
+    const result =
+      __wasmCalculationTestInternals.internalProcessInterpolationsCore(
+        wasm,
+        {
+          distance: states,
+          degree: [],
+          location: [],
+        },
+        timestamp
+      );
+
+    states.forEach((state, index) => {
+      const progress = (timestamp - state.startTimestamp) / state.durationMs;
+      const expected = resolveEasing(state.easingParam).func(progress);
+      const actual = result.distance[index]?.value ?? Number.NaN;
+      expect(Math.abs(actual - expected)).toBeLessThan(1e-9);
+      expect(result.distance[index]?.completed).toBe(false);
+    });
+  });
+
+  it('keeps exponential easing precise for tiny exponents', () => {
+    const wasm = prepareWasmHost();
+    const timestamp = 1000;
+    const states: SpriteInterpolationState<number>[] = [];
+    for (const exponent of [1e-12, 1e-20]) {
+      for (const mode of ['in', 'out', 'in-out'] as const) {
+        for (const startTimestamp of [100, 250, 500, 750, 900]) {
+          states.push({
+            mode: 'feedback',
+            durationMs: 1000,
+            easingFunc: (t: number) => t,
+            easingParam: { type: 'exponential', mode, exponent },
+            from: 0,
+            to: 1,
+            startTimestamp,
+          });
+        }
+      }
+    }
+
+    const result =
+      __wasmCalculationTestInternals.internalProcessInterpolationsCore(
+        wasm,
+        {
+          distance: states,
+          degree: [],
+          location: [],
+        },
+        timestamp
+      );
+
+    states.forEach((state, index) => {
+      const progress = (timestamp - state.startTimestamp) / state.durationMs;
+      const expected = resolveEasing(state.easingParam).func(progress);
+      const actual = result.distance[index]?.value ?? Number.NaN;
+      expect(Number.isFinite(actual)).toBe(true);
+      expect(Math.abs(actual - expected)).toBeLessThan(1e-9);
+    });
+  });
+
+  it('keeps easing tables within 1e-4 of the exact presets', () => {
+    const wasm = prepareWasmHost();
+    // Includes parameter sets that cannot be tabulated (power below one, very
+    // many bounces); those keep the exact kernels.
+    const presets: readonly SpriteEasingParam[] = [
+      { type: 'ease', mode: 'in-out', power: 2.5 },
+      { type: 'ease', mode: 'out', power: 1.2 },
+      { type: 'ease', mode: 'in', power: 0.5 },
+      { type: 'exponential', mode: 'in-out', exponent: 5 },
+      { type: 'exponential', mode: 'in', exponent: 20 },
+      { type: 'sine', mode: 'in-out', amplitude: 1 },
+      { type: 'sine', mode: 'out', amplitude: 0.8 },
+      { type: 'bounce', bounces: 3, decay: 0.5 },
+      { type: 'bounce', bounces: 8, decay: 0.9 },
+      { type: 'bounce', bounces: 100, decay: 0.5 },
+    ];
+    const samplesPerPreset = 500;
+    const timestamp = 1000;
+    const states: SpriteInterpolationState<number>[] = [];
+    presets.forEach((preset) => {
+      for (let index = 0; index < samplesPerPreset; index++) {
+        states.push({
+          mode: 'feedback',
+          durationMs: 1000,
+          easingFunc: (t: number) => t,
+          easingParam: preset,
+          from: 0,
+          to: 1,
+          startTimestamp: ((index * 997) % 999) + 1,
+        });
+      }
+    });
+    const requests = { distance: states, degree: [], location: [] };
+
+    const tabulated =
+      __wasmCalculationTestInternals.internalProcessInterpolationsCore(
+        wasm,
+        requests,
+        timestamp,
+        true
+      );
+    const exact =
+      __wasmCalculationTestInternals.internalProcessInterpolationsCore(
+        wasm,
+        requests,
+        timestamp,
+        false
+      );
+
+    states.forEach((state, index) => {
+      const progress = (timestamp - state.startTimestamp) / state.durationMs;
+      const expected = resolveEasing(state.easingParam).func(progress);
+      const tabulatedValue = tabulated.distance[index]?.value ?? Number.NaN;
+      const exactValue = exact.distance[index]?.value ?? Number.NaN;
+      expect(Math.abs(tabulatedValue - expected)).toBeLessThan(1e-4);
+      expect(Math.abs(exactValue - expected)).toBeLessThan(1e-9);
+      expect(tabulated.distance[index]?.completed).toBe(
+        exact.distance[index]?.completed
+      );
+    });
+  });
+
+  it('keeps easing tables accurate while parameter sets come and go', () => {
+    const wasm = prepareWasmHost();
+    // More parameter sets than the module caches, shifting every batch, so
+    // later batches run on tables rebuilt after eviction.
+    const batchPresets = (batch: number): SpriteEasingParam[] =>
+      Array.from({ length: 24 }, (_, index) => ({
+        type: 'ease',
+        mode: 'in-out',
+        power: 1.5 + (batch * 12 + index) * 0.05,
+      }));
+    const timestamp = 1000;
+    for (let batch = 0; batch < 6; batch++) {
+      const states: SpriteInterpolationState<number>[] = batchPresets(
+        batch
+      ).flatMap((preset) =>
+        [100, 350, 600, 850].map((startTimestamp) => ({
+          mode: 'feedback' as const,
+          durationMs: 1000,
+          easingFunc: (t: number) => t,
+          easingParam: preset,
+          from: 0,
+          to: 1,
+          startTimestamp,
+        }))
+      );
+      const tabulated =
+        __wasmCalculationTestInternals.internalProcessInterpolationsCore(
+          wasm,
+          { distance: states, degree: [], location: [] },
+          timestamp,
+          true
+        );
+      states.forEach((state, index) => {
+        const progress =
+          (timestamp - state.startTimestamp) / state.durationMs;
+        const expected = resolveEasing(state.easingParam).func(progress);
+        expect(
+          Math.abs(
+            (tabulated.distance[index]?.value ?? Number.NaN) - expected
+          )
+        ).toBeLessThan(1e-4);
+      });
+    }
+  });
 });
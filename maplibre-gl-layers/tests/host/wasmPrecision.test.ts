@@ -11,7 +11,11 @@ import {
   type ProjectionHostParams,
 } from '../../src/host/projectionHost';
 import { createWasmProjectionHost } from '../../src/host/wasmProjectionHost';
-import { initializeWasmHost } from '../../src/host/wasmHost';
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  WASM_BATCH_FLAG_FAST_MERCATOR_MATH,
+} from '../../src/host/wasmHost';
 
 //////////////////////////////////////////////////////////////////////////////////////
 
@@ -114,3 +118,129 @@ describe('wasm fromLngLat precision', () => {
     //);
   }, 60_000);
 });
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Zoom 22 world size, where one mercator unit is 2^31 pixels.
+const FAST_MATH_WORLD_SIZE = 512 * 2 ** 22;
+const FAST_MATH_SAMPLE_COUNT = 200_000;
+const IDENTITY_MATRIX = [1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1];
+
+/**
+ * Runs `projectMany` or `unprojectMany` with the identity matrix, so the
+ * output is the raw mercator conversion scaled by the world size.
+ */
+const runIdentityBatch = (
+  kind: 'project' | 'unproject',
+  points: Float64Array,
+  stride: number,
+  flags: number
+): Float64Array => {
+  const wasm = prepareWasmHost();
+  const invoke = kind === 'project' ? wasm.projectMany : wasm.unprojectMany;
+  if (!invoke) {
+    throw new Error(`${kind}Many is not exported.`);
+  }
+  const count = points.length / stride;
+  const input = wasm.allocateTypedBuffer(Float64Array, points);
+  const matrix = wasm.allocateTypedBuffer(Float64Array, IDENTITY_MATRIX);
+  const output = wasm.allocateTypedBuffer(Float64Array, count * 2);
+  const mask = wasm.allocateTypedBuffer(Uint32Array, Math.ceil(count / 32));
+  try {
+    const { ptr: inputPtr } = input.prepare();
+    const { ptr: matrixPtr } = matrix.prepare();
+    const { ptr: outputPtr } = output.prepare();
+    const { ptr: maskPtr } = mask.prepare();
+    if (
+      !invoke(
+        inputPtr,
+        count,
+        stride,
+        FAST_MATH_WORLD_SIZE,
+        matrixPtr,
+        outputPtr,
+        maskPtr,
+        flags
+      )
+    ) {
+      throw new Error(`${kind}Many failed.`);
+    }
+    return output.prepare().buffer.slice();
+  } finally {
+    mask.release();
+    output.release();
+    matrix.release();
+    input.release();
+  }
+};
+
+const maxAbsDiff = (a: Float64Array, b: Float64Array): number => {
+  let max = 0;
+  for (let index = 0; index < a.length; index++) {
+    const diff = Math.abs(a[index]! - b[index]!);
+    if (!(diff <= max)) {
+      max = diff;
+    }
+  }
+  return max;
+};
+
+describe.each(['nosimd', 'simd'] as const)(
+  'wasm fast mercator math precision (%s)',
+  (variant) => {
+    it('keeps projected points within 1e-4 pixels at zoom 22', async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      expect(initialized).toBe(variant);
+
+      const random = createMulberry32(RANDOM_SEED);
+      const points = new Float64Array(FAST_MATH_SAMPLE_COUNT * 3);
+      for (let index = 0; index < FAST_MATH_SAMPLE_COUNT; index++) {
+        points[index * 3] = randomInRange(random, -180, 180);
+        points[index * 3 + 1] =
+          index === 0
+            ? 85.051129
+            : index === 1
+              ? -85.051129
+              : randomInRange(random, -85.051129, 85.051129);
+      }
+
+      const exact = runIdentityBatch('project', points, 3, 0);
+      const fast = runIdentityBatch(
+        'project',
+        points,
+        3,
+        WASM_BATCH_FLAG_FAST_MERCATOR_MATH
+      );
+
+      expect(maxAbsDiff(exact, fast)).toBeLessThanOrEqual(1e-4);
+    }, 60_000);
+
+    it('keeps unprojected latitudes within 5e-11 degrees', async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      expect(initialized).toBe(variant);
+
+      const random = createMulberry32(RANDOM_SEED);
+      const points = new Float64Array(FAST_MATH_SAMPLE_COUNT * 2);
+      for (let index = 0; index < FAST_MATH_SAMPLE_COUNT; index++) {
+        points[index * 2] = randomInRange(random, 0, FAST_MATH_WORLD_SIZE);
+        points[index * 2 + 1] = randomInRange(random, 0, FAST_MATH_WORLD_SIZE);
+      }
+
+      const exact = runIdentityBatch('unproject', points, 2, 0);
+      const fast = runIdentityBatch(
+        'unproject',
+        points,
+        2,
+        WASM_BATCH_FLAG_FAST_MERCATOR_MATH
+      );
+
+      expect(maxAbsDiff(exact, fast)).toBeLessThanOrEqual(5e-11);
+    }, 60_000);
+  }
+);
@@ -0,0 +1,209 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import {
+  prepareProjectionState,
+  type ProjectionHostParams,
+} from '../../src/host/projectionHost';
+import {
+  EPS_NDC,
+  MIN_CLIP_Z_EPSILON,
+  ORDER_BUCKET,
+  ORDER_MAX,
+} from '../../src/const';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Shared prepareDrawSpriteImages input builder for the prepare benches and
+// tests.
+
+// Mirrors wasm/calculation_host_layouts.h
+export const INPUT_HEADER_LENGTH = 15;
+export const INPUT_FRAME_CONSTANT_LENGTH = 27;
+export const INPUT_MATRIX_LENGTH = 48;
+export const RESOURCE_STRIDE = 9;
+export const ITEM_STRIDE = 27;
+export const RESULT_HEADER_LENGTH = 13;
+export const RESULT_ITEM_STRIDE = 132;
+
+export const WIDTH = 1024;
+export const HEIGHT = 768;
+
+export const BASE_PARAMS: ProjectionHostParams = {
+  zoom: 16,
+  width: WIDTH,
+  height: HEIGHT,
+  center: { lng: 139.7514, lat: 35.685, z: 0 },
+  cameraLocation: { lng: 139.7514, lat: 35.68, z: 500 },
+  pitchDeg: 40,
+  bearingDeg: 20,
+  fovDeg: 36.87,
+  cameraToCenterDistance: 1150,
+  tileSize: 512,
+  autoCalculateNearFarZ: true,
+};
+
+/**
+ * Writes the frame constants and matrices of `BASE_PARAMS` (optionally at
+ * another zoom) into a marshalled prepare input.
+ */
+export const writePrepareFrame = (
+  buffer: Float64Array,
+  matrixOffset: number,
+  options?: { readonly zoom?: number; readonly enableSurfaceBias?: boolean }
+): void => {
+  const projection = prepareProjectionState({
+    ...BASE_PARAMS,
+    zoom: options?.zoom ?? BASE_PARAMS.zoom,
+  });
+  const camera = projection.cameraLocation ?? { lng: 0, lat: 0, z: 0 };
+  buffer.set(
+    [
+      projection.zoom,
+      projection.worldSize,
+      projection.pixelPerMeter,
+      projection.cameraToCenterDistance,
+      1,
+      0,
+      0,
+      WIDTH,
+      HEIGHT,
+      1,
+      1,
+      1,
+      1,
+      0,
+      0,
+      2 / WIDTH,
+      -2 / HEIGHT,
+      -1,
+      1,
+      MIN_CLIP_Z_EPSILON,
+      ORDER_BUCKET,
+      ORDER_MAX,
+      EPS_NDC,
+      (options?.enableSurfaceBias ?? true) ? 1 : 0,
+      camera.lng,
+      camera.lat,
+      camera.z ?? 0,
+    ],
+    INPUT_HEADER_LENGTH
+  );
+  buffer.set(projection.mercatorMatrix!, matrixOffset);
+  buffer.set(projection.pixelMatrix!, matrixOffset + 16);
+  buffer.set(projection.pixelMatrixInverse!, matrixOffset + 32);
+};
+
+/** Per-item fields that differ between the benches. */
+export interface PrepareInputItem {
+  /** 0: surface, 1: billboard. */
+  readonly mode: number;
+  readonly rotateDeg: number;
+  readonly order: number;
+}
+
+export interface PrepareInputOptions {
+  /** One item per sprite. */
+  readonly spriteCount: number;
+  /** INPUT_FLAG_* bits of the input header. */
+  readonly flags: number;
+  readonly zoom: number;
+  /** Frame constant `enableNdcBiasSurface`. */
+  readonly enableSurfaceBias: boolean;
+  /** Size of the single resource; 0x0 stops each item before its kernel. */
+  readonly resourceWidth: number;
+  readonly resourceHeight: number;
+  /** Sprites cover a grid of this size (degrees) around the map center. */
+  readonly spanLng: number;
+  readonly spanLat: number;
+  readonly item: (index: number) => PrepareInputItem;
+}
+
+/**
+ * Builds a marshalled prepareDrawSpriteImages input: one resource and
+ * `spriteCount` sprites on a square grid, one image each. Every fourth
+ * sprite is raised 12 m.
+ */
+export const createPrepareInput = (
+  options: PrepareInputOptions
+): Float64Array => {
+  const { spriteCount } = options;
+  const matrixOffset = INPUT_HEADER_LENGTH + INPUT_FRAME_CONSTANT_LENGTH;
+  const resourceOffset = matrixOffset + INPUT_MATRIX_LENGTH;
+  const itemOffset = resourceOffset + RESOURCE_STRIDE;
+  const totalLength = itemOffset + spriteCount * ITEM_STRIDE;
+  const buffer = new Float64Array(totalLength);
+
+  buffer.set(
+    [
+      totalLength,
+      INPUT_FRAME_CONSTANT_LENGTH,
+      matrixOffset,
+      1,
+      resourceOffset,
+      0,
+      0,
+      spriteCount,
+      itemOffset,
+      options.flags,
+      0,
+    ],
+    0
+  );
+
+  writePrepareFrame(buffer, matrixOffset, {
+    zoom: options.zoom,
+    enableSurfaceBias: options.enableSurfaceBias,
+  });
+  buffer.set(
+    [0, options.resourceWidth, options.resourceHeight, 1, -1, 0, 0, 1, 1],
+    resourceOffset
+  );
+
+  const center = BASE_PARAMS.center;
+  const columns = Math.ceil(Math.sqrt(spriteCount));
+  for (let index = 0; index < spriteCount; index++) {
+    const lng =
+      center.lng + ((index % columns) / columns - 0.5) * options.spanLng;
+    const lat =
+      center.lat +
+      (Math.floor(index / columns) / columns - 0.5) * options.spanLat;
+    const item = options.item(index);
+    buffer.set(
+      [
+        index,
+        0,
+        -1,
+        0,
+        item.mode,
+        1,
+        1,
+        0,
+        0,
+        0,
+        0,
+        item.rotateDeg,
+        0,
+        0,
+        item.order,
+        0,
+        -1,
+        -1,
+        -1,
+        0,
+        lng,
+        lat,
+        index % 4 === 0 ? 12 : 0,
+        -1,
+        -1,
+        0,
+        index,
+      ],
+      itemOffset + index * ITEM_STRIDE
+    );
+  }
+  return buffer;
+};
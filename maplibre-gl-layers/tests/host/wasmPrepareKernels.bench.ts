@@ -0,0 +1,103 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, bench, describe } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmVariant,
+} from '../../src/host/wasmHost';
+import {
+  createPrepareInput,
+  RESULT_HEADER_LENGTH,
+  RESULT_ITEM_STRIDE,
+} from './wasmPrepareInput';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+const SPRITE_COUNT = 20_000;
+
+// Mirrors INPUT_FLAG_* in wasm/calculation_host.cpp; every combination
+// selects a different pair of prepare kernels.
+const FLAG_COMBINATIONS = [
+  ['cpu geometry', 0],
+  ['shader surface', 1],
+  ['shader billboard', 2],
+  ['shader geometry', 3],
+] as const;
+const FLAG_ENABLE_NDC_BIAS_SURFACE = 4;
+
+/**
+ * Alternating surfaces and billboards inside the viewport, all with a real
+ * resource, so every item runs through its prepare kernel.
+ */
+const createInput = (
+  spriteCount: number,
+  flags: number,
+  enableSurfaceBias: boolean
+): Float64Array =>
+  createPrepareInput({
+    spriteCount,
+    flags: flags | (enableSurfaceBias ? FLAG_ENABLE_NDC_BIAS_SURFACE : 0),
+    zoom: 16,
+    enableSurfaceBias,
+    resourceWidth: 24,
+    resourceHeight: 16,
+    spanLng: 0.004,
+    spanLat: 0.003,
+    item: (index) => ({
+      mode: index % 2, // surface or billboard
+      rotateDeg: (index * 30) % 360,
+      order: index % 3,
+    }),
+  });
+
+const definePrepareKernelBenches = (variant: WasmVariant) => {
+  describe(`prepare kernels (${variant})`, () => {
+    beforeAll(async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      if (initialized !== variant) {
+        throw new Error(`WASM host failed to initialize ${variant}.`);
+      }
+    });
+
+    afterAll(() => {
+      releaseWasmHost();
+    });
+
+    for (const [flagsName, flags] of FLAG_COMBINATIONS) {
+      for (const enableSurfaceBias of [false, true]) {
+        const input = createInput(SPRITE_COUNT, flags, enableSurfaceBias);
+        const biasName = enableSurfaceBias ? 'with bias' : 'without bias';
+        bench(`${flagsName} ${biasName} ${SPRITE_COUNT} sprites`, () => {
+          const wasm = prepareWasmHost();
+          const params = wasm.allocateTypedBuffer(Float64Array, input);
+          const result = wasm.allocateTypedBuffer(
+            Float64Array,
+            RESULT_HEADER_LENGTH + SPRITE_COUNT * RESULT_ITEM_STRIDE
+          );
+          try {
+            const { ptr: paramsPtr } = params.prepare();
+            const { ptr: resultPtr } = result.prepare();
+            if (!wasm.prepareDrawSpriteImages(paramsPtr, resultPtr)) {
+              throw new Error('prepareDrawSpriteImages failed.');
+            }
+          } finally {
+            result.release();
+            params.release();
+          }
+        });
+      }
+    }
+  });
+};
+
+definePrepareKernelBenches('simd');
@@ -0,0 +1,550 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, describe, expect, it } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+} from '../../src/host/wasmHost';
+import {
+  BASE_PARAMS,
+  RESULT_HEADER_LENGTH,
+  RESULT_ITEM_STRIDE,
+} from './wasmPrepareInput';
+import {
+  createScene,
+  FLAGS_SHADER_GEOMETRY,
+  prepareMarshalled,
+  RESULT_HEADER_SURFACE_COUNT,
+  RESULT_STREAM_ITEM_STRIDE,
+  RESULT_SURFACE_RECORD_STRIDE,
+} from './wasmPrepareScene';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Mirrors wasm/calculation_host_layouts.h
+const FRAME_ARENA_STATS_LENGTH = 7;
+const RESULT_HEADER_CULLED_COUNT = 5;
+
+// Mirrors INPUT_FLAG_* in wasm/calculation_host.cpp
+const FLAG_ENABLE_VIEWPORT_CULLING = 8;
+const FLAG_FLOAT32_RESULT = 32;
+const FLAG_VERTEX_OUTPUT = 64;
+const FLAG_INSTANCE_OUTPUT = 128;
+const FLAG_SURFACE_STREAM = 256;
+const RESULT_FLAG_VERTEX_OUTPUT = 8;
+const RESULT_FLAG_INSTANCE_OUTPUT = 16;
+const RESULT_FLAG_SURFACE_STREAM = 32;
+const RESULT_INSTANCE_RECORD_LENGTH = 16;
+const RESULT_HEADER_FLAGS = 4;
+const RESULT_COMMON_ITEM_LENGTH = 20;
+const RESULT_VERTEX_COMPONENT_LENGTH = 36;
+const RESULT_VERTEXLESS_ITEM_STRIDE = 96;
+
+// Mirrors RESULT_FLOAT32_* in wasm/calculation_host_layouts.h
+const RESULT_ID_COMPONENT_LENGTH = 3;
+const RESULT_FLOAT32_COMPONENT_LENGTH = 64;
+const RESULT_FLOAT32_ITEM_STRIDE = 66;
+const RESULT_SURFACE_BLOCK_LENGTH = 68;
+const RESULT_HEADER_ANCHOR = 6; // mercator x/y, lng/lat
+const RESULT_FLOAT32_STREAM_ITEM_STRIDE = 32;
+const RESULT_FLOAT32_SURFACE_RECORD_STRIDE = 35;
+const ITEM_RESULT_USE_SHADER_SURFACE = 8;
+const ITEM_RESULT_BILLBOARD_CENTER = 11; // center x/y, half width/height
+// Surface block slots that carry absolute coordinates
+const SURFACE_MERCATOR_SLOTS = [0, 1];
+const SURFACE_LNG_LAT_SLOTS = [45, 48, 54, 58, 62, 66];
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+describe('wasm prepare output', () => {
+  beforeAll(async () => {
+    const initialized = await initializeWasmHost('nosimd', {
+      force: true,
+      wasmBaseUrl: undefined,
+    });
+    if (initialized === 'disabled') {
+      throw new Error('WASM host failed to initialize.');
+    }
+  });
+
+  afterAll(() => {
+    releaseWasmHost();
+  });
+
+  it('reuses the frame arena once it has grown to the workload', () => {
+    const wasm = prepareWasmHost();
+    expect(wasm.getFrameArenaStats).toBeDefined();
+    const scene = createScene(200);
+
+    const readStats = () => {
+      const holder = wasm.allocateTypedBuffer(
+        Float64Array,
+        FRAME_ARENA_STATS_LENGTH
+      );
+      try {
+        expect(wasm.getFrameArenaStats!(holder.prepare().ptr)).toBe(true);
+        const { buffer } = holder.prepare();
+        return {
+          frames: buffer[0]!,
+          reservedBytes: buffer[2]!,
+          lastFrameBytes: buffer[4]!,
+          blockAllocations: buffer[6]!,
+        };
+      } finally {
+        holder.release();
+      }
+    };
+
+    prepareMarshalled(wasm, scene);
+    const first = prepareMarshalled(wasm, scene);
+    const settled = readStats();
+    const expected = prepareMarshalled(wasm, scene);
+    const reused = readStats();
+
+    expect(reused.frames).toBe(settled.frames + 1);
+    expect(reused.lastFrameBytes).toBeGreaterThan(0);
+    expect(reused.lastFrameBytes).toBe(settled.lastFrameBytes);
+    expect(reused.reservedBytes).toBeGreaterThanOrEqual(reused.lastFrameBytes);
+    expect(reused.blockAllocations).toBe(settled.blockAllocations);
+    expect(Array.from(expected)).toEqual(Array.from(first));
+  });
+
+  it('culls images outside the viewport without changing visible ones', () => {
+    const wasm = prepareWasmHost();
+    const scene = createScene(60);
+    // Push every other row of sprites far beyond the viewport.
+    scene.sprites.forEach((sprite, index) => {
+      if (Math.floor(index / 7) % 2 === 0) {
+        return;
+      }
+      sprite.lng += 0.05;
+      scene.items.forEach((entry) => {
+        if (entry[0] === sprite.handle) {
+          entry[20] = sprite.lng;
+        }
+      });
+    });
+
+    const full = prepareMarshalled(wasm, scene);
+    const culled = prepareMarshalled(
+      wasm,
+      scene,
+      FLAGS_SHADER_GEOMETRY | FLAG_ENABLE_VIEWPORT_CULLING,
+      32
+    );
+    expect(full[RESULT_HEADER_CULLED_COUNT]).toBe(0);
+    const culledCount = culled[RESULT_HEADER_CULLED_COUNT]!;
+    expect(culledCount).toBeGreaterThan(0);
+    expect(culled[0]!).toBeLessThan(full[0]!);
+
+    // Surviving items keep their exact output and relative order.
+    const readItem = (buffer: Float64Array, index: number) =>
+      Array.from(
+        buffer.subarray(
+          RESULT_HEADER_LENGTH + index * RESULT_ITEM_STRIDE,
+          RESULT_HEADER_LENGTH + (index + 1) * RESULT_ITEM_STRIDE
+        )
+      );
+    const fullIndices = new Map<string, number>();
+    for (let index = 0; index < full[0]!; index++) {
+      const item = readItem(full, index);
+      fullIndices.set(`${item[0]}:${item[1]}`, index);
+    }
+    let previous = -1;
+    for (let index = 0; index < culled[0]!; index++) {
+      const item = readItem(culled, index);
+      const fullIndex = fullIndices.get(`${item[0]}:${item[1]}`);
+      expect(fullIndex).toBeDefined();
+      expect(fullIndex!).toBeGreaterThan(previous);
+      expect(item).toEqual(readItem(full, fullIndex!));
+      previous = fullIndex!;
+    }
+  });
+
+  it('narrows float32 result items relative to the frame anchor', () => {
+    const wasm = prepareWasmHost();
+    const scene = createScene(40);
+
+    for (const flags of [0, FLAGS_SHADER_GEOMETRY]) {
+      const expected = prepareMarshalled(wasm, scene, flags);
+      const narrowed = prepareMarshalled(
+        wasm,
+        scene,
+        flags | FLAG_FLOAT32_RESULT
+      );
+      expect(narrowed[0]).toBe(expected[0]);
+      expect(expected[1]).toBe(RESULT_ITEM_STRIDE);
+      expect(narrowed[1]).toBe(RESULT_FLOAT32_ITEM_STRIDE);
+
+      const floats = new Float32Array(
+        narrowed.buffer,
+        narrowed.byteOffset,
+        narrowed.length * 2
+      );
+      const ids = new Int32Array(
+        narrowed.buffer,
+        narrowed.byteOffset,
+        narrowed.length * 2
+      );
+      for (let index = 0; index < expected[0]!; index++) {
+        const expectedBase = RESULT_HEADER_LENGTH + index * RESULT_ITEM_STRIDE;
+        const narrowedBase =
+          RESULT_HEADER_LENGTH + index * RESULT_FLOAT32_ITEM_STRIDE;
+        const componentBase = narrowedBase * 2;
+        for (let i = 0; i < RESULT_ID_COMPONENT_LENGTH; i++) {
+          expect(ids[componentBase + i]).toBe(expected[expectedBase + i]);
+        }
+        for (
+          let i = RESULT_ID_COMPONENT_LENGTH;
+          i < RESULT_COMMON_ITEM_LENGTH;
+          i++
+        ) {
+          expect(floats[componentBase + i]).toBe(
+            Math.fround(expected[expectedBase + i]!)
+          );
+        }
+
+        // Billboard quads are computed in float32, so vertices and hit test
+        // stay within float32 precision of the quad's screen extent rather
+        // than matching the narrowed double path bit for bit.
+        const extent =
+          Math.max(
+            1,
+            Math.abs(expected[expectedBase + ITEM_RESULT_BILLBOARD_CENTER]!),
+            Math.abs(expected[expectedBase + ITEM_RESULT_BILLBOARD_CENTER + 1]!)
+          ) +
+          Math.abs(expected[expectedBase + ITEM_RESULT_BILLBOARD_CENTER + 2]!) +
+          Math.abs(expected[expectedBase + ITEM_RESULT_BILLBOARD_CENTER + 3]!);
+        for (
+          let i = RESULT_COMMON_ITEM_LENGTH;
+          i < RESULT_FLOAT32_COMPONENT_LENGTH;
+          i++
+        ) {
+          const reference = expected[expectedBase + i]!;
+          expect(
+            Math.abs(floats[componentBase + i]! - reference)
+          ).toBeLessThanOrEqual(
+            Math.max(extent, Math.abs(reference)) * 2 ** -20
+          );
+        }
+
+        // Absolute surface coordinates are narrowed after subtracting the
+        // anchor, so they stay well below a pixel off once rebased.
+        const surface = Array.from(
+          expected.subarray(
+            expectedBase + RESULT_FLOAT32_COMPONENT_LENGTH,
+            expectedBase +
+              RESULT_FLOAT32_COMPONENT_LENGTH +
+              RESULT_SURFACE_BLOCK_LENGTH
+          )
+        );
+        if (expected[expectedBase + ITEM_RESULT_USE_SHADER_SURFACE] === 1) {
+          const rebase = (slot: number, anchorIndex: number) => {
+            surface[slot] =
+              surface[slot]! - narrowed[RESULT_HEADER_ANCHOR + anchorIndex]!;
+          };
+          SURFACE_MERCATOR_SLOTS.forEach((slot, index) => rebase(slot, index));
+          for (const slot of SURFACE_LNG_LAT_SLOTS) {
+            rebase(slot, 2);
+            rebase(slot + 1, 3);
+          }
+          const surfaceStart = componentBase + RESULT_FLOAT32_COMPONENT_LENGTH;
+          const rebasedX =
+            floats[surfaceStart]! + narrowed[RESULT_HEADER_ANCHOR]!;
+          const worldSize = 512 * 2 ** BASE_PARAMS.zoom;
+          expect(
+            Math.abs(
+              rebasedX -
+                expected[expectedBase + RESULT_FLOAT32_COMPONENT_LENGTH]!
+            ) * worldSize
+          ).toBeLessThan(1e-3);
+        }
+        for (let i = 0; i < RESULT_SURFACE_BLOCK_LENGTH; i++) {
+          expect(
+            floats[componentBase + RESULT_FLOAT32_COMPONENT_LENGTH + i]
+          ).toBe(Math.fround(surface[i]!));
+        }
+      }
+    }
+  });
+
+  it('writes interleaved float32 vertices to the caller region', () => {
+    const wasm = prepareWasmHost();
+    const scene = createScene(40);
+    const regionLength = scene.items.length * RESULT_VERTEX_COMPONENT_LENGTH;
+    const region = wasm.allocateTypedBuffer(Float32Array, regionLength);
+    try {
+      for (const flags of [0, FLAGS_SHADER_GEOMETRY]) {
+        const expected = prepareMarshalled(wasm, scene, flags);
+        const { ptr } = region.prepare();
+        const result = prepareMarshalled(
+          wasm,
+          scene,
+          flags | FLAG_VERTEX_OUTPUT,
+          undefined,
+          { ptr, length: regionLength }
+        );
+        expect(result[RESULT_HEADER_FLAGS]! & RESULT_FLAG_VERTEX_OUTPUT).toBe(
+          RESULT_FLAG_VERTEX_OUTPUT
+        );
+        expect(
+          expected[RESULT_HEADER_FLAGS]! & RESULT_FLAG_VERTEX_OUTPUT
+        ).toBe(0);
+        // Result items keep everything but the vertex block.
+        expect(result[0]).toBe(expected[0]);
+        expect(result[1]).toBe(RESULT_VERTEXLESS_ITEM_STRIDE);
+        const { buffer } = region.prepare();
+        for (let index = 0; index < expected[0]!; index++) {
+          const expectedBase = RESULT_HEADER_LENGTH + index * RESULT_ITEM_STRIDE;
+          const resultBase =
+            RESULT_HEADER_LENGTH + index * RESULT_VERTEXLESS_ITEM_STRIDE;
+          expect(
+            Array.from(
+              result.subarray(resultBase, resultBase + RESULT_COMMON_ITEM_LENGTH)
+            )
+          ).toEqual(
+            Array.from(
+              expected.subarray(
+                expectedBase,
+                expectedBase + RESULT_COMMON_ITEM_LENGTH
+              )
+            )
+          );
+          expect(
+            Array.from(
+              result.subarray(
+                resultBase + RESULT_COMMON_ITEM_LENGTH,
+                resultBase + RESULT_VERTEXLESS_ITEM_STRIDE
+              )
+            )
+          ).toEqual(
+            Array.from(
+              expected.subarray(
+                expectedBase +
+                  RESULT_COMMON_ITEM_LENGTH +
+                  RESULT_VERTEX_COMPONENT_LENGTH,
+                expectedBase + RESULT_ITEM_STRIDE
+              )
+            )
+          );
+
+          const vertexBase = expectedBase + RESULT_COMMON_ITEM_LENGTH;
+          for (let i = 0; i < RESULT_VERTEX_COMPONENT_LENGTH; i++) {
+            expect(buffer[index * RESULT_VERTEX_COMPONENT_LENGTH + i]).toBe(
+              Math.fround(expected[vertexBase + i]!)
+            );
+          }
+        }
+
+        // An undersized region is ignored rather than overrun.
+        const undersized = prepareMarshalled(
+          wasm,
+          scene,
+          flags | FLAG_VERTEX_OUTPUT,
+          undefined,
+          { ptr, length: regionLength - 1 }
+        );
+        expect(
+          undersized[RESULT_HEADER_FLAGS]! & RESULT_FLAG_VERTEX_OUTPUT
+        ).toBe(0);
+      }
+    } finally {
+      region.release();
+    }
+  });
+
+  it('writes one instance record per prepared item', () => {
+    const wasm = prepareWasmHost();
+    const scene = createScene(40);
+    const regionLength = scene.items.length * RESULT_INSTANCE_RECORD_LENGTH;
+    const region = wasm.allocateTypedBuffer(Float32Array, regionLength);
+    try {
+      for (const flags of [0, FLAGS_SHADER_GEOMETRY]) {
+        const expected = prepareMarshalled(wasm, scene, flags);
+        const { ptr } = region.prepare();
+        const result = prepareMarshalled(
+          wasm,
+          scene,
+          flags | FLAG_INSTANCE_OUTPUT,
+          undefined,
+          undefined,
+          { ptr, length: regionLength }
+        );
+        expect(
+          result[RESULT_HEADER_FLAGS]! & RESULT_FLAG_INSTANCE_OUTPUT
+        ).toBe(RESULT_FLAG_INSTANCE_OUTPUT);
+        expect(result.length).toBe(expected.length);
+
+        const { buffer } = region.prepare();
+        let billboards = 0;
+        for (let index = 0; index < expected[0]!; index++) {
+          const itemBase = RESULT_HEADER_LENGTH + index * RESULT_ITEM_STRIDE;
+          const record = buffer.subarray(
+            index * RESULT_INSTANCE_RECORD_LENGTH,
+            (index + 1) * RESULT_INSTANCE_RECORD_LENGTH
+          );
+          // Instanced billboards leave their vertex block zero; everything
+          // else matches the plain prepare.
+          const vertexStart = itemBase + RESULT_COMMON_ITEM_LENGTH;
+          const vertexEnd = vertexStart + RESULT_VERTEX_COMPONENT_LENGTH;
+          expect(Array.from(result.subarray(itemBase, vertexStart))).toEqual(
+            Array.from(expected.subarray(itemBase, vertexStart))
+          );
+          expect(
+            Array.from(
+              result.subarray(vertexEnd, itemBase + RESULT_ITEM_STRIDE)
+            )
+          ).toEqual(
+            Array.from(
+              expected.subarray(vertexEnd, itemBase + RESULT_ITEM_STRIDE)
+            )
+          );
+          expect(Array.from(result.subarray(vertexStart, vertexEnd))).toEqual(
+            record[14] === 1
+              ? new Array<number>(RESULT_VERTEX_COMPONENT_LENGTH).fill(0)
+              : Array.from(expected.subarray(vertexStart, vertexEnd))
+          );
+          // center, half size, anchor, sin/cos mirror the billboard uniforms.
+          for (let i = 0; i < 8; i++) {
+            expect(record[i]).toBe(Math.fround(expected[itemBase + 11 + i]!));
+          }
+          expect(record[12]).toBe(Math.fround(expected[itemBase + 3]!));
+          expect(record[14]).toBe(expected[itemBase + 10]);
+          if (record[14] !== 1) {
+            continue;
+          }
+          billboards++;
+          // The template UVs are the corners of the atlas UV rect.
+          for (let vertex = 0; vertex < 6; vertex++) {
+            const uvBase =
+              itemBase + RESULT_COMMON_ITEM_LENGTH + vertex * 6 + 4;
+            expect([record[8], record[10]]).toContain(
+              Math.fround(expected[uvBase]!)
+            );
+            expect([record[9], record[11]]).toContain(
+              Math.fround(expected[uvBase + 1]!)
+            );
+          }
+        }
+        expect(billboards > 0).toBe(flags === FLAGS_SHADER_GEOMETRY);
+      }
+    } finally {
+      region.release();
+    }
+  });
+
+  it('moves surface blocks into trailing stream records', () => {
+    const wasm = prepareWasmHost();
+    const scene = createScene(40);
+
+    for (const flags of [
+      FLAGS_SHADER_GEOMETRY,
+      FLAGS_SHADER_GEOMETRY | FLAG_FLOAT32_RESULT,
+    ]) {
+      const float32 = (flags & FLAG_FLOAT32_RESULT) !== 0;
+      const inlineStride = float32
+        ? RESULT_FLOAT32_ITEM_STRIDE
+        : RESULT_ITEM_STRIDE;
+      const streamStride = float32
+        ? RESULT_FLOAT32_STREAM_ITEM_STRIDE
+        : RESULT_STREAM_ITEM_STRIDE;
+      const recordStride = float32
+        ? RESULT_FLOAT32_SURFACE_RECORD_STRIDE
+        : RESULT_SURFACE_RECORD_STRIDE;
+      const componentScale = float32 ? 2 : 1;
+
+      const expected = prepareMarshalled(wasm, scene, flags);
+      const streamed = prepareMarshalled(
+        wasm,
+        scene,
+        flags | FLAG_SURFACE_STREAM
+      );
+      expect(streamed[0]).toBe(expected[0]);
+      expect(streamed[1]).toBe(streamStride);
+      expect(
+        streamed[RESULT_HEADER_FLAGS]! & RESULT_FLAG_SURFACE_STREAM
+      ).toBe(RESULT_FLAG_SURFACE_STREAM);
+      expect(streamed[RESULT_HEADER_SURFACE_COUNT + 2]).toBe(recordStride);
+
+      const view = (buffer: Float64Array) =>
+        float32
+          ? new Float32Array(
+              buffer.buffer,
+              buffer.byteOffset,
+              buffer.length * 2
+            )
+          : buffer;
+      const readIndex = (buffer: Float64Array, component: number) =>
+        float32
+          ? new Int32Array(
+              buffer.buffer,
+              buffer.byteOffset,
+              buffer.length * 2
+            )[component]!
+          : buffer[component]!;
+      const expectedComponents = view(expected);
+      const streamedComponents = view(streamed);
+
+      const surfaceCount = streamed[RESULT_HEADER_SURFACE_COUNT]!;
+      const surfaceOffset = streamed[RESULT_HEADER_SURFACE_COUNT + 1]!;
+      let record = 0;
+      for (let index = 0; index < expected[0]!; index++) {
+        const expectedBase =
+          (RESULT_HEADER_LENGTH + index * inlineStride) * componentScale;
+        const streamedBase =
+          (RESULT_HEADER_LENGTH + index * streamStride) * componentScale;
+        // Everything ahead of the surface block is unchanged.
+        expect(
+          Array.from(
+            streamedComponents.subarray(
+              streamedBase,
+              streamedBase + RESULT_FLOAT32_COMPONENT_LENGTH
+            )
+          )
+        ).toEqual(
+          Array.from(
+            expectedComponents.subarray(
+              expectedBase,
+              expectedBase + RESULT_FLOAT32_COMPONENT_LENGTH
+            )
+          )
+        );
+        const useShaderSurface =
+          expectedComponents[expectedBase + ITEM_RESULT_USE_SHADER_SURFACE];
+        if (useShaderSurface !== 1) {
+          continue;
+        }
+        // Surfaces own the next record, tagged with their item index.
+        const recordBase =
+          (surfaceOffset + record * recordStride) * componentScale;
+        expect(readIndex(streamed, recordBase)).toBe(index);
+        expect(
+          Array.from(
+            streamedComponents.subarray(
+              recordBase + 1,
+              recordBase + 1 + RESULT_SURFACE_BLOCK_LENGTH
+            )
+          )
+        ).toEqual(
+          Array.from(
+            expectedComponents.subarray(
+              expectedBase + RESULT_FLOAT32_COMPONENT_LENGTH,
+              expectedBase +
+                RESULT_FLOAT32_COMPONENT_LENGTH +
+                RESULT_SURFACE_BLOCK_LENGTH
+            )
+          )
+        );
+        record++;
+      }
+      expect(record > 0).toBe(true);
+      expect(surfaceCount).toBe(record);
+    }
+  });
+});
@@ -0,0 +1,256 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { expect } from 'vitest';
+
+import type { WasmHost } from '../../src/host/wasmHost';
+import {
+  INPUT_FRAME_CONSTANT_LENGTH,
+  INPUT_HEADER_LENGTH,
+  INPUT_MATRIX_LENGTH,
+  ITEM_STRIDE,
+  RESOURCE_STRIDE,
+  RESULT_HEADER_LENGTH,
+  writePrepareFrame,
+} from './wasmPrepareInput';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Shared scene of sprites with several images each, marshalled into
+// prepareDrawSpriteImages (and loaded into the resident store by its tests).
+
+// Mirrors wasm/calculation_host_layouts.h
+export const SPRITE_STRIDE = 6;
+export const RESULT_HEADER_SURFACE_COUNT = 10; // count, offset, stride
+export const RESULT_STREAM_ITEM_STRIDE = 64;
+export const RESULT_SURFACE_RECORD_STRIDE = 69;
+
+// Mirrors INPUT_FLAG_* in wasm/calculation_host.cpp
+export const FLAGS_SHADER_GEOMETRY = 3; // shader billboard + shader surface
+
+export interface SceneSprite {
+  handle: number;
+  lng: number;
+  lat: number;
+  z: number;
+}
+
+export interface Scene {
+  readonly resources: number[][];
+  readonly sprites: SceneSprite[];
+  readonly items: number[][];
+}
+
+export const IMAGES_PER_SPRITE = 3;
+
+export const createScene = (spriteCount: number): Scene => {
+  const resources: number[][] = [];
+  for (let handle = 0; handle < 3; handle++) {
+    resources.push([
+      handle,
+      24 + handle * 8,
+      16 + handle * 4,
+      1,
+      -1,
+      0,
+      0,
+      1,
+      1,
+    ]);
+  }
+
+  const sprites: SceneSprite[] = [];
+  const items: number[][] = [];
+  for (let index = 0; index < spriteCount; index++) {
+    const sprite: SceneSprite = {
+      handle: 100 + index,
+      lng: 139.7514 + ((index % 7) - 3) * 0.0006,
+      lat: 35.685 + (Math.floor(index / 7) - 2) * 0.0005,
+      z: index % 4 === 0 ? 12 : 0,
+    };
+    sprites.push(sprite);
+    const firstBucketIndex = items.length;
+    for (let order = 0; order < IMAGES_PER_SPRITE; order++) {
+      const hasOrigin = order === IMAGES_PER_SPRITE - 1;
+      const bucketIndex = items.length;
+      items.push([
+        sprite.handle,
+        (index + order) % resources.length,
+        hasOrigin ? firstBucketIndex : -1,
+        hasOrigin ? 1 : 0,
+        order === 0 && index % 2 === 0 ? 0 : 1, // surface or billboard
+        1 + order * 0.25,
+        1,
+        order * 0.2 - 0.2,
+        0.1,
+        order * 3,
+        order * 45,
+        (index * 30) % 360,
+        0,
+        0,
+        order,
+        0,
+        -1,
+        -1,
+        -1,
+        (index + order) % resources.length,
+        sprite.lng,
+        sprite.lat,
+        sprite.z,
+        hasOrigin ? 0 : -1,
+        hasOrigin ? 0 : -1,
+        hasOrigin ? 1 : 0,
+        bucketIndex,
+      ]);
+    }
+  }
+  return { resources, sprites, items };
+};
+
+export const writeHeader = (
+  buffer: Float64Array,
+  values: {
+    totalLength: number;
+    matrixOffset: number;
+    resourceCount: number;
+    resourceOffset: number;
+    spriteCount: number;
+    spriteOffset: number;
+    itemCount: number;
+    itemOffset: number;
+    flags?: number;
+    cullGuardBandPixels?: number;
+    vertexOutputPtr?: number;
+    vertexOutputCapacity?: number;
+    instanceOutputPtr?: number;
+    instanceOutputCapacity?: number;
+  }
+) => {
+  buffer.set(
+    [
+      values.totalLength,
+      INPUT_FRAME_CONSTANT_LENGTH,
+      values.matrixOffset,
+      values.resourceCount,
+      values.resourceOffset,
+      values.spriteCount,
+      values.spriteOffset,
+      values.itemCount,
+      values.itemOffset,
+      values.flags ?? FLAGS_SHADER_GEOMETRY,
+      values.cullGuardBandPixels ?? 0,
+      values.vertexOutputPtr ?? 0,
+      values.vertexOutputCapacity ?? 0,
+      values.instanceOutputPtr ?? 0,
+      values.instanceOutputCapacity ?? 0,
+    ],
+    0
+  );
+};
+
+export const readResult = (
+  wasm: WasmHost,
+  capacity: number,
+  invoke: (resultPtr: number) => boolean
+): Float64Array => {
+  const holder = wasm.allocateTypedBuffer(
+    Float64Array,
+    RESULT_HEADER_LENGTH +
+      capacity * (RESULT_STREAM_ITEM_STRIDE + RESULT_SURFACE_RECORD_STRIDE)
+  );
+  try {
+    const { ptr } = holder.prepare();
+    expect(invoke(ptr)).toBe(true);
+    const { buffer } = holder.prepare();
+    const preparedCount = buffer[0]!;
+    const itemStride = buffer[1]!;
+    const surfaceEnd =
+      buffer[RESULT_HEADER_SURFACE_COUNT + 1]! +
+      buffer[RESULT_HEADER_SURFACE_COUNT]! *
+        buffer[RESULT_HEADER_SURFACE_COUNT + 2]!;
+    return buffer.slice(
+      0,
+      Math.max(RESULT_HEADER_LENGTH + preparedCount * itemStride, surfaceEnd)
+    );
+  } finally {
+    holder.release();
+  }
+};
+
+export const prepareMarshalledWith = (
+  wasm: WasmHost,
+  scene: Scene,
+  prepare: (paramsPtr: number, resultPtr: number) => boolean,
+  flags?: number,
+  cullGuardBandPixels?: number,
+  vertexOutput?: { readonly ptr: number; readonly length: number },
+  instanceOutput?: { readonly ptr: number; readonly length: number }
+): Float64Array => {
+  const matrixOffset = INPUT_HEADER_LENGTH + INPUT_FRAME_CONSTANT_LENGTH;
+  const resourceOffset = matrixOffset + INPUT_MATRIX_LENGTH;
+  const spriteOffset =
+    resourceOffset + scene.resources.length * RESOURCE_STRIDE;
+  const itemOffset = spriteOffset + scene.sprites.length * SPRITE_STRIDE;
+  const totalLength = itemOffset + scene.items.length * ITEM_STRIDE;
+
+  const holder = wasm.allocateTypedBuffer(Float64Array, totalLength);
+  try {
+    const { ptr, buffer } = holder.prepare();
+    buffer.fill(0);
+    writeHeader(buffer, {
+      totalLength,
+      matrixOffset,
+      resourceCount: scene.resources.length,
+      resourceOffset,
+      spriteCount: scene.sprites.length,
+      spriteOffset,
+      itemCount: scene.items.length,
+      itemOffset,
+      flags,
+      cullGuardBandPixels,
+      vertexOutputPtr: vertexOutput?.ptr,
+      vertexOutputCapacity: vertexOutput?.length,
+      instanceOutputPtr: instanceOutput?.ptr,
+      instanceOutputCapacity: instanceOutput?.length,
+    });
+    writePrepareFrame(buffer, matrixOffset);
+    scene.resources.forEach((entry, index) =>
+      buffer.set(entry, resourceOffset + index * RESOURCE_STRIDE)
+    );
+    scene.sprites.forEach((sprite, index) =>
+      buffer.set(
+        [sprite.lng, sprite.lat, sprite.z, 0, 0, 0],
+        spriteOffset + index * SPRITE_STRIDE
+      )
+    );
+    scene.items.forEach((entry, index) =>
+      buffer.set(entry, itemOffset + index * ITEM_STRIDE)
+    );
+    return readResult(wasm, scene.items.length, (resultPtr) =>
+      prepare(ptr, resultPtr)
+    );
+  } finally {
+    holder.release();
+  }
+};
+
+export const prepareMarshalled = (
+  wasm: WasmHost,
+  scene: Scene,
+  flags?: number,
+  cullGuardBandPixels?: number,
+  vertexOutput?: { readonly ptr: number; readonly length: number },
+  instanceOutput?: { readonly ptr: number; readonly length: number }
+): Float64Array =>
+  prepareMarshalledWith(
+    wasm,
+    scene,
+    wasm.prepareDrawSpriteImages,
+    flags,
+    cullGuardBandPixels,
+    vertexOutput,
+    instanceOutput
+  );
@@ -0,0 +1,592 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, describe, expect, it } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmHost,
+} from '../../src/host/wasmHost';
+import {
+  INPUT_FRAME_CONSTANT_LENGTH,
+  INPUT_HEADER_LENGTH,
+  INPUT_MATRIX_LENGTH,
+  RESULT_HEADER_LENGTH,
+  RESULT_ITEM_STRIDE,
+  writePrepareFrame,
+} from './wasmPrepareInput';
+import {
+  createScene,
+  FLAGS_SHADER_GEOMETRY,
+  IMAGES_PER_SPRITE,
+  prepareMarshalled,
+  prepareMarshalledWith,
+  readResult,
+  writeHeader,
+  type Scene,
+} from './wasmPrepareScene';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Mirrors wasm/calculation_host_layouts.h
+const ITEM_FIELD_SCALE = 5;
+const ITEM_FIELD_OPACITY = 6;
+const RESULT_HEADER_CULLED_COUNT = 5;
+
+// Mirrors INPUT_FLAG_* in wasm/calculation_host.cpp
+const FLAG_ENABLE_VIEWPORT_CULLING = 8;
+
+// Mirrors wasm/interpolation_store.h
+const RESIDENT_INTERPOLATION_KEY_STRIDE = 4;
+const INTERPOLATION_KIND_DISTANCE = 0;
+const INTERPOLATION_KIND_LOCATION = 2;
+const DISTANCE_CHANNEL_OPACITY = 1;
+// Mirrors wasm/interpolation_layouts.h
+const SPRITE_INTERPOLATION_RESULT_LENGTH = 6;
+
+const prepareResident = (
+  wasm: WasmHost,
+  flags?: number,
+  cullGuardBandPixels?: number
+): Float64Array => {
+  const store = wasm.residentSpriteStore!;
+  const matrixOffset = INPUT_HEADER_LENGTH + INPUT_FRAME_CONSTANT_LENGTH;
+  const totalLength = matrixOffset + INPUT_MATRIX_LENGTH;
+
+  const holder = wasm.allocateTypedBuffer(Float64Array, totalLength);
+  try {
+    const { ptr, buffer } = holder.prepare();
+    buffer.fill(0);
+    writeHeader(buffer, {
+      totalLength,
+      matrixOffset,
+      resourceCount: 0,
+      resourceOffset: 0,
+      spriteCount: 0,
+      spriteOffset: 0,
+      itemCount: 0,
+      itemOffset: 0,
+      flags,
+      cullGuardBandPixels,
+    });
+    writePrepareFrame(buffer, matrixOffset);
+    return readResult(wasm, store.getImageCount(), (resultPtr) =>
+      store.prepare(ptr, resultPtr)
+    );
+  } finally {
+    holder.release();
+  }
+};
+
+const sendBatch = (
+  wasm: WasmHost,
+  invoke: (ptr: number) => boolean,
+  entries: readonly (readonly number[])[]
+) => {
+  const holder = wasm.allocateTypedBuffer(Float64Array, [
+    entries.length,
+    ...entries.flat(),
+  ]);
+  try {
+    expect(invoke(holder.prepare().ptr)).toBe(true);
+  } finally {
+    holder.release();
+  }
+};
+
+const loadResident = (wasm: WasmHost, scene: Scene) => {
+  const store = wasm.residentSpriteStore!;
+  store.clear();
+  sendBatch(wasm, store.upsertResources, scene.resources);
+  sendBatch(
+    wasm,
+    store.upsertSprites,
+    scene.sprites.map((sprite) => [
+      sprite.handle,
+      sprite.lng,
+      sprite.lat,
+      sprite.z,
+    ])
+  );
+  sendBatch(wasm, store.upsertImages, scene.items);
+};
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+describe('wasm resident sprite store', () => {
+  beforeAll(async () => {
+    const initialized = await initializeWasmHost('nosimd', {
+      force: true,
+      wasmBaseUrl: undefined,
+    });
+    if (initialized === 'disabled') {
+      throw new Error('WASM host failed to initialize.');
+    }
+  });
+
+  afterAll(() => {
+    releaseWasmHost();
+  });
+
+  it('prepares the same output as the marshalled entry point', () => {
+    const wasm = prepareWasmHost();
+    expect(wasm.residentSpriteStore).toBeDefined();
+    const scene = createScene(35);
+
+    loadResident(wasm, scene);
+    expect(wasm.residentSpriteStore!.getImageCount()).toBe(scene.items.length);
+
+    const expected = prepareMarshalled(wasm, scene);
+    expect(expected[0]).toBeGreaterThan(0);
+    expect(Array.from(prepareResident(wasm))).toEqual(Array.from(expected));
+  });
+
+  it('applies patches and sprite moves without resending images', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const scene = createScene(20);
+    loadResident(wasm, scene);
+
+    const patches: number[][] = [];
+    scene.items.forEach((entry, index) => {
+      if (index % 4 !== 0) {
+        return;
+      }
+      entry[ITEM_FIELD_OPACITY] = 0.5;
+      entry[ITEM_FIELD_SCALE] = 2;
+      patches.push([entry[0]!, entry[26]!, ITEM_FIELD_OPACITY, 0.5]);
+      patches.push([entry[0]!, entry[26]!, ITEM_FIELD_SCALE, 2]);
+    });
+    expect(patches.length).toBeGreaterThan(0);
+    sendBatch(wasm, store.patchImages, patches);
+
+    const moved = scene.sprites[3]!;
+    moved.lng += 0.0004;
+    moved.lat -= 0.0002;
+    scene.items.forEach((entry) => {
+      if (entry[0] === moved.handle) {
+        entry[20] = moved.lng;
+        entry[21] = moved.lat;
+      }
+    });
+    sendBatch(wasm, store.upsertSprites, [
+      [moved.handle, moved.lng, moved.lat, moved.z],
+    ]);
+
+    const expected = prepareMarshalled(wasm, scene);
+    expect(Array.from(prepareResident(wasm))).toEqual(Array.from(expected));
+  });
+
+  it('removes images and whole sprites', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const scene = createScene(10);
+    loadResident(wasm, scene);
+
+    const first = scene.items[0]!;
+    sendBatch(wasm, store.removeImages, [[first[0]!, first[26]!]]);
+    expect(store.getImageCount()).toBe(scene.items.length - 1);
+
+    sendBatch(wasm, store.removeSprites, [[scene.sprites[1]!.handle]]);
+    expect(store.getImageCount()).toBe(
+      scene.items.length - 1 - IMAGES_PER_SPRITE
+    );
+
+    const remaining = prepareResident(wasm);
+    const preparedCount = remaining[0]!;
+    const removedSprite = scene.sprites[1]!.handle;
+    for (let index = 0; index < preparedCount; index++) {
+      const base = RESULT_HEADER_LENGTH + index * RESULT_ITEM_STRIDE;
+      expect(remaining[base]).not.toBe(removedSprite);
+      expect(
+        remaining[base] === first[0] && remaining[base + 1] === first[26]
+      ).toBe(false);
+    }
+
+    store.clear();
+    expect(store.getImageCount()).toBe(0);
+  });
+
+  it('keeps the order of surviving images when removing an image', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const scene = createScene(12);
+    loadResident(wasm, scene);
+
+    // The second image of the first sprite is no origin of any other image.
+    const removed = scene.items[1]!;
+    sendBatch(wasm, store.removeImages, [[removed[0]!, removed[26]!]]);
+
+    const expected = prepareMarshalled(wasm, {
+      ...scene,
+      items: scene.items.filter((entry) => entry !== removed),
+    });
+    expect(Array.from(prepareResident(wasm))).toEqual(Array.from(expected));
+  });
+
+  it('rejects resource handles beyond the batch growth', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const scene = createScene(4);
+    loadResident(wasm, scene);
+    const expected = prepareMarshalled(wasm, scene);
+
+    const stray = [...scene.resources[0]!];
+    stray[0] = 1e12;
+    const holder = wasm.allocateTypedBuffer(Float64Array, [1, ...stray]);
+    try {
+      expect(store.upsertResources(holder.prepare().ptr)).toBe(false);
+    } finally {
+      holder.release();
+    }
+    expect(Array.from(prepareResident(wasm))).toEqual(Array.from(expected));
+  });
+
+  it('rejects patches to store-managed fields', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const scene = createScene(2);
+    loadResident(wasm, scene);
+
+    const holder = wasm.allocateTypedBuffer(Float64Array, [
+      1,
+      scene.items[0]![0]!,
+      scene.items[0]![26]!,
+      0, // spriteHandle
+      999,
+    ]);
+    try {
+      expect(store.patchImages(holder.prepare().ptr)).toBe(false);
+    } finally {
+      holder.release();
+    }
+  });
+
+  it('leaves the store unchanged when a patch batch is rejected', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const scene = createScene(4);
+    loadResident(wasm, scene);
+    const expected = prepareMarshalled(wasm, scene);
+
+    const first = scene.items[0]!;
+    const holder = wasm.allocateTypedBuffer(Float64Array, [
+      2,
+      first[0]!,
+      first[26]!,
+      ITEM_FIELD_OPACITY,
+      0.25,
+      // Unknown image: rejects the whole batch.
+      first[0]!,
+      9999,
+      ITEM_FIELD_OPACITY,
+      0.25,
+    ]);
+    try {
+      expect(store.patchImages(holder.prepare().ptr)).toBe(false);
+    } finally {
+      holder.release();
+    }
+    expect(Array.from(prepareResident(wasm))).toEqual(Array.from(expected));
+  });
+
+  it('culls resident images through the spatial grid like the marshalled path', () => {
+    const wasm = prepareWasmHost();
+    const store = wasm.residentSpriteStore!;
+    const flags = FLAGS_SHADER_GEOMETRY | FLAG_ENABLE_VIEWPORT_CULLING;
+    const scene = createScene(60);
+    scene.sprites.forEach((sprite, index) => {
+      if (Math.floor(index / 7) % 2 === 0) {
+        return;
+      }
+      sprite.lng += 0.05;
+      scene.items.forEach((entry) => {
+        if (entry[0] === sprite.handle) {
+          entry[20] = sprite.lng;
+        }
+      });
+    });
+    loadResident(wasm, scene);
+
+    const expected = prepareMarshalled(wasm, scene, flags, 32);
+    expect(expected[RESULT_HEADER_CULLED_COUNT]!).toBeGreaterThan(0);
+    expect(Array.from(prepareResident(wasm, flags, 32))).toEqual(
+      Array.from(expected)
+    );
+
+    // Bring a far sprite back into view and push a visible one out.
+    const returning = scene.sprites[7]!;
+    const leaving = scene.sprites[0]!;
+    returning.lng -= 0.05;
+    leaving.lng += 0.05;
+    scene.items.forEach((entry) => {
+      if (entry[0] === returning.handle) {
+        entry[20] = returning.lng;
+      } else if (entry[0] === leaving.handle) {
+        entry[20] = leaving.lng;
+      }
+    });
+    sendBatch(
+      wasm,
+      store.upsertSprites,
+      [returning, leaving].map((sprite) => [
+        sprite.handle,
+        sprite.lng,
+        sprite.lat,
+        sprite.z,
+      ])
+    );
+
+    const movedExpected = prepareMarshalled(wasm, scene, flags, 32);
+    expect(Array.from(prepareResident(wasm, flags, 32))).toEqual(
+      Array.from(movedExpected)
+    );
+  });
+
+  it('advances resident interpolations in place', () => {
+    const wasm = prepareWasmHost();
+    const interpolations = wasm.residentInterpolations!;
+    expect(interpolations).toBeDefined();
+    const scene = createScene(10);
+    loadResident(wasm, scene);
+
+    const moving = scene.sprites[2]!;
+    const from = [moving.lng, moving.lat, moving.z];
+    const to = [moving.lng + 0.0008, moving.lat - 0.0004, moving.z];
+    // Linear, 1000 ms, starting at 0.
+    sendBatch(wasm, interpolations.upsertLocations, [
+      [moving.handle, 1000, ...from, ...to, 0, 0, 0, 0, 0, 0],
+    ]);
+    const fading = scene.items.find(
+      (entry) => entry[0] === scene.sprites[5]!.handle
+    )!;
+    sendBatch(wasm, interpolations.upsertChannels, [
+      [
+        fading[0]!,
+        fading[26]!,
+        INTERPOLATION_KIND_DISTANCE,
+        DISTANCE_CHANNEL_OPACITY,
+        1000,
+        1,
+        0.2,
+        0.2,
+        0,
+        0,
+        0,
+        0,
+        0,
+      ],
+    ]);
+    expect(interpolations.getCount()).toBe(2);
+
+    const advance = (timestamp: number): number[] => {
+      const holder = wasm.allocateTypedBuffer(
+        Float64Array,
+        1 + interpolations.getCount() * RESIDENT_INTERPOLATION_KEY_STRIDE
+      );
+      try {
+        expect(interpolations.advance(timestamp, holder.prepare().ptr)).toBe(
+          true
+        );
+        const { buffer } = holder.prepare();
+        return Array.from(
+          buffer.subarray(
+            1,
+            1 + buffer[0]! * RESIDENT_INTERPOLATION_KEY_STRIDE
+          )
+        );
+      } finally {
+        holder.release();
+      }
+    };
+    const lerp = (a: number, b: number, ratio: number) => a + (b - a) * ratio;
+    const moveSprite = (lng: number, lat: number) => {
+      moving.lng = lng;
+      moving.lat = lat;
+      scene.items.forEach((entry) => {
+        if (entry[0] === moving.handle) {
+          entry[20] = lng;
+          entry[21] = lat;
+        }
+      });
+    };
+
+    expect(advance(250)).toEqual([]);
+    moveSprite(lerp(from[0]!, to[0]!, 0.25), lerp(from[1]!, to[1]!, 0.25));
+    fading[ITEM_FIELD_OPACITY] = lerp(1, 0.2, 0.25);
+    expect(Array.from(prepareResident(wasm))).toEqual(
+      Array.from(prepareMarshalled(wasm, scene))
+    );
+
+    // Only finished animations come back.
+    expect(advance(1000)).toEqual([
+      moving.handle,
+      -1,
+      INTERPOLATION_KIND_LOCATION,
+      0,
+      fading[0]!,
+      fading[26]!,
+      INTERPOLATION_KIND_DISTANCE,
+      DISTANCE_CHANNEL_OPACITY,
+    ]);
+    expect(interpolations.getCount()).toBe(0);
+    moveSprite(to[0]!, to[1]!);
+    fading[ITEM_FIELD_OPACITY] = 0.2;
+    expect(Array.from(prepareResident(wasm))).toEqual(
+      Array.from(prepareMarshalled(wasm, scene))
+    );
+  });
+
+  it('rejects a resident interpolation batch without applying any of it', () => {
+    const wasm = prepareWasmHost();
+    const interpolations = wasm.residentInterpolations!;
+    const scene = createScene(2);
+    loadResident(wasm, scene);
+    const image = scene.items[0]!;
+    const sprite = scene.sprites[0]!;
+    const location = [sprite.lng, sprite.lat, sprite.z];
+
+    const sendRejected = (
+      invoke: (ptr: number) => boolean,
+      entries: readonly (readonly number[])[]
+    ) => {
+      const holder = wasm.allocateTypedBuffer(Float64Array, [
+        entries.length,
+        ...entries.flat(),
+      ]);
+      try {
+        expect(invoke(holder.prepare().ptr)).toBe(false);
+      } finally {
+        holder.release();
+      }
+    };
+
+    // The valid first entry must not be kept when the second one fails.
+    sendRejected(interpolations.upsertLocations, [
+      [sprite.handle, 1000, ...location, ...location, 0, 0, 0, 0, 0, 0],
+      [Number.NaN, 1000, ...location, ...location, 0, 0, 0, 0, 0, 0],
+    ]);
+    const channel = (channelCode: number) => [
+      image[0]!,
+      image[26]!,
+      INTERPOLATION_KIND_DISTANCE,
+      channelCode,
+      1000,
+      1,
+      0.2,
+      0.2,
+      0,
+      0,
+      0,
+      0,
+      0,
+    ];
+    sendRejected(interpolations.upsertChannels, [
+      channel(DISTANCE_CHANNEL_OPACITY),
+      channel(99),
+    ]);
+    // Codes are not truncated: 1.5 is not channel 1.
+    sendRejected(interpolations.upsertChannels, [channel(1.5)]);
+    sendRejected(interpolations.upsertChannels, [channel(1e12)]);
+    expect(interpolations.getCount()).toBe(0);
+
+    sendBatch(wasm, interpolations.upsertChannels, [
+      channel(DISTANCE_CHANNEL_OPACITY),
+    ]);
+    sendRejected(interpolations.cancel, [
+      [image[0]!, image[26]!, INTERPOLATION_KIND_DISTANCE, 0],
+      [image[0]!, -1, INTERPOLATION_KIND_DISTANCE, 0],
+    ]);
+    sendRejected(interpolations.cancel, [[image[0]!, image[26]!, 0.5, 0]]);
+    expect(interpolations.getCount()).toBe(1);
+    // Clears the interpolation table too.
+    wasm.residentSpriteStore!.clear();
+  });
+
+  it('evaluates sprite interpolations inside the prepare pass', () => {
+    const wasm = prepareWasmHost();
+    const prepareInterpolated = wasm.prepareInterpolatedSpriteImages!;
+    expect(prepareInterpolated).toBeDefined();
+    const scene = createScene(10);
+
+    const moving = scene.sprites[3]!;
+    const from = [moving.lng, moving.lat, moving.z];
+    const to = [moving.lng - 0.0006, moving.lat + 0.0003, moving.z + 8];
+    const missingHandle = 9999;
+    // Linear, 1000 ms, started at 0 and evaluated at 400; the last entry has
+    // no drawn sprite and only produces its result.
+    const entries = [
+      [moving.handle, 1000, ...from, ...to, 1, 0, 400, 0, 0, 0, 0],
+      [missingHandle, 1000, ...from, ...to, 0, 0, 400, 0, 0, 0, 0],
+    ];
+
+    const interpolationParams = wasm.allocateTypedBuffer(Float64Array, [
+      entries.length,
+      ...entries.flat(),
+    ]);
+    const interpolationResult = wasm.allocateTypedBuffer(
+      Float64Array,
+      1 + entries.length * SPRITE_INTERPOLATION_RESULT_LENGTH
+    );
+    try {
+      // The item table still carries the previous sprite location, and one
+      // image of the moving sprite disagrees with it, so it gets its own
+      // projection entry. Every image must still follow the interpolation.
+      scene.items.find((entry) => entry[0] === moving.handle)![20] += 0.0001;
+      const fused = prepareMarshalledWith(
+        wasm,
+        scene,
+        (paramsPtr, resultPtr) =>
+          prepareInterpolated(
+            paramsPtr,
+            interpolationParams.prepare().ptr,
+            interpolationResult.prepare().ptr,
+            resultPtr
+          )
+      );
+      const { buffer: results } = interpolationResult.prepare();
+
+      const lerp = (a: number, b: number) => a + (b - a) * 0.4;
+      const location = [
+        lerp(from[0]!, to[0]!),
+        lerp(from[1]!, to[1]!),
+        lerp(from[2]!, to[2]!),
+      ];
+      expect(Array.from(results)).toEqual([
+        entries.length,
+        ...location,
+        1,
+        0,
+        0,
+        location[0]!,
+        location[1]!,
+        0,
+        0,
+        0,
+        0,
+      ]);
+
+      moving.lng = location[0]!;
+      moving.lat = location[1]!;
+      moving.z = location[2]!;
+      scene.items.forEach((entry) => {
+        if (entry[0] === moving.handle) {
+          entry[20] = moving.lng;
+          entry[21] = moving.lat;
+          entry[22] = moving.z;
+        }
+      });
+      expect(Array.from(fused)).toEqual(
+        Array.from(prepareMarshalled(wasm, scene))
+      );
+    } finally {
+      interpolationResult.release();
+      interpolationParams.release();
+    }
+  });
+});
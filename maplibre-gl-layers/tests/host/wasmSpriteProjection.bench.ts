@@ -0,0 +1,88 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, bench, describe } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmVariant,
+} from '../../src/host/wasmHost';
+import {
+  createPrepareInput,
+  RESULT_HEADER_LENGTH,
+  RESULT_ITEM_STRIDE,
+} from './wasmPrepareInput';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+const SPRITE_COUNTS = [10_000, 100_000] as const;
+
+const FLAGS_SHADER_GEOMETRY = 3;
+
+/**
+ * One billboard per distinct sprite. Every image uses a zero-sized resource,
+ * so the frame stops right after the per-sprite projection stage and the
+ * bench measures that stage (plus marshalling) rather than the draw output.
+ */
+const createInput = (spriteCount: number): Float64Array =>
+  createPrepareInput({
+    spriteCount,
+    flags: FLAGS_SHADER_GEOMETRY,
+    zoom: 14,
+    enableSurfaceBias: true,
+    resourceWidth: 0,
+    resourceHeight: 0,
+    spanLng: 0.2,
+    spanLat: 0.2,
+    item: () => ({ mode: 1, rotateDeg: 0, order: 0 }),
+  });
+
+const defineSpriteProjectionBenches = (variant: WasmVariant) => {
+  describe(`sprite projection (${variant})`, () => {
+    beforeAll(async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      if (initialized !== variant) {
+        throw new Error(`WASM host failed to initialize ${variant}.`);
+      }
+    });
+
+    afterAll(() => {
+      releaseWasmHost();
+    });
+
+    for (const count of SPRITE_COUNTS) {
+      const input = createInput(count);
+      bench(`prepareDrawSpriteImages ${count} sprites`, () => {
+        const wasm = prepareWasmHost();
+        const params = wasm.allocateTypedBuffer(Float64Array, input);
+        const result = wasm.allocateTypedBuffer(
+          Float64Array,
+          RESULT_HEADER_LENGTH + count * RESULT_ITEM_STRIDE
+        );
+        try {
+          const { ptr: paramsPtr } = params.prepare();
+          const { ptr: resultPtr } = result.prepare();
+          if (!wasm.prepareDrawSpriteImages(paramsPtr, resultPtr)) {
+            throw new Error('prepareDrawSpriteImages failed.');
+          }
+        } finally {
+          result.release();
+          params.release();
+        }
+      });
+    }
+  });
+};
+
+// `nosimd` runs the scalar per-sprite projection; `simd` runs the SoA kernel
+// over two sprites per vector.
+defineSpriteProjectionBenches('nosimd');
+defineSpriteProjectionBenches('simd');
@@ -0,0 +1,97 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo@mi.kekyo.net)
+// Under MIT
+// https://github.com/kekyo/maplibre-gl-layers
+
+import { afterAll, beforeAll, bench, describe } from 'vitest';
+
+import {
+  initializeWasmHost,
+  prepareWasmHost,
+  releaseWasmHost,
+  type WasmVariant,
+} from '../../src/host/wasmHost';
+import { __wasmCalculationTestInternals } from '../../src/host/wasmCalculationHost';
+import type { SpriteInterpolationState } from '../../src/internalTypes';
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Batch sizes around the parallel threshold (512) are dominated by the
+// per-dispatch cost of the worker pool, larger ones by the actual work.
+const BATCH_SIZES = [512, 1024, 8192] as const;
+
+const createDistanceStates = (
+  count: number
+): SpriteInterpolationState<number>[] => {
+  const states: SpriteInterpolationState<number>[] = [];
+  for (let index = 0; index < count; index++) {
+    states.push({
+      mode: 'feedback',
+      durationMs: 1000,
+      easingFunc: (t: number) => t,
+      easingParam: { type: 'linear' },
+      from: index,
+      to: index + 10,
+      startTimestamp: 0,
+    });
+  }
+  return states;
+};
+
+/**
+ * @param spawnPerDispatch Disables the resident pool so every dispatch
+ * spawns and joins its own threads, the path the pool replaced.
+ */
+const defineDispatchBenches = (
+  variant: WasmVariant,
+  spawnPerDispatch = false
+) => {
+  const label = spawnPerDispatch ? `${variant}, spawn/join` : variant;
+  describe(`worker dispatch (${label})`, () => {
+    beforeAll(async () => {
+      const initialized = await initializeWasmHost(variant, {
+        force: true,
+        wasmBaseUrl: undefined,
+      });
+      if (initialized !== variant) {
+        throw new Error(`WASM host failed to initialize ${variant}.`);
+      }
+      if (spawnPerDispatch) {
+        const setWorkerPoolEnabled = prepareWasmHost().setWorkerPoolEnabled;
+        if (!setWorkerPoolEnabled) {
+          throw new Error(`${variant} cannot disable the worker pool.`);
+        }
+        setWorkerPoolEnabled(false);
+      }
+    });
+
+    afterAll(() => {
+      if (spawnPerDispatch) {
+        prepareWasmHost().setWorkerPoolEnabled?.(true);
+      }
+      releaseWasmHost();
+    });
+
+    for (const size of BATCH_SIZES) {
+      const distance = createDistanceStates(size);
+      let timestamp = 0;
+      bench(`processInterpolations ${size} items`, () => {
+        timestamp = (timestamp + 16) % 1000;
+        __wasmCalculationTestInternals.internalProcessInterpolationsCore(
+          prepareWasmHost(),
+          { distance, degree: [], location: [] },
+          timestamp
+        );
+      });
+    }
+  });
+};
+
+// `simd` never dispatches to workers, so it is the zero-overhead reference
+// for the pooled `simd-mt` variant. The spawn/join run measures the same
+// dispatches without the pool; per-dispatch cost is the difference in mean
+// time against `simd` at the same batch size.
+defineDispatchBenches('simd');
+defineDispatchBenches('simd-mt');
+defineDispatchBenches('simd-mt', true);
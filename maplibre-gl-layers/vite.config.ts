@@ -59,15 +59,38 @@ const wasmExports = [
   '_project',
   '_calculatePerspectiveRatio',
   '_unproject',
+  '_projectMany',
+  '_unprojectMany',
   '_projectLngLatToClipSpace',
   '_calculateBillboardDepthKey',
   '_calculateSurfaceDepthKey',
   '_prepareDrawSpriteImages',
+  '_prepareInterpolatedSpriteImages',
   '_evaluateDistanceInterpolations',
   '_evaluateDegreeInterpolations',
   '_evaluateSpriteInterpolations',
   '_processInterpolations',
   '_setThreadPoolSize',
+  '_setWorkerChunkSize',
+  '_setWorkerPoolEnabled',
+  '_upsertResidentResources',
+  '_upsertResidentSprites',
+  '_removeResidentSprites',
+  '_upsertResidentImages',
+  '_removeResidentImages',
+  '_patchResidentImages',
+  '_clearResidentStore',
+  '_getResidentImageCount',
+  '_prepareResidentSpriteImages',
+  '_upsertResidentLocationInterpolations',
+  '_upsertResidentChannelInterpolations',
+  '_cancelResidentInterpolations',
+  '_getResidentInterpolationCount',
+  '_advanceResidentInterpolations',
+  '_sortDepthKeys',
+  '_setTemporalDepthSortEnabled',
+  '_getTemporalDepthSortStats',
+  '_getFrameArenaStats',
 ];
 
 const wasmCommonCompileOptions = ['-O3', '-std=c++17', '-mbulk-memory'];
@@ -18,6 +18,7 @@
 #include <limits>
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 #if defined(__EMSCRIPTEN_PTHREADS__)
@@ -31,25 +32,22 @@
 #include "projection_host.h"
 #include "calculation_host_layouts.h"
 #include "calculation_host_common.h"
+#include "depth_sort.h"
+#include "frame_arena.h"
+#include "interpolation_layouts.h"
+#include "interpolation_store.h"
+#include "spatial_grid.h"
+#include "sprite_store.h"
 #include "worker_jobs.h"
 
 constexpr std::size_t SURFACE_CLIP_CORNER_COUNT = 4;
 
-static inline bool convertToInt64(double value, int64_t& out) {
-  if (!std::isfinite(value)) {
-    return false;
-  }
-  const double truncated = std::trunc(value);
-  if (!std::isfinite(truncated)) {
-    return false;
-  }
-  const auto candidate = static_cast<int64_t>(truncated);
-  if (static_cast<double>(candidate) != truncated) {
-    return false;
-  }
-  out = candidate;
-  return true;
-}
+/**
+ * @brief Backing store for every per-frame container of the prepare pipeline.
+ *
+ * Rewound at the start of each prepare call; see FrameArena.
+ */
+static FrameArena g_frameArena;
 
 static inline bool toBool(double value) {
   return value != 0.0;
@@ -201,6 +199,16 @@ struct QuadCorner {
   double v = 0.0;
 };
 
+/**
+ * @brief Billboard quad of a float32 result item, one lane per corner.
+ */
+struct BillboardQuadF32 {
+  alignas(16) std::array<float, 4> x{};
+  alignas(16) std::array<float, 4> y{};
+  alignas(16) std::array<float, 4> u{};
+  alignas(16) std::array<float, 4> v{};
+};
+
 struct BillboardCenterResult {
   SpriteScreenPoint center;
   double halfWidth = 0.0;
@@ -227,6 +235,39 @@ struct SurfaceCenterResult {
   std::optional<SpriteLocation> anchorlessLngLat;
 };
 
+/**
+ * @brief Base-independent part of a surface placement.
+ */
+struct SurfaceGeometry {
+  SurfaceWorldDimensions worldDimensions;
+  SurfaceCorner offsetMeters;
+  SurfaceCorner totalDisplacement;
+};
+
+/**
+ * @brief Surface geometry of a bucket item, computed once per frame and shared
+ * by center precompute, depth collection and draw prep.
+ *
+ * The geometry and corner displacements do not depend on where the surface is
+ * placed. The placement (displaced center and its projection) and the clip
+ * corners are only cached for items at their own sprite location; origin
+ * relative bases are resolved slightly differently per stage.
+ */
+struct SurfaceGeometryCache {
+  SurfaceGeometry geometry;
+  std::array<SurfaceCorner, SURFACE_CLIP_CORNER_COUNT> cornerDisplacements{};
+  std::optional<SpriteScreenPoint> center;
+  SpriteLocation displacedLngLat;
+  // Unbiased clip positions of the corners.
+  std::array<std::array<double, 4>, SURFACE_CLIP_CORNER_COUNT> clipCorners{};
+  bool hasGeometry = false;
+  bool hasPlacement = false;
+  bool hasClipCorners = false;
+};
+
+constexpr uint32_t SURFACE_GEOMETRY_INDEX_NONE =
+    std::numeric_limits<uint32_t>::max();
+
 struct SurfaceShaderCornerModel {
   double east = 0.0;
   double north = 0.0;
@@ -247,7 +288,7 @@ struct ResourceInfo {
 };
 
 static inline const ResourceInfo* findResourceByHandle(
-    const std::vector<ResourceInfo>& resources, double handleValue) {
+    const FrameVector<ResourceInfo>& resources, double handleValue) {
   std::size_t handleIndex = 0;
   if (!convertToSizeT(handleValue, handleIndex)) {
     return nullptr;
@@ -280,8 +321,29 @@ struct BucketItem {
   bool hasResolvedAnchorCenter = false;
   SpriteScreenPoint anchorlessCenter;
   bool hasAnchorlessCenter = false;
+  // Outside the viewport; skipped by depth collection and draw prep.
+  bool culled = false;
+  // Origin of a drawn item, so its centers are still needed.
+  bool originReferenced = false;
+  // Slot in the frame's SurfaceGeometryCache table, surfaces only.
+  uint32_t surfaceGeometryIndex = SURFACE_GEOMETRY_INDEX_NONE;
 };
 
+/**
+ * @brief Surface geometry cache of `bucket`, or nullptr for billboards.
+ *
+ * The caches live in their own table so billboards, and every copy of a
+ * BucketItem, do not carry one.
+ */
+static inline SurfaceGeometryCache* findSurfaceGeometry(
+    const BucketItem& bucket,
+    FrameVector<SurfaceGeometryCache>& surfaceGeometries) {
+  if (bucket.surfaceGeometryIndex == SURFACE_GEOMETRY_INDEX_NONE) {
+    return nullptr;
+  }
+  return &surfaceGeometries[bucket.surfaceGeometryIndex];
+}
+
 static inline bool tryGetPrecomputedCenter(const BucketItem& bucket,
                                            bool useResolvedAnchor,
                                            SpriteScreenPoint& out) {
@@ -299,14 +361,12 @@ static inline bool tryGetPrecomputedCenter(const BucketItem& bucket,
 struct DepthItem {
   const BucketItem* item = nullptr;
   double depthKey = 0.0;
+  // Surface geometry is cached on the bucket item.
   bool hasSurfaceData = false;
-  SurfaceWorldDimensions surfaceWorldDimensions;
-  SurfaceCorner surfaceOffsetMeters;
-  std::array<SurfaceCorner, SURFACE_CLIP_CORNER_COUNT> surfaceCornerDisplacements;
 };
 
 struct DepthCollectionResult {
-  std::vector<DepthItem> items;
+  FrameVector<DepthItem> items;
 };
 
 struct ProjectionContext;
@@ -367,6 +427,10 @@ alignas(16) constexpr double SURFACE_BASE_EAST_SIMD[4] = {-1.0, 1.0, -1.0, 1.0};
 alignas(16) constexpr double SURFACE_BASE_NORTH_SIMD[4] = {1.0, 1.0, -1.0, -1.0};
 alignas(16) constexpr double BILLBOARD_BASE_X_SIMD[4] = {-1.0, 1.0, -1.0, 1.0};
 alignas(16) constexpr double BILLBOARD_BASE_Y_SIMD[4] = {1.0, 1.0, -1.0, -1.0};
+alignas(16) constexpr float BILLBOARD_BASE_X_F32[4] = {-1.0f, 1.0f, -1.0f, 1.0f};
+alignas(16) constexpr float BILLBOARD_BASE_Y_F32[4] = {1.0f, 1.0f, -1.0f, -1.0f};
+alignas(16) constexpr float UV_CORNERS_U_F32[4] = {0.0f, 1.0f, 0.0f, 1.0f};
+alignas(16) constexpr float UV_CORNERS_V_F32[4] = {0.0f, 0.0f, 1.0f, 1.0f};
 #endif
 
 constexpr double MIN_CLIP_Z_EPSILON = 1e-7;
@@ -401,8 +465,16 @@ computeSurfaceCornerShaderModel(const SpriteLocation& baseLngLat,
                                 double sinNegativeRotation,
                                 double cosNegativeRotation,
                                 const SurfaceCorner& offsetMeters);
+static inline SurfaceGeometry calculateSurfaceGeometry(
+    const SurfaceCenterParams& params);
+static inline SurfaceCenterResult placeSurfaceCenter(
+    const SurfaceCenterParams& params,
+    const SurfaceGeometry& geometry);
 static inline SurfaceCenterResult calculateSurfaceCenterPosition(
     const SurfaceCenterParams& params);
+static inline const SurfaceGeometry& ensureSurfaceGeometry(
+    SurfaceGeometryCache& cache,
+    const SurfaceCenterParams& params);
 /**
  * @brief Computes billboard center, size and anchor/offset shifts in screen space.
  *
@@ -431,6 +503,22 @@ static inline std::array<QuadCorner, 4> calculateBillboardCornerScreenPositions(
     double halfHeight,
     const SpriteAnchor* anchor,
     const RotationCache& rotation);
+/**
+ * @brief float32 counterpart of calculateBillboardCornerScreenPositions for
+ * float32 result items, also resolving the atlas UVs. Corners are rotated
+ * around the center and translated last, so float32 only has to carry
+ * screen-space magnitudes.
+ */
+static inline BillboardQuadF32 calculateBillboardCornersF32(
+    const SpriteScreenPoint& center,
+    double halfWidth,
+    double halfHeight,
+    const SpriteAnchor* anchor,
+    const RotationCache& rotation,
+    double atlasU0,
+    double atlasV0,
+    double atlasUSpan,
+    double atlasVSpan);
 static inline bool __calculateBillboardDepthKey(double centerX,
                                                 double centerY,
                                                 double worldSize,
@@ -450,19 +538,27 @@ static inline bool __calculateSurfaceDepthKey(double baseLng,
                                               double minClipZEpsilon,
                                               double* out);
 
-constexpr int32_t SPRITE_ORIGIN_REFERENCE_INDEX_NONE = -1;
-constexpr int32_t SPRITE_ORIGIN_REFERENCE_KEY_NONE = -1;
 
 constexpr int INPUT_FLAG_USE_SHADER_SURFACE_GEOMETRY = 1 << 0;
 constexpr int INPUT_FLAG_USE_SHADER_BILLBOARD_GEOMETRY = 1 << 1;
 constexpr int INPUT_FLAG_ENABLE_NDC_BIAS_SURFACE = 1 << 2;
+constexpr int INPUT_FLAG_ENABLE_VIEWPORT_CULLING = 1 << 3;
+constexpr int INPUT_FLAG_FAST_MERCATOR_MATH = 1 << 4;
+constexpr int INPUT_FLAG_FLOAT32_RESULT = 1 << 5;
+constexpr int INPUT_FLAG_VERTEX_OUTPUT = 1 << 6;
+constexpr int INPUT_FLAG_INSTANCE_OUTPUT = 1 << 7;
+constexpr int INPUT_FLAG_SURFACE_STREAM = 1 << 8;
 
 constexpr int RESULT_FLAG_HAS_HIT_TEST = 1 << 0;
 constexpr int RESULT_FLAG_HAS_SURFACE_INPUTS = 1 << 1;
+constexpr int RESULT_FLAG_FLOAT32_ITEMS = 1 << 2;
+constexpr int RESULT_FLAG_VERTEX_OUTPUT = 1 << 3;
+constexpr int RESULT_FLAG_INSTANCE_OUTPUT = 1 << 4;
+constexpr int RESULT_FLAG_SURFACE_STREAM = 1 << 5;
 
 static inline const BucketItem* resolveOriginBucketItem(
     const BucketItem& current,
-    const std::vector<BucketItem>& bucketItems) {
+    const FrameVector<BucketItem>& bucketItems) {
   int64_t originIndex = 0;
   if (!convertToInt64(current.entry->originTargetIndex, originIndex)) {
     return nullptr;
@@ -580,6 +676,296 @@ static inline void storeVec4(double*& dst, const std::array<double, 4>& values)
   storeVec4(dst, values[0], values[1], values[2], values[3]);
 }
 
+// float32 result items keep their vertex and hit-test blocks in float. These
+// narrow on store, rounding to nearest like storeFloat32Components.
+static inline void storeVec2(float*& dst, float v0, float v1) {
+  dst[0] = v0;
+  dst[1] = v1;
+  dst += 2;
+}
+
+static inline void storeVec2At(float* dst, float v0, float v1) {
+  dst[0] = v0;
+  dst[1] = v1;
+}
+
+static inline void storeVec4(float*& dst,
+                             float v0,
+                             float v1,
+                             float v2,
+                             float v3) {
+#ifdef SIMD_ENABLED
+  wasm_v128_store(dst, wasm_f32x4_make(v0, v1, v2, v3));
+#else
+  dst[0] = v0;
+  dst[1] = v1;
+  dst[2] = v2;
+  dst[3] = v3;
+#endif
+  dst += 4;
+}
+
+static inline void storeVec4(float*& dst, const std::array<double, 4>& values) {
+  storeVec4(dst,
+            static_cast<float>(values[0]),
+            static_cast<float>(values[1]),
+            static_cast<float>(values[2]),
+            static_cast<float>(values[3]));
+}
+
+/**
+ * @brief Narrows `count` doubles to float32, four per vector when SIMD is
+ * enabled. Both paths round to nearest and produce the same bits.
+ */
+static inline void storeFloat32Components(float* dst,
+                                          const double* src,
+                                          std::size_t count) {
+  std::size_t index = 0;
+#ifdef SIMD_ENABLED
+  for (; index + 4 <= count; index += 4) {
+    const v128_t low = wasm_f32x4_demote_f64x2_zero(wasm_v128_load(src + index));
+    const v128_t high =
+        wasm_f32x4_demote_f64x2_zero(wasm_v128_load(src + index + 2));
+    wasm_v128_store(dst + index, wasm_i64x2_shuffle(low, high, 0, 2));
+  }
+#endif
+  for (; index < count; ++index) {
+    dst[index] = static_cast<float>(src[index]);
+  }
+}
+
+static inline void storeFloat32Components(float* dst,
+                                          const float* src,
+                                          std::size_t count) {
+  std::memcpy(dst, src, count * sizeof(float));
+}
+
+/**
+ * @brief Stores the quad corners as interleaved (x, y) hit-test pairs.
+ */
+static inline void storeBillboardHitTestF32(float* dst,
+                                            const BillboardQuadF32& quad) {
+#ifdef SIMD_ENABLED
+  const v128_t x = wasm_v128_load(quad.x.data());
+  const v128_t y = wasm_v128_load(quad.y.data());
+  wasm_v128_store(dst, wasm_i32x4_shuffle(x, y, 0, 4, 1, 5));
+  wasm_v128_store(dst + 4, wasm_i32x4_shuffle(x, y, 2, 6, 3, 7));
+#else
+  for (std::size_t corner = 0; corner < 4; ++corner) {
+    dst[corner * 2] = quad.x[corner];
+    dst[corner * 2 + 1] = quad.y[corner];
+  }
+#endif
+}
+
+/**
+ * @brief Integral id as int32; -1 when it does not fit.
+ */
+static inline int32_t toResultId(double value) {
+  if (!std::isfinite(value) || value < 0.0 ||
+      value > static_cast<double>(std::numeric_limits<int32_t>::max())) {
+    return -1;
+  }
+  return static_cast<int32_t>(value);
+}
+
+/**
+ * @brief Components of one result item. The vertex and hit-test blocks are
+ * computed in the result type; the common and surface blocks stay in double
+ * until written, since the surface block holds absolute coordinates.
+ */
+template <typename TResult>
+struct ResultItemComponents {
+  std::array<double, RESULT_COMMON_ITEM_LENGTH> common{};
+  alignas(16) std::array<TResult, RESULT_VERTEX_COMPONENT_LENGTH> vertex{};
+  alignas(16) std::array<TResult, RESULT_HIT_TEST_COMPONENT_LENGTH> hitTest{};
+  std::array<double, RESULT_SURFACE_BLOCK_LENGTH> surface{};
+};
+
+/**
+ * @brief Per-frame origin for relative-to-center surface coordinates.
+ */
+struct ResultRelativeAnchor {
+  double mercatorX = 0.0;
+  double mercatorY = 0.0;
+  double lng = 0.0;
+  double lat = 0.0;
+};
+
+/**
+ * @brief Where one prepared item is written. Only `item` is required.
+ */
+struct ResultItemTarget {
+  double* item = nullptr;
+  float* vertexOutput = nullptr;
+  float* instanceOutput = nullptr;
+  // Surface stream record, with INPUT_FLAG_SURFACE_STREAM for surface items.
+  double* surfaceRecord = nullptr;
+  std::size_t itemIndex = 0;
+  bool surfaceStream = false;
+};
+
+/**
+ * @brief Rebases the absolute coordinates of a surface block onto `anchor`.
+ *
+ * The subtraction runs in double, so the deltas only lose precision when they
+ * are narrowed, and that loss scales with the distance from the anchor rather
+ * than with the absolute coordinate.
+ */
+static inline void rebaseSurfaceBlock(
+    std::array<double, RESULT_SURFACE_BLOCK_LENGTH>& surface,
+    const ResultRelativeAnchor& anchor) {
+  surface[RESULT_SURFACE_MERCATOR_CENTER_OFFSET] -= anchor.mercatorX;
+  surface[RESULT_SURFACE_MERCATOR_CENTER_OFFSET + 1] -= anchor.mercatorY;
+  surface[RESULT_SURFACE_BASE_LNG_LAT_OFFSET] -= anchor.lng;
+  surface[RESULT_SURFACE_BASE_LNG_LAT_OFFSET + 1] -= anchor.lat;
+  surface[RESULT_SURFACE_DISPLACED_CENTER_OFFSET] -= anchor.lng;
+  surface[RESULT_SURFACE_DISPLACED_CENTER_OFFSET + 1] -= anchor.lat;
+  for (std::size_t corner = 0; corner < 4; ++corner) {
+    const std::size_t base = RESULT_SURFACE_CORNER_MODEL_OFFSET +
+                             corner * RESULT_SURFACE_CORNER_MODEL_STRIDE;
+    surface[base + 2] -= anchor.lng;
+    surface[base + 3] -= anchor.lat;
+  }
+}
+
+/**
+ * @brief Result item stride (in doubles) for the frame's output flags.
+ */
+static inline std::size_t resolveResultItemStride(bool float32Result,
+                                                  bool surfaceStream,
+                                                  bool vertexOutput) {
+  if (vertexOutput) {
+    if (surfaceStream) {
+      return float32Result ? RESULT_FLOAT32_VERTEXLESS_STREAM_ITEM_STRIDE
+                           : RESULT_VERTEXLESS_STREAM_ITEM_STRIDE;
+    }
+    return float32Result ? RESULT_FLOAT32_VERTEXLESS_ITEM_STRIDE
+                         : RESULT_VERTEXLESS_ITEM_STRIDE;
+  }
+  if (surfaceStream) {
+    return float32Result ? RESULT_FLOAT32_STREAM_ITEM_STRIDE
+                         : RESULT_STREAM_ITEM_STRIDE;
+  }
+  return float32Result ? RESULT_FLOAT32_ITEM_STRIDE : RESULT_ITEM_STRIDE;
+}
+
+/**
+ * @brief Writes one result item in the layout selected by `TResult`:
+ * `double` for RESULT_ITEM_STRIDE items, `float` for
+ * RESULT_FLOAT32_ITEM_STRIDE items. Without `includeVertex` the vertex block
+ * is left out (the RESULT_*VERTEXLESS* layouts), and without
+ * `includeSurface` the surface block (the RESULT_*STREAM_ITEM_STRIDE layouts).
+ */
+template <typename TResult>
+static inline void writeResultItem(double* itemBase,
+                                   const ResultItemComponents<TResult>& components,
+                                   bool includeVertex,
+                                   bool includeSurface);
+
+template <>
+inline void writeResultItem<double>(double* itemBase,
+                                    const ResultItemComponents<double>& components,
+                                    bool includeVertex,
+                                    bool includeSurface) {
+  double* write = itemBase;
+  write = std::copy(components.common.begin(), components.common.end(), write);
+  if (includeVertex) {
+    write =
+        std::copy(components.vertex.begin(), components.vertex.end(), write);
+  }
+  write = std::copy(components.hitTest.begin(), components.hitTest.end(), write);
+  if (includeSurface) {
+    std::copy(components.surface.begin(), components.surface.end(), write);
+  }
+}
+
+template <>
+inline void writeResultItem<float>(double* itemBase,
+                                   const ResultItemComponents<float>& components,
+                                   bool includeVertex,
+                                   bool includeSurface) {
+  float* write = reinterpret_cast<float*>(itemBase);
+  for (std::size_t index = 0; index < RESULT_ID_COMPONENT_LENGTH; ++index) {
+    const int32_t id = toResultId(components.common[index]);
+    std::memcpy(write + index, &id, sizeof(id));
+  }
+  storeFloat32Components(write + RESULT_ID_COMPONENT_LENGTH,
+                         components.common.data() + RESULT_ID_COMPONENT_LENGTH,
+                         RESULT_COMMON_ITEM_LENGTH - RESULT_ID_COMPONENT_LENGTH);
+  write += RESULT_COMMON_ITEM_LENGTH;
+  if (includeVertex) {
+    storeFloat32Components(
+        write, components.vertex.data(), RESULT_VERTEX_COMPONENT_LENGTH);
+    write += RESULT_VERTEX_COMPONENT_LENGTH;
+  }
+  storeFloat32Components(
+      write, components.hitTest.data(), RESULT_HIT_TEST_COMPONENT_LENGTH);
+  write += RESULT_HIT_TEST_COMPONENT_LENGTH;
+  if (includeSurface) {
+    storeFloat32Components(
+        write, components.surface.data(), RESULT_SURFACE_BLOCK_LENGTH);
+  }
+}
+
+/**
+ * @brief Writes one surface stream record (item index, surface block) in the
+ * layout selected by `TResult`.
+ */
+template <typename TResult>
+static inline void writeSurfaceRecord(
+    double* recordBase,
+    std::size_t itemIndex,
+    const std::array<double, RESULT_SURFACE_BLOCK_LENGTH>& surface);
+
+template <>
+inline void writeSurfaceRecord<double>(
+    double* recordBase,
+    std::size_t itemIndex,
+    const std::array<double, RESULT_SURFACE_BLOCK_LENGTH>& surface) {
+  recordBase[0] = static_cast<double>(itemIndex);
+  std::copy(surface.begin(), surface.end(), recordBase + 1);
+}
+
+template <>
+inline void writeSurfaceRecord<float>(
+    double* recordBase,
+    std::size_t itemIndex,
+    const std::array<double, RESULT_SURFACE_BLOCK_LENGTH>& surface) {
+  float* write = reinterpret_cast<float*>(recordBase);
+  const int32_t index = toResultId(static_cast<double>(itemIndex));
+  std::memcpy(write, &index, sizeof(index));
+  storeFloat32Components(write + 1, surface.data(), RESULT_SURFACE_BLOCK_LENGTH);
+  write[1 + RESULT_SURFACE_BLOCK_LENGTH] = 0.0f;
+}
+
+/**
+ * @brief Reads the item index of a surface stream record.
+ */
+static inline std::size_t readSurfaceRecordItemIndex(const double* recordBase,
+                                                     bool float32Result) {
+  if (float32Result) {
+    int32_t index = 0;
+    std::memcpy(&index, recordBase, sizeof(index));
+    return static_cast<std::size_t>(index);
+  }
+  return static_cast<std::size_t>(recordBase[0]);
+}
+
+/**
+ * @brief Updates the item index of a surface stream record.
+ */
+static inline void writeSurfaceRecordItemIndex(double* recordBase,
+                                               std::size_t itemIndex,
+                                               bool float32Result) {
+  if (float32Result) {
+    const int32_t index = toResultId(static_cast<double>(itemIndex));
+    std::memcpy(recordBase, &index, sizeof(index));
+  } else {
+    recordBase[0] = static_cast<double>(itemIndex);
+  }
+}
+
 static inline ResultBufferHeader* initializeResultHeader(double* resultPtr) {
   auto* header = AsResultHeader(resultPtr);
   header->preparedCount = 0;
@@ -587,8 +973,14 @@ static inline ResultBufferHeader* initializeResultHeader(double* resultPtr) {
   header->vertexComponentCount = RESULT_VERTEX_COMPONENT_LENGTH;
   header->surfaceCornerCount = SURFACE_CLIP_CORNER_COUNT;
   header->flags = 0;
-  header->reserved0 = 0;
-  header->reserved1 = 0;
+  header->culledCount = 0;
+  header->anchorMercatorX = 0;
+  header->anchorMercatorY = 0;
+  header->anchorLng = 0;
+  header->anchorLat = 0;
+  header->surfaceCount = 0;
+  header->surfaceOffset = 0;
+  header->surfaceStride = 0;
   return header;
 }
 
@@ -861,6 +1253,17 @@ struct ProjectionContext {
   const double* pixelMatrixInverse = nullptr;
 };
 
+static inline ProjectionContext createProjectionContext(
+    const FrameConstants& frame, const double* matrixPtr) {
+  ProjectionContext projectionContext;
+  projectionContext.worldSize = frame.worldSize;
+  projectionContext.cameraToCenterDistance = frame.cameraToCenterDistance;
+  projectionContext.mercatorMatrix = matrixPtr;
+  projectionContext.pixelMatrix = matrixPtr + 16;
+  projectionContext.pixelMatrixInverse = matrixPtr + 32;
+  return projectionContext;
+}
+
 static inline bool projectSpritePoint(const ProjectionContext& ctx,
                                       const SpriteLocation& location,
                                       SpriteScreenPoint& out) {
@@ -901,6 +1304,37 @@ static inline bool unprojectSpritePoint(const ProjectionContext& ctx,
   return true;
 }
 
+/**
+ * @brief Picks the relative-to-center anchor of a frame: the ground point
+ * under the viewport center, else the camera location.
+ */
+static inline ResultRelativeAnchor resolveResultRelativeAnchor(
+    const ProjectionContext& ctx,
+    const FrameConstants& frame,
+    bool clipContextAvailable) {
+  SpriteLocation center{};
+  const bool hasCenter =
+      clipContextAvailable &&
+      unprojectSpritePoint(
+          ctx,
+          SpritePoint{frame.drawingBufferWidth / frame.pixelRatio * 0.5,
+                      frame.drawingBufferHeight / frame.pixelRatio * 0.5},
+          center);
+  if (!hasCenter) {
+    if (!std::isfinite(frame.cameraLng) || !std::isfinite(frame.cameraLat)) {
+      return {};
+    }
+    center.lng = frame.cameraLng;
+    center.lat = frame.cameraLat;
+  }
+  ResultRelativeAnchor anchor;
+  anchor.mercatorX = mercatorXfromLng(center.lng);
+  anchor.mercatorY = mercatorYfromLat(center.lat);
+  anchor.lng = center.lng;
+  anchor.lat = center.lat;
+  return anchor;
+}
+
 static inline bool projectLngLatToClip(const ProjectionContext& ctx,
                                        const SpriteLocation& location,
                                        std::array<double, 4>& out) {
@@ -1092,27 +1526,42 @@ static inline bool hasOriginLocation(const InputItemEntry& entry) {
   return false;
 }
 
+static SpriteScreenPoint computeImageCenter(
+    const BucketItem& bucketItem,
+    bool useResolvedAnchor,
+    const ProjectionContext& projection,
+    const FrameConstants& frame,
+    const ResourceInfo& resource,
+    double effectivePixelsPerMeter,
+    const FrameVector<BucketItem>& bucketItems,
+    bool clipContextAvailable);
+
 /**
- * @brief Resolves the on-screen center of an item, honoring anchors/origins.
+ * @brief Resolves the anchored and anchorless on-screen centers of an item,
+ * honoring anchors/origins.
  *
  * The function now consumes rotation cache data indirectly through the
  * `BucketItem`, so recomputing trigonometric values while walking origin chains
- * is unnecessary.
+ * is unnecessary. Both centers come from one placement. With a geometry cache,
+ * surfaces also leave their geometry there for depth collection and draw prep.
  */
-static SpriteScreenPoint computeImageCenter(
+static void computeImageCenters(
     const BucketItem& bucketItem,
-    bool useResolvedAnchor,
     const ProjectionContext& projection,
     const FrameConstants& frame,
     const ResourceInfo& resource,
     double effectivePixelsPerMeter,
-    const std::vector<BucketItem>& bucketItems,
-    bool clipContextAvailable) {
+    const FrameVector<BucketItem>& bucketItems,
+    bool clipContextAvailable,
+    SurfaceGeometryCache* geometryCache,
+    SpriteScreenPoint& outResolvedCenter,
+    SpriteScreenPoint& outAnchorlessCenter) {
   SpriteScreenPoint fallbackCenter = bucketItem.projected;
 
   SpriteScreenPoint basePoint = bucketItem.projected;
 
-  if (hasOriginLocation(*bucketItem.entry)) {
+  const bool hasOrigin = hasOriginLocation(*bucketItem.entry);
+  if (hasOrigin) {
     const BucketItem* reference =
         resolveOriginBucketItem(bucketItem, bucketItems);
     if (reference && reference->resource) {
@@ -1143,12 +1592,14 @@ static SpriteScreenPoint computeImageCenter(
   SpriteScreenPoint anchorlessCenter = basePoint;
 
   if (resource.width <= 0.0 || resource.height <= 0.0) {
-    return basePoint;
+    outResolvedCenter = basePoint;
+    outAnchorlessCenter = basePoint;
+    return;
   }
 
   if (isSurface) {
     SpriteLocation baseLngLat = bucketItem.spriteLocation;
-    if (hasOriginLocation(*bucketItem.entry)) {
+    if (hasOrigin) {
       SpriteLocation unprojected{};
       if (unprojectSpritePoint(projection,
                                SpritePoint{basePoint.x, basePoint.y},
@@ -1180,8 +1631,19 @@ static SpriteScreenPoint computeImageCenter(
     params.pixelRatio = frame.pixelRatio;
     params.resolveAnchorless = true;
 
-    const SurfaceCenterResult placement =
-        calculateSurfaceCenterPosition(params);
+    SurfaceCenterResult placement;
+    if (geometryCache != nullptr) {
+      placement = placeSurfaceCenter(
+          params, ensureSurfaceGeometry(*geometryCache, params));
+      // Draw prep places surfaces through the clip path at the same base.
+      if (!hasOrigin && clipContextAvailable) {
+        geometryCache->center = placement.center;
+        geometryCache->displacedLngLat = placement.displacedLngLat;
+        geometryCache->hasPlacement = true;
+      }
+    } else {
+      placement = calculateSurfaceCenterPosition(params);
+    }
 
     if (placement.anchorlessCenter) {
       anchorlessCenter = *placement.anchorlessCenter;
@@ -1212,13 +1674,44 @@ static SpriteScreenPoint computeImageCenter(
                         placement.center.y - placement.anchorShift.y};
   }
 
-  return useResolvedAnchor ? anchorAppliedCenter : anchorlessCenter;
+  outResolvedCenter = anchorAppliedCenter;
+  outAnchorlessCenter = anchorlessCenter;
+}
+
+/**
+ * @brief Resolves one on-screen center of an item without touching caches,
+ * as origin chains are walked with the referencing item's pixel scale.
+ */
+static SpriteScreenPoint computeImageCenter(
+    const BucketItem& bucketItem,
+    bool useResolvedAnchor,
+    const ProjectionContext& projection,
+    const FrameConstants& frame,
+    const ResourceInfo& resource,
+    double effectivePixelsPerMeter,
+    const FrameVector<BucketItem>& bucketItems,
+    bool clipContextAvailable) {
+  SpriteScreenPoint resolvedCenter;
+  SpriteScreenPoint anchorlessCenter;
+  computeImageCenters(bucketItem,
+                      projection,
+                      frame,
+                      resource,
+                      effectivePixelsPerMeter,
+                      bucketItems,
+                      clipContextAvailable,
+                      nullptr,
+                      resolvedCenter,
+                      anchorlessCenter);
+  return useResolvedAnchor ? resolvedCenter : anchorlessCenter;
 }
 
-static void precomputeBucketCenters(std::vector<BucketItem>& bucketItems,
-                                    const ProjectionContext& projection,
-                                    const FrameConstants& frame,
-                                    bool clipContextAvailable) {
+static void precomputeBucketCenters(
+    FrameVector<BucketItem>& bucketItems,
+    FrameVector<SurfaceGeometryCache>& surfaceGeometries,
+    const ProjectionContext& projection,
+    const FrameConstants& frame,
+    bool clipContextAvailable) {
   for (BucketItem& bucket : bucketItems) {
     if (bucket.entry == nullptr || bucket.resource == nullptr) {
       continue;
@@ -1226,33 +1719,24 @@ static void precomputeBucketCenters(std::vector<BucketItem>& bucketItems,
     if (!bucket.projectedValid) {
       continue;
     }
+    if (bucket.culled && !bucket.originReferenced) {
+      continue;
+    }
     if (!ensureBucketEffectivePixelsPerMeter(bucket, projection, frame)) {
       continue;
     }
 
-    const double effectivePixelsPerMeter = bucket.effectivePixelsPerMeter;
-    SpriteScreenPoint resolvedCenter =
-        computeImageCenter(bucket,
-                           true,
-                           projection,
-                           frame,
-                           *bucket.resource,
-                           effectivePixelsPerMeter,
-                           bucketItems,
-                           clipContextAvailable);
-    bucket.resolvedAnchorCenter = resolvedCenter;
+    computeImageCenters(bucket,
+                        projection,
+                        frame,
+                        *bucket.resource,
+                        bucket.effectivePixelsPerMeter,
+                        bucketItems,
+                        clipContextAvailable,
+                        findSurfaceGeometry(bucket, surfaceGeometries),
+                        bucket.resolvedAnchorCenter,
+                        bucket.anchorlessCenter);
     bucket.hasResolvedAnchorCenter = true;
-
-    SpriteScreenPoint anchorlessCenter =
-        computeImageCenter(bucket,
-                           false,
-                           projection,
-                           frame,
-                           *bucket.resource,
-                           effectivePixelsPerMeter,
-                           bucketItems,
-                           clipContextAvailable);
-    bucket.anchorlessCenter = anchorlessCenter;
     bucket.hasAnchorlessCenter = true;
   }
 }
@@ -1298,347 +1782,1097 @@ static inline bool ensureBucketEffectivePixelsPerMeter(
   return true;
 }
 
-struct DepthWorkerContext {
-  std::vector<BucketItem>* bucketItems = nullptr;
-  const ProjectionContext* projectionContext = nullptr;
-  const FrameConstants* frame = nullptr;
-  bool enableSurfaceBias = false;
-};
-
-constexpr std::size_t DEPTH_PARALLEL_MIN_ITEMS = 512;
-constexpr std::size_t DEPTH_PARALLEL_SLICE = 256;
-
-static inline std::size_t determineDepthWorkerCount(std::size_t totalItems) {
-  return determineWorkerCount(
-      totalItems, DEPTH_PARALLEL_MIN_ITEMS, DEPTH_PARALLEL_SLICE);
-}
+//////////////////////////////////////////////////////////////////////////////////////
+// Viewport culling
 
-static void processDepthRange(const DepthWorkerContext& ctx,
-                              std::size_t startIndex,
-                              std::size_t endIndex,
-                              std::vector<DepthItem>& outDepthItems) {
-  outDepthItems.clear();
-  if (ctx.bucketItems == nullptr || ctx.projectionContext == nullptr ||
-      ctx.frame == nullptr) {
-    return;
-  }
+constexpr std::size_t VIEWPORT_CULL_PARALLEL_MIN_ITEMS = 4096;
+constexpr std::size_t VIEWPORT_CULL_PARALLEL_SLICE = 2048;
 
-  auto& bucketItems = *ctx.bucketItems;
-  const ProjectionContext& projectionContext = *ctx.projectionContext;
-  const FrameConstants& frame = *ctx.frame;
+/**
+ * @brief Viewport rectangle (CSS pixels) and side clip planes, both widened
+ * by the guard band.
+ */
+struct ViewportCullBounds {
+  double minX = 0.0;
+  double minY = 0.0;
+  double maxX = 0.0;
+  double maxY = 0.0;
+  // Left, right, bottom and top planes over mercator coordinates, normalized
+  // so that plane . (x, y, z, 1) is a signed distance (inside >= 0).
+  std::array<std::array<double, 4>, 4> clipPlanes{};
+  bool hasClipPlanes = false;
+};
 
-  if (startIndex >= bucketItems.size()) {
-    return;
+static inline bool buildViewportCullBounds(
+    const ProjectionContext& projectionContext,
+    const FrameConstants& frame,
+    double guardBandPixels,
+    ViewportCullBounds& out) {
+  if (!std::isfinite(frame.pixelRatio) || frame.pixelRatio <= 0.0 ||
+      !std::isfinite(frame.drawingBufferWidth) ||
+      !std::isfinite(frame.drawingBufferHeight) ||
+      frame.drawingBufferWidth <= 0.0 || frame.drawingBufferHeight <= 0.0) {
+    return false;
   }
-  endIndex = std::min(endIndex, bucketItems.size());
-  if (startIndex >= endIndex) {
-    return;
+  const double guard =
+      std::isfinite(guardBandPixels) && guardBandPixels > 0.0
+          ? guardBandPixels
+          : 0.0;
+  const double width = frame.drawingBufferWidth / frame.pixelRatio;
+  const double height = frame.drawingBufferHeight / frame.pixelRatio;
+  out.minX = -guard;
+  out.minY = -guard;
+  out.maxX = width + guard;
+  out.maxY = height + guard;
+
+  out.hasClipPlanes = false;
+  const double* m = projectionContext.mercatorMatrix;
+  if (m == nullptr) {
+    return true;
   }
-
-  outDepthItems.reserve(endIndex - startIndex);
-
-  const auto* triangleIndices = TRIANGLE_INDICES.data();
-  const int triangleIndexCount =
-      static_cast<int>(TRIANGLE_INDICES.size());
-
-  for (std::size_t idx = startIndex; idx < endIndex; ++idx) {
-    BucketItem& bucketItem = bucketItems[idx];
-    if (bucketItem.entry == nullptr || bucketItem.resource == nullptr) {
-      continue;
+  // -w * scale <= x <= w * scale widens NDC by the guard band.
+  const double scaleX = 1.0 + 2.0 * guard / width;
+  const double scaleY = 1.0 + 2.0 * guard / height;
+  for (std::size_t plane = 0; plane < 4; ++plane) {
+    const std::size_t row = plane < 2 ? 0 : 1;
+    const double sign = (plane % 2 == 0) ? 1.0 : -1.0;
+    const double scale = row == 0 ? scaleX : scaleY;
+    std::array<double, 4> coefficients{};
+    for (std::size_t column = 0; column < 4; ++column) {
+      coefficients[column] = m[column * 4 + 3] * scale +
+                             sign * m[column * 4 + row];
     }
-    if (!bucketItem.resource->textureReady) {
-      continue;
+    const double length = std::sqrt(coefficients[0] * coefficients[0] +
+                                    coefficients[1] * coefficients[1] +
+                                    coefficients[2] * coefficients[2]);
+    if (!std::isfinite(length) || length <= 0.0) {
+      return true;
     }
-    if (!bucketItem.projectedValid) {
-      continue;
+    for (double& coefficient : coefficients) {
+      coefficient /= length;
     }
+    out.clipPlanes[plane] = coefficients;
+  }
+  out.hasClipPlanes = true;
+  return true;
+}
 
-    if (!ensureBucketEffectivePixelsPerMeter(bucketItem,
-                                             projectionContext,
-                                             frame)) {
-      continue;
-    }
-
-    const double effectivePixelsPerMeter = bucketItem.effectivePixelsPerMeter;
-
-    SpriteScreenPoint depthCenter = bucketItem.projected;
-    tryGetPrecomputedCenter(bucketItem, true, depthCenter);
-
-    double depthKey = 0.0;
-    const bool isSurface = std::lround(bucketItem.entry->mode) == 0;
-    DepthItem depthEntry;
-    depthEntry.item = &bucketItem;
+/**
+ * @brief Radius of the circle around the anchor point that holds every
+ * corner, for half extents shifted by the anchor and then by an offset.
+ */
+static inline double calculateAnchoredQuadRadius(double halfWidth,
+                                                 double halfHeight,
+                                                 const SpriteAnchor& anchor,
+                                                 double offsetLength) {
+  return std::hypot(halfWidth * (1.0 + std::fabs(anchor.x)),
+                    halfHeight * (1.0 + std::fabs(anchor.y))) +
+         offsetLength;
+}
 
-    if (isSurface) {
-      if (!projectionContext.mercatorMatrix) {
-        continue;
-      }
+static inline bool hasUsableEffectivePixelsPerMeter(const BucketItem& item) {
+  return item.hasEffectivePixelsPerMeter &&
+         std::isfinite(item.effectivePixelsPerMeter) &&
+         item.effectivePixelsPerMeter > 0.0;
+}
 
-      const double imageScale = resolveImageScale(*bucketItem.entry);
-      const SpriteAnchor anchor = resolveAnchor(*bucketItem.entry);
-      const SpriteImageOffset offset = resolveOffset(*bucketItem.entry);
-
-      const SurfaceWorldDimensions worldDims = calculateSurfaceWorldDimensions(
-          bucketItem.resource->width,
-          bucketItem.resource->height,
-          frame.baseMetersPerPixel,
-          imageScale,
-          frame.zoomScaleFactor,
-          effectivePixelsPerMeter,
-          frame.spriteMinPixel,
-          frame.spriteMaxPixel);
-      const SurfaceCorner offsetMeters = calculateSurfaceOffsetMeters(
-          &offset,
-          imageScale,
-          frame.zoomScaleFactor,
-          worldDims.scaleAdjustment);
-      const auto cornerDisplacements =
-          calculateSurfaceCornerDisplacements(worldDims.width,
-                                              worldDims.height,
-                                              &anchor,
-                                              bucketItem.rotation.sinNegativeRad,
-                                              bucketItem.rotation.cosNegativeRad,
-                                              offsetMeters);
-
-      SpriteLocation baseLngLat = bucketItem.spriteLocation;
-      if (hasOriginLocation(*bucketItem.entry)) {
-        const BucketItem* reference =
-            resolveOriginBucketItem(bucketItem, bucketItems);
-        if (reference && reference->resource) {
-          const bool useAnchorDisplacement =
-              toBool(bucketItem.entry->originUseResolvedAnchor);
-          SpriteScreenPoint originCenter = reference->projected;
-          tryGetPrecomputedCenter(*reference, useAnchorDisplacement,
-                                  originCenter);
-          SpriteLocation reprojection{};
-          if (unprojectSpritePoint(projectionContext,
-                                   SpritePoint{originCenter.x, originCenter.y},
-                                   reprojection)) {
-            baseLngLat = reprojection;
-          }
-        }
-      }
+/**
+ * @brief Screen radius around `projected` holding a billboard's corners and
+ * both of its (anchored and anchorless) centers.
+ *
+ * The radius never shrinks as `effectivePixelsPerMeter` grows, so passing
+ * the larger of two candidates stays conservative.
+ */
+static inline double calculateBillboardBoundRadius(
+    const BucketItem& bucketItem,
+    const FrameConstants& frame,
+    double effectivePixelsPerMeter) {
+  const InputItemEntry& entry = *bucketItem.entry;
+  const double imageScale = resolveImageScale(entry);
+  const SpriteImageOffset offset = resolveOffset(entry);
+  const auto pixelDims = calculateBillboardPixelDimensions(
+      bucketItem.resource->width,
+      bucketItem.resource->height,
+      frame.baseMetersPerPixel,
+      imageScale,
+      frame.zoomScaleFactor,
+      effectivePixelsPerMeter,
+      frame.spriteMinPixel,
+      frame.spriteMaxPixel);
+  const SpritePoint offsetPixels = calculateBillboardOffsetPixels(
+      &offset,
+      imageScale,
+      frame.zoomScaleFactor,
+      effectivePixelsPerMeter,
+      pixelDims.scaleAdjustment);
+  return calculateAnchoredQuadRadius(pixelDims.width * 0.5,
+                                     pixelDims.height * 0.5,
+                                     resolveAnchor(entry),
+                                     std::hypot(offsetPixels.x,
+                                                offsetPixels.y));
+}
 
-      const bool applyBias = ctx.enableSurfaceBias;
-      const double clampedOrder =
-          std::fmin(bucketItem.entry->order, frame.orderMax - 1.0);
-      const double biasIndex = bucketItem.entry->subLayer * frame.orderBucket +
-                               clampedOrder;
-      const double depthBiasNdc = applyBias ? -(biasIndex * frame.epsNdc) : 0.0;
+static inline bool isCullableBucketItem(const BucketItem& bucketItem) {
+  return bucketItem.entry != nullptr && bucketItem.resource != nullptr &&
+         bucketItem.projectedValid && bucketItem.resource->width > 0.0 &&
+         bucketItem.resource->height > 0.0 &&
+         hasUsableEffectivePixelsPerMeter(bucketItem);
+}
 
-      std::array<double, SURFACE_CLIP_CORNER_COUNT * 2> displacementData{};
-      for (std::size_t corner = 0; corner < SURFACE_CLIP_CORNER_COUNT;
-           ++corner) {
-        displacementData[corner * 2 + 0] = cornerDisplacements[corner].east;
-        displacementData[corner * 2 + 1] = cornerDisplacements[corner].north;
-      }
+/**
+ * @brief Decides whether an item certainly lies outside the viewport.
+ *
+ * Billboards are tested in screen space with pixel dimensions clamped by
+ * spriteMin/MaxPixel; a billboard placed on another billboard's origin is
+ * bounded around that origin's projected point. Surfaces are tested as a
+ * bounding sphere against the side planes of the clip volume. Anything that
+ * cannot be bounded (surface origins, chained origins, missing data) is
+ * kept. Only the item itself is written, so items can be tested in parallel.
+ */
+static inline bool isBucketItemOutsideViewport(
+    const BucketItem& bucketItem,
+    const FrameVector<BucketItem>& bucketItems,
+    const FrameConstants& frame,
+    const ViewportCullBounds& bounds) {
+  if (!isCullableBucketItem(bucketItem)) {
+    return false;
+  }
+  const InputItemEntry& entry = *bucketItem.entry;
+  const bool hasOrigin = hasOriginLocation(entry);
 
-      const int displacementCount =
-          static_cast<int>(SURFACE_CLIP_CORNER_COUNT);
-
-      if (!__calculateSurfaceDepthKey(baseLngLat.lng,
-                                      baseLngLat.lat,
-                                      baseLngLat.z,
-                                      displacementData.data(),
-                                      displacementCount,
-                                      triangleIndices,
-                                      triangleIndexCount,
-                                      projectionContext.mercatorMatrix,
-                                      applyBias,
-                                      depthBiasNdc,
-                                      frame.minClipZEpsilon,
-                                      &depthKey)) {
-        continue;
+  if (std::lround(entry.mode) != 0) {
+    SpriteScreenPoint center = bucketItem.projected;
+    double radius = 0.0;
+    if (hasOrigin) {
+      const BucketItem* reference =
+          resolveOriginBucketItem(bucketItem, bucketItems);
+      if (reference == nullptr || !isCullableBucketItem(*reference) ||
+          std::lround(reference->entry->mode) == 0 ||
+          hasOriginLocation(*reference->entry)) {
+        return false;
       }
-
-      depthEntry.hasSurfaceData = true;
-      depthEntry.surfaceWorldDimensions = worldDims;
-      depthEntry.surfaceOffsetMeters = offsetMeters;
-      depthEntry.surfaceCornerDisplacements = cornerDisplacements;
+      const double effectivePixelsPerMeter =
+          std::max(bucketItem.effectivePixelsPerMeter,
+                   reference->effectivePixelsPerMeter);
+      center = reference->projected;
+      radius = calculateBillboardBoundRadius(
+                   *reference, frame, effectivePixelsPerMeter) +
+               calculateBillboardBoundRadius(
+                   bucketItem, frame, effectivePixelsPerMeter);
     } else {
-      if (!projectionContext.pixelMatrixInverse ||
-          !projectionContext.mercatorMatrix) {
-        continue;
-      }
-      if (!__calculateBillboardDepthKey(depthCenter.x,
-                                        depthCenter.y,
-                                        frame.worldSize,
-                                        projectionContext.pixelMatrixInverse,
-                                        projectionContext.mercatorMatrix,
-                                        &depthKey)) {
-        continue;
-      }
+      radius = calculateBillboardBoundRadius(
+          bucketItem, frame, bucketItem.effectivePixelsPerMeter);
     }
-
-    depthEntry.depthKey = depthKey;
-  outDepthItems.push_back(std::move(depthEntry));
+    if (!std::isfinite(radius)) {
+      return false;
+    }
+    return center.x + radius < bounds.minX || center.x - radius > bounds.maxX ||
+           center.y + radius < bounds.minY || center.y - radius > bounds.maxY;
   }
-}
-
-constexpr std::size_t PREPARE_PARALLEL_MIN_ITEMS = 256;
-constexpr std::size_t PREPARE_PARALLEL_SLICE = 128;
 
-static inline std::size_t determinePrepareWorkerCount(std::size_t totalItems) {
-  return determineWorkerCount(
-      totalItems, PREPARE_PARALLEL_MIN_ITEMS, PREPARE_PARALLEL_SLICE);
+  if (hasOrigin || !bounds.hasClipPlanes) {
+    return false;
+  }
+  SpriteMercatorCoordinate mercator = bucketItem.mercator;
+  if (!bucketItem.hasMercator &&
+      !calculateMercatorCoordinate(bucketItem.spriteLocation, mercator)) {
+    return false;
+  }
+  const double imageScale = resolveImageScale(entry);
+  const SpriteImageOffset offset = resolveOffset(entry);
+  const SurfaceWorldDimensions worldDims = calculateSurfaceWorldDimensions(
+      bucketItem.resource->width,
+      bucketItem.resource->height,
+      frame.baseMetersPerPixel,
+      imageScale,
+      frame.zoomScaleFactor,
+      bucketItem.effectivePixelsPerMeter,
+      frame.spriteMinPixel,
+      frame.spriteMaxPixel);
+  const SurfaceCorner offsetMeters = calculateSurfaceOffsetMeters(
+      &offset, imageScale, frame.zoomScaleFactor, worldDims.scaleAdjustment);
+  const double radiusMeters = calculateAnchoredQuadRadius(
+      worldDims.width * 0.5,
+      worldDims.height * 0.5,
+      resolveAnchor(entry),
+      std::hypot(offsetMeters.east, offsetMeters.north));
+  // Meters to mercator units at the sprite latitude.
+  const double radius =
+      mercatorZfromAltitude(radiusMeters, bucketItem.spriteLocation.lat);
+  if (!std::isfinite(radius)) {
+    return false;
+  }
+  for (const auto& plane : bounds.clipPlanes) {
+    const double distance = plane[0] * mercator.x + plane[1] * mercator.y +
+                            plane[2] * mercator.z + plane[3];
+    if (distance < -radius) {
+      return true;
+    }
+  }
+  return false;
 }
 
-static DepthCollectionResult collectDepthSortedItemsInternal(
-    std::vector<BucketItem>& bucketItems,
+/**
+ * @brief Marks items outside the viewport (plus guard band) as culled.
+ *
+ * Origins of surviving items are flagged so their centers are still
+ * precomputed. @return Number of culled items.
+ */
+static std::size_t cullBucketItemsOutsideViewport(
+    FrameVector<BucketItem>& bucketItems,
     const ProjectionContext& projectionContext,
     const FrameConstants& frame,
-    bool clipContextAvailable,
-    bool enableSurfaceBias) {
-  (void)clipContextAvailable;
-  DepthCollectionResult result;
-  std::vector<DepthItem> depthItems;
-  depthItems.reserve(bucketItems.size());
-
-  DepthWorkerContext ctx;
-  ctx.bucketItems = &bucketItems;
-  ctx.projectionContext = &projectionContext;
-  ctx.frame = &frame;
-  ctx.enableSurfaceBias = enableSurfaceBias;
+    double guardBandPixels) {
+  ViewportCullBounds bounds;
+  if (!buildViewportCullBounds(projectionContext, frame, guardBandPixels,
+                               bounds)) {
+    return 0;
+  }
 
   const std::size_t workerCount =
-      determineDepthWorkerCount(bucketItems.size());
-
-  if (workerCount <= 1 || bucketItems.empty()) {
-    processDepthRange(ctx, 0, bucketItems.size(), depthItems);
-  } else {
-    std::vector<std::vector<DepthItem>> workerOutputs(workerCount);
-    runWorkerJobs(workerCount, bucketItems.size(),
-                  [ctx, &workerOutputs](std::size_t start,
-                                        std::size_t end,
-                                        std::size_t workerIndex) {
-                    processDepthRange(
-                        ctx, start, end, workerOutputs[workerIndex]);
-                  });
-    depthItems.clear();
-    depthItems.reserve(bucketItems.size());
-    for (auto& workerVector : workerOutputs) {
-      for (DepthItem& item : workerVector) {
-        depthItems.push_back(std::move(item));
-      }
+      determineWorkerCount(bucketItems.size(),
+                           VIEWPORT_CULL_PARALLEL_MIN_ITEMS,
+                           VIEWPORT_CULL_PARALLEL_SLICE);
+  FrameVector<std::size_t> workerCulled(
+      std::max<std::size_t>(1, workerCount), 0,
+      g_frameArena.mainAllocator<std::size_t>());
+  runWorkerJobs(workerCount, bucketItems.size(),
+                [&](std::size_t start, std::size_t end,
+                    std::size_t workerIndex) {
+                  std::size_t culled = 0;
+                  for (std::size_t index = start; index < end; ++index) {
+                    BucketItem& bucketItem = bucketItems[index];
+                    bucketItem.culled = isBucketItemOutsideViewport(
+                        bucketItem, bucketItems, frame, bounds);
+                    culled += bucketItem.culled ? 1 : 0;
+                  }
+                  workerCulled[workerIndex] += culled;
+                });
+
+  std::size_t culledCount = 0;
+  for (const std::size_t culled : workerCulled) {
+    culledCount += culled;
+  }
+  if (culledCount == 0) {
+    return 0;
+  }
+  for (const BucketItem& bucketItem : bucketItems) {
+    if (bucketItem.culled || bucketItem.entry == nullptr ||
+        !hasOriginLocation(*bucketItem.entry)) {
+      continue;
+    }
+    const BucketItem* reference =
+        resolveOriginBucketItem(bucketItem, bucketItems);
+    if (reference != nullptr) {
+      bucketItems[static_cast<std::size_t>(reference - bucketItems.data())]
+          .originReferenced = true;
     }
   }
-
-  std::sort(depthItems.begin(), depthItems.end(),
-            [](const DepthItem& a, const DepthItem& b) {
-              if (a.depthKey != b.depthKey) {
-                return a.depthKey < b.depthKey;
-              }
-              const double orderA = a.item ? a.item->entry->order : 0.0;
-              const double orderB = b.item ? b.item->entry->order : 0.0;
-              if (orderA != orderB) {
-                return orderA < orderB;
-              }
-              const int64_t spriteA = a.item ? a.item->spriteHandle : 0;
-              const int64_t spriteB = b.item ? b.item->spriteHandle : 0;
-              if (spriteA != spriteB) {
-                return spriteA < spriteB;
-              }
-              const double imageA =
-                  a.item ? a.item->entry->imageHandle : 0.0;
-              const double imageB =
-                  b.item ? b.item->entry->imageHandle : 0.0;
-              return imageA < imageB;
-            });
-
-  result.items = std::move(depthItems);
-  return result;
+  return culledCount;
 }
 
-static bool prepareDrawSpriteImageInternal(
-    const DepthItem& depth,
+//////////////////////////////////////////////////////////////////////////////////////
+// Spatial grid culling
+
+// Absorbs rounding differences against the per-item test.
+constexpr double SPATIAL_GRID_CULL_SLACK_PIXELS = 1.0;
+constexpr double SPATIAL_GRID_CULL_SLACK_RATIO = 1e-6;
+
+/**
+ * @brief Frame-wide inputs of the spatial grid cell test.
+ */
+struct SpatialGridCullContext {
+  const ProjectionContext* projection = nullptr;
+  const FrameConstants* frame = nullptr;
+  ViewportCullBounds bounds;
+  // Largest and smallest positive max(width, height) over the resources.
+  double maxResourceExtent = 0.0;
+  double minResourceExtent = 0.0;
+};
+
+static inline bool buildSpatialGridCullContext(
     const ProjectionContext& projectionContext,
     const FrameConstants& frame,
-    bool clipContextAvailable,
-    bool useShaderBillboardGeometry,
-    bool useShaderSurfaceGeometry,
-    const std::vector<BucketItem>& bucketItems,
-    double* itemBase,
-    bool& outHasHitTest,
-    bool& outHasSurfaceInputs) {
-  outHasHitTest = false;
-  outHasSurfaceInputs = false;
-  if (depth.item == nullptr || depth.item->entry == nullptr ||
-      depth.item->resource == nullptr) {
+    double guardBandPixels,
+    const FrameVector<ResourceInfo>& resources,
+    SpatialGridCullContext& out) {
+  if (projectionContext.pixelMatrix == nullptr ||
+      !(projectionContext.worldSize > 0.0) ||
+      !std::isfinite(projectionContext.worldSize) ||
+      !(frame.zoomExp2 > 0.0) || !std::isfinite(frame.zoomExp2)) {
     return false;
   }
-
-  const BucketItem& bucketItem = *depth.item;
-  const InputItemEntry& entry = *bucketItem.entry;
-  const ResourceInfo& resource = *bucketItem.resource;
-  const double atlasU0 = resource.atlasU0;
-  const double atlasV0 = resource.atlasV0;
-  const double atlasU1 = resource.atlasU1;
-  const double atlasV1 = resource.atlasV1;
-  const double atlasUSpan = atlasU1 - atlasU0;
-  const double atlasVSpan = atlasV1 - atlasV0;
-
-  if (!bucketItem.projectedValid || resource.width <= 0.0 ||
-      resource.height <= 0.0) {
+  if (!buildViewportCullBounds(projectionContext, frame, guardBandPixels,
+                               out.bounds) ||
+      !out.bounds.hasClipPlanes) {
     return false;
   }
+  out.projection = &projectionContext;
+  out.frame = &frame;
+  out.maxResourceExtent = 0.0;
+  out.minResourceExtent = std::numeric_limits<double>::infinity();
+  for (const ResourceInfo& resource : resources) {
+    const double extent = std::max(resource.width, resource.height);
+    if (std::isfinite(extent) && extent > 0.0) {
+      out.maxResourceExtent = std::max(out.maxResourceExtent, extent);
+      out.minResourceExtent = std::min(out.minResourceExtent, extent);
+    }
+  }
+  return true;
+}
 
-  const bool isSurface = std::lround(entry.mode) == 0;
-  const bool enableSurfaceBias = frame.enableNdcBiasSurface;
+/**
+ * @brief Upper bound of the largest side produced by clampSpritePixelSize
+ * for any raw largest side up to `rawLargest`.
+ */
+static inline double calculateClampedLargestBound(double rawLargest,
+                                                  double spriteMinPixel,
+                                                  double spriteMaxPixel) {
+  double largest = rawLargest;
+  if (spriteMinPixel > 0.0) {
+    largest = std::max(largest, spriteMinPixel);
+  }
+  if (spriteMaxPixel > 0.0) {
+    largest = std::min(largest, spriteMaxPixel);
+  }
+  return largest;
+}
 
-  if (!bucketItem.hasEffectivePixelsPerMeter ||
-      !std::isfinite(bucketItem.effectivePixelsPerMeter) ||
-      bucketItem.effectivePixelsPerMeter <= 0.0) {
-    return false;
+/**
+ * @brief Offset bound for images raised to spriteMinPixel: the offset then
+ * scales with the image, i.e. by spriteMinPixel / (extent * baseMetersPerPixel).
+ * Returned in pixels; divide by effectivePixelsPerMeter for meters.
+ */
+static inline double calculateRaisedOffsetBound(
+    const SpatialGridImageReach& reach,
+    const SpatialGridCullContext& ctx) {
+  const FrameConstants& frame = *ctx.frame;
+  if (!(frame.spriteMinPixel > 0.0) || !(frame.baseMetersPerPixel > 0.0) ||
+      !std::isfinite(ctx.minResourceExtent)) {
+    return 0.0;
   }
-  const double effectivePixelsPerMeter = bucketItem.effectivePixelsPerMeter;
+  return reach.offsetMeters * frame.spriteMinPixel /
+         (ctx.minResourceExtent * frame.baseMetersPerPixel);
+}
 
-  SpriteScreenPoint baseProjected = bucketItem.projected;
-  if (hasOriginLocation(entry)) {
-      const BucketItem* reference =
-          resolveOriginBucketItem(bucketItem, bucketItems);
-      if (reference && reference->resource) {
-        const bool useAnchor = toBool(entry.originUseResolvedAnchor);
-        SpriteScreenPoint originCenter = reference->projected;
-        tryGetPrecomputedCenter(*reference, useAnchor, originCenter);
-        baseProjected = originCenter;
-      }
-    }
+/**
+ * @brief Bounds calculateBillboardBoundRadius over every billboard in
+ * `reach` whose effectivePixelsPerMeter is at most `maxPixelsPerMeter`.
+ */
+static inline double calculateBillboardReachPixels(
+    const SpatialGridImageReach& reach,
+    const SpatialGridCullContext& ctx,
+    double maxPixelsPerMeter) {
+  const FrameConstants& frame = *ctx.frame;
+  const double zoomScale = std::fabs(frame.zoomScaleFactor);
+  const double rawLargest = ctx.maxResourceExtent *
+                            std::fabs(frame.baseMetersPerPixel) * reach.scale *
+                            zoomScale * maxPixelsPerMeter;
+  const double largest = calculateClampedLargestBound(
+      rawLargest, frame.spriteMinPixel, frame.spriteMaxPixel);
+  const double offset =
+      std::max(reach.scaledOffsetMeters * zoomScale * maxPixelsPerMeter,
+               calculateRaisedOffsetBound(reach, ctx));
+  return largest * reach.anchorReach + offset;
+}
 
-  SpriteLocation baseLngLat = bucketItem.spriteLocation;
-  if (hasOriginLocation(entry)) {
-    SpriteLocation unprojected{};
-    if (unprojectSpritePoint(projectionContext,
-                             SpritePoint{baseProjected.x, baseProjected.y},
-                             unprojected)) {
-      baseLngLat = unprojected;
-    }
+/**
+ * @brief Bounds the surface radius (meters) used by the per-item test over
+ * every surface in `reach` whose effectivePixelsPerMeter is at least
+ * `minPixelsPerMeter`.
+ */
+static inline double calculateSurfaceReachMeters(
+    const SpatialGridImageReach& reach,
+    const SpatialGridCullContext& ctx,
+    double minPixelsPerMeter) {
+  const FrameConstants& frame = *ctx.frame;
+  const double zoomScale = std::fabs(frame.zoomScaleFactor);
+  double largest = ctx.maxResourceExtent *
+                   std::fabs(frame.baseMetersPerPixel) * reach.scale *
+                   zoomScale;
+  if (frame.spriteMinPixel > 0.0) {
+    largest = std::max(largest, frame.spriteMinPixel / minPixelsPerMeter);
   }
-  baseLngLat.z = bucketItem.spriteLocation.z;
+  if (frame.spriteMaxPixel > 0.0) {
+    largest = std::min(largest, frame.spriteMaxPixel / minPixelsPerMeter);
+  }
+  const double offset =
+      std::max(reach.scaledOffsetMeters * zoomScale,
+               calculateRaisedOffsetBound(reach, ctx) / minPixelsPerMeter);
+  return largest * reach.anchorReach + offset;
+}
 
-  double cameraDistance = std::numeric_limits<double>::infinity();
-  if (std::isfinite(frame.cameraLng) && std::isfinite(frame.cameraLat)) {
-    SpriteLocation cameraLocation{frame.cameraLng,
-                                  frame.cameraLat,
-                                  frame.cameraAltitude};
-    cameraDistance =
-        calculateDistanceBetweenLocations(cameraLocation, baseLngLat);
+/**
+ * @brief Decides whether any image of a grid cell may survive the per-item
+ * viewport test.
+ *
+ * The cell box spans the sprite altitudes of its members. A box entirely
+ * behind the camera is dropped: depth collection skips images whose sprite
+ * point does not project. With every corner in front of the camera,
+ * projected sprite points stay inside the projected corners' bounds, and the
+ * clip w range bounds the perspective ratio and thus effectivePixelsPerMeter;
+ * the image radii are then bounded from the merged SpatialGridExtent.
+ * Anything else keeps the cell. A larger box or extent only widens these
+ * bounds, so the same test also prunes whole ranges of cells.
+ */
+static bool isSpatialGridCellVisible(const SpatialGridCullContext& ctx,
+                                     const SpatialGridExtent& extent,
+                                     double minX,
+                                     double minY,
+                                     double maxX,
+                                     double maxY) {
+  if (extent.unbounded || !std::isfinite(extent.minAltitude) ||
+      !std::isfinite(extent.maxAltitude)) {
+    return true;
   }
+  // Sprites beyond the mercator latitude limit keep their own latitude for
+  // metersPerPixel, which the cell bounds cannot express.
+  if (minY <= 0.0 || maxY >= 1.0) {
+    return true;
+  }
+  const ProjectionContext& projection = *ctx.projection;
+  const FrameConstants& frame = *ctx.frame;
 
-  const SpriteAnchor anchor = resolveAnchor(entry);
-  const SpriteImageOffset offset = resolveOffset(entry);
-  const double imageScale = resolveImageScale(entry);
-  const double totalRotateDeg = bucketItem.rotation.degrees;
+  const double northLat = latFromMercatorY(minY);
+  const double southLat = latFromMercatorY(maxY);
+  const double minAbsLat = (northLat >= 0.0 && southLat <= 0.0)
+                               ? 0.0
+                               : std::min(std::fabs(northLat),
+                                          std::fabs(southLat));
+  const double maxAbsLat = std::max(std::fabs(northLat), std::fabs(southLat));
+  const double maxCos = std::cos(minAbsLat * DEG2RAD);
+  const double minCos = std::cos(maxAbsLat * DEG2RAD);
+  if (!(minCos > 0.0)) {
+    return true;
+  }
+  const double circumference = 2.0 * PI * EARTH_RADIUS_METERS;
 
-  const double screenScaleX =
-      isSurface ? frame.identityScaleX : frame.screenToClipScaleX;
-  const double screenScaleY =
-      isSurface ? frame.identityScaleY : frame.screenToClipScaleY;
-  const double screenOffsetX =
-      isSurface ? frame.identityOffsetX : frame.screenToClipOffsetX;
-  const double screenOffsetY =
-      isSurface ? frame.identityOffsetY : frame.screenToClipOffsetY;
+  // Screen bounds of the box in the pixel matrix (altitude in meters).
+  const double* pixelMatrix = projection.pixelMatrix;
+  double screenMinX = std::numeric_limits<double>::infinity();
+  double screenMinY = std::numeric_limits<double>::infinity();
+  double screenMaxX = -std::numeric_limits<double>::infinity();
+  double screenMaxY = -std::numeric_limits<double>::infinity();
+  // Clip w range in the mercator matrix (altitude in mercator units).
+  const double* mercatorMatrix = projection.mercatorMatrix;
+  const double minZScale = 1.0 / (circumference * maxCos);
+  const double maxZScale = 1.0 / (circumference * minCos);
+  const double minZ = std::min(extent.minAltitude * minZScale,
+                               extent.minAltitude * maxZScale);
+  const double maxZ = std::max(extent.maxAltitude * minZScale,
+                               extent.maxAltitude * maxZScale);
+  double minW = std::numeric_limits<double>::infinity();
+  double maxW = 0.0;
+  std::size_t cornersInFront = 0;
+  bool straddlesCamera = false;
+  for (std::size_t corner = 0; corner < 8; ++corner) {
+    const double x = (corner & 1) != 0 ? maxX : minX;
+    const double y = (corner & 2) != 0 ? maxY : minY;
+    const bool upper = (corner & 4) != 0;
+
+    const double worldX = x * projection.worldSize;
+    const double worldY = y * projection.worldSize;
+    const double altitude = upper ? extent.maxAltitude : extent.minAltitude;
+    const double pixelW = pixelMatrix[3] * worldX + pixelMatrix[7] * worldY +
+                          pixelMatrix[11] * altitude + pixelMatrix[15];
+    if (!std::isfinite(pixelW)) {
+      return true;
+    }
+    if (pixelW <= 0.0) {
+      straddlesCamera = true;
+      continue;
+    }
+    ++cornersInFront;
+    const double screenX = (pixelMatrix[0] * worldX + pixelMatrix[4] * worldY +
+                            pixelMatrix[8] * altitude + pixelMatrix[12]) /
+                           pixelW;
+    const double screenY = (pixelMatrix[1] * worldX + pixelMatrix[5] * worldY +
+                            pixelMatrix[9] * altitude + pixelMatrix[13]) /
+                           pixelW;
+    screenMinX = std::min(screenMinX, screenX);
+    screenMaxX = std::max(screenMaxX, screenX);
+    screenMinY = std::min(screenMinY, screenY);
+    screenMaxY = std::max(screenMaxY, screenY);
+
+    const double z = upper ? maxZ : minZ;
+    const double clipW = mercatorMatrix[3] * x + mercatorMatrix[7] * y +
+                         mercatorMatrix[11] * z + mercatorMatrix[15];
+    if (!std::isfinite(clipW) || clipW <= 0.0) {
+      return true;
+    }
+    minW = std::min(minW, clipW);
+    maxW = std::max(maxW, clipW);
+  }
+  if (cornersInFront == 0) {
+    return false;
+  }
+  if (straddlesCamera || !std::isfinite(screenMinX) || !std::isfinite(screenMaxX) ||
+      !std::isfinite(screenMinY) || !std::isfinite(screenMaxY)) {
+    return true;
+  }
 
-  double useShaderSurfaceValue = 0.0;
+  // effectivePixelsPerMeter = perspectiveRatio / metersPerPixelAtLatitude.
+  double minRatio = 1.0;
+  double maxRatio = 1.0;
+  if (projection.cameraToCenterDistance > 0.0) {
+    minRatio = projection.cameraToCenterDistance / maxW;
+    maxRatio = projection.cameraToCenterDistance / minW;
+  }
+  const double pixelsPerMeterScale = 512.0 * frame.zoomExp2 / circumference;
+  const double minPixelsPerMeter = minRatio * pixelsPerMeterScale / maxCos;
+  const double maxPixelsPerMeter = maxRatio * pixelsPerMeterScale / minCos;
+  if (!(minPixelsPerMeter > 0.0) || !std::isfinite(maxPixelsPerMeter)) {
+    return true;
+  }
+
+  const ViewportCullBounds& bounds = ctx.bounds;
+  if (extent.billboards.present) {
+    double radius =
+        calculateBillboardReachPixels(extent.billboards, ctx, maxPixelsPerMeter);
+    if (extent.hasBillboardOrigins) {
+      // Bounded around the origin billboard: both radii add up.
+      radius *= 2.0;
+    }
+    radius += SPATIAL_GRID_CULL_SLACK_PIXELS;
+    if (!std::isfinite(radius)) {
+      return true;
+    }
+    if (!(screenMaxX + radius < bounds.minX ||
+          screenMinX - radius > bounds.maxX ||
+          screenMaxY + radius < bounds.minY ||
+          screenMinY - radius > bounds.maxY)) {
+      return true;
+    }
+  }
+  if (extent.surfaces.present) {
+    const double radius =
+        calculateSurfaceReachMeters(extent.surfaces, ctx, minPixelsPerMeter) *
+        maxZScale * (1.0 + SPATIAL_GRID_CULL_SLACK_RATIO);
+    if (!std::isfinite(radius)) {
+      return true;
+    }
+    bool outside = false;
+    for (const auto& plane : bounds.clipPlanes) {
+      const double distance =
+          plane[3] + std::max(plane[0] * minX, plane[0] * maxX) +
+          std::max(plane[1] * minY, plane[1] * maxY) +
+          std::max(plane[2] * minZ, plane[2] * maxZ);
+      if (distance < -radius) {
+        outside = true;
+        break;
+      }
+    }
+    if (!outside) {
+      return true;
+    }
+  }
+  return false;
+}
+
+struct DepthWorkerContext {
+  FrameVector<BucketItem>* bucketItems = nullptr;
+  FrameVector<SurfaceGeometryCache>* surfaceGeometries = nullptr;
+  const ProjectionContext* projectionContext = nullptr;
+  const FrameConstants* frame = nullptr;
+  bool enableSurfaceBias = false;
+};
+
+constexpr std::size_t DEPTH_PARALLEL_MIN_ITEMS = 512;
+constexpr std::size_t DEPTH_PARALLEL_SLICE = 256;
+constexpr std::size_t DEPTH_PARALLEL_CHUNK = 64;
+
+static inline std::size_t determineDepthWorkerCount(std::size_t totalItems) {
+  return determineWorkerCount(
+      totalItems, DEPTH_PARALLEL_MIN_ITEMS, DEPTH_PARALLEL_SLICE);
+}
+
+/**
+ * @brief Projects the four displaced corners of a surface to clip space.
+ */
+static inline bool projectSurfaceClipCorners(
+    const ProjectionContext& projectionContext,
+    const SpriteLocation& baseLngLat,
+    const std::array<SurfaceCorner, SURFACE_CLIP_CORNER_COUNT>& displacements,
+    std::array<std::array<double, 4>, SURFACE_CLIP_CORNER_COUNT>& outClip) {
+  for (std::size_t corner = 0; corner < SURFACE_CLIP_CORNER_COUNT; ++corner) {
+    SpriteLocation displaced;
+    applySurfaceDisplacement(baseLngLat, displacements[corner], displaced);
+    if (!projectLngLatToClip(projectionContext, displaced, outClip[corner])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Same depth key as __calculateSurfaceDepthKey, taken from corners
+ * that are already in clip space.
+ */
+static inline bool calculateSurfaceDepthKeyFromClipCorners(
+    const std::array<std::array<double, 4>, SURFACE_CLIP_CORNER_COUNT>& clip,
+    bool applyBias,
+    double biasNdc,
+    double minClipZEpsilon,
+    double& out) {
+  double maxDepth = -std::numeric_limits<double>::infinity();
+  for (const auto& corner : clip) {
+    double clipZ = corner[2];
+    const double clipW = corner[3];
+    if (!std::isfinite(clipZ) || !std::isfinite(clipW)) {
+      return false;
+    }
+    if (applyBias) {
+      const double biasedClipZ = clipZ + biasNdc * clipW;
+      const double minClipZ = -clipW + minClipZEpsilon;
+      clipZ = biasedClipZ < minClipZ ? minClipZ : biasedClipZ;
+    }
+    const double ndcZ = clipW != 0.0 ? (clipZ / clipW) : clipZ;
+    if (!std::isfinite(ndcZ)) {
+      return false;
+    }
+    maxDepth = std::max(maxDepth, -ndcZ);
+  }
+  if (!std::isfinite(maxDepth)) {
+    return false;
+  }
+  out = maxDepth;
+  return true;
+}
+
+static void processDepthRange(const DepthWorkerContext& ctx,
+                              std::size_t startIndex,
+                              std::size_t endIndex,
+                              FrameVector<DepthItem>& outDepthItems) {
+  outDepthItems.clear();
+  if (ctx.bucketItems == nullptr || ctx.projectionContext == nullptr ||
+      ctx.frame == nullptr) {
+    return;
+  }
+
+  auto& bucketItems = *ctx.bucketItems;
+  const ProjectionContext& projectionContext = *ctx.projectionContext;
+  const FrameConstants& frame = *ctx.frame;
+
+  if (startIndex >= bucketItems.size()) {
+    return;
+  }
+  endIndex = std::min(endIndex, bucketItems.size());
+  if (startIndex >= endIndex) {
+    return;
+  }
+
+  outDepthItems.reserve(endIndex - startIndex);
+
+  const auto* triangleIndices = TRIANGLE_INDICES.data();
+  const int triangleIndexCount =
+      static_cast<int>(TRIANGLE_INDICES.size());
+
+  for (std::size_t idx = startIndex; idx < endIndex; ++idx) {
+    BucketItem& bucketItem = bucketItems[idx];
+    if (bucketItem.entry == nullptr || bucketItem.resource == nullptr) {
+      continue;
+    }
+    if (bucketItem.culled) {
+      continue;
+    }
+    if (!bucketItem.resource->textureReady) {
+      continue;
+    }
+    if (!bucketItem.projectedValid) {
+      continue;
+    }
+
+    if (!ensureBucketEffectivePixelsPerMeter(bucketItem,
+                                             projectionContext,
+                                             frame)) {
+      continue;
+    }
+
+    const double effectivePixelsPerMeter = bucketItem.effectivePixelsPerMeter;
+
+    SpriteScreenPoint depthCenter = bucketItem.projected;
+    tryGetPrecomputedCenter(bucketItem, true, depthCenter);
+
+    double depthKey = 0.0;
+    const bool isSurface = std::lround(bucketItem.entry->mode) == 0;
+    DepthItem depthEntry;
+    depthEntry.item = &bucketItem;
+
+    if (isSurface) {
+      if (!projectionContext.mercatorMatrix) {
+        continue;
+      }
+
+      SurfaceGeometryCache& geometryCache =
+          (*ctx.surfaceGeometries)[bucketItem.surfaceGeometryIndex];
+      if (!geometryCache.hasGeometry) {
+        const SpriteAnchor anchor = resolveAnchor(*bucketItem.entry);
+        const SpriteImageOffset offset = resolveOffset(*bucketItem.entry);
+        SurfaceCenterParams params;
+        params.imageWidth = bucketItem.resource->width;
+        params.imageHeight = bucketItem.resource->height;
+        params.baseMetersPerPixel = frame.baseMetersPerPixel;
+        params.imageScale = resolveImageScale(*bucketItem.entry);
+        params.zoomScaleFactor = frame.zoomScaleFactor;
+        params.sinNegativeRotation = bucketItem.rotation.sinNegativeRad;
+        params.cosNegativeRotation = bucketItem.rotation.cosNegativeRad;
+        params.anchor = &anchor;
+        params.offset = &offset;
+        params.effectivePixelsPerMeter = effectivePixelsPerMeter;
+        params.spriteMinPixel = frame.spriteMinPixel;
+        params.spriteMaxPixel = frame.spriteMaxPixel;
+        ensureSurfaceGeometry(geometryCache, params);
+      }
+      const auto& cornerDisplacements = geometryCache.cornerDisplacements;
+
+      const bool applyBias = ctx.enableSurfaceBias;
+      const double clampedOrder =
+          std::fmin(bucketItem.entry->order, frame.orderMax - 1.0);
+      const double biasIndex = bucketItem.entry->subLayer * frame.orderBucket +
+                               clampedOrder;
+      const double depthBiasNdc = applyBias ? -(biasIndex * frame.epsNdc) : 0.0;
+
+      if (!hasOriginLocation(*bucketItem.entry)) {
+        // At its own location a surface projects each corner once; draw prep
+        // reuses these clip positions for its vertices.
+        if (!projectSurfaceClipCorners(projectionContext,
+                                       bucketItem.spriteLocation,
+                                       cornerDisplacements,
+                                       geometryCache.clipCorners) ||
+            !calculateSurfaceDepthKeyFromClipCorners(geometryCache.clipCorners,
+                                                     applyBias,
+                                                     depthBiasNdc,
+                                                     frame.minClipZEpsilon,
+                                                     depthKey)) {
+          continue;
+        }
+        geometryCache.hasClipCorners = true;
+      } else {
+        // Origin relative: the base is the origin's precomputed center.
+        SpriteLocation baseLngLat = bucketItem.spriteLocation;
+        const BucketItem* reference =
+            resolveOriginBucketItem(bucketItem, bucketItems);
+        if (reference && reference->resource) {
+          const bool useAnchorDisplacement =
+              toBool(bucketItem.entry->originUseResolvedAnchor);
+          SpriteScreenPoint originCenter = reference->projected;
+          tryGetPrecomputedCenter(*reference, useAnchorDisplacement,
+                                  originCenter);
+          SpriteLocation reprojection{};
+          if (unprojectSpritePoint(projectionContext,
+                                   SpritePoint{originCenter.x, originCenter.y},
+                                   reprojection)) {
+            baseLngLat = reprojection;
+          }
+        }
+
+        std::array<double, SURFACE_CLIP_CORNER_COUNT * 2> displacementData{};
+        for (std::size_t corner = 0; corner < SURFACE_CLIP_CORNER_COUNT;
+             ++corner) {
+          displacementData[corner * 2 + 0] = cornerDisplacements[corner].east;
+          displacementData[corner * 2 + 1] = cornerDisplacements[corner].north;
+        }
+
+        const int displacementCount =
+            static_cast<int>(SURFACE_CLIP_CORNER_COUNT);
+
+        if (!__calculateSurfaceDepthKey(baseLngLat.lng,
+                                        baseLngLat.lat,
+                                        baseLngLat.z,
+                                        displacementData.data(),
+                                        displacementCount,
+                                        triangleIndices,
+                                        triangleIndexCount,
+                                        projectionContext.mercatorMatrix,
+                                        applyBias,
+                                        depthBiasNdc,
+                                        frame.minClipZEpsilon,
+                                        &depthKey)) {
+          continue;
+        }
+      }
+
+      depthEntry.hasSurfaceData = true;
+    } else {
+      if (!projectionContext.pixelMatrixInverse ||
+          !projectionContext.mercatorMatrix) {
+        continue;
+      }
+      if (!__calculateBillboardDepthKey(depthCenter.x,
+                                        depthCenter.y,
+                                        frame.worldSize,
+                                        projectionContext.pixelMatrixInverse,
+                                        projectionContext.mercatorMatrix,
+                                        &depthKey)) {
+        continue;
+      }
+    }
+
+    depthEntry.depthKey = depthKey;
+  outDepthItems.push_back(std::move(depthEntry));
+  }
+}
+
+constexpr std::size_t PREPARE_PARALLEL_MIN_ITEMS = 256;
+constexpr std::size_t PREPARE_PARALLEL_SLICE = 128;
+constexpr std::size_t PREPARE_PARALLEL_CHUNK = 32;
+
+static inline std::size_t determinePrepareWorkerCount(std::size_t totalItems) {
+  return determineWorkerCount(
+      totalItems, PREPARE_PARALLEL_MIN_ITEMS, PREPARE_PARALLEL_SLICE);
+}
+
+/**
+ * @brief Frame-to-frame depth order history, used when temporal mode is on.
+ */
+static TemporalDepthSorter g_temporalDepthSorter;
+static bool g_temporalDepthSortEnabled = false;
+
+/**
+ * @brief History of the standalone `sortDepthKeys` export, kept apart so its
+ * calls neither replace the prepare pass's order nor add to its counters.
+ */
+static TemporalDepthSorter g_standaloneDepthSorter;
+
+static inline void sortDepthKeysWithMode(const FrameVector<DepthSortKey>& keys,
+                                         DepthSortMode mode,
+                                         TemporalDepthSorter& temporalSorter,
+                                         FrameVector<std::size_t>& outOrder) {
+  if (mode == DepthSortMode::Temporal) {
+    temporalSorter.sort(keys, outOrder);
+    return;
+  }
+  computeDepthSortOrder(keys, mode, outOrder);
+}
+
+static DepthCollectionResult collectDepthSortedItemsInternal(
+    FrameVector<BucketItem>& bucketItems,
+    FrameVector<SurfaceGeometryCache>& surfaceGeometries,
+    const ProjectionContext& projectionContext,
+    const FrameConstants& frame,
+    bool clipContextAvailable,
+    bool enableSurfaceBias) {
+  (void)clipContextAvailable;
+  DepthCollectionResult result{
+      FrameVector<DepthItem>(g_frameArena.mainAllocator<DepthItem>())};
+  FrameVector<DepthItem> depthItems(g_frameArena.mainAllocator<DepthItem>());
+  depthItems.reserve(bucketItems.size());
+
+  DepthWorkerContext ctx;
+  ctx.bucketItems = &bucketItems;
+  ctx.surfaceGeometries = &surfaceGeometries;
+  ctx.projectionContext = &projectionContext;
+  ctx.frame = &frame;
+  ctx.enableSurfaceBias = enableSurfaceBias;
+
+  const std::size_t workerCount =
+      determineDepthWorkerCount(bucketItems.size());
+
+  if (workerCount <= 1 || bucketItems.empty()) {
+    processDepthRange(ctx, 0, bucketItems.size(), depthItems);
+  } else {
+    // Outputs are kept per chunk so the pre-sort order matches the serial
+    // path regardless of which worker claimed which chunk.
+    const std::size_t chunkItems =
+        resolveWorkerChunkItems(DEPTH_PARALLEL_CHUNK);
+    FrameVector<FrameVector<DepthItem>> chunkOutputs(
+        (bucketItems.size() + chunkItems - 1) / chunkItems,
+        g_frameArena.mainAllocator<FrameVector<DepthItem>>());
+    runChunkedWorkerJobs(
+        workerCount, bucketItems.size(), chunkItems,
+        [ctx, chunkItems, &chunkOutputs](std::size_t start,
+                                         std::size_t end,
+                                         std::size_t workerIndex) {
+          // Each chunk's output lives in the slab of the worker filling it.
+          FrameVector<DepthItem> chunkVector(
+              g_frameArena.workerAllocator<DepthItem>(workerIndex));
+          chunkVector.reserve(end - start);
+          processDepthRange(ctx, start, end, chunkVector);
+          chunkOutputs[start / chunkItems] = std::move(chunkVector);
+        });
+    depthItems.clear();
+    depthItems.reserve(bucketItems.size());
+    for (auto& chunkVector : chunkOutputs) {
+      for (DepthItem& item : chunkVector) {
+        depthItems.push_back(std::move(item));
+      }
+    }
+  }
+
+  FrameVector<DepthSortKey> sortKeys(
+      depthItems.size(), g_frameArena.mainAllocator<DepthSortKey>());
+  for (std::size_t i = 0; i < depthItems.size(); ++i) {
+    const DepthItem& depth = depthItems[i];
+    DepthSortKey& key = sortKeys[i];
+    key.depthKey = depth.depthKey;
+    if (depth.item) {
+      key.order = depth.item->entry->order;
+      key.spriteHandle = depth.item->spriteHandle;
+      key.imageHandle = depth.item->entry->imageHandle;
+    }
+  }
+  FrameVector<std::size_t> sortedOrder(
+      g_frameArena.mainAllocator<std::size_t>());
+  sortDepthKeysWithMode(sortKeys,
+                        g_temporalDepthSortEnabled ? DepthSortMode::Temporal
+                                                   : DepthSortMode::Auto,
+                        g_temporalDepthSorter,
+                        sortedOrder);
+
+  result.items.reserve(depthItems.size());
+  for (const std::size_t index : sortedOrder) {
+    result.items.push_back(std::move(depthItems[index]));
+  }
+  return result;
+}
+
+/**
+ * @brief Checks the inexpensive preconditions of prepareDrawSpriteImageKernel.
+ *
+ * Items rejected here are exactly those the prepare step rejects before any
+ * projection work; candidates can still fail later (surface clip projection).
+ */
+static inline bool isDrawSpriteImageCandidate(
+    const DepthItem& depth,
+    const ProjectionContext& projectionContext,
+    bool clipContextAvailable) {
+  if (depth.item == nullptr || depth.item->entry == nullptr ||
+      depth.item->resource == nullptr) {
+    return false;
+  }
+  const BucketItem& bucketItem = *depth.item;
+  const ResourceInfo& resource = *bucketItem.resource;
+  if (!bucketItem.projectedValid || resource.width <= 0.0 ||
+      resource.height <= 0.0) {
+    return false;
+  }
+  if (!bucketItem.hasEffectivePixelsPerMeter ||
+      !std::isfinite(bucketItem.effectivePixelsPerMeter) ||
+      bucketItem.effectivePixelsPerMeter <= 0.0) {
+    return false;
+  }
+  if (std::lround(bucketItem.entry->mode) == 0) {
+    return clipContextAvailable &&
+           projectionContext.mercatorMatrix != nullptr &&
+           depth.hasSurfaceData;
+  }
+  return true;
+}
+
+/**
+ * @brief Whether a draw candidate gets a surface stream record: surfaces
+ * carry shader inputs exactly when shader surface geometry is enabled.
+ */
+static inline bool hasSurfaceStreamRecord(const DepthItem& depth,
+                                          bool useShaderSurfaceGeometry) {
+  return useShaderSurfaceGeometry && depth.item != nullptr &&
+         depth.item->entry != nullptr &&
+         std::lround(depth.item->entry->mode) == 0;
+}
+
+/**
+ * @brief Prepares one draw candidate, specialized on its mode and the frame
+ * flags that shape its output.
+ *
+ * Only candidates (see isDrawSpriteImageCandidate) of the matching mode reach
+ * a kernel, so surfaces can rely on the clip context being available. Surface
+ * kernels without shader geometry skip the shader input preparation entirely.
+ *
+ * `TResult` is the result item scalar type. float32 kernels compute the
+ * billboard quad, vertices and hit test in float32; surface corners are
+ * projected from absolute coordinates in double and narrowed on store.
+ */
+template <typename TResult,
+          bool IsSurface,
+          bool UseShaderGeometry,
+          bool EnableSurfaceBias>
+static bool prepareDrawSpriteImageKernel(
+    const DepthItem& depth,
+    const ProjectionContext& projectionContext,
+    const FrameConstants& frame,
+    const ResultRelativeAnchor& relativeAnchor,
+    const FrameVector<BucketItem>& bucketItems,
+    const FrameVector<SurfaceGeometryCache>& surfaceGeometries,
+    const ResultItemTarget& target,
+    bool& outHasHitTest,
+    bool& outHasSurfaceInputs) {
+  static_assert(IsSurface || !EnableSurfaceBias);
+  outHasHitTest = false;
+  outHasSurfaceInputs = false;
+  if (depth.item == nullptr || depth.item->entry == nullptr ||
+      depth.item->resource == nullptr) {
+    return false;
+  }
+
+  const BucketItem& bucketItem = *depth.item;
+  const InputItemEntry& entry = *bucketItem.entry;
+  const ResourceInfo& resource = *bucketItem.resource;
+  const double atlasU0 = resource.atlasU0;
+  const double atlasV0 = resource.atlasV0;
+  const double atlasU1 = resource.atlasU1;
+  const double atlasV1 = resource.atlasV1;
+  const double atlasUSpan = atlasU1 - atlasU0;
+  const double atlasVSpan = atlasV1 - atlasV0;
+
+  if (!bucketItem.projectedValid || resource.width <= 0.0 ||
+      resource.height <= 0.0) {
+    return false;
+  }
+
+  if (!bucketItem.hasEffectivePixelsPerMeter ||
+      !std::isfinite(bucketItem.effectivePixelsPerMeter) ||
+      bucketItem.effectivePixelsPerMeter <= 0.0) {
+    return false;
+  }
+  const double effectivePixelsPerMeter = bucketItem.effectivePixelsPerMeter;
+
+  SpriteScreenPoint baseProjected = bucketItem.projected;
+  if (hasOriginLocation(entry)) {
+      const BucketItem* reference =
+          resolveOriginBucketItem(bucketItem, bucketItems);
+      if (reference && reference->resource) {
+        const bool useAnchor = toBool(entry.originUseResolvedAnchor);
+        SpriteScreenPoint originCenter = reference->projected;
+        tryGetPrecomputedCenter(*reference, useAnchor, originCenter);
+        baseProjected = originCenter;
+      }
+    }
+
+  SpriteLocation baseLngLat = bucketItem.spriteLocation;
+  if (hasOriginLocation(entry)) {
+    SpriteLocation unprojected{};
+    if (unprojectSpritePoint(projectionContext,
+                             SpritePoint{baseProjected.x, baseProjected.y},
+                             unprojected)) {
+      baseLngLat = unprojected;
+    }
+  }
+  baseLngLat.z = bucketItem.spriteLocation.z;
+
+  double cameraDistance = std::numeric_limits<double>::infinity();
+  if (std::isfinite(frame.cameraLng) && std::isfinite(frame.cameraLat)) {
+    SpriteLocation cameraLocation{frame.cameraLng,
+                                  frame.cameraLat,
+                                  frame.cameraAltitude};
+    cameraDistance =
+        calculateDistanceBetweenLocations(cameraLocation, baseLngLat);
+  }
+
+  const SpriteAnchor anchor = resolveAnchor(entry);
+  const SpriteImageOffset offset = resolveOffset(entry);
+  const double imageScale = resolveImageScale(entry);
+  const double totalRotateDeg = bucketItem.rotation.degrees;
+
+  const double screenScaleX =
+      IsSurface ? frame.identityScaleX : frame.screenToClipScaleX;
+  const double screenScaleY =
+      IsSurface ? frame.identityScaleY : frame.screenToClipScaleY;
+  const double screenOffsetX =
+      IsSurface ? frame.identityOffsetX : frame.screenToClipOffsetX;
+  const double screenOffsetY =
+      IsSurface ? frame.identityOffsetY : frame.screenToClipOffsetY;
+
+  double useShaderSurfaceValue = 0.0;
   double surfaceClipEnabledValue = 0.0;
   double useShaderBillboardValue = 0.0;
   double billboardCenterX = 0.0;
@@ -1649,11 +2883,13 @@ static bool prepareDrawSpriteImageInternal(
   double billboardAnchorY = 0.0;
   double billboardSin = 0.0;
   double billboardCos = 1.0;
+  // Shader billboards with an instance record get no vertices.
+  bool instanced = false;
 
-  std::array<double, RESULT_VERTEX_COMPONENT_LENGTH> vertexData{};
-  std::array<double, RESULT_HIT_TEST_COMPONENT_LENGTH> hitTestData{};
-  std::array<double, RESULT_SURFACE_BLOCK_LENGTH> surfaceBlock{};
-  surfaceBlock.fill(0.0);
+  ResultItemComponents<TResult> components;
+  auto& vertexData = components.vertex;
+  auto& hitTestData = components.hitTest;
+  auto& surfaceBlock = components.surface;
 
   std::size_t imageIndex = 0;
   if (!convertToSizeT(entry.bucketIndex, imageIndex)) {
@@ -1661,11 +2897,7 @@ static bool prepareDrawSpriteImageInternal(
   }
   const std::size_t resourceIndex = bucketItem.resource->handle;
 
-  if (isSurface) {
-    if (!clipContextAvailable || projectionContext.mercatorMatrix == nullptr) {
-      return false;
-    }
-
+  if constexpr (IsSurface) {
     SurfaceCenterParams params{};
     params.baseLngLat = baseLngLat;
     params.imageWidth = resource.width;
@@ -1689,8 +2921,22 @@ static bool prepareDrawSpriteImageInternal(
     params.pixelRatio = frame.pixelRatio;
     params.resolveAnchorless = true;
 
-    const SurfaceCenterResult surfaceCenter =
-        calculateSurfaceCenterPosition(params);
+    // Items at their own location reuse the placement and clip corners
+    // cached during center precompute and depth collection.
+    const SurfaceGeometryCache& geometryCache =
+        surfaceGeometries[bucketItem.surfaceGeometryIndex];
+    const bool useCachedPlacement = !hasOriginLocation(entry) &&
+                                    geometryCache.hasPlacement &&
+                                    geometryCache.hasClipCorners;
+    SurfaceCenterResult surfaceCenter;
+    if (useCachedPlacement) {
+      surfaceCenter.center = geometryCache.center;
+      surfaceCenter.displacedLngLat = geometryCache.displacedLngLat;
+      surfaceCenter.totalDisplacement =
+          geometryCache.geometry.totalDisplacement;
+    } else {
+      surfaceCenter = calculateSurfaceCenterPosition(params);
+    }
     if (!surfaceCenter.center.has_value()) {
       return false;
     }
@@ -1699,52 +2945,38 @@ static bool prepareDrawSpriteImageInternal(
       return false;
     }
     const SurfaceWorldDimensions& cachedWorldDims =
-        depth.surfaceWorldDimensions;
-    const SurfaceCorner offsetMeters = depth.surfaceOffsetMeters;
-    const auto& cornerDisplacements = depth.surfaceCornerDisplacements;
-
-    const double orderIndex =
-        std::fmin(entry.order, frame.orderMax - 1.0);
-    const double biasIndex = entry.subLayer * frame.orderBucket + orderIndex;
-    const double depthBiasNdc =
-        enableSurfaceBias ? (-(biasIndex * frame.epsNdc)) : 0.0;
-
-    const SpriteLocation displacedCenter = surfaceCenter.displacedLngLat;
-
-    SurfaceShaderInputsData surfaceInputs = prepareSurfaceShaderInputs(
-        projectionContext,
-        baseLngLat,
-        cachedWorldDims.width,
-        cachedWorldDims.height,
-        &anchor,
-        bucketItem.rotation,
-        offsetMeters,
-        displacedCenter,
-        depthBiasNdc,
-        cachedWorldDims.scaleAdjustment,
-        surfaceCenter.totalDisplacement);
+        geometryCache.geometry.worldDimensions;
+    const SurfaceCorner offsetMeters = geometryCache.geometry.offsetMeters;
+    const auto& cornerDisplacements = geometryCache.cornerDisplacements;
+
+    double depthBiasNdc = 0.0;
+    if constexpr (EnableSurfaceBias) {
+      const double orderIndex =
+          std::fmin(entry.order, frame.orderMax - 1.0);
+      const double biasIndex = entry.subLayer * frame.orderBucket + orderIndex;
+      depthBiasNdc = -(biasIndex * frame.epsNdc);
+    }
 
-    const bool useShaderSurface = useShaderSurfaceGeometry && clipContextAvailable;
+    constexpr bool useShaderSurface = UseShaderGeometry;
     useShaderSurfaceValue = useShaderSurface ? 1.0 : 0.0;
 
     std::array<std::array<double, 4>, 4> clipCornerPositions{};
     std::array<bool, 4> clipCornerValid{false, false, false, false};
 
-    std::array<double, 4> clipCenterPosition{};
-    bool clipCenterValid = projectLngLatToClip(projectionContext,
-                                               displacedCenter,
-                                               clipCenterPosition);
-
-    double* vertexWrite = vertexData.data();
+    TResult* vertexWrite = vertexData.data();
     for (int idx : TRIANGLE_INDICES) {
       const std::size_t cornerIndex = static_cast<std::size_t>(idx);
-      const SurfaceCorner& displacement = cornerDisplacements[cornerIndex];
-      SpriteLocation displacedPoint;
-      applySurfaceDisplacement(baseLngLat, displacement, displacedPoint);
-
       std::array<double, 4> clipPosition{};
-      if (!projectLngLatToClip(projectionContext, displacedPoint, clipPosition)) {
-        return false;
+      if (useCachedPlacement) {
+        clipPosition = geometryCache.clipCorners[cornerIndex];
+      } else {
+        const SurfaceCorner& displacement = cornerDisplacements[cornerIndex];
+        SpriteLocation displacedPoint;
+        applySurfaceDisplacement(baseLngLat, displacement, displacedPoint);
+        if (!projectLngLatToClip(
+                projectionContext, displacedPoint, clipPosition)) {
+          return false;
+        }
       }
 
       double clipX = clipPosition[0];
@@ -1773,7 +3005,7 @@ static bool prepareDrawSpriteImageInternal(
                     screenCorner.y);
       }
 
-      if (useShaderSurface) {
+      if constexpr (useShaderSurface) {
         const auto& baseCorner = SURFACE_BASE_CORNERS[cornerIndex];
         storeVec4(vertexWrite, baseCorner[0], baseCorner[1], 0.0, 1.0);
       } else {
@@ -1786,38 +3018,55 @@ static bool prepareDrawSpriteImageInternal(
     }
 
     bool clipUniformEnabled = false;
-    if (useShaderSurface && clipCenterValid &&
-        std::all_of(clipCornerValid.begin(), clipCornerValid.end(),
-                    [](bool v) { return v; })) {
-      const auto& leftTop = clipCornerPositions[0];
-      const auto& rightTop = clipCornerPositions[1];
-      const auto& leftBottom = clipCornerPositions[2];
-      const auto& rightBottom = clipCornerPositions[3];
-
-      std::array<double, 4> clipBasisEast = {
-          (rightTop[0] - leftTop[0]) * 0.5,
-          (rightTop[1] - leftTop[1]) * 0.5,
-          (rightTop[2] - leftTop[2]) * 0.5,
-          (rightTop[3] - leftTop[3]) * 0.5};
-      std::array<double, 4> clipBasisNorth = {
-          (leftTop[0] - leftBottom[0]) * 0.5,
-          (leftTop[1] - leftBottom[1]) * 0.5,
-          (leftTop[2] - leftBottom[2]) * 0.5,
-          (leftTop[3] - leftBottom[3]) * 0.5};
-
-      surfaceInputs.clipCenter = clipCenterPosition;
-      surfaceInputs.clipBasisEast = clipBasisEast;
-      surfaceInputs.clipBasisNorth = clipBasisNorth;
-      surfaceInputs.clipCornerCount = clipCornerPositions.size();
-      for (std::size_t i = 0; i < clipCornerPositions.size(); ++i) {
-        surfaceInputs.clipCorners[i] = clipCornerPositions[i];
+    if constexpr (useShaderSurface) {
+      const SpriteLocation displacedCenter = surfaceCenter.displacedLngLat;
+
+      SurfaceShaderInputsData surfaceInputs = prepareSurfaceShaderInputs(
+          projectionContext,
+          baseLngLat,
+          cachedWorldDims.width,
+          cachedWorldDims.height,
+          &anchor,
+          bucketItem.rotation,
+          offsetMeters,
+          displacedCenter,
+          depthBiasNdc,
+          cachedWorldDims.scaleAdjustment,
+          surfaceCenter.totalDisplacement);
+
+      std::array<double, 4> clipCenterPosition{};
+      const bool clipCenterValid = projectLngLatToClip(projectionContext,
+                                                       displacedCenter,
+                                                       clipCenterPosition);
+      if (clipCenterValid &&
+          std::all_of(clipCornerValid.begin(), clipCornerValid.end(),
+                      [](bool v) { return v; })) {
+        const auto& leftTop = clipCornerPositions[0];
+        const auto& rightTop = clipCornerPositions[1];
+        const auto& leftBottom = clipCornerPositions[2];
+        const auto& rightBottom = clipCornerPositions[3];
+
+        std::array<double, 4> clipBasisEast = {
+            (rightTop[0] - leftTop[0]) * 0.5,
+            (rightTop[1] - leftTop[1]) * 0.5,
+            (rightTop[2] - leftTop[2]) * 0.5,
+            (rightTop[3] - leftTop[3]) * 0.5};
+        std::array<double, 4> clipBasisNorth = {
+            (leftTop[0] - leftBottom[0]) * 0.5,
+            (leftTop[1] - leftBottom[1]) * 0.5,
+            (leftTop[2] - leftBottom[2]) * 0.5,
+            (leftTop[3] - leftBottom[3]) * 0.5};
+
+        surfaceInputs.clipCenter = clipCenterPosition;
+        surfaceInputs.clipBasisEast = clipBasisEast;
+        surfaceInputs.clipBasisNorth = clipBasisNorth;
+        surfaceInputs.clipCornerCount = clipCornerPositions.size();
+        for (std::size_t i = 0; i < clipCornerPositions.size(); ++i) {
+          surfaceInputs.clipCorners[i] = clipCornerPositions[i];
+        }
+        clipUniformEnabled = true;
       }
-      clipUniformEnabled = true;
-    }
 
-    surfaceClipEnabledValue = clipUniformEnabled ? 1.0 : 0.0;
-
-    if (useShaderSurface) {
       double* surfaceWrite = surfaceBlock.data();
       storeVec2(surfaceWrite,
                 surfaceInputs.mercatorCenter.x,
@@ -1864,6 +3113,8 @@ static bool prepareDrawSpriteImageInternal(
       outHasSurfaceInputs = true;
     }
 
+    surfaceClipEnabledValue = clipUniformEnabled ? 1.0 : 0.0;
+
     useShaderBillboardValue = 0.0;
     outHasHitTest = true;
   } else {
@@ -1881,15 +3132,10 @@ static bool prepareDrawSpriteImageInternal(
         &anchor,
         &offset);
 
-    std::array<QuadCorner, 4> resolvedCorners =
-        calculateBillboardCornerScreenPositions(placement.center,
-                                                placement.halfWidth,
-                                                placement.halfHeight,
-                                                &anchor,
-                                                bucketItem.rotation);
-
-    const bool useShaderBillboard = useShaderBillboardGeometry;
+    constexpr bool useShaderBillboard = UseShaderGeometry;
     useShaderBillboardValue = useShaderBillboard ? 1.0 : 0.0;
+    // Instanced billboards are drawn from their instance record alone.
+    instanced = useShaderBillboard && target.instanceOutput != nullptr;
     billboardCenterX = placement.center.x;
     billboardCenterY = placement.center.y;
     billboardHalfWidth = placement.halfWidth;
@@ -1899,63 +3145,199 @@ static bool prepareDrawSpriteImageInternal(
     billboardSin = bucketItem.rotation.sinNegativeRad;
     billboardCos = bucketItem.rotation.cosNegativeRad;
 
-    double* vertexWrite = vertexData.data();
-    for (int idx : TRIANGLE_INDICES) {
-      if (useShaderBillboard) {
-        const auto& baseCorner = BILLBOARD_BASE_CORNERS[idx];
-        storeVec4(vertexWrite, baseCorner[0], baseCorner[1], 0.0, 1.0);
-      } else {
-        storeVec4(vertexWrite,
-                  resolvedCorners[idx].x,
-                  resolvedCorners[idx].y,
-                  0.0,
-                  1.0);
+    if constexpr (std::is_same<TResult, float>::value) {
+      // The quad is screen-space local to its center, so float32 items
+      // build it and its vertices in float32 directly.
+      const BillboardQuadF32 quad =
+          calculateBillboardCornersF32(placement.center,
+                                       placement.halfWidth,
+                                       placement.halfHeight,
+                                       &anchor,
+                                       bucketItem.rotation,
+                                       atlasU0,
+                                       atlasV0,
+                                       atlasUSpan,
+                                       atlasVSpan);
+      if (!instanced) {
+        float* vertexWrite = vertexData.data();
+        for (int idx : TRIANGLE_INDICES) {
+          if constexpr (useShaderBillboard) {
+            storeVec4(vertexWrite,
+                      static_cast<float>(BILLBOARD_BASE_CORNERS[idx][0]),
+                      static_cast<float>(BILLBOARD_BASE_CORNERS[idx][1]),
+                      0.0f,
+                      1.0f);
+          } else {
+            storeVec4(vertexWrite, quad.x[idx], quad.y[idx], 0.0f, 1.0f);
+          }
+          storeVec2(vertexWrite, quad.u[idx], quad.v[idx]);
+        }
+      }
+      storeBillboardHitTestF32(hitTestData.data(), quad);
+    } else {
+      std::array<QuadCorner, 4> resolvedCorners =
+          calculateBillboardCornerScreenPositions(placement.center,
+                                                  placement.halfWidth,
+                                                  placement.halfHeight,
+                                                  &anchor,
+                                                  bucketItem.rotation);
+
+      if (!instanced) {
+        double* vertexWrite = vertexData.data();
+        for (int idx : TRIANGLE_INDICES) {
+          if constexpr (useShaderBillboard) {
+            const auto& baseCorner = BILLBOARD_BASE_CORNERS[idx];
+            storeVec4(vertexWrite, baseCorner[0], baseCorner[1], 0.0, 1.0);
+          } else {
+            storeVec4(vertexWrite,
+                      resolvedCorners[idx].x,
+                      resolvedCorners[idx].y,
+                      0.0,
+                      1.0);
+          }
+          const double resolvedU = atlasU0 + resolvedCorners[idx].u * atlasUSpan;
+          const double resolvedV = atlasV0 + resolvedCorners[idx].v * atlasVSpan;
+          storeVec2(vertexWrite, resolvedU, resolvedV);
+        }
       }
-      const double resolvedU = atlasU0 + resolvedCorners[idx].u * atlasUSpan;
-      const double resolvedV = atlasV0 + resolvedCorners[idx].v * atlasVSpan;
-      storeVec2(vertexWrite, resolvedU, resolvedV);
-    }
 
-    double* hitTestWrite = hitTestData.data();
-    for (const auto& corner : resolvedCorners) {
-      storeVec2(hitTestWrite, corner.x, corner.y);
+      double* hitTestWrite = hitTestData.data();
+      for (const auto& corner : resolvedCorners) {
+        storeVec2(hitTestWrite, corner.x, corner.y);
+      }
     }
 
     outHasHitTest = true;
   }
 
+  double* common = components.common.data();
   std::size_t cursor = 0;
-  itemBase[cursor++] = entry.spriteHandle;
-  itemBase[cursor++] = static_cast<double>(imageIndex);
-  itemBase[cursor++] = static_cast<double>(resourceIndex);
-  itemBase[cursor++] = entry.opacity;
-  itemBase[cursor++] = screenScaleX;
-  itemBase[cursor++] = screenScaleY;
-  itemBase[cursor++] = screenOffsetX;
-  itemBase[cursor++] = screenOffsetY;
-  itemBase[cursor++] = useShaderSurfaceValue;
-  itemBase[cursor++] = surfaceClipEnabledValue;
-  itemBase[cursor++] = useShaderBillboardValue;
-  itemBase[cursor++] = billboardCenterX;
-  itemBase[cursor++] = billboardCenterY;
-  itemBase[cursor++] = billboardHalfWidth;
-  itemBase[cursor++] = billboardHalfHeight;
-  itemBase[cursor++] = billboardAnchorX;
-  itemBase[cursor++] = billboardAnchorY;
-  itemBase[cursor++] = billboardSin;
-  itemBase[cursor++] = billboardCos;
-  itemBase[cursor++] = cameraDistance;
-
-  double* vertexPtr = itemBase + RESULT_COMMON_ITEM_LENGTH;
-  std::copy(vertexData.begin(), vertexData.end(), vertexPtr);
-  double* hitTestPtr = vertexPtr + RESULT_VERTEX_COMPONENT_LENGTH;
-  std::copy(hitTestData.begin(), hitTestData.end(), hitTestPtr);
-  double* surfacePtr = hitTestPtr + RESULT_HIT_TEST_COMPONENT_LENGTH;
-  std::copy(surfaceBlock.begin(), surfaceBlock.end(), surfacePtr);
+  common[cursor++] = entry.spriteHandle;
+  common[cursor++] = static_cast<double>(imageIndex);
+  common[cursor++] = static_cast<double>(resourceIndex);
+  common[cursor++] = entry.opacity;
+  common[cursor++] = screenScaleX;
+  common[cursor++] = screenScaleY;
+  common[cursor++] = screenOffsetX;
+  common[cursor++] = screenOffsetY;
+  common[cursor++] = useShaderSurfaceValue;
+  common[cursor++] = surfaceClipEnabledValue;
+  common[cursor++] = useShaderBillboardValue;
+  common[cursor++] = billboardCenterX;
+  common[cursor++] = billboardCenterY;
+  common[cursor++] = billboardHalfWidth;
+  common[cursor++] = billboardHalfHeight;
+  common[cursor++] = billboardAnchorX;
+  common[cursor++] = billboardAnchorY;
+  common[cursor++] = billboardSin;
+  common[cursor++] = billboardCos;
+  common[cursor++] = cameraDistance;
+
+  if (target.vertexOutput != nullptr && !instanced) {
+    storeFloat32Components(
+        target.vertexOutput, vertexData.data(), RESULT_VERTEX_COMPONENT_LENGTH);
+  }
+  if (target.instanceOutput != nullptr) {
+    alignas(16) std::array<double, RESULT_INSTANCE_RECORD_LENGTH> record{};
+    record[RESULT_INSTANCE_CENTER_OFFSET] = billboardCenterX;
+    record[RESULT_INSTANCE_CENTER_OFFSET + 1] = billboardCenterY;
+    record[RESULT_INSTANCE_HALF_SIZE_OFFSET] = billboardHalfWidth;
+    record[RESULT_INSTANCE_HALF_SIZE_OFFSET + 1] = billboardHalfHeight;
+    record[RESULT_INSTANCE_ANCHOR_OFFSET] = billboardAnchorX;
+    record[RESULT_INSTANCE_ANCHOR_OFFSET + 1] = billboardAnchorY;
+    record[RESULT_INSTANCE_SIN_COS_OFFSET] = billboardSin;
+    record[RESULT_INSTANCE_SIN_COS_OFFSET + 1] = billboardCos;
+    record[RESULT_INSTANCE_UV_RECT_OFFSET] = atlasU0;
+    record[RESULT_INSTANCE_UV_RECT_OFFSET + 1] = atlasV0;
+    record[RESULT_INSTANCE_UV_RECT_OFFSET + 2] = atlasU1;
+    record[RESULT_INSTANCE_UV_RECT_OFFSET + 3] = atlasV1;
+    record[RESULT_INSTANCE_OPACITY_OFFSET] = entry.opacity;
+    record[RESULT_INSTANCE_ATLAS_PAGE_OFFSET] = resource.atlasPageIndex;
+    record[RESULT_INSTANCE_BILLBOARD_OFFSET] = useShaderBillboardValue;
+    storeFloat32Components(
+        target.instanceOutput, record.data(), RESULT_INSTANCE_RECORD_LENGTH);
+  }
+  // Vertices written to the output region stay out of the item.
+  const bool includeVertex = target.vertexOutput == nullptr;
+  const bool includeSurface = !target.surfaceStream;
+  if constexpr (std::is_same<TResult, float>::value) {
+    if (outHasSurfaceInputs) {
+      rebaseSurfaceBlock(surfaceBlock, relativeAnchor);
+    }
+  }
+  writeResultItem<TResult>(
+      target.item, components, includeVertex, includeSurface);
+  if (target.surfaceRecord != nullptr) {
+    writeSurfaceRecord<TResult>(
+        target.surfaceRecord, target.itemIndex, surfaceBlock);
+  }
 
   return true;
 }
 
+using PrepareDrawSpriteImageKernel = bool (*)(const DepthItem&,
+                                              const ProjectionContext&,
+                                              const FrameConstants&,
+                                              const ResultRelativeAnchor&,
+                                              const FrameVector<BucketItem>&,
+                                              const FrameVector<SurfaceGeometryCache>&,
+                                              const ResultItemTarget&,
+                                              bool&,
+                                              bool&);
+
+/**
+ * @brief Kernel pair for one frame: the flags are resolved once, leaving only
+ * the surface/billboard choice per item.
+ */
+struct PrepareDrawSpriteImageKernels {
+  PrepareDrawSpriteImageKernel surface;
+  PrepareDrawSpriteImageKernel billboard;
+
+  PrepareDrawSpriteImageKernel select(const DepthItem& depth) const {
+    return std::lround(depth.item->entry->mode) == 0 ? surface : billboard;
+  }
+};
+
+template <typename TResult>
+static inline PrepareDrawSpriteImageKernels resolvePrepareDrawSpriteImageKernels(
+    bool useShaderSurfaceGeometry,
+    bool useShaderBillboardGeometry,
+    bool enableSurfaceBias) {
+  PrepareDrawSpriteImageKernels kernels{};
+  if (useShaderSurfaceGeometry) {
+    kernels.surface =
+        enableSurfaceBias
+            ? prepareDrawSpriteImageKernel<TResult, true, true, true>
+            : prepareDrawSpriteImageKernel<TResult, true, true, false>;
+  } else {
+    kernels.surface =
+        enableSurfaceBias
+            ? prepareDrawSpriteImageKernel<TResult, true, false, true>
+            : prepareDrawSpriteImageKernel<TResult, true, false, false>;
+  }
+  kernels.billboard =
+      useShaderBillboardGeometry
+          ? prepareDrawSpriteImageKernel<TResult, false, true, false>
+          : prepareDrawSpriteImageKernel<TResult, false, false, false>;
+  return kernels;
+}
+
+static inline PrepareDrawSpriteImageKernels resolvePrepareDrawSpriteImageKernels(
+    bool float32Result,
+    bool useShaderSurfaceGeometry,
+    bool useShaderBillboardGeometry,
+    bool enableSurfaceBias) {
+  return float32Result
+             ? resolvePrepareDrawSpriteImageKernels<float>(
+                   useShaderSurfaceGeometry,
+                   useShaderBillboardGeometry,
+                   enableSurfaceBias)
+             : resolvePrepareDrawSpriteImageKernels<double>(
+                   useShaderSurfaceGeometry,
+                   useShaderBillboardGeometry,
+                   enableSurfaceBias);
+}
+
 static inline SurfaceWorldDimensions calculateSurfaceWorldDimensions(
     double imageWidth,
     double imageHeight,
@@ -2116,34 +3498,12 @@ computeSurfaceCornerShaderModel(const SpriteLocation& baseLngLat,
   return corners;
 }
 
-static inline SurfaceCenterResult calculateSurfaceCenterPosition(
+/**
+ * @brief Computes the world size and the anchor/offset displacement of a
+ * surface, none of which depend on its base location.
+ */
+static inline SurfaceGeometry calculateSurfaceGeometry(
     const SurfaceCenterParams& params) {
-  const bool clipProjectionAvailable =
-      params.enableClipProjection && params.projection &&
-      params.drawingBufferWidth > 0.0 && params.drawingBufferHeight > 0.0 &&
-      params.pixelRatio != 0.0 && std::isfinite(params.pixelRatio);
-  const bool screenProjectionAvailable =
-      params.enableScreenProjection && params.projection;
-
-  auto projectPoint = [&](const SpriteLocation& lngLat,
-                          SpriteScreenPoint& out) -> bool {
-    if (clipProjectionAvailable) {
-      std::array<double, 4> clip{};
-      if (projectLngLatToClip(*params.projection, lngLat, clip) &&
-          clipToScreen(clip,
-                       params.drawingBufferWidth,
-                       params.drawingBufferHeight,
-                       params.pixelRatio,
-                       out)) {
-        return true;
-      }
-    }
-    if (screenProjectionAvailable) {
-      return projectSpritePoint(*params.projection, lngLat, out);
-    }
-    return false;
-  };
-
   const SurfaceWorldDimensions worldDims = calculateSurfaceWorldDimensions(
       params.imageWidth,
       params.imageHeight,
@@ -2169,9 +3529,47 @@ static inline SurfaceCenterResult calculateSurfaceCenterPosition(
       params.zoomScaleFactor,
       worldDims.scaleAdjustment);
 
-  SurfaceCorner totalDisplacement{
-      anchorShiftMeters.east + offsetMeters.east,
-      anchorShiftMeters.north + offsetMeters.north};
+  SurfaceGeometry geometry;
+  geometry.worldDimensions = worldDims;
+  geometry.offsetMeters = offsetMeters;
+  geometry.totalDisplacement = {anchorShiftMeters.east + offsetMeters.east,
+                                anchorShiftMeters.north + offsetMeters.north};
+  return geometry;
+}
+
+/**
+ * @brief Places a surface at its base location and projects its centers.
+ */
+static inline SurfaceCenterResult placeSurfaceCenter(
+    const SurfaceCenterParams& params,
+    const SurfaceGeometry& geometry) {
+  const bool clipProjectionAvailable =
+      params.enableClipProjection && params.projection &&
+      params.drawingBufferWidth > 0.0 && params.drawingBufferHeight > 0.0 &&
+      params.pixelRatio != 0.0 && std::isfinite(params.pixelRatio);
+  const bool screenProjectionAvailable =
+      params.enableScreenProjection && params.projection;
+
+  auto projectPoint = [&](const SpriteLocation& lngLat,
+                          SpriteScreenPoint& out) -> bool {
+    if (clipProjectionAvailable) {
+      std::array<double, 4> clip{};
+      if (projectLngLatToClip(*params.projection, lngLat, clip) &&
+          clipToScreen(clip,
+                       params.drawingBufferWidth,
+                       params.drawingBufferHeight,
+                       params.pixelRatio,
+                       out)) {
+        return true;
+      }
+    }
+    if (screenProjectionAvailable) {
+      return projectSpritePoint(*params.projection, lngLat, out);
+    }
+    return false;
+  };
+
+  const SurfaceCorner& totalDisplacement = geometry.totalDisplacement;
 
   SpriteLocation displaced = params.baseLngLat;
   applySurfaceDisplacement(params.baseLngLat, totalDisplacement, displaced);
@@ -2184,12 +3582,12 @@ static inline SurfaceCenterResult calculateSurfaceCenterPosition(
 
   SurfaceCenterResult result;
   result.center = center;
-  result.worldDimensions = worldDims;
+  result.worldDimensions = geometry.worldDimensions;
   result.totalDisplacement = totalDisplacement;
   result.displacedLngLat = displaced;
 
   if (params.resolveAnchorless) {
-    SurfaceCorner anchorlessDisplacement = offsetMeters;
+    SurfaceCorner anchorlessDisplacement = geometry.offsetMeters;
     SpriteLocation anchorlessLngLat = params.baseLngLat;
     applySurfaceDisplacement(
         params.baseLngLat, anchorlessDisplacement, anchorlessLngLat);
@@ -2206,6 +3604,31 @@ static inline SurfaceCenterResult calculateSurfaceCenterPosition(
   return result;
 }
 
+static inline SurfaceCenterResult calculateSurfaceCenterPosition(
+    const SurfaceCenterParams& params) {
+  return placeSurfaceCenter(params, calculateSurfaceGeometry(params));
+}
+
+/**
+ * @brief Fills the base-independent part of a surface geometry cache once.
+ */
+static inline const SurfaceGeometry& ensureSurfaceGeometry(
+    SurfaceGeometryCache& cache,
+    const SurfaceCenterParams& params) {
+  if (!cache.hasGeometry) {
+    cache.geometry = calculateSurfaceGeometry(params);
+    cache.cornerDisplacements = calculateSurfaceCornerDisplacements(
+        cache.geometry.worldDimensions.width,
+        cache.geometry.worldDimensions.height,
+        params.anchor,
+        params.sinNegativeRotation,
+        params.cosNegativeRotation,
+        cache.geometry.offsetMeters);
+    cache.hasGeometry = true;
+  }
+  return cache.geometry;
+}
+
 static inline BillboardCenterResult calculateBillboardCenterPosition(
     const SpriteScreenPoint& base,
     double imageWidth,
@@ -2325,174 +3748,1192 @@ static inline std::array<QuadCorner, 4> calculateBillboardCornerScreenPositions(
   }
 #endif
 
-  return corners;
+  return corners;
+}
+
+static inline BillboardQuadF32 calculateBillboardCornersF32(
+    const SpriteScreenPoint& center,
+    double halfWidth,
+    double halfHeight,
+    const SpriteAnchor* anchor,
+    const RotationCache& rotation,
+    double atlasU0,
+    double atlasV0,
+    double atlasUSpan,
+    double atlasVSpan) {
+  const float u0 = static_cast<float>(atlasU0);
+  const float v0 = static_cast<float>(atlasV0);
+  const float uSpan = static_cast<float>(atlasUSpan);
+  const float vSpan = static_cast<float>(atlasVSpan);
+  const float centerX = static_cast<float>(center.x);
+  const float centerY = static_cast<float>(center.y);
+  BillboardQuadF32 quad;
+  if (halfWidth <= 0.0 || halfHeight <= 0.0) {
+    for (std::size_t i = 0; i < 4; ++i) {
+      quad.x[i] = centerX;
+      quad.y[i] = centerY;
+      quad.u[i] = u0 + static_cast<float>(UV_CORNERS[i][0]) * uSpan;
+      quad.v[i] = v0 + static_cast<float>(UV_CORNERS[i][1]) * vSpan;
+    }
+    return quad;
+  }
+
+  const float width = static_cast<float>(halfWidth);
+  const float height = static_cast<float>(halfHeight);
+  const float anchorOffsetX =
+      static_cast<float>((anchor ? anchor->x : 0.0) * halfWidth);
+  const float anchorOffsetY =
+      static_cast<float>((anchor ? anchor->y : 0.0) * halfHeight);
+  const float cosR = static_cast<float>(rotation.cosNegativeRad);
+  const float sinR = static_cast<float>(rotation.sinNegativeRad);
+
+#ifdef SIMD_ENABLED
+  const v128_t cornerX = wasm_f32x4_sub(
+      wasm_f32x4_mul(wasm_v128_load(BILLBOARD_BASE_X_F32),
+                     wasm_f32x4_splat(width)),
+      wasm_f32x4_splat(anchorOffsetX));
+  const v128_t cornerY = wasm_f32x4_sub(
+      wasm_f32x4_mul(wasm_v128_load(BILLBOARD_BASE_Y_F32),
+                     wasm_f32x4_splat(height)),
+      wasm_f32x4_splat(anchorOffsetY));
+  const v128_t cosVec = wasm_f32x4_splat(cosR);
+  const v128_t sinVec = wasm_f32x4_splat(sinR);
+  const v128_t rotatedX = wasm_f32x4_sub(wasm_f32x4_mul(cornerX, cosVec),
+                                         wasm_f32x4_mul(cornerY, sinVec));
+  const v128_t rotatedY = wasm_f32x4_add(wasm_f32x4_mul(cornerX, sinVec),
+                                         wasm_f32x4_mul(cornerY, cosVec));
+  wasm_v128_store(quad.x.data(),
+                  wasm_f32x4_add(wasm_f32x4_splat(centerX), rotatedX));
+  wasm_v128_store(quad.y.data(),
+                  wasm_f32x4_sub(wasm_f32x4_splat(centerY), rotatedY));
+  wasm_v128_store(quad.u.data(),
+                  wasm_f32x4_add(wasm_f32x4_splat(u0),
+                                 wasm_f32x4_mul(wasm_v128_load(UV_CORNERS_U_F32),
+                                                wasm_f32x4_splat(uSpan))));
+  wasm_v128_store(quad.v.data(),
+                  wasm_f32x4_add(wasm_f32x4_splat(v0),
+                                 wasm_f32x4_mul(wasm_v128_load(UV_CORNERS_V_F32),
+                                                wasm_f32x4_splat(vSpan))));
+#else
+  for (std::size_t i = 0; i < 4; ++i) {
+    const float cornerX =
+        static_cast<float>(BILLBOARD_BASE_CORNERS[i][0]) * width -
+        anchorOffsetX;
+    const float cornerY =
+        static_cast<float>(BILLBOARD_BASE_CORNERS[i][1]) * height -
+        anchorOffsetY;
+    quad.x[i] = centerX + (cornerX * cosR - cornerY * sinR);
+    quad.y[i] = centerY - (cornerX * sinR + cornerY * cosR);
+    quad.u[i] = u0 + static_cast<float>(UV_CORNERS[i][0]) * uSpan;
+    quad.v[i] = v0 + static_cast<float>(UV_CORNERS[i][1]) * vSpan;
+  }
+#endif
+
+  return quad;
+}
+
+static inline bool __projectLngLatToClipSpace(double lng,
+                                              double lat,
+                                              double altitude,
+                                              const double* matrix,
+                                              double* out) {
+  double mercator[3] = {0.0, 0.0, 0.0};
+  if (!__fromLngLat(lng, lat, altitude, mercator)) {
+    return false;
+  }
+
+  double clipX = 0.0;
+  double clipY = 0.0;
+  double clipZ = 0.0;
+  double clipW = 0.0;
+  multiplyMatrixAndVector(
+      matrix, mercator[0], mercator[1], mercator[2], 1.0, clipX, clipY, clipZ,
+      clipW);
+
+  if (!std::isfinite(clipX) || !std::isfinite(clipY) ||
+      !std::isfinite(clipZ) || !std::isfinite(clipW) || clipW <= MIN_CLIP_W) {
+    return false;
+  }
+
+  out[0] = clipX;
+  out[1] = clipY;
+  out[2] = clipZ;
+  out[3] = clipW;
+
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+static inline bool __calculateBillboardDepthKey(double centerX,
+                                                double centerY,
+                                                double worldSize,
+                                                const double* inverseMatrix,
+                                                const double* mercatorMatrix,
+                                                double* out) {
+  if (!std::isfinite(worldSize) || worldSize <= 0.0) {
+    return false;
+  }
+
+  double lngLat[2] = {0.0, 0.0};
+  if (!__unproject(centerX, centerY, worldSize, inverseMatrix, lngLat)) {
+    return false;
+  }
+
+  double mercator[3] = {0.0, 0.0, 0.0};
+  if (!__fromLngLat(lngLat[0], lngLat[1], 0.0, mercator)) {
+    return false;
+  }
+
+  double clipX = 0.0;
+  double clipY = 0.0;
+  double clipZ = 0.0;
+  double clipW = 0.0;
+  multiplyMatrixAndVector(mercatorMatrix,
+                          mercator[0],
+                          mercator[1],
+                          mercator[2],
+                          1.0,
+                          clipX,
+                          clipY,
+                          clipZ,
+                          clipW);
+
+  if (!std::isfinite(clipX) || !std::isfinite(clipY) ||
+      !std::isfinite(clipZ) || !std::isfinite(clipW)) {
+    return false;
+  }
+
+  const double ndcZ = clipW != 0.0 ? (clipZ / clipW) : clipZ;
+  if (!std::isfinite(ndcZ)) {
+    return false;
+  }
+
+  *out = -ndcZ;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+static inline bool __calculateSurfaceDepthKey(double baseLng,
+                                              double baseLat,
+                                              double baseAltitude,
+                                              const double* displacements,
+                                              int displacementCount,
+                                              const int32_t* indices,
+                                              int indexCount,
+                                              const double* mercatorMatrix,
+                                              bool applyBias,
+                                              double biasNdc,
+                                              double minClipZEpsilon,
+                                              double* out) {
+  if (displacementCount <= 0 || indexCount <= 0) {
+    return false;
+  }
+
+  double clip[4] = {0.0, 0.0, 0.0, 0.0};
+  double maxDepth = -std::numeric_limits<double>::infinity();
+
+  for (int index = 0; index < indexCount; index++) {
+    const int32_t displacementIndex = indices[index];
+    if (displacementIndex < 0 || displacementIndex >= displacementCount) {
+      continue;
+    }
+
+    const double east = displacements[displacementIndex * 2 + 0];
+    const double north = displacements[displacementIndex * 2 + 1];
+
+    double displacedLng = 0.0;
+    double displacedLat = 0.0;
+    double displacedAltitude = 0.0;
+    applySurfaceDisplacement(baseLng,
+                             baseLat,
+                             baseAltitude,
+                             east,
+                             north,
+                             displacedLng,
+                             displacedLat,
+                             displacedAltitude);
+
+    if (!__projectLngLatToClipSpace(displacedLng,
+                                    displacedLat,
+                                    displacedAltitude,
+                                    mercatorMatrix,
+                                    clip)) {
+      return false;
+    }
+
+    double clipZ = clip[2];
+    const double clipW = clip[3];
+
+    if (!std::isfinite(clipZ) || !std::isfinite(clipW)) {
+      return false;
+    }
+
+    if (applyBias) {
+      const double biasedClipZ = clipZ + biasNdc * clipW;
+      const double minClipZ = -clipW + minClipZEpsilon;
+      clipZ = biasedClipZ < minClipZ ? minClipZ : biasedClipZ;
+    }
+
+    const double ndcZ = clipW != 0.0 ? (clipZ / clipW) : clipZ;
+    if (!std::isfinite(ndcZ)) {
+      return false;
+    }
+
+    const double depthCandidate = -ndcZ;
+    if (depthCandidate > maxDepth) {
+      maxDepth = depthCandidate;
+    }
+  }
+
+  if (!std::isfinite(maxDepth)) {
+    return false;
+  }
+
+  *out = maxDepth;
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+static inline FrameVector<ResourceInfo> buildResourceInfos(
+    const InputResourceEntry* resourceEntries, std::size_t resourceCount) {
+  FrameVector<ResourceInfo> resources(
+      resourceCount, g_frameArena.mainAllocator<ResourceInfo>());
+  for (std::size_t i = 0; i < resourceCount; ++i) {
+    const auto& entry = resourceEntries[i];
+    ResourceInfo info;
+    info.handle = i;
+    info.width = entry.width;
+    info.height = entry.height;
+    info.textureReady = entry.textureReady != 0.0;
+    info.atlasPageIndex = entry.atlasPageIndex;
+    info.atlasU0 = entry.atlasU0;
+    info.atlasV0 = entry.atlasV0;
+    info.atlasU1 = entry.atlasU1;
+    info.atlasV1 = entry.atlasV1;
+    if (!std::isfinite(info.atlasU0)) {
+      info.atlasU0 = 0.0;
+    }
+    if (!std::isfinite(info.atlasV0)) {
+      info.atlasV0 = 0.0;
+    }
+    if (!std::isfinite(info.atlasU1)) {
+      info.atlasU1 = 1.0;
+    }
+    if (!std::isfinite(info.atlasV1)) {
+      info.atlasV1 = 1.0;
+    }
+    resources[i] = info;
+  }
+
+  return resources;
+}
+
+/**
+ * @brief Module-resident sprite/image table used by the `*Resident*` exports.
+ */
+static ResidentSpriteStore g_residentSpriteStore;
+
+/**
+ * @brief Animations advanced in place on `g_residentSpriteStore`.
+ */
+static ResidentInterpolationTable g_residentInterpolations;
+
+/**
+ * @brief Copies the resident images at `slots` (ascending) into a dense table
+ * and re-targets their origin references to the new positions.
+ */
+static FrameVector<InputItemEntry> gatherResidentImages(
+    const std::vector<InputItemEntry>& images,
+    const FrameVector<std::size_t>& slots) {
+  FrameVector<InputItemEntry> gathered(
+      g_frameArena.mainAllocator<InputItemEntry>());
+  gathered.reserve(slots.size());
+  for (const std::size_t slot : slots) {
+    InputItemEntry entry = images[slot];
+    std::size_t originSlot = 0;
+    if (convertToSizeT(entry.originTargetIndex, originSlot)) {
+      // Origins belong to the same sprite, so they are gathered as well.
+      const auto found =
+          std::lower_bound(slots.begin(), slots.end(), originSlot);
+      entry.originTargetIndex =
+          (found != slots.end() && *found == originSlot)
+              ? static_cast<double>(found - slots.begin())
+              : static_cast<double>(SPRITE_ORIGIN_REFERENCE_INDEX_NONE);
+    }
+    gathered.push_back(entry);
+  }
+  return gathered;
+}
+
+static inline bool readResidentBatchCount(const double* paramsPtr,
+                                          std::size_t& count) {
+  if (paramsPtr == nullptr) {
+    return false;
+  }
+  return convertToSizeT(paramsPtr[0], count);
+}
+
+/**
+ * @brief Projection results shared by every image of one sprite.
+ */
+struct SpriteProjection {
+  SpriteLocation location;
+  SpriteMercatorCoordinate mercator;
+  bool hasMercator = false;
+  SpriteScreenPoint projected;
+  bool projectedValid = false;
+  double metersPerPixelAtLat = 0.0;
+  double perspectiveRatio = 1.0;
+  double effectivePixelsPerMeter = 0.0;
+  bool hasEffectivePixelsPerMeter = false;
+};
+
+constexpr std::size_t SPRITE_PROJECTION_PARALLEL_MIN_ITEMS = 512;
+constexpr std::size_t SPRITE_PROJECTION_PARALLEL_SLICE = 256;
+
+/**
+ * @brief Sprite location interpolations evaluated by the prepare pass itself
+ * (PREPARE_SPRITE_INTERPOLATION_ITEM_LENGTH entries). Each entry writes its
+ * SPRITE_INTERPOLATION_RESULT_LENGTH record to `results`.
+ */
+struct SpriteLocationInterpolations {
+  const double* entries = nullptr;
+  std::size_t count = 0;
+  double* results = nullptr;
+};
+
+constexpr std::size_t SPRITE_INTERPOLATION_NONE =
+    std::numeric_limits<std::size_t>::max();
+
+static inline bool isSameSpriteLocation(const SpriteLocation& a,
+                                        const SpriteLocation& b) {
+  return a.lng == b.lng && a.lat == b.lat && a.z == b.z;
 }
 
-static inline bool __projectLngLatToClipSpace(double lng,
-                                              double lat,
-                                              double altitude,
-                                              const double* matrix,
-                                              double* out) {
-  double mercator[3] = {0.0, 0.0, 0.0};
-  if (!__fromLngLat(lng, lat, altitude, mercator)) {
-    return false;
+/**
+ * @brief Computes screen point, mercator and scale factors for one sprite.
+ *
+ * Mirrors `ensureBucketEffectivePixelsPerMeter` so shared results stay
+ * identical to the per-item path.
+ */
+static inline void computeSpriteProjection(
+    const ProjectionContext& projectionContext,
+    const FrameConstants& frame,
+    SpriteProjection& sprite) {
+  sprite.projectedValid =
+      projectSpritePoint(projectionContext, sprite.location, sprite.projected);
+  sprite.hasMercator =
+      calculateMercatorCoordinate(sprite.location, sprite.mercator);
+
+  const double metersPerPixelAtLat =
+      calculateMetersPerPixelAtLatitude(frame.zoomExp2, sprite.location.lat);
+  if (!std::isfinite(metersPerPixelAtLat) || metersPerPixelAtLat <= 0.0) {
+    return;
+  }
+  const double perspectiveRatio = calculatePerspectiveRatio(
+      projectionContext,
+      sprite.location,
+      sprite.hasMercator ? &sprite.mercator : nullptr);
+  const double effectivePixelsPerMeter = calculateEffectivePixelsPerMeter(
+      metersPerPixelAtLat, perspectiveRatio);
+  if (!std::isfinite(effectivePixelsPerMeter) ||
+      effectivePixelsPerMeter <= 0.0) {
+    return;
   }
+  sprite.metersPerPixelAtLat = metersPerPixelAtLat;
+  sprite.perspectiveRatio = perspectiveRatio;
+  sprite.effectivePixelsPerMeter = effectivePixelsPerMeter;
+  sprite.hasEffectivePixelsPerMeter = true;
+}
 
-  double clipX = 0.0;
-  double clipY = 0.0;
-  double clipZ = 0.0;
-  double clipW = 0.0;
-  multiplyMatrixAndVector(
-      matrix, mercator[0], mercator[1], mercator[2], 1.0, clipX, clipY, clipZ,
-      clipW);
+#ifdef SIMD_ENABLED
+/**
+ * @brief Per-lane scalar inputs of the SoA sprite projection kernel.
+ *
+ * The transcendental parts stay scalar unless fast mercator math is enabled,
+ * in which case `mercatorY` is left unset and computed for both lanes at
+ * once. `mercatorY` is shared between the screen projection and the mercator
+ * coordinate, and the latitude cosine is shared between the mercator altitude
+ * and meters-per-pixel whenever the latitude needed no clamping.
+ */
+struct SpriteProjectionLane {
+  double altitude = 0.0;
+  double constrainedLat = 0.0;
+  double mercatorX = 0.0;
+  double mercatorY = 0.0;
+  double circumference = 0.0;
+  double cosLatitude = 0.0;
+};
 
-  if (!std::isfinite(clipX) || !std::isfinite(clipY) ||
-      !std::isfinite(clipZ) || !std::isfinite(clipW) || clipW <= MIN_CLIP_W) {
-    return false;
+static inline SpriteProjectionLane prepareSpriteProjectionLane(
+    const SpriteLocation& location) {
+  const double constrainedLat =
+      clamp(toFiniteOr(location.lat, 0.0),
+            -MAX_MERCATOR_LATITUDE,
+            MAX_MERCATOR_LATITUDE);
+  SpriteProjectionLane lane;
+  lane.altitude = toFiniteOr(location.z, 0.0);
+  lane.constrainedLat = constrainedLat;
+  lane.mercatorX = mercatorXfromLng(toFiniteOr(location.lng, 0.0));
+  if (!g_fastMercatorMath) {
+    lane.mercatorY = mercatorYfromLat(constrainedLat);
   }
+  const double cosConstrained = std::cos(constrainedLat * DEG2RAD);
+  lane.circumference = 2.0 * PI * EARTH_RADIUS_METERS * cosConstrained;
+  lane.cosLatitude = location.lat == constrainedLat
+                         ? cosConstrained
+                         : std::cos(location.lat * DEG2RAD);
+  return lane;
+}
 
-  out[0] = clipX;
-  out[1] = clipY;
-  out[2] = clipZ;
-  out[3] = clipW;
+// Lane-wise finite test: x - x is 0 only for finite values.
+static inline v128_t simdIsFinite(v128_t value) {
+  return wasm_f64x2_eq(wasm_f64x2_sub(value, value), wasm_f64x2_splat(0.0));
+}
 
-  return true;
+/**
+ * @brief Row `row` of a column-major matrix times (x, y, z, 1), summed in
+ * the same order as the scalar projection.
+ */
+static inline v128_t simdMatrixRowAffine(const double* matrix,
+                                         std::size_t row,
+                                         v128_t x,
+                                         v128_t y,
+                                         v128_t z) {
+  return wasm_f64x2_add(
+      wasm_f64x2_add(
+          wasm_f64x2_add(wasm_f64x2_mul(wasm_f64x2_splat(matrix[row]), x),
+                         wasm_f64x2_mul(wasm_f64x2_splat(matrix[row + 4]), y)),
+          wasm_f64x2_mul(wasm_f64x2_splat(matrix[row + 8]), z)),
+      wasm_f64x2_splat(matrix[row + 12]));
 }
 
-//////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief SoA form of `computeSpriteProjection` for two sprites per f64x2.
+ *
+ * Results are identical to the scalar path. Requires the pixel and mercator
+ * matrices, a positive world size and a positive camera distance.
+ */
+static inline void computeSpriteProjectionPair(
+    const ProjectionContext& projectionContext,
+    const FrameConstants& frame,
+    SpriteProjection& sprite0,
+    SpriteProjection& sprite1) {
+  const SpriteProjectionLane lane0 =
+      prepareSpriteProjectionLane(sprite0.location);
+  const SpriteProjectionLane lane1 =
+      prepareSpriteProjectionLane(sprite1.location);
+
+  const v128_t zero = wasm_f64x2_splat(0.0);
+  const v128_t one = wasm_f64x2_splat(1.0);
+  const v128_t mercatorX = wasm_f64x2_make(lane0.mercatorX, lane1.mercatorX);
+  const v128_t mercatorY =
+      g_fastMercatorMath
+          ? fastMercatorYfromLatX2(
+                wasm_f64x2_make(lane0.constrainedLat, lane1.constrainedLat))
+          : wasm_f64x2_make(lane0.mercatorY, lane1.mercatorY);
+  const v128_t altitude = wasm_f64x2_make(lane0.altitude, lane1.altitude);
+  const v128_t circumference =
+      wasm_f64x2_make(lane0.circumference, lane1.circumference);
+  const v128_t mercatorZ = wasm_v128_bitselect(
+      zero,
+      wasm_f64x2_div(altitude, circumference),
+      wasm_f64x2_eq(circumference, zero));
+
+  // Screen point through the pixel matrix.
+  const v128_t worldSize = wasm_f64x2_splat(projectionContext.worldSize);
+  const v128_t worldX = wasm_f64x2_mul(mercatorX, worldSize);
+  const v128_t worldY = wasm_f64x2_mul(mercatorY, worldSize);
+  const double* pixelMatrix = projectionContext.pixelMatrix;
+  const v128_t clipX =
+      simdMatrixRowAffine(pixelMatrix, 0, worldX, worldY, altitude);
+  const v128_t clipY =
+      simdMatrixRowAffine(pixelMatrix, 1, worldX, worldY, altitude);
+  const v128_t clipW =
+      simdMatrixRowAffine(pixelMatrix, 3, worldX, worldY, altitude);
+  const uint32_t projectedBits = wasm_i64x2_bitmask(wasm_v128_and(
+      wasm_v128_and(simdIsFinite(clipX), simdIsFinite(clipY)),
+      wasm_v128_and(simdIsFinite(clipW), wasm_f64x2_gt(clipW, zero))));
+  const v128_t projectedX = wasm_f64x2_div(clipX, clipW);
+  const v128_t projectedY = wasm_f64x2_div(clipY, clipW);
+
+  // Perspective ratio through the mercator matrix.
+  const double* mercatorMatrix = projectionContext.mercatorMatrix;
+  const v128_t mercatorW = wasm_f64x2_add(
+      wasm_f64x2_add(
+          wasm_f64x2_add(
+              wasm_f64x2_mul(wasm_f64x2_splat(mercatorMatrix[3]), mercatorX),
+              wasm_f64x2_mul(wasm_f64x2_splat(mercatorMatrix[7]), mercatorY)),
+          wasm_f64x2_mul(wasm_f64x2_splat(mercatorMatrix[11]), mercatorZ)),
+      wasm_f64x2_mul(wasm_f64x2_splat(mercatorMatrix[15]), one));
+  const v128_t rawRatio = wasm_f64x2_div(
+      wasm_f64x2_splat(projectionContext.cameraToCenterDistance), mercatorW);
+  const v128_t ratioValid = wasm_v128_and(
+      wasm_v128_and(simdIsFinite(mercatorW), wasm_f64x2_gt(mercatorW, zero)),
+      wasm_v128_and(simdIsFinite(rawRatio), wasm_f64x2_gt(rawRatio, zero)));
+  const v128_t perspectiveRatio = wasm_v128_bitselect(rawRatio, one, ratioValid);
+
+  // Scale factors.
+  const v128_t metersPerPixel = wasm_f64x2_div(
+      wasm_f64x2_mul(wasm_f64x2_make(lane0.cosLatitude, lane1.cosLatitude),
+                     wasm_f64x2_splat(2.0 * PI * EARTH_RADIUS_METERS)),
+      wasm_f64x2_splat(512.0 * frame.zoomExp2));
+  const v128_t effectivePixelsPerMeter =
+      wasm_f64x2_mul(wasm_f64x2_div(one, metersPerPixel), perspectiveRatio);
+  const uint32_t scaleBits = wasm_i64x2_bitmask(wasm_v128_and(
+      wasm_v128_and(simdIsFinite(metersPerPixel),
+                    wasm_f64x2_gt(metersPerPixel, zero)),
+      wasm_v128_and(simdIsFinite(effectivePixelsPerMeter),
+                    wasm_f64x2_gt(effectivePixelsPerMeter, zero))));
+
+  double projectedXs[2];
+  double projectedYs[2];
+  double mercatorYs[2];
+  double mercatorZs[2];
+  double metersPerPixels[2];
+  double perspectiveRatios[2];
+  double effectivePixelsPerMeters[2];
+  wasm_v128_store(projectedXs, projectedX);
+  wasm_v128_store(projectedYs, projectedY);
+  wasm_v128_store(mercatorYs, mercatorY);
+  wasm_v128_store(mercatorZs, mercatorZ);
+  wasm_v128_store(metersPerPixels, metersPerPixel);
+  wasm_v128_store(perspectiveRatios, perspectiveRatio);
+  wasm_v128_store(effectivePixelsPerMeters, effectivePixelsPerMeter);
+
+  SpriteProjection* const sprites[2] = {&sprite0, &sprite1};
+  const SpriteProjectionLane* const lanes[2] = {&lane0, &lane1};
+  for (std::size_t index = 0; index < 2; ++index) {
+    SpriteProjection& sprite = *sprites[index];
+    const uint32_t bit = 1u << index;
+    sprite.projectedValid = (projectedBits & bit) != 0;
+    if (sprite.projectedValid) {
+      sprite.projected.x = projectedXs[index];
+      sprite.projected.y = projectedYs[index];
+    }
+    sprite.mercator.x = lanes[index]->mercatorX;
+    sprite.mercator.y = mercatorYs[index];
+    sprite.mercator.z = mercatorZs[index];
+    sprite.hasMercator = true;
+    if ((scaleBits & bit) != 0) {
+      sprite.metersPerPixelAtLat = metersPerPixels[index];
+      sprite.perspectiveRatio = perspectiveRatios[index];
+      sprite.effectivePixelsPerMeter = effectivePixelsPerMeters[index];
+      sprite.hasEffectivePixelsPerMeter = true;
+    }
+  }
+}
+#endif
 
-static inline bool __calculateBillboardDepthKey(double centerX,
-                                                double centerY,
-                                                double worldSize,
-                                                const double* inverseMatrix,
-                                                const double* mercatorMatrix,
-                                                double* out) {
-  if (!std::isfinite(worldSize) || worldSize <= 0.0) {
-    return false;
+/**
+ * @brief Runs the sprite projection over `[start, end)`, two sprites per
+ * vector when SIMD is enabled.
+ */
+static inline void computeSpriteProjectionRange(
+    const ProjectionContext& projectionContext,
+    const FrameConstants& frame,
+    FrameVector<SpriteProjection>& sprites,
+    std::size_t start,
+    std::size_t end) {
+  std::size_t index = start;
+#ifdef SIMD_ENABLED
+  const bool pairable = projectionContext.pixelMatrix != nullptr &&
+                        projectionContext.mercatorMatrix != nullptr &&
+                        projectionContext.worldSize > 0.0 &&
+                        projectionContext.cameraToCenterDistance > 0.0;
+  if (pairable) {
+    for (; index + 1 < end; index += 2) {
+      computeSpriteProjectionPair(
+          projectionContext, frame, sprites[index], sprites[index + 1]);
+    }
   }
+#endif
+  for (; index < end; ++index) {
+    computeSpriteProjection(projectionContext, frame, sprites[index]);
+  }
+}
 
-  double lngLat[2] = {0.0, 0.0};
-  if (!__unproject(centerX, centerY, worldSize, inverseMatrix, lngLat)) {
-    return false;
+/**
+ * @brief Location produced by one fused interpolation entry.
+ */
+struct FusedSpriteLocation {
+  double lng = 0.0;
+  double lat = 0.0;
+  double z = 0.0;
+  bool hasZ = false;
+
+  /**
+   * @brief Moves `base`, keeping its altitude when the entry has none.
+   */
+  SpriteLocation applyTo(const SpriteLocation& base) const {
+    return SpriteLocation{lng, lat, hasZ ? z : base.z};
   }
+};
 
-  double mercator[3] = {0.0, 0.0, 0.0};
-  if (!__fromLngLat(lngLat[0], lngLat[1], 0.0, mercator)) {
-    return false;
+/**
+ * @brief Evaluates one fused interpolation entry and writes its result.
+ */
+static inline FusedSpriteLocation evaluateFusedSpriteInterpolation(
+    const SpriteLocationInterpolations& interpolations,
+    std::size_t index) {
+  const double* entry =
+      interpolations.entries + index * PREPARE_SPRITE_INTERPOLATION_ITEM_LENGTH;
+  double location[3];
+  const bool hasZ = evaluateSpriteInterpolationItem(
+      entry + 1,
+      interpolations.results + index * SPRITE_INTERPOLATION_RESULT_LENGTH,
+      location);
+  return FusedSpriteLocation{location[0], location[1], location[2], hasZ};
+}
+
+/**
+ * @brief Projects each distinct sprite once and maps items onto the results.
+ *
+ * Sprites are numbered by first appearance of `spriteHandle` and take the
+ * location carried by their first item. Items whose location disagrees with
+ * their sprite (or whose handle is unusable) get a private entry so the
+ * output never depends on the sharing; a fused interpolation moves every
+ * entry of its sprite. `spriteCount` is only a capacity hint.
+ */
+static void buildSpriteProjections(const ProjectionContext& projectionContext,
+                                   const FrameConstants& frame,
+                                   std::size_t spriteCount,
+                                   const InputItemEntry* itemEntries,
+                                   std::size_t itemCount,
+                                   const SpriteLocationInterpolations* interpolations,
+                                   FrameVector<SpriteProjection>& sprites,
+                                   FrameVector<std::size_t>& itemSpriteIndices) {
+  sprites.clear();
+  sprites.reserve(std::min(itemCount, spriteCount > 0 ? spriteCount : itemCount));
+  itemSpriteIndices.assign(itemCount, 0);
+
+  std::unordered_map<int64_t,
+                     std::size_t,
+                     std::hash<int64_t>,
+                     std::equal_to<int64_t>,
+                     FrameAllocator<std::pair<const int64_t, std::size_t>>>
+      spriteSlots(0,
+                  std::hash<int64_t>(),
+                  std::equal_to<int64_t>(),
+                  g_frameArena.mainAllocator<
+                      std::pair<const int64_t, std::size_t>>());
+  spriteSlots.reserve(spriteCount > 0 ? spriteCount : itemCount);
+  // (shared entry, private entry) of items whose location disagrees with
+  // their sprite.
+  FrameVector<std::pair<std::size_t, std::size_t>> privateEntries(
+      g_frameArena.mainAllocator<std::pair<std::size_t, std::size_t>>());
+  for (std::size_t i = 0; i < itemCount; ++i) {
+    const InputItemEntry& entry = itemEntries[i];
+    const SpriteLocation itemLocation{
+        entry.spriteLng, entry.spriteLat, entry.spriteZ};
+    int64_t spriteHandle = 0;
+    const bool hasHandle = convertToInt64(entry.spriteHandle, spriteHandle);
+    if (hasHandle) {
+      const auto found = spriteSlots.find(spriteHandle);
+      if (found != spriteSlots.end()) {
+        if (isSameSpriteLocation(sprites[found->second].location,
+                                 itemLocation)) {
+          itemSpriteIndices[i] = found->second;
+          continue;
+        }
+        privateEntries.emplace_back(found->second, sprites.size());
+      } else {
+        spriteSlots.emplace(spriteHandle, sprites.size());
+        itemSpriteIndices[i] = sprites.size();
+        SpriteProjection sprite;
+        sprite.location = itemLocation;
+        sprites.push_back(sprite);
+        continue;
+      }
+    }
+    itemSpriteIndices[i] = sprites.size();
+    SpriteProjection sprite;
+    sprite.location = itemLocation;
+    sprites.push_back(sprite);
   }
 
-  double clipX = 0.0;
-  double clipY = 0.0;
-  double clipZ = 0.0;
-  double clipW = 0.0;
-  multiplyMatrixAndVector(mercatorMatrix,
-                          mercator[0],
-                          mercator[1],
-                          mercator[2],
-                          1.0,
-                          clipX,
-                          clipY,
-                          clipZ,
-                          clipW);
+  // Interpolated sprites are moved right before their projection, in the same
+  // worker slice. Entries without a drawn sprite only produce their result.
+  FrameVector<std::size_t> spriteInterpolations(
+      g_frameArena.mainAllocator<std::size_t>());
+  FrameVector<std::size_t> detachedInterpolations(
+      g_frameArena.mainAllocator<std::size_t>());
+  if (interpolations != nullptr && interpolations->count > 0) {
+    spriteInterpolations.assign(sprites.size(), SPRITE_INTERPOLATION_NONE);
+    for (std::size_t index = 0; index < interpolations->count; ++index) {
+      int64_t spriteHandle = 0;
+      const double* entry = interpolations->entries +
+                            index * PREPARE_SPRITE_INTERPOLATION_ITEM_LENGTH;
+      const auto found = convertToInt64(entry[0], spriteHandle)
+                             ? spriteSlots.find(spriteHandle)
+                             : spriteSlots.end();
+      if (found == spriteSlots.end()) {
+        detachedInterpolations.push_back(index);
+        continue;
+      }
+      std::size_t& slot = spriteInterpolations[found->second];
+      if (slot != SPRITE_INTERPOLATION_NONE) {
+        detachedInterpolations.push_back(slot);
+      }
+      slot = index;
+    }
 
-  if (!std::isfinite(clipX) || !std::isfinite(clipY) ||
-      !std::isfinite(clipZ) || !std::isfinite(clipW)) {
-    return false;
+    // An interpolated sprite moves all of its entries. Sprites with private
+    // entries are evaluated once here and the result is applied to each of
+    // them, so their images cannot end up at two positions.
+    if (!privateEntries.empty()) {
+      FrameVector<std::optional<FusedSpriteLocation>> moved(
+          sprites.size(),
+          std::nullopt,
+          g_frameArena.mainAllocator<std::optional<FusedSpriteLocation>>());
+      for (const auto& privateEntry : privateEntries) {
+        const std::size_t shared = privateEntry.first;
+        std::size_t& interpolation = spriteInterpolations[shared];
+        if (interpolation != SPRITE_INTERPOLATION_NONE) {
+          moved[shared] =
+              evaluateFusedSpriteInterpolation(*interpolations, interpolation);
+          sprites[shared].location =
+              moved[shared]->applyTo(sprites[shared].location);
+          interpolation = SPRITE_INTERPOLATION_NONE;
+        }
+        if (moved[shared]) {
+          SpriteLocation& location = sprites[privateEntry.second].location;
+          location = moved[shared]->applyTo(location);
+        }
+      }
+    }
+  }
+  const bool hasSpriteInterpolations = !spriteInterpolations.empty();
+
+  parallelFor(sprites.size(),
+              SPRITE_PROJECTION_PARALLEL_MIN_ITEMS,
+              SPRITE_PROJECTION_PARALLEL_SLICE,
+              [&](std::size_t start, std::size_t end, std::size_t) {
+                if (hasSpriteInterpolations) {
+                  for (std::size_t index = start; index < end; ++index) {
+                    const std::size_t interpolation =
+                        spriteInterpolations[index];
+                    if (interpolation != SPRITE_INTERPOLATION_NONE) {
+                      sprites[index].location =
+                          evaluateFusedSpriteInterpolation(*interpolations,
+                                                           interpolation)
+                              .applyTo(sprites[index].location);
+                    }
+                  }
+                }
+                computeSpriteProjectionRange(
+                    projectionContext, frame, sprites, start, end);
+              });
+
+  for (const std::size_t index : detachedInterpolations) {
+    evaluateFusedSpriteInterpolation(*interpolations, index);
   }
+}
 
-  const double ndcZ = clipW != 0.0 ? (clipZ / clipW) : clipZ;
-  if (!std::isfinite(ndcZ)) {
-    return false;
+/**
+ * @brief Resolves a caller-provided float32 output region, or null when
+ * `flag` is off or the region holds fewer than `requiredLength` elements.
+ */
+static inline float* resolveFloat32Output(const InputBufferHeader* header,
+                                          int flag,
+                                          double pointer,
+                                          double capacityValue,
+                                          std::size_t requiredLength) {
+  if ((static_cast<int>(header->flags) & flag) == 0) {
+    return nullptr;
+  }
+  std::size_t address = 0;
+  std::size_t capacity = 0;
+  if (!convertToSizeT(pointer, address) ||
+      !convertToSizeT(capacityValue, capacity) ||
+      address == 0 || address % alignof(float) != 0 ||
+      capacity < requiredLength) {
+    return nullptr;
   }
+  return reinterpret_cast<float*>(address);
+}
 
-  *out = -ndcZ;
-  return true;
+/**
+ * @brief Resolves the vertex output region for `itemCount` items.
+ */
+static inline float* resolveVertexOutput(const InputBufferHeader* header,
+                                         std::size_t itemCount) {
+  return resolveFloat32Output(header,
+                              INPUT_FLAG_VERTEX_OUTPUT,
+                              header->vertexOutputPtr,
+                              header->vertexOutputCapacity,
+                              itemCount * RESULT_VERTEX_COMPONENT_LENGTH);
 }
 
-//////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief Resolves the instance record region for `itemCount` items.
+ */
+static inline float* resolveInstanceOutput(const InputBufferHeader* header,
+                                           std::size_t itemCount) {
+  return resolveFloat32Output(header,
+                              INPUT_FLAG_INSTANCE_OUTPUT,
+                              header->instanceOutputPtr,
+                              header->instanceOutputCapacity,
+                              itemCount * RESULT_INSTANCE_RECORD_LENGTH);
+}
 
-static inline bool __calculateSurfaceDepthKey(double baseLng,
-                                              double baseLat,
-                                              double baseAltitude,
-                                              const double* displacements,
-                                              int displacementCount,
-                                              const int32_t* indices,
-                                              int indexCount,
-                                              const double* mercatorMatrix,
-                                              bool applyBias,
-                                              double biasNdc,
-                                              double minClipZEpsilon,
-                                              double* out) {
-  if (displacementCount <= 0 || indexCount <= 0) {
-    return false;
-  }
+/**
+ * @brief Shared prepare pipeline for marshalled and resident item tables.
+ *
+ * `resultPtr` must have room for `itemCount` result items. A non-null
+ * `vertexOutput` receives the float32 vertices of every prepared item,
+ * `RESULT_VERTEX_COMPONENT_LENGTH` per item in result order, in place of the
+ * vertex block of the items. A non-null `instanceOutput` likewise receives
+ * one instance record per item; shader billboards are then drawn from their
+ * record alone, so their vertex block stays zero and their vertex region slot
+ * is left untouched.
+ */
+static bool prepareDrawSpriteImagesCore(const FrameConstants& frame,
+                                        const double* matrixPtr,
+                                        int inputFlags,
+                                        double cullGuardBandPixels,
+                                        const FrameVector<ResourceInfo>& resources,
+                                        std::size_t spriteCount,
+                                        const InputItemEntry* itemEntries,
+                                        std::size_t itemCount,
+                                        const SpriteLocationInterpolations* interpolations,
+                                        double* resultPtr,
+                                        float* vertexOutput,
+                                        float* instanceOutput) {
+  const ScopedFastMercatorMath fastMercatorMath(
+      (inputFlags & INPUT_FLAG_FAST_MERCATOR_MATH) != 0);
+  ResultBufferHeader* resultHeader = initializeResultHeader(resultPtr);
 
-  double clip[4] = {0.0, 0.0, 0.0, 0.0};
-  double maxDepth = -std::numeric_limits<double>::infinity();
+  const ProjectionContext projectionContext =
+      createProjectionContext(frame, matrixPtr);
 
-  for (int index = 0; index < indexCount; index++) {
-    const int32_t displacementIndex = indices[index];
-    if (displacementIndex < 0 || displacementIndex >= displacementCount) {
-      continue;
+  const bool clipContextAvailable =
+      frame.drawingBufferWidth > 0.0 && frame.drawingBufferHeight > 0.0 &&
+      frame.pixelRatio != 0.0 && std::isfinite(frame.pixelRatio) &&
+      projectionContext.mercatorMatrix != nullptr;
+
+  const bool useShaderSurfaceGeometry =
+      (inputFlags & INPUT_FLAG_USE_SHADER_SURFACE_GEOMETRY) != 0;
+  const bool useShaderBillboardGeometry =
+      (inputFlags & INPUT_FLAG_USE_SHADER_BILLBOARD_GEOMETRY) != 0;
+  const bool enableSurfaceBias =
+      (inputFlags & INPUT_FLAG_ENABLE_NDC_BIAS_SURFACE) != 0 &&
+      frame.enableNdcBiasSurface;
+  const bool float32Result = (inputFlags & INPUT_FLAG_FLOAT32_RESULT) != 0;
+  // The draw output applies the frame's surface bias on its own, as before.
+  const PrepareDrawSpriteImageKernels kernels =
+      resolvePrepareDrawSpriteImageKernels(float32Result,
+                                           useShaderSurfaceGeometry,
+                                           useShaderBillboardGeometry,
+                                           frame.enableNdcBiasSurface);
+  const bool surfaceStream = (inputFlags & INPUT_FLAG_SURFACE_STREAM) != 0;
+  const std::size_t resultItemStride = resolveResultItemStride(
+      float32Result, surfaceStream, vertexOutput != nullptr);
+  std::size_t surfaceRecordStride = 0;
+  if (surfaceStream) {
+    surfaceRecordStride = float32Result ? RESULT_FLOAT32_SURFACE_RECORD_STRIDE
+                                        : RESULT_SURFACE_RECORD_STRIDE;
+  }
+  ResultRelativeAnchor relativeAnchor;
+  if (float32Result) {
+    relativeAnchor = resolveResultRelativeAnchor(
+        projectionContext, frame, clipContextAvailable);
+    resultHeader->anchorMercatorX = relativeAnchor.mercatorX;
+    resultHeader->anchorMercatorY = relativeAnchor.mercatorY;
+    resultHeader->anchorLng = relativeAnchor.lng;
+    resultHeader->anchorLat = relativeAnchor.lat;
+  }
+
+  FrameVector<SpriteProjection> sprites(
+      g_frameArena.mainAllocator<SpriteProjection>());
+  FrameVector<std::size_t> itemSpriteIndices(
+      g_frameArena.mainAllocator<std::size_t>());
+  buildSpriteProjections(projectionContext,
+                         frame,
+                         spriteCount,
+                         itemEntries,
+                         itemCount,
+                         interpolations,
+                         sprites,
+                         itemSpriteIndices);
+
+  FrameVector<BucketItem> bucketItems(
+      itemCount, g_frameArena.mainAllocator<BucketItem>());
+  std::size_t surfaceGeometryCount = 0;
+  for (std::size_t i = 0; i < itemCount; ++i) {
+    const SpriteProjection& sprite = sprites[itemSpriteIndices[i]];
+    BucketItem bucket;
+    bucket.entry = &itemEntries[i];
+    bucket.index = i;
+    bucket.resource =
+        findResourceByHandle(resources, bucket.entry->resourceHandle);
+    bucket.spriteLocation = sprite.location;
+    bucket.projected = sprite.projected;
+    bucket.projectedValid = sprite.projectedValid;
+    bucket.mercator = sprite.mercator;
+    bucket.hasMercator = sprite.hasMercator;
+    bucket.metersPerPixelAtLat = sprite.metersPerPixelAtLat;
+    bucket.perspectiveRatio = sprite.perspectiveRatio;
+    bucket.effectivePixelsPerMeter = sprite.effectivePixelsPerMeter;
+    bucket.hasEffectivePixelsPerMeter = sprite.hasEffectivePixelsPerMeter;
+    if (!convertToInt64(bucket.entry->spriteHandle, bucket.spriteHandle)) {
+      bucket.spriteHandle = 0;
+    }
+    const double resolvedRotate = resolveTotalRotateDeg(*bucket.entry);
+    bucket.rotation = buildRotationCache(resolvedRotate);
+    if (std::lround(bucket.entry->mode) == 0) {
+      bucket.surfaceGeometryIndex =
+          static_cast<uint32_t>(surfaceGeometryCount++);
     }
+    bucketItems[i] = bucket;
+  }
+  FrameVector<SurfaceGeometryCache> surfaceGeometries(
+      surfaceGeometryCount, g_frameArena.mainAllocator<SurfaceGeometryCache>());
 
-    const double east = displacements[displacementIndex * 2 + 0];
-    const double north = displacements[displacementIndex * 2 + 1];
+  std::size_t culledCount = 0;
+  if ((inputFlags & INPUT_FLAG_ENABLE_VIEWPORT_CULLING) != 0) {
+    culledCount = cullBucketItemsOutsideViewport(
+        bucketItems, projectionContext, frame, cullGuardBandPixels);
+  }
 
-    double displacedLng = 0.0;
-    double displacedLat = 0.0;
-    double displacedAltitude = 0.0;
-    applySurfaceDisplacement(baseLng,
-                             baseLat,
-                             baseAltitude,
-                             east,
-                             north,
-                             displacedLng,
-                             displacedLat,
-                             displacedAltitude);
+  precomputeBucketCenters(bucketItems,
+                          surfaceGeometries,
+                          projectionContext,
+                          frame,
+                          clipContextAvailable);
 
-    if (!__projectLngLatToClipSpace(displacedLng,
-                                    displacedLat,
-                                    displacedAltitude,
-                                    mercatorMatrix,
-                                    clip)) {
-      return false;
-    }
+  DepthCollectionResult depthResult = collectDepthSortedItemsInternal(
+      bucketItems,
+      surfaceGeometries,
+      projectionContext,
+      frame,
+      clipContextAvailable,
+      enableSurfaceBias);
 
-    double clipZ = clip[2];
-    const double clipW = clip[3];
+  const std::size_t depthCount = depthResult.items.size();
+  const std::size_t chunkItems = resolveWorkerChunkItems(PREPARE_PARALLEL_CHUNK);
+  const std::size_t chunkCount = (depthCount + chunkItems - 1) / chunkItems;
+  const std::size_t prepareWorkerCount =
+      determinePrepareWorkerCount(depthCount);
 
-    if (!std::isfinite(clipZ) || !std::isfinite(clipW)) {
-      return false;
-    }
+  // Phase 1: count candidates per chunk, then an exclusive scan over the
+  // chunk totals gives every chunk its first output slot. Surface stream
+  // records are counted the same way.
+  FrameVector<std::size_t> chunkSlots(
+      chunkCount + 1, 0, g_frameArena.mainAllocator<std::size_t>());
+  FrameVector<std::size_t> chunkSurfaceSlots(
+      chunkCount + 1, 0, g_frameArena.mainAllocator<std::size_t>());
+  runChunkedWorkerJobs(prepareWorkerCount, depthCount, chunkItems,
+                       [&](std::size_t start, std::size_t end, std::size_t) {
+                         std::size_t candidates = 0;
+                         std::size_t surfaces = 0;
+                         for (std::size_t idx = start; idx < end; ++idx) {
+                           const DepthItem& depth = depthResult.items[idx];
+                           if (isDrawSpriteImageCandidate(
+                                   depth,
+                                   projectionContext,
+                                   clipContextAvailable)) {
+                             ++candidates;
+                             if (surfaceStream &&
+                                 hasSurfaceStreamRecord(
+                                     depth, useShaderSurfaceGeometry)) {
+                               ++surfaces;
+                             }
+                           }
+                         }
+                         chunkSlots[start / chunkItems + 1] = candidates;
+                         chunkSurfaceSlots[start / chunkItems + 1] = surfaces;
+                       });
+  for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+    chunkSlots[chunk + 1] += chunkSlots[chunk];
+    chunkSurfaceSlots[chunk + 1] += chunkSurfaceSlots[chunk];
+  }
+  const std::size_t candidateCount = chunkSlots[chunkCount];
+  const std::size_t surfaceCandidateCount = chunkSurfaceSlots[chunkCount];
+
+  // Phase 2: workers write straight into their final slots. Candidates that
+  // still fail late (surface clip projection) leave a hole to close below.
+  double* writePtr = resultPtr + RESULT_HEADER_LENGTH;
+  // The surface stream follows the item slots of every candidate.
+  const std::size_t surfaceOffset =
+      RESULT_HEADER_LENGTH + candidateCount * resultItemStride;
+  double* surfacePtr = resultPtr + surfaceOffset;
+  FrameVector<uint8_t> workerHasHitTest(
+      prepareWorkerCount, 0, g_frameArena.mainAllocator<uint8_t>());
+  FrameVector<uint8_t> workerHasSurfaceInputs(
+      prepareWorkerCount, 0, g_frameArena.mainAllocator<uint8_t>());
+  FrameVector<FrameVector<std::size_t>> workerFailedSlots(
+      g_frameArena.mainAllocator<FrameVector<std::size_t>>());
+  FrameVector<FrameVector<std::size_t>> workerFailedSurfaceSlots(
+      g_frameArena.mainAllocator<FrameVector<std::size_t>>());
+  workerFailedSlots.reserve(prepareWorkerCount);
+  workerFailedSurfaceSlots.reserve(prepareWorkerCount);
+  for (std::size_t worker = 0; worker < prepareWorkerCount; ++worker) {
+    workerFailedSlots.emplace_back(
+        g_frameArena.workerAllocator<std::size_t>(worker));
+    workerFailedSurfaceSlots.emplace_back(
+        g_frameArena.workerAllocator<std::size_t>(worker));
+  }
+  runChunkedWorkerJobs(
+      prepareWorkerCount, depthCount, chunkItems,
+      [&](std::size_t start, std::size_t end, std::size_t workerIndex) {
+        std::size_t slot = chunkSlots[start / chunkItems];
+        std::size_t surfaceSlot = chunkSurfaceSlots[start / chunkItems];
+        for (std::size_t idx = start; idx < end; ++idx) {
+          const DepthItem& depth = depthResult.items[idx];
+          if (!isDrawSpriteImageCandidate(depth, projectionContext,
+                                          clipContextAvailable)) {
+            continue;
+          }
+          ResultItemTarget target;
+          target.item = writePtr + slot * resultItemStride;
+          if (vertexOutput != nullptr) {
+            target.vertexOutput =
+                vertexOutput + slot * RESULT_VERTEX_COMPONENT_LENGTH;
+          }
+          if (instanceOutput != nullptr) {
+            target.instanceOutput =
+                instanceOutput + slot * RESULT_INSTANCE_RECORD_LENGTH;
+          }
+          target.itemIndex = slot;
+          target.surfaceStream = surfaceStream;
+          const bool hasSurfaceRecord =
+              surfaceStream &&
+              hasSurfaceStreamRecord(depth, useShaderSurfaceGeometry);
+          if (hasSurfaceRecord) {
+            target.surfaceRecord =
+                surfacePtr + surfaceSlot * surfaceRecordStride;
+          }
+          bool itemHasHitTest = false;
+          bool itemHasSurfaceInputs = false;
+          if (kernels.select(depth)(depth,
+                                    projectionContext,
+                                    frame,
+                                    relativeAnchor,
+                                    bucketItems,
+                                    surfaceGeometries,
+                                    target,
+                                    itemHasHitTest,
+                                    itemHasSurfaceInputs)) {
+            workerHasHitTest[workerIndex] |= itemHasHitTest ? 1 : 0;
+            workerHasSurfaceInputs[workerIndex] |= itemHasSurfaceInputs ? 1 : 0;
+          } else {
+            workerFailedSlots[workerIndex].push_back(slot);
+            if (hasSurfaceRecord) {
+              workerFailedSurfaceSlots[workerIndex].push_back(surfaceSlot);
+            }
+          }
+          ++slot;
+          if (hasSurfaceRecord) {
+            ++surfaceSlot;
+          }
+        }
+      });
+
+  bool hasHitTest = false;
+  bool hasSurfaceInputs = false;
+  FrameVector<std::size_t> failedSlots(
+      g_frameArena.mainAllocator<std::size_t>());
+  FrameVector<std::size_t> failedSurfaceSlots(
+      g_frameArena.mainAllocator<std::size_t>());
+  for (std::size_t worker = 0; worker < prepareWorkerCount; ++worker) {
+    hasHitTest = hasHitTest || workerHasHitTest[worker] != 0;
+    hasSurfaceInputs = hasSurfaceInputs || workerHasSurfaceInputs[worker] != 0;
+    failedSlots.insert(failedSlots.end(),
+                       workerFailedSlots[worker].begin(),
+                       workerFailedSlots[worker].end());
+    failedSurfaceSlots.insert(failedSurfaceSlots.end(),
+                              workerFailedSurfaceSlots[worker].begin(),
+                              workerFailedSurfaceSlots[worker].end());
+  }
 
-    if (applyBias) {
-      const double biasedClipZ = clipZ + biasNdc * clipW;
-      const double minClipZ = -clipW + minClipZEpsilon;
-      clipZ = biasedClipZ < minClipZ ? minClipZ : biasedClipZ;
+  std::size_t preparedCount = candidateCount;
+  if (!failedSlots.empty()) {
+    // Rare path: slide the survivors after the first hole down, run by run.
+    std::sort(failedSlots.begin(), failedSlots.end());
+    failedSlots.push_back(candidateCount);
+    std::size_t writeSlot = failedSlots[0];
+    for (std::size_t i = 0; i + 1 < failedSlots.size(); ++i) {
+      const std::size_t runStart = failedSlots[i] + 1;
+      const std::size_t runLength = failedSlots[i + 1] - runStart;
+      if (runLength > 0) {
+        std::memmove(writePtr + writeSlot * resultItemStride,
+                     writePtr + runStart * resultItemStride,
+                     sizeof(double) * resultItemStride * runLength);
+        if (vertexOutput != nullptr) {
+          std::memmove(
+              vertexOutput + writeSlot * RESULT_VERTEX_COMPONENT_LENGTH,
+              vertexOutput + runStart * RESULT_VERTEX_COMPONENT_LENGTH,
+              sizeof(float) * RESULT_VERTEX_COMPONENT_LENGTH * runLength);
+        }
+        if (instanceOutput != nullptr) {
+          std::memmove(
+              instanceOutput + writeSlot * RESULT_INSTANCE_RECORD_LENGTH,
+              instanceOutput + runStart * RESULT_INSTANCE_RECORD_LENGTH,
+              sizeof(float) * RESULT_INSTANCE_RECORD_LENGTH * runLength);
+        }
+        writeSlot += runLength;
+      }
     }
+    preparedCount = writeSlot;
+  }
 
-    const double ndcZ = clipW != 0.0 ? (clipZ / clipW) : clipZ;
-    if (!std::isfinite(ndcZ)) {
-      return false;
+  std::size_t surfaceCount = surfaceCandidateCount;
+  if (!failedSurfaceSlots.empty()) {
+    std::sort(failedSurfaceSlots.begin(), failedSurfaceSlots.end());
+    failedSurfaceSlots.push_back(surfaceCandidateCount);
+    std::size_t writeSlot = failedSurfaceSlots[0];
+    for (std::size_t i = 0; i + 1 < failedSurfaceSlots.size(); ++i) {
+      const std::size_t runStart = failedSurfaceSlots[i] + 1;
+      const std::size_t runLength = failedSurfaceSlots[i + 1] - runStart;
+      if (runLength > 0) {
+        std::memmove(surfacePtr + writeSlot * surfaceRecordStride,
+                     surfacePtr + runStart * surfaceRecordStride,
+                     sizeof(double) * surfaceRecordStride * runLength);
+        writeSlot += runLength;
+      }
     }
-
-    const double depthCandidate = -ndcZ;
-    if (depthCandidate > maxDepth) {
-      maxDepth = depthCandidate;
+    surfaceCount = writeSlot;
+  }
+  if (surfaceCount > 0 && failedSlots.size() > 1) {
+    // Items slid down as well: shift each record's item index by the number
+    // of failed slots before it (failedSlots ends with the sentinel).
+    const auto failedEnd = failedSlots.end() - 1;
+    for (std::size_t record = 0; record < surfaceCount; ++record) {
+      double* recordBase = surfacePtr + record * surfaceRecordStride;
+      const std::size_t itemIndex =
+          readSurfaceRecordItemIndex(recordBase, float32Result);
+      const std::size_t shift = static_cast<std::size_t>(
+          std::lower_bound(failedSlots.begin(), failedEnd, itemIndex) -
+          failedSlots.begin());
+      writeSurfaceRecordItemIndex(recordBase, itemIndex - shift, float32Result);
     }
   }
 
-  if (!std::isfinite(maxDepth)) {
-    return false;
+  resultHeader->preparedCount = static_cast<double>(preparedCount);
+  resultHeader->culledCount = static_cast<double>(culledCount);
+  resultHeader->itemStride = static_cast<double>(resultItemStride);
+  if (surfaceStream) {
+    resultHeader->surfaceCount = static_cast<double>(surfaceCount);
+    resultHeader->surfaceOffset = static_cast<double>(surfaceOffset);
+    resultHeader->surfaceStride = static_cast<double>(surfaceRecordStride);
   }
+  resultHeader->flags = (hasHitTest ? RESULT_FLAG_HAS_HIT_TEST : 0) |
+                        (hasSurfaceInputs ? RESULT_FLAG_HAS_SURFACE_INPUTS
+                                          : 0) |
+                        (float32Result ? RESULT_FLAG_FLOAT32_ITEMS : 0) |
+                        (vertexOutput != nullptr ? RESULT_FLAG_VERTEX_OUTPUT
+                                                 : 0) |
+                        (instanceOutput != nullptr ? RESULT_FLAG_INSTANCE_OUTPUT
+                                                   : 0) |
+                        (surfaceStream ? RESULT_FLAG_SURFACE_STREAM : 0);
 
-  *out = maxDepth;
   return true;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////
-
 extern "C" {
 
 EMSCRIPTEN_KEEPALIVE bool projectLngLatToClipSpace(double lng,
@@ -2552,8 +4993,14 @@ EMSCRIPTEN_KEEPALIVE bool calculateSurfaceDepthKey(double baseLng,
                                     out);
 }
 
-EMSCRIPTEN_KEEPALIVE bool
-prepareDrawSpriteImages(const double* paramsPtr, double* resultPtr) {
+/**
+ * @brief Validates a marshalled input buffer and runs the prepare pipeline,
+ * optionally evaluating sprite location interpolations on the way.
+ */
+static bool prepareMarshalledSpriteImages(
+    const double* paramsPtr,
+    const SpriteLocationInterpolations* interpolations,
+    double* resultPtr) {
   if (paramsPtr == nullptr || resultPtr == nullptr) {
     return false;
   }
@@ -2639,173 +5086,410 @@ prepareDrawSpriteImages(const double* paramsPtr, double* resultPtr) {
   const FrameConstants frame = readFrameConstants(
       frameConstPtr, frameConstCount);
 
-  const double* mercatorMatrix = matrixPtr;
-  const double* pixelMatrix = matrixPtr + 16;
-  const double* pixelMatrixInverse = matrixPtr + 32;
+  g_frameArena.beginFrame();
+  const auto* resourceEntries =
+      reinterpret_cast<const InputResourceEntry*>(resourcePtr);
+  const FrameVector<ResourceInfo> resources =
+      buildResourceInfos(resourceEntries, resourceCount);
+
+  return prepareDrawSpriteImagesCore(frame,
+                                     matrixPtr,
+                                     static_cast<int>(header->flags),
+                                     header->cullGuardBandPixels,
+                                     resources,
+                                     spriteCount,
+                                     reinterpret_cast<const InputItemEntry*>(
+                                         itemPtr),
+                                     itemCount,
+                                     interpolations,
+                                     resultPtr,
+                                     resolveVertexOutput(header, itemCount),
+                                     resolveInstanceOutput(header, itemCount));
+}
 
-  ProjectionContext projectionContext;
-  projectionContext.worldSize = frame.worldSize;
-  projectionContext.cameraToCenterDistance = frame.cameraToCenterDistance;
-  projectionContext.mercatorMatrix = mercatorMatrix;
-  projectionContext.pixelMatrix = pixelMatrix;
-  projectionContext.pixelMatrixInverse = pixelMatrixInverse;
+EMSCRIPTEN_KEEPALIVE bool
+prepareDrawSpriteImages(const double* paramsPtr, double* resultPtr) {
+  return prepareMarshalledSpriteImages(paramsPtr, nullptr, resultPtr);
+}
 
-  const bool clipContextAvailable =
-      frame.drawingBufferWidth > 0.0 && frame.drawingBufferHeight > 0.0 &&
-      frame.pixelRatio != 0.0 && std::isfinite(frame.pixelRatio) &&
-      mercatorMatrix != nullptr;
+/**
+ * @brief prepareDrawSpriteImages with sprite location interpolations fused
+ * into the sprite projection pass.
+ *
+ * `interpolationParamsPtr` holds a count followed by
+ * PREPARE_SPRITE_INTERPOLATION_ITEM_LENGTH entries (sprite handle, then the
+ * evaluateSpriteInterpolations item layout). Each interpolated sprite is
+ * evaluated and projected in the same worker slice, so the item table may
+ * carry stale locations for them. `interpolationResultPtr` receives the count
+ * and one evaluateSpriteInterpolations result record per entry.
+ */
+EMSCRIPTEN_KEEPALIVE bool
+prepareInterpolatedSpriteImages(const double* paramsPtr,
+                                const double* interpolationParamsPtr,
+                                double* interpolationResultPtr,
+                                double* resultPtr) {
+  if (interpolationParamsPtr == nullptr || interpolationResultPtr == nullptr) {
+    return false;
+  }
+  SpriteLocationInterpolations interpolations;
+  if (!convertToSizeT(interpolationParamsPtr[0], interpolations.count)) {
+    return false;
+  }
+  interpolations.entries =
+      interpolationParamsPtr + INTERPOLATION_BATCH_HEADER_LENGTH;
+  interpolations.results =
+      interpolationResultPtr + INTERPOLATION_BATCH_HEADER_LENGTH;
+  interpolationResultPtr[0] = static_cast<double>(interpolations.count);
+  return prepareMarshalledSpriteImages(paramsPtr, &interpolations, resultPtr);
+}
 
-  const int inputFlags = static_cast<int>(header->flags);
-  const bool useShaderSurfaceGeometry =
-      (inputFlags & INPUT_FLAG_USE_SHADER_SURFACE_GEOMETRY) != 0;
-  const bool useShaderBillboardGeometry =
-      (inputFlags & INPUT_FLAG_USE_SHADER_BILLBOARD_GEOMETRY) != 0;
-  const bool enableSurfaceBias =
-      (inputFlags & INPUT_FLAG_ENABLE_NDC_BIAS_SURFACE) != 0 &&
-      frame.enableNdcBiasSurface;
+//////////////////////////////////////////////////////////////////////////////////////
+// Depth sort
 
-  const auto* resourceEntries =
-      reinterpret_cast<const InputResourceEntry*>(resourcePtr);
-  std::vector<ResourceInfo> resources(resourceCount);
-  for (std::size_t i = 0; i < resourceCount; ++i) {
-    const auto& entry = resourceEntries[i];
-    ResourceInfo info;
-    info.handle = i;
-    info.width = entry.width;
-    info.height = entry.height;
-    info.textureReady = entry.textureReady != 0.0;
-    info.atlasPageIndex = entry.atlasPageIndex;
-    info.atlasU0 = entry.atlasU0;
-    info.atlasV0 = entry.atlasV0;
-    info.atlasU1 = entry.atlasU1;
-    info.atlasV1 = entry.atlasV1;
-    if (!std::isfinite(info.atlasU0)) {
-      info.atlasU0 = 0.0;
-    }
-    if (!std::isfinite(info.atlasV0)) {
-      info.atlasV0 = 0.0;
-    }
-    if (!std::isfinite(info.atlasU1)) {
-      info.atlasU1 = 1.0;
-    }
-    if (!std::isfinite(info.atlasV1)) {
-      info.atlasV1 = 1.0;
-    }
-    resources[i] = info;
+constexpr std::size_t DEPTH_SORT_HEADER_LENGTH = 2;
+constexpr std::size_t DEPTH_SORT_KEY_STRIDE = 4;
+
+/**
+ * @brief Sorts depth keys with the same routine as the prepare pipeline.
+ *
+ * Layout: [count, mode (DepthSortMode), count * (depthKey, order,
+ * spriteHandle, imageHandle)]. Writes the sorted input indices to
+ * `resultPtr` (count elements). Temporal mode keeps its own history, separate
+ * from the prepare pass and getTemporalDepthSortStats.
+ */
+EMSCRIPTEN_KEEPALIVE bool sortDepthKeys(const double* paramsPtr,
+                                        double* resultPtr) {
+  if (paramsPtr == nullptr || resultPtr == nullptr) {
+    return false;
+  }
+  std::size_t count = 0;
+  if (!convertToSizeT(paramsPtr[0], count)) {
+    return false;
+  }
+  std::size_t mode = 0;
+  if (!convertToSizeT(paramsPtr[1], mode) ||
+      mode > static_cast<std::size_t>(DepthSortMode::Temporal)) {
+    return false;
   }
 
-  const auto* itemEntries = reinterpret_cast<const InputItemEntry*>(itemPtr);
-  std::vector<BucketItem> bucketItems(itemCount);
-  for (std::size_t i = 0; i < itemCount; ++i) {
-    BucketItem bucket;
-    bucket.entry = &itemEntries[i];
-    bucket.index = i;
-    bucket.resource =
-        findResourceByHandle(resources, bucket.entry->resourceHandle);
-    bucket.spriteLocation = {bucket.entry->spriteLng,
-                             bucket.entry->spriteLat,
-                             bucket.entry->spriteZ};
-    bucket.projectedValid =
-        projectSpritePoint(projectionContext, bucket.spriteLocation,
-                           bucket.projected);
-    bucket.hasMercator =
-        calculateMercatorCoordinate(bucket.spriteLocation, bucket.mercator);
-    if (!convertToInt64(bucket.entry->spriteHandle, bucket.spriteHandle)) {
-      bucket.spriteHandle = 0;
+  FrameVector<DepthSortKey> keys(count);
+  const double* cursor = paramsPtr + DEPTH_SORT_HEADER_LENGTH;
+  for (std::size_t i = 0; i < count; ++i) {
+    const double* entry = cursor + i * DEPTH_SORT_KEY_STRIDE;
+    DepthSortKey& key = keys[i];
+    key.depthKey = entry[0];
+    key.order = entry[1];
+    if (!convertToInt64(entry[2], key.spriteHandle)) {
+      return false;
     }
-    const double resolvedRotate = resolveTotalRotateDeg(*bucket.entry);
-    bucket.rotation = buildRotationCache(resolvedRotate);
-    bucketItems[i] = bucket;
+    key.imageHandle = entry[3];
   }
 
-  precomputeBucketCenters(bucketItems,
-                          projectionContext,
-                          frame,
-                          clipContextAvailable);
+  FrameVector<std::size_t> sortedOrder;
+  sortDepthKeysWithMode(keys,
+                        static_cast<DepthSortMode>(mode),
+                        g_standaloneDepthSorter,
+                        sortedOrder);
+  for (std::size_t i = 0; i < count; ++i) {
+    resultPtr[i] = static_cast<double>(sortedOrder[i]);
+  }
+  return true;
+}
 
-  DepthCollectionResult depthResult = collectDepthSortedItemsInternal(
-      bucketItems,
-      projectionContext,
-      frame,
-      clipContextAvailable,
-      enableSurfaceBias);
+constexpr std::size_t TEMPORAL_DEPTH_SORT_STATS_LENGTH = 6;
 
-  const std::size_t depthCount = depthResult.items.size();
-  std::vector<double> stagedResults(depthCount * RESULT_ITEM_STRIDE, 0.0);
-  std::vector<uint8_t> preparedFlags(depthCount, 0);
-  std::vector<uint8_t> hitTestFlags(depthCount, 0);
-  std::vector<uint8_t> surfaceFlags(depthCount, 0);
-
-  auto prepareRange = [&](std::size_t start, std::size_t end) {
-    if (start >= depthCount) {
-      return;
-    }
-    end = std::min(end, depthCount);
-    double* stagedBase = stagedResults.data();
-    for (std::size_t idx = start; idx < end; ++idx) {
-      const DepthItem& depth = depthResult.items[idx];
-      double* itemBase = stagedBase + idx * RESULT_ITEM_STRIDE;
-      bool itemHasHitTest = false;
-      bool itemHasSurfaceInputs = false;
-      if (prepareDrawSpriteImageInternal(depth,
-                                         projectionContext,
-                                         frame,
-                                         clipContextAvailable,
-                                         useShaderBillboardGeometry,
-                                         useShaderSurfaceGeometry,
-                                         bucketItems,
-                                         itemBase,
-                                         itemHasHitTest,
-                                         itemHasSurfaceInputs)) {
-        preparedFlags[idx] = 1;
-        if (itemHasHitTest) {
-          hitTestFlags[idx] = 1;
-        }
-        if (itemHasSurfaceInputs) {
-          surfaceFlags[idx] = 1;
-        }
-      }
-    }
-  };
+/**
+ * @brief Enables the temporal depth sort for prepare calls.
+ *
+ * Toggling clears the kept order and the counters.
+ */
+EMSCRIPTEN_KEEPALIVE void setTemporalDepthSortEnabled(bool enabled) {
+  g_temporalDepthSortEnabled = enabled;
+  g_temporalDepthSorter.reset();
+}
 
-  const std::size_t prepareWorkerCount =
-      determinePrepareWorkerCount(depthCount);
-  if (prepareWorkerCount <= 1 || depthCount == 0) {
-    prepareRange(0, depthCount);
-  } else {
-    runWorkerJobs(prepareWorkerCount, depthCount,
-                  [&](std::size_t start, std::size_t end, std::size_t) {
-                    prepareRange(start, end);
-                  });
+/**
+ * @brief Writes the temporal depth sort counters.
+ *
+ * Layout (TEMPORAL_DEPTH_SORT_STATS_LENGTH): frames, fastPathHits,
+ * inversionFallbacks, coldFrames, lastMoves, lastFreshItems.
+ */
+EMSCRIPTEN_KEEPALIVE bool getTemporalDepthSortStats(double* resultPtr) {
+  if (resultPtr == nullptr) {
+    return false;
   }
+  const TemporalDepthSortStats& stats = g_temporalDepthSorter.stats();
+  resultPtr[0] = static_cast<double>(stats.frames);
+  resultPtr[1] = static_cast<double>(stats.fastPathHits);
+  resultPtr[2] = static_cast<double>(stats.inversionFallbacks);
+  resultPtr[3] = static_cast<double>(stats.coldFrames);
+  resultPtr[4] = static_cast<double>(stats.lastMoves);
+  resultPtr[5] = static_cast<double>(stats.lastFreshItems);
+  return true;
+}
 
-  double* writePtr = resultPtr + RESULT_HEADER_LENGTH;
-  std::size_t preparedCount = 0;
-  bool hasHitTest = false;
-  bool hasSurfaceInputs = false;
+//////////////////////////////////////////////////////////////////////////////////////
+// Frame arena
 
-  for (std::size_t idx = 0; idx < depthCount; ++idx) {
-    if (preparedCount >= itemCount) {
-      break;
-    }
-    if (preparedFlags[idx] == 0) {
-      continue;
-    }
-    double* stagedBase = stagedResults.data() + idx * RESULT_ITEM_STRIDE;
-    double* dest = writePtr + preparedCount * RESULT_ITEM_STRIDE;
-    std::memcpy(dest,
-                stagedBase,
-                sizeof(double) * RESULT_ITEM_STRIDE);
-    preparedCount += 1;
-    hasHitTest = hasHitTest || (hitTestFlags[idx] != 0);
-    hasSurfaceInputs = hasSurfaceInputs || (surfaceFlags[idx] != 0);
+constexpr std::size_t FRAME_ARENA_STATS_LENGTH = 7;
+
+/**
+ * @brief Reports per-frame arena usage, for sizing WASM_PTHREAD_MEMORY_MB.
+ *
+ * Layout (FRAME_ARENA_STATS_LENGTH): frames, slabCount, reservedBytes,
+ * highWaterBytes, lastFrameBytes, peakFrameBytes, blockAllocations.
+ * `blockAllocations` stops growing once the slabs have settled on the
+ * workload.
+ */
+EMSCRIPTEN_KEEPALIVE bool getFrameArenaStats(double* resultPtr) {
+  if (resultPtr == nullptr) {
+    return false;
   }
+  const FrameArena::Stats stats = g_frameArena.stats();
+  resultPtr[0] = static_cast<double>(stats.frames);
+  resultPtr[1] = static_cast<double>(stats.slabCount);
+  resultPtr[2] = static_cast<double>(stats.reservedBytes);
+  resultPtr[3] = static_cast<double>(stats.highWaterBytes);
+  resultPtr[4] = static_cast<double>(stats.lastFrameBytes);
+  resultPtr[5] = static_cast<double>(stats.peakFrameBytes);
+  resultPtr[6] = static_cast<double>(stats.blockAllocations);
+  return true;
+}
 
-  resultHeader->preparedCount = static_cast<double>(preparedCount);
-  resultHeader->flags = (hasHitTest ? RESULT_FLAG_HAS_HIT_TEST : 0) |
-                        (hasSurfaceInputs ? RESULT_FLAG_HAS_SURFACE_INPUTS
-                                          : 0);
+//////////////////////////////////////////////////////////////////////////////////////
+// Resident sprite store
+
+EMSCRIPTEN_KEEPALIVE bool upsertResidentResources(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentSpriteStore.upsertResources(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool upsertResidentSprites(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentSpriteStore.upsertSprites(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool removeResidentSprites(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentSpriteStore.removeSprites(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool upsertResidentImages(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentSpriteStore.upsertImages(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool removeResidentImages(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentSpriteStore.removeImages(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool patchResidentImages(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentSpriteStore.patchImages(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE void clearResidentStore() {
+  g_residentSpriteStore.clear();
+  g_residentInterpolations.clear();
+}
+
+EMSCRIPTEN_KEEPALIVE int getResidentImageCount() {
+  return static_cast<int>(g_residentSpriteStore.imageCount());
+}
+
+EMSCRIPTEN_KEEPALIVE bool
+upsertResidentLocationInterpolations(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentInterpolations.upsertLocations(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool
+upsertResidentChannelInterpolations(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentInterpolations.upsertChannels(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE bool cancelResidentInterpolations(const double* paramsPtr) {
+  std::size_t count = 0;
+  if (!readResidentBatchCount(paramsPtr, count)) {
+    return false;
+  }
+  return g_residentInterpolations.cancel(
+      paramsPtr + RESIDENT_BATCH_HEADER_LENGTH, count);
+}
+
+EMSCRIPTEN_KEEPALIVE int getResidentInterpolationCount() {
+  return static_cast<int>(g_residentInterpolations.trackCount());
+}
 
+/**
+ * @brief Advances the resident interpolations to `timestamp` (the current time
+ * when not finite) and writes them into the resident store. `resultPtr` must
+ * have room for the finished count plus `getResidentInterpolationCount()`
+ * keys.
+ */
+EMSCRIPTEN_KEEPALIVE bool advanceResidentInterpolations(double timestamp,
+                                                        double* resultPtr) {
+  if (resultPtr == nullptr) {
+    return false;
+  }
+  const double resolvedTimestamp =
+      std::isfinite(timestamp) ? timestamp : emscripten_get_now();
+  const std::size_t finishedCount = g_residentInterpolations.advance(
+      resolvedTimestamp,
+      g_residentSpriteStore,
+      resultPtr + RESIDENT_BATCH_HEADER_LENGTH);
+  resultPtr[0] = static_cast<double>(finishedCount);
   return true;
 }
+
+/**
+ * @brief Prepares the resident store. `paramsPtr` only needs the input header,
+ * frame constants and matrices; resource/sprite/item spans are ignored.
+ * `resultPtr` must have room for `getResidentImageCount()` items.
+ */
+EMSCRIPTEN_KEEPALIVE bool
+prepareResidentSpriteImages(const double* paramsPtr, double* resultPtr) {
+  if (paramsPtr == nullptr || resultPtr == nullptr) {
+    return false;
+  }
+
+  initializeResultHeader(resultPtr);
+
+  const InputBufferHeader* header = AsInputHeader(paramsPtr);
+
+  std::size_t totalLength = 0;
+  if (!convertToSizeT(header->totalLength, totalLength)) {
+    return false;
+  }
+  if (totalLength < INPUT_HEADER_LENGTH) {
+    return false;
+  }
+
+  std::size_t frameConstCount = 0;
+  if (!convertToSizeT(header->frameConstCount, frameConstCount)) {
+    return false;
+  }
+  if (frameConstCount != INPUT_FRAME_CONSTANT_LENGTH) {
+    return false;
+  }
+  if (!validateSpan(totalLength, INPUT_HEADER_LENGTH, frameConstCount)) {
+    return false;
+  }
+
+  std::size_t matrixOffset = 0;
+  if (!convertToSizeT(header->matrixOffset, matrixOffset)) {
+    return false;
+  }
+  if (!validateSpan(totalLength, matrixOffset, INPUT_MATRIX_LENGTH)) {
+    return false;
+  }
+
+  const FrameConstants frame = readFrameConstants(
+      paramsPtr + INPUT_HEADER_LENGTH, frameConstCount);
+
+  g_frameArena.beginFrame();
+  const std::vector<InputResourceEntry>& resourceEntries =
+      g_residentSpriteStore.resources();
+  const FrameVector<ResourceInfo> resources =
+      buildResourceInfos(resourceEntries.data(), resourceEntries.size());
+  const std::vector<InputItemEntry>& images =
+      g_residentSpriteStore.resolveImages();
+  const double* matrixPtr = paramsPtr + matrixOffset;
+  const int inputFlags = static_cast<int>(header->flags);
+
+  if ((inputFlags & INPUT_FLAG_ENABLE_VIEWPORT_CULLING) != 0) {
+    // Only images in grid cells that may reach the viewport enter the
+    // pipeline; the per-item test then runs on them as usual.
+    const ProjectionContext projectionContext =
+        createProjectionContext(frame, matrixPtr);
+    SpatialGridCullContext cullContext;
+    if (buildSpatialGridCullContext(projectionContext,
+                                    frame,
+                                    header->cullGuardBandPixels,
+                                    resources,
+                                    cullContext)) {
+      FrameVector<std::size_t> slots(g_frameArena.mainAllocator<std::size_t>());
+      slots.reserve(images.size());
+      g_residentSpriteStore.collectSpatialCandidates(
+          [&](const SpatialGridExtent& extent,
+              double minX,
+              double minY,
+              double maxX,
+              double maxY) {
+            return isSpatialGridCellVisible(
+                cullContext, extent, minX, minY, maxX, maxY);
+          },
+          slots);
+      const FrameVector<InputItemEntry> candidates =
+          gatherResidentImages(images, slots);
+      if (!prepareDrawSpriteImagesCore(frame,
+                                       matrixPtr,
+                                       inputFlags,
+                                       header->cullGuardBandPixels,
+                                       resources,
+                                       0,
+                                       candidates.data(),
+                                       candidates.size(),
+                                       nullptr,
+                                       resultPtr,
+                                       resolveVertexOutput(
+                                           header, candidates.size()),
+                                       resolveInstanceOutput(
+                                           header, candidates.size()))) {
+        return false;
+      }
+      AsResultHeader(resultPtr)->culledCount +=
+          static_cast<double>(images.size() - candidates.size());
+      return true;
+    }
+  }
+
+  return prepareDrawSpriteImagesCore(frame,
+                                     matrixPtr,
+                                     inputFlags,
+                                     header->cullGuardBandPixels,
+                                     resources,
+                                     0,
+                                     images.data(),
+                                     images.size(),
+                                     nullptr,
+                                     resultPtr,
+                                     resolveVertexOutput(header, images.size()),
+                                     resolveInstanceOutput(header,
+                                                           images.size()));
+}
 } // extern "C"
@@ -10,6 +10,7 @@
 
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 
 static inline double normalizeAngleDeg(double angle) {
   if (!std::isfinite(angle)) {
@@ -42,4 +43,20 @@ static inline bool convertToSizeT(double value, std::size_t& out) {
   return true;
 }
 
+static inline bool convertToInt64(double value, int64_t& out) {
+  if (!std::isfinite(value)) {
+    return false;
+  }
+  const double truncated = std::trunc(value);
+  if (!std::isfinite(truncated)) {
+    return false;
+  }
+  const auto candidate = static_cast<int64_t>(truncated);
+  if (static_cast<double>(candidate) != truncated) {
+    return false;
+  }
+  out = candidate;
+  return true;
+}
+
 #endif
@@ -21,7 +21,7 @@ constexpr std::size_t RESOURCE_STRIDE = 9;
 constexpr std::size_t SPRITE_STRIDE = 6;
 constexpr std::size_t ITEM_STRIDE = 27;
 
-constexpr std::size_t RESULT_HEADER_LENGTH = 7;
+constexpr std::size_t RESULT_HEADER_LENGTH = 13;
 constexpr std::size_t RESULT_VERTEX_COMPONENT_LENGTH = 36;
 constexpr std::size_t RESULT_HIT_TEST_COMPONENT_LENGTH = 8;
 constexpr std::size_t RESULT_COMMON_ITEM_LENGTH = 20;
@@ -30,6 +30,85 @@ constexpr std::size_t RESULT_ITEM_STRIDE =
     RESULT_COMMON_ITEM_LENGTH + RESULT_VERTEX_COMPONENT_LENGTH +
     RESULT_HIT_TEST_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH;
 
+// Absolute coordinates inside the surface block: the mercator center, the
+// base and displaced lng/lat, and four (east, north, lng, lat) corner models.
+constexpr std::size_t RESULT_SURFACE_MERCATOR_CENTER_OFFSET = 0;
+constexpr std::size_t RESULT_SURFACE_BASE_LNG_LAT_OFFSET = 45;
+constexpr std::size_t RESULT_SURFACE_DISPLACED_CENTER_OFFSET = 48;
+constexpr std::size_t RESULT_SURFACE_CORNER_MODEL_OFFSET = 52;
+constexpr std::size_t RESULT_SURFACE_CORNER_MODEL_STRIDE = 4;
+
+static_assert(RESULT_SURFACE_CORNER_MODEL_OFFSET +
+                  4 * RESULT_SURFACE_CORNER_MODEL_STRIDE ==
+              RESULT_SURFACE_BLOCK_LENGTH);
+
+// Float32 result items (INPUT_FLAG_FLOAT32_RESULT): every component as
+// float32, with the three leading ids stored as int32. The absolute surface
+// coordinates are stored relative to the anchor in the result header so they
+// keep their precision at high zoom. Strides count doubles.
+constexpr std::size_t RESULT_ID_COMPONENT_LENGTH = 3;
+constexpr std::size_t RESULT_FLOAT32_COMPONENT_LENGTH =
+    RESULT_COMMON_ITEM_LENGTH + RESULT_VERTEX_COMPONENT_LENGTH +
+    RESULT_HIT_TEST_COMPONENT_LENGTH;
+constexpr std::size_t RESULT_FLOAT32_ITEM_STRIDE =
+    (RESULT_FLOAT32_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH) / 2;
+
+static_assert((RESULT_FLOAT32_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH) %
+                  2 ==
+              0);
+
+// Surface stream (INPUT_FLAG_SURFACE_STREAM): items stop carrying the surface
+// block, and only items with surface shader inputs get a record in a separate
+// stream described by the result header. A record starts with the index of its
+// item, followed by the surface block. Strides count doubles. The result
+// buffer needs room for every item plus one record per surface-mode item.
+constexpr std::size_t RESULT_STREAM_ITEM_STRIDE =
+    RESULT_COMMON_ITEM_LENGTH + RESULT_VERTEX_COMPONENT_LENGTH +
+    RESULT_HIT_TEST_COMPONENT_LENGTH;
+constexpr std::size_t RESULT_FLOAT32_STREAM_ITEM_STRIDE =
+    RESULT_FLOAT32_COMPONENT_LENGTH / 2;
+constexpr std::size_t RESULT_SURFACE_RECORD_STRIDE =
+    1 + RESULT_SURFACE_BLOCK_LENGTH;
+// int32 item index, float32 block, one float of padding.
+constexpr std::size_t RESULT_FLOAT32_SURFACE_RECORD_STRIDE =
+    (1 + RESULT_SURFACE_BLOCK_LENGTH + 1) / 2;
+
+static_assert(RESULT_FLOAT32_COMPONENT_LENGTH % 2 == 0);
+
+// Vertex output (INPUT_FLAG_VERTEX_OUTPUT): the vertices only go to the
+// output region, so items drop the vertex block. Each layout above has a
+// vertexless counterpart; the result header carries the stride in use.
+constexpr std::size_t RESULT_VERTEXLESS_COMPONENT_LENGTH =
+    RESULT_COMMON_ITEM_LENGTH + RESULT_HIT_TEST_COMPONENT_LENGTH;
+constexpr std::size_t RESULT_VERTEXLESS_ITEM_STRIDE =
+    RESULT_VERTEXLESS_COMPONENT_LENGTH + RESULT_SURFACE_BLOCK_LENGTH;
+constexpr std::size_t RESULT_FLOAT32_VERTEXLESS_ITEM_STRIDE =
+    RESULT_VERTEXLESS_ITEM_STRIDE / 2;
+constexpr std::size_t RESULT_VERTEXLESS_STREAM_ITEM_STRIDE =
+    RESULT_VERTEXLESS_COMPONENT_LENGTH;
+constexpr std::size_t RESULT_FLOAT32_VERTEXLESS_STREAM_ITEM_STRIDE =
+    RESULT_VERTEXLESS_COMPONENT_LENGTH / 2;
+
+static_assert(RESULT_VERTEXLESS_COMPONENT_LENGTH % 2 == 0);
+static_assert(RESULT_VERTEXLESS_ITEM_STRIDE % 2 == 0);
+
+// Instance records (INPUT_FLAG_INSTANCE_OUTPUT): one float32 record per
+// prepared item in result order. Billboards drawn by the shader only need
+// these fields; the corner template and triangle expansion are static.
+constexpr std::size_t RESULT_INSTANCE_RECORD_LENGTH = 16;
+constexpr std::size_t RESULT_INSTANCE_CENTER_OFFSET = 0;      // x, y
+constexpr std::size_t RESULT_INSTANCE_HALF_SIZE_OFFSET = 2;   // width, height
+constexpr std::size_t RESULT_INSTANCE_ANCHOR_OFFSET = 4;      // x, y
+constexpr std::size_t RESULT_INSTANCE_SIN_COS_OFFSET = 6;     // sin, cos
+constexpr std::size_t RESULT_INSTANCE_UV_RECT_OFFSET = 8;     // u0, v0, u1, v1
+constexpr std::size_t RESULT_INSTANCE_OPACITY_OFFSET = 12;
+constexpr std::size_t RESULT_INSTANCE_ATLAS_PAGE_OFFSET = 13;
+constexpr std::size_t RESULT_INSTANCE_BILLBOARD_OFFSET = 14;  // 1 when drawable
+// Slot 15 is padding that keeps records 16-byte aligned.
+
+constexpr int32_t SPRITE_ORIGIN_REFERENCE_INDEX_NONE = -1;
+constexpr int32_t SPRITE_ORIGIN_REFERENCE_KEY_NONE = -1;
+
 ////////////////////////////////////////////////////////////////////////////////
 // Input buffer layout
 
@@ -44,11 +123,11 @@ struct InputBufferHeader {
   double itemCount;
   double itemOffset;
   double flags;
-  double reserved0;
-  double reserved1;
-  double reserved2;
-  double reserved3;
-  double reserved4;
+  double cullGuardBandPixels;  // With INPUT_FLAG_ENABLE_VIEWPORT_CULLING
+  double vertexOutputPtr;  // With INPUT_FLAG_VERTEX_OUTPUT
+  double vertexOutputCapacity;  // float32 elements
+  double instanceOutputPtr;  // With INPUT_FLAG_INSTANCE_OUTPUT
+  double instanceOutputCapacity;  // float32 elements
 };
 
 static_assert(sizeof(InputBufferHeader) == INPUT_HEADER_LENGTH * sizeof(double));
@@ -127,8 +206,16 @@ struct ResultBufferHeader {
   double vertexComponentCount;
   double surfaceCornerCount;
   double flags;
-  double reserved0;
-  double reserved1;
+  double culledCount;
+  // Relative-to-center anchor, with INPUT_FLAG_FLOAT32_RESULT
+  double anchorMercatorX;
+  double anchorMercatorY;
+  double anchorLng;
+  double anchorLat;
+  // Surface stream, with INPUT_FLAG_SURFACE_STREAM
+  double surfaceCount;
+  double surfaceOffset;  // doubles from the start of the result buffer
+  double surfaceStride;
 };
 
 static_assert(sizeof(ResultBufferHeader) == RESULT_HEADER_LENGTH * sizeof(double));
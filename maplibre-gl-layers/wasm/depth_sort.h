@@ -0,0 +1,670 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _DEPTH_SORT_H
+#define _DEPTH_SORT_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "frame_arena.h"
+#include "worker_jobs.h"
+
+/**
+ * @brief Sort key of one depth item, compared in field order.
+ */
+struct DepthSortKey {
+  double depthKey = 0.0;
+  double order = 0.0;
+  int64_t spriteHandle = 0;
+  double imageHandle = 0.0;
+};
+
+/**
+ * @brief Depth ordering used for draw submission (back to front).
+ */
+static inline bool lessDepthSortKey(const DepthSortKey& a,
+                                    const DepthSortKey& b) {
+  if (a.depthKey != b.depthKey) {
+    return a.depthKey < b.depthKey;
+  }
+  if (a.order != b.order) {
+    return a.order < b.order;
+  }
+  if (a.spriteHandle != b.spriteHandle) {
+    return a.spriteHandle < b.spriteHandle;
+  }
+  return a.imageHandle < b.imageHandle;
+}
+
+/**
+ * @brief Total order over key indices: equal keys keep their input order.
+ */
+static inline bool lessDepthSortEntry(const FrameVector<DepthSortKey>& keys,
+                                      std::size_t a,
+                                      std::size_t b) {
+  if (lessDepthSortKey(keys[a], keys[b])) {
+    return true;
+  }
+  if (lessDepthSortKey(keys[b], keys[a])) {
+    return false;
+  }
+  return a < b;
+}
+
+enum class DepthSortMode : int {
+  Auto = 0,
+  Comparison = 1,
+  Radix = 2,
+  // Repairs the previous frame's order; see TemporalDepthSorter.
+  Temporal = 3,
+};
+
+constexpr std::size_t DEPTH_RADIX_SORT_MIN_ITEMS = 1024;
+constexpr std::size_t DEPTH_RADIX_PARALLEL_MIN_ITEMS = 32768;
+constexpr std::size_t DEPTH_RADIX_PARALLEL_SLICE = 16384;
+constexpr unsigned DEPTH_RADIX_DIGIT_BITS = 11;
+constexpr std::size_t DEPTH_RADIX_BUCKETS = std::size_t{1} << DEPTH_RADIX_DIGIT_BITS;
+
+constexpr uint64_t DEPTH_RADIX_SIGN_BIT = uint64_t{1} << 63;
+// Largest magnitude where every integer is exactly representable as double.
+constexpr double DEPTH_RADIX_MAX_EXACT_INTEGER = 9007199254740992.0;
+
+/**
+ * @brief Maps a double onto uint64 so unsigned order matches `<`.
+ *
+ * -0.0 is folded onto +0.0 because the comparator treats them as equal.
+ */
+static inline uint64_t encodeOrderedDouble(double value) {
+  if (value == 0.0) {
+    value = 0.0;
+  }
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return (bits & DEPTH_RADIX_SIGN_BIT) != 0 ? ~bits
+                                            : (bits | DEPTH_RADIX_SIGN_BIT);
+}
+
+static inline uint64_t encodeOrderedInt64(int64_t value) {
+  return static_cast<uint64_t>(value) ^ DEPTH_RADIX_SIGN_BIT;
+}
+
+static inline unsigned countSignificantBits(uint64_t value) {
+  unsigned bits = 0;
+  while (value != 0) {
+    value >>= 1;
+    ++bits;
+  }
+  return bits;
+}
+
+/**
+ * @brief Order-preserving encoding for one secondary double column.
+ *
+ * Integral columns (order, image handles) are encoded as integers so their
+ * value range stays narrow; anything else falls back to the float bits.
+ */
+struct DepthRadixColumn {
+  bool integral = true;
+  uint64_t minCode = std::numeric_limits<uint64_t>::max();
+  uint64_t maxCode = 0;
+  unsigned bits = 0;
+
+  static inline bool isExactInteger(double value) {
+    return std::fabs(value) <= DEPTH_RADIX_MAX_EXACT_INTEGER &&
+           std::trunc(value) == value;
+  }
+
+  inline uint64_t encode(double value) const {
+    return integral ? encodeOrderedInt64(static_cast<int64_t>(value))
+                    : encodeOrderedDouble(value);
+  }
+
+  inline void include(uint64_t code) {
+    minCode = std::min(minCode, code);
+    maxCode = std::max(maxCode, code);
+  }
+
+  inline void finish(std::size_t count) {
+    if (count == 0) {
+      minCode = 0;
+      maxCode = 0;
+    }
+    bits = countSignificantBits(maxCode - minCode);
+  }
+};
+
+struct DepthRadixRecord {
+  uint64_t key = 0;
+  uint32_t index = 0;
+};
+
+/**
+ * @brief One stable counting pass over a DEPTH_RADIX_DIGIT_BITS digit.
+ *
+ * The input is split into `blockCount` fixed blocks; each block owns one
+ * histogram so the scatter is stable no matter which worker runs it.
+ * Returns false (and leaves `dst` untouched) when every record shares the
+ * digit, in which case the pass is a no-op.
+ */
+static inline bool radixSortPass(
+    const FrameVector<DepthRadixRecord>& src,
+    FrameVector<DepthRadixRecord>& dst,
+    unsigned shift,
+    std::size_t blockCount,
+    FrameVector<std::array<std::size_t, DEPTH_RADIX_BUCKETS>>& histograms) {
+  const std::size_t count = src.size();
+  const std::size_t blockSize = (count + blockCount - 1) / blockCount;
+  const auto digitOf = [shift](const DepthRadixRecord& record) {
+    return static_cast<std::size_t>((record.key >> shift) &
+                                    (DEPTH_RADIX_BUCKETS - 1));
+  };
+
+  runWorkerJobs(blockCount, blockCount,
+                [&](std::size_t startBlock, std::size_t endBlock, std::size_t) {
+                  for (std::size_t block = startBlock; block < endBlock;
+                       ++block) {
+                    auto& histogram = histograms[block];
+                    histogram.fill(0);
+                    const std::size_t start = block * blockSize;
+                    const std::size_t end = std::min(count, start + blockSize);
+                    for (std::size_t i = start; i < end; ++i) {
+                      ++histogram[digitOf(src[i])];
+                    }
+                  }
+                });
+
+  std::size_t running = 0;
+  for (std::size_t bucket = 0; bucket < DEPTH_RADIX_BUCKETS; ++bucket) {
+    std::size_t bucketTotal = 0;
+    for (std::size_t block = 0; block < blockCount; ++block) {
+      const std::size_t blockCountInBucket = histograms[block][bucket];
+      histograms[block][bucket] = running + bucketTotal;
+      bucketTotal += blockCountInBucket;
+    }
+    if (bucketTotal == count) {
+      return false;
+    }
+    running += bucketTotal;
+  }
+
+  runWorkerJobs(blockCount, blockCount,
+                [&](std::size_t startBlock, std::size_t endBlock, std::size_t) {
+                  for (std::size_t block = startBlock; block < endBlock;
+                       ++block) {
+                    auto& offsets = histograms[block];
+                    const std::size_t start = block * blockSize;
+                    const std::size_t end = std::min(count, start + blockSize);
+                    for (std::size_t i = start; i < end; ++i) {
+                      dst[offsets[digitOf(src[i])]++] = src[i];
+                    }
+                  }
+                });
+  return true;
+}
+
+static inline void sortDepthKeysByComparison(
+    const FrameVector<DepthSortKey>& keys,
+    FrameVector<std::size_t>& outOrder) {
+  outOrder.resize(keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    outOrder[i] = i;
+  }
+  std::sort(outOrder.begin(), outOrder.end(),
+            [&keys](std::size_t a, std::size_t b) {
+              return lessDepthSortEntry(keys, a, b);
+            });
+}
+
+/**
+ * @brief Packs order, sprite handle and image handle into one 64-bit key.
+ *
+ * Each field is rebased to its minimum and given only the bits its range
+ * needs. Returns false when the three ranges do not fit together.
+ */
+static inline bool packDepthSecondaryKeys(const FrameVector<DepthSortKey>& keys,
+                                          FrameVector<uint64_t>& outPacked) {
+  DepthRadixColumn orderColumn;
+  DepthRadixColumn imageColumn;
+  for (const DepthSortKey& key : keys) {
+    orderColumn.integral =
+        orderColumn.integral && DepthRadixColumn::isExactInteger(key.order);
+    imageColumn.integral = imageColumn.integral &&
+                           DepthRadixColumn::isExactInteger(key.imageHandle);
+  }
+  DepthRadixColumn spriteColumn;
+  for (const DepthSortKey& key : keys) {
+    orderColumn.include(orderColumn.encode(key.order));
+    spriteColumn.include(encodeOrderedInt64(key.spriteHandle));
+    imageColumn.include(imageColumn.encode(key.imageHandle));
+  }
+  orderColumn.finish(keys.size());
+  spriteColumn.finish(keys.size());
+  imageColumn.finish(keys.size());
+  if (orderColumn.bits + spriteColumn.bits + imageColumn.bits > 64) {
+    return false;
+  }
+
+  const unsigned spriteShift = imageColumn.bits;
+  const unsigned orderShift = imageColumn.bits + spriteColumn.bits;
+  outPacked.resize(keys.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    const DepthSortKey& key = keys[i];
+    uint64_t packed = imageColumn.encode(key.imageHandle) - imageColumn.minCode;
+    if (spriteColumn.bits > 0) {
+      packed |= (encodeOrderedInt64(key.spriteHandle) - spriteColumn.minCode)
+                << spriteShift;
+    }
+    if (orderColumn.bits > 0) {
+      packed |= (orderColumn.encode(key.order) - orderColumn.minCode)
+                << orderShift;
+    }
+    outPacked[i] = packed;
+  }
+  return true;
+}
+
+/**
+ * @brief LSD radix sort on depthKey, then tie resolution.
+ *
+ * depthKey is mapped to rebased order-preserving bits and radix sorted
+ * together with the input index (16-byte records); digits identical across
+ * all records are skipped. The stable sort leaves equal depth keys in input
+ * order, and those (usually short) runs are then ordered by the packed
+ * order/sprite/image key, or by the full comparator when the fields do not
+ * pack. Returns false for NaN keys so the caller can fall back.
+ */
+static inline bool sortDepthKeysByRadix(const FrameVector<DepthSortKey>& keys,
+                                        FrameVector<std::size_t>& outOrder) {
+  const std::size_t count = keys.size();
+  if (count > std::numeric_limits<uint32_t>::max()) {
+    return false;
+  }
+
+  uint64_t minCode = std::numeric_limits<uint64_t>::max();
+  uint64_t maxCode = 0;
+  for (const DepthSortKey& key : keys) {
+    if (std::isnan(key.depthKey) || std::isnan(key.order) ||
+        std::isnan(key.imageHandle)) {
+      return false;
+    }
+    const uint64_t code = encodeOrderedDouble(key.depthKey);
+    minCode = std::min(minCode, code);
+    maxCode = std::max(maxCode, code);
+  }
+  if (count == 0) {
+    minCode = 0;
+    maxCode = 0;
+  }
+  const unsigned primaryBits = countSignificantBits(maxCode - minCode);
+
+  // Scratch buffers share the output's allocator (the frame arena when the
+  // caller is the prepare pipeline).
+  const FrameAllocator<std::size_t> allocator = outOrder.get_allocator();
+  FrameVector<DepthRadixRecord> records(count, allocator);
+  const std::size_t workerCount = determineWorkerCount(
+      count, DEPTH_RADIX_PARALLEL_MIN_ITEMS, DEPTH_RADIX_PARALLEL_SLICE);
+  runWorkerJobs(workerCount, count,
+                [&](std::size_t start, std::size_t end, std::size_t) {
+                  for (std::size_t i = start; i < end; ++i) {
+                    records[i].key =
+                        encodeOrderedDouble(keys[i].depthKey) - minCode;
+                    records[i].index = static_cast<uint32_t>(i);
+                  }
+                });
+
+  const std::size_t blockCount = std::max<std::size_t>(1, workerCount);
+  FrameVector<std::array<std::size_t, DEPTH_RADIX_BUCKETS>> histograms(
+      blockCount, allocator);
+  FrameVector<DepthRadixRecord> scratch(count, allocator);
+  for (unsigned shift = 0; shift < primaryBits;
+       shift += DEPTH_RADIX_DIGIT_BITS) {
+    if (radixSortPass(records, scratch, shift, blockCount, histograms)) {
+      records.swap(scratch);
+    }
+  }
+
+  outOrder.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    outOrder[i] = records[i].index;
+  }
+
+  FrameVector<uint64_t> packed(allocator);
+  bool packedReady = false;
+  bool packable = false;
+  std::size_t runStart = 0;
+  while (runStart < count) {
+    std::size_t runEnd = runStart + 1;
+    while (runEnd < count && records[runEnd].key == records[runStart].key) {
+      ++runEnd;
+    }
+    if (runEnd - runStart > 1) {
+      if (!packedReady) {
+        packable = packDepthSecondaryKeys(keys, packed);
+        packedReady = true;
+      }
+      const auto runBegin = outOrder.begin() + runStart;
+      const auto runFinish = outOrder.begin() + runEnd;
+      if (packable) {
+        std::sort(runBegin, runFinish, [&packed](std::size_t a, std::size_t b) {
+          return packed[a] != packed[b] ? packed[a] < packed[b] : a < b;
+        });
+      } else {
+        std::sort(runBegin, runFinish, [&keys](std::size_t a, std::size_t b) {
+          return lessDepthSortEntry(keys, a, b);
+        });
+      }
+    }
+    runStart = runEnd;
+  }
+  return true;
+}
+
+/**
+ * @brief Computes the ascending permutation of `keys` under `lessDepthSortKey`.
+ *
+ * Equal keys keep their input order, so every mode yields the same result.
+ */
+static inline void computeDepthSortOrder(const FrameVector<DepthSortKey>& keys,
+                                         DepthSortMode mode,
+                                         FrameVector<std::size_t>& outOrder) {
+  // Temporal mode needs frame history; without it, behave like Auto.
+  const bool useRadix =
+      mode == DepthSortMode::Radix ||
+      ((mode == DepthSortMode::Auto || mode == DepthSortMode::Temporal) &&
+       keys.size() >= DEPTH_RADIX_SORT_MIN_ITEMS);
+  if (useRadix && sortDepthKeysByRadix(keys, outOrder)) {
+    return;
+  }
+  sortDepthKeysByComparison(keys, outOrder);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Temporal-coherence depth sort.
+
+// Insertion repair gives up once it has shifted this many elements per item.
+constexpr std::size_t TEMPORAL_DEPTH_SORT_MAX_MOVES_PER_ITEM = 4;
+
+/**
+ * @brief Counters reported by `getTemporalDepthSortStats`.
+ */
+struct TemporalDepthSortStats {
+  uint64_t frames = 0;
+  uint64_t fastPathHits = 0;
+  uint64_t inversionFallbacks = 0;
+  uint64_t coldFrames = 0;
+  uint64_t lastMoves = 0;
+  uint64_t lastFreshItems = 0;
+};
+
+/**
+ * @brief Open-addressing table from (sprite handle, image handle) to rank.
+ *
+ * Cleared in O(1) by bumping a stamp, so it is rebuilt every frame without
+ * touching the allocator.
+ */
+class DepthRankTable {
+public:
+  void reset(std::size_t expectedCount) {
+    std::size_t capacity = 16;
+    while (capacity < expectedCount * 2) {
+      capacity <<= 1;
+    }
+    ++stamp_;
+    if (capacity != slots_.size() || stamp_ == 0) {
+      slots_.assign(capacity, Slot{});
+      stamp_ = 1;
+    }
+    count_ = 0;
+  }
+
+  /** @return false when the key is already present. */
+  bool insert(int64_t spriteHandle, double imageHandle, uint32_t rank) {
+    const uint64_t image = encodeOrderedDouble(imageHandle);
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t slot = hash(spriteHandle, image) & mask;;
+         slot = (slot + 1) & mask) {
+      Slot& entry = slots_[slot];
+      if (entry.stamp != stamp_) {
+        entry = Slot{spriteHandle, image, rank, stamp_};
+        ++count_;
+        return true;
+      }
+      if (entry.spriteHandle == spriteHandle && entry.image == image) {
+        return false;
+      }
+    }
+  }
+
+  bool find(int64_t spriteHandle, double imageHandle, uint32_t& rank) const {
+    if (count_ == 0) {
+      return false;
+    }
+    const uint64_t image = encodeOrderedDouble(imageHandle);
+    const std::size_t mask = slots_.size() - 1;
+    for (std::size_t slot = hash(spriteHandle, image) & mask;;
+         slot = (slot + 1) & mask) {
+      const Slot& entry = slots_[slot];
+      if (entry.stamp != stamp_) {
+        return false;
+      }
+      if (entry.spriteHandle == spriteHandle && entry.image == image) {
+        rank = entry.rank;
+        return true;
+      }
+    }
+  }
+
+  std::size_t size() const {
+    return count_;
+  }
+
+private:
+  struct Slot {
+    int64_t spriteHandle = 0;
+    uint64_t image = 0;
+    uint32_t rank = 0;
+    uint32_t stamp = 0;
+  };
+
+  static inline std::size_t hash(int64_t spriteHandle, uint64_t image) {
+    uint64_t value = static_cast<uint64_t>(spriteHandle) * 0x9E3779B97F4A7C15ull;
+    value ^= image + 0x632BE59BD9B4E019ull + (value << 6) + (value >> 2);
+    value ^= value >> 29;
+    return static_cast<std::size_t>(value);
+  }
+
+  std::vector<Slot> slots_;
+  uint32_t stamp_ = 0;
+  std::size_t count_ = 0;
+};
+
+/**
+ * @brief Keeps the previous frame's order and repairs it incrementally.
+ *
+ * Items seen last frame are laid out in their previous rank order and fixed
+ * up with a budgeted insertion sort; new items are sorted separately and
+ * merged in. When the input lists the same (sprite, image) pairs in the same
+ * order as last frame, the previous permutation is reused directly;
+ * otherwise ranks are looked up through a hash table built on demand.
+ * When the budget runs out (too many inversions), there is no usable
+ * history, or a (sprite, image) pair repeats, a full sort is used instead.
+ * Because ties are broken by input index, every path returns the same
+ * permutation as `computeDepthSortOrder`.
+ */
+class TemporalDepthSorter {
+public:
+  void sort(const FrameVector<DepthSortKey>& keys,
+            FrameVector<std::size_t>& outOrder) {
+    stats_.frames += 1;
+    stats_.lastMoves = 0;
+    stats_.lastFreshItems = 0;
+    bool repaired = false;
+    if (previousOrder_.empty() || keys.size() >= NO_ITEM) {
+      stats_.coldFrames += 1;
+    } else {
+      repaired = repair(keys, outOrder);
+    }
+    if (!repaired) {
+      computeDepthSortOrder(keys, DepthSortMode::Auto, outOrder);
+    }
+    remember(keys, outOrder);
+  }
+
+  void reset() {
+    previousIdentities_.clear();
+    previousOrder_.clear();
+    stats_ = TemporalDepthSortStats{};
+  }
+
+  const TemporalDepthSortStats& stats() const {
+    return stats_;
+  }
+
+private:
+  static constexpr uint32_t NO_ITEM = std::numeric_limits<uint32_t>::max();
+
+  struct Identity {
+    int64_t spriteHandle = 0;
+    uint64_t image = 0;
+    bool operator==(const Identity& other) const {
+      return spriteHandle == other.spriteHandle && image == other.image;
+    }
+  };
+
+  static inline Identity identityOf(const DepthSortKey& key) {
+    return Identity{key.spriteHandle, encodeOrderedDouble(key.imageHandle)};
+  }
+
+  bool sameIdentities(const FrameVector<DepthSortKey>& keys) const {
+    if (keys.size() != previousIdentities_.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      if (!(identityOf(keys[i]) == previousIdentities_[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Maps items onto last frame's ranks through a hash table.
+   * @return false when a (sprite, image) pair repeats in either frame.
+   */
+  bool collectByRank(const FrameVector<DepthSortKey>& keys) {
+    const std::size_t previousCount = previousOrder_.size();
+    ranks_.reset(previousCount);
+    for (std::size_t rank = 0; rank < previousCount; ++rank) {
+      const DepthSortKey& previous = previousKeys_[rank];
+      if (!ranks_.insert(previous.spriteHandle, previous.imageHandle,
+                         static_cast<uint32_t>(rank))) {
+        return false;
+      }
+    }
+    ranked_.assign(previousCount, NO_ITEM);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      uint32_t rank = 0;
+      if (!ranks_.find(keys[i].spriteHandle, keys[i].imageHandle, rank)) {
+        fresh_.push_back(i);
+        continue;
+      }
+      if (ranked_[rank] != NO_ITEM) {
+        return false;
+      }
+      ranked_[rank] = static_cast<uint32_t>(i);
+    }
+    for (const uint32_t index : ranked_) {
+      if (index != NO_ITEM) {
+        carried_.push_back(index);
+      }
+    }
+    return true;
+  }
+
+  bool repair(const FrameVector<DepthSortKey>& keys,
+              FrameVector<std::size_t>& outOrder) {
+    const std::size_t count = keys.size();
+    carried_.clear();
+    fresh_.clear();
+    if (sameIdentities(keys)) {
+      carried_.assign(previousOrder_.begin(), previousOrder_.end());
+    } else if (!collectByRank(keys) || carried_.empty()) {
+      stats_.coldFrames += 1;
+      return false;
+    }
+
+    const std::size_t budget = count * TEMPORAL_DEPTH_SORT_MAX_MOVES_PER_ITEM;
+    std::size_t moves = 0;
+    for (std::size_t i = 1; i < carried_.size(); ++i) {
+      const std::size_t value = carried_[i];
+      if (!lessDepthSortEntry(keys, value, carried_[i - 1])) {
+        continue;
+      }
+      std::size_t j = i;
+      do {
+        carried_[j] = carried_[j - 1];
+        --j;
+        if (++moves > budget) {
+          stats_.lastMoves = moves;
+          stats_.inversionFallbacks += 1;
+          return false;
+        }
+      } while (j > 0 && lessDepthSortEntry(keys, value, carried_[j - 1]));
+      carried_[j] = value;
+    }
+
+    const auto less = [&keys](std::size_t a, std::size_t b) {
+      return lessDepthSortEntry(keys, a, b);
+    };
+    if (fresh_.empty()) {
+      outOrder.assign(carried_.begin(), carried_.end());
+    } else {
+      std::sort(fresh_.begin(), fresh_.end(), less);
+      outOrder.resize(count);
+      std::merge(carried_.begin(), carried_.end(), fresh_.begin(),
+                 fresh_.end(), outOrder.begin(), less);
+    }
+
+    stats_.lastMoves = moves;
+    stats_.lastFreshItems = fresh_.size();
+    stats_.fastPathHits += 1;
+    return true;
+  }
+
+  void remember(const FrameVector<DepthSortKey>& keys,
+                const FrameVector<std::size_t>& order) {
+    previousIdentities_.resize(keys.size());
+    previousKeys_.resize(order.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      previousIdentities_[i] = identityOf(keys[i]);
+    }
+    for (std::size_t rank = 0; rank < order.size(); ++rank) {
+      previousKeys_[rank] = keys[order[rank]];
+    }
+    previousOrder_.assign(order.begin(), order.end());
+  }
+
+  // Last frame's input identities (by input index), sorted keys (by rank)
+  // and permutation.
+  std::vector<Identity> previousIdentities_;
+  std::vector<DepthSortKey> previousKeys_;
+  std::vector<std::size_t> previousOrder_;
+  DepthRankTable ranks_;
+  std::vector<uint32_t> ranked_;
+  std::vector<std::size_t> carried_;
+  std::vector<std::size_t> fresh_;
+  TemporalDepthSortStats stats_;
+};
+
+#endif
@@ -0,0 +1,507 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _FAST_MATH_H
+#define _FAST_MATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef SIMD_ENABLED
+#include <wasm_simd128.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Polynomial/rational replacements for the libm calls used by the mercator
+// conversion and the batched easing kernels. Each scalar kernel performs exactly the same operations as its
+// f64x2 counterpart, so both produce identical bits per lane.
+//
+// Relative errors measured against libm (absolute where |result| < 1 for log):
+//   fastLog   x in [1e-300, 1e300]   < 4.4e-16
+//   fastExp   x in [-700, 700]       < 2.3e-16
+//   fastExpm1 x in [-700, 700]       < 2.7e-16
+//   fastTan   |x| <= 1e4             < 1.9e-13
+//   fastAtan  every x                < 3.7e-13
+//   fastSin   |x| <= 1e4             < 1.2e-16 (absolute)
+//   fastCos   |x| <= 1e4             < 1.2e-16 (absolute)
+
+constexpr double FAST_MATH_LN2 = 0.69314718055994530942;
+constexpr double FAST_MATH_LN2_HI = 6.93147180369123816490e-01;
+constexpr double FAST_MATH_LN2_LO = 1.90821492927058770002e-10;
+constexpr double FAST_MATH_LOG2E = 1.44269504088896340736;
+constexpr double FAST_MATH_SQRT2 = 1.41421356237309504880;
+constexpr double FAST_MATH_PIO2_HI = 1.57079632673412561417e+00;
+constexpr double FAST_MATH_PIO2_LO = 6.07710050650619224932e-11;
+constexpr double FAST_MATH_PIO2 = 1.57079632679489661923;
+constexpr double FAST_MATH_PIO4 = 0.78539816339744830962;
+constexpr double FAST_MATH_2_OVER_PI = 0.63661977236758134308;
+constexpr double FAST_MATH_TAN_PI_8 = 0.41421356237309504880;
+// Inputs beyond this range saturate instead of overflowing to infinity.
+constexpr double FAST_MATH_EXP_LIMIT = 700.0;
+// 1.5 * 2^52: adding it leaves an integral double's value in the low mantissa bits.
+constexpr double FAST_MATH_INT_MAGIC = 6755399441055744.0;
+constexpr uint64_t FAST_MATH_EXPONENT_MASK = 0x7ff0000000000000ull;
+constexpr uint64_t FAST_MATH_MANTISSA_MASK = 0x000fffffffffffffull;
+constexpr uint64_t FAST_MATH_ONE_BITS = 0x3ff0000000000000ull;
+constexpr uint64_t FAST_MATH_SIGN_BITS = 0x8000000000000000ull;
+
+static inline uint64_t fastMathBits(double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static inline double fastMathFromBits(uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// log(m) = 2 * atanh(s), s = (m - 1) / (m + 1), |s| <= 0.1716 for m in [sqrt(1/2), sqrt(2)).
+static inline double fastLogSeries(double s) {
+  const double s2 = s * s;
+  double p = 1.0 / 17.0;
+  p = p * s2 + 1.0 / 15.0;
+  p = p * s2 + 1.0 / 13.0;
+  p = p * s2 + 1.0 / 11.0;
+  p = p * s2 + 1.0 / 9.0;
+  p = p * s2 + 1.0 / 7.0;
+  p = p * s2 + 1.0 / 5.0;
+  p = p * s2 + 1.0 / 3.0;
+  p = p * s2 + 1.0;
+  return 2.0 * s * p;
+}
+
+// Taylor series of exp(r) for |r| <= ln2 / 2.
+static inline double fastExpSeries(double r) {
+  double p = 1.0 / 6227020800.0;
+  p = p * r + 1.0 / 479001600.0;
+  p = p * r + 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  return p * r + 1.0;
+}
+
+// Taylor series of exp(r) - 1 for |r| <= ln2 / 2, without the cancellation
+// of subtracting one from exp(r).
+static inline double fastExpm1Series(double r) {
+  double p = 1.0 / 6227020800.0;
+  p = p * r + 1.0 / 479001600.0;
+  p = p * r + 1.0 / 39916800.0;
+  p = p * r + 1.0 / 3628800.0;
+  p = p * r + 1.0 / 362880.0;
+  p = p * r + 1.0 / 40320.0;
+  p = p * r + 1.0 / 5040.0;
+  p = p * r + 1.0 / 720.0;
+  p = p * r + 1.0 / 120.0;
+  p = p * r + 1.0 / 24.0;
+  p = p * r + 1.0 / 6.0;
+  p = p * r + 0.5;
+  p = p * r + 1.0;
+  return p * r;
+}
+
+// [7/6] continued-fraction rational of tan(r) for |r| <= pi/4.
+static inline double fastTanRational(double r) {
+  const double u = r * r;
+  const double numerator =
+      ((-u + 378.0) * u - 17325.0) * u + 135135.0;
+  const double denominator =
+      ((-28.0 * u + 3150.0) * u - 62370.0) * u + 135135.0;
+  return r * numerator / denominator;
+}
+
+// [9/8] continued-fraction rational of atan(t) for |t| <= tan(pi/8).
+static inline double fastAtanRational(double t) {
+  const double u = t * t;
+  const double numerator =
+      (((147456.0 * u + 5742495.0) * u + 33648615.0) * u + 61486425.0) * u +
+      34459425.0;
+  const double denominator =
+      (((893025.0 * u + 13097700.0) * u + 51081030.0) * u + 72972900.0) * u +
+      34459425.0;
+  return t * numerator / denominator;
+}
+
+// Taylor series of sin(r) for |r| <= pi/4.
+static inline double fastSinSeries(double r) {
+  const double u = r * r;
+  double p = 1.0 / 355687428096000.0;
+  p = p * u - 1.0 / 1307674368000.0;
+  p = p * u + 1.0 / 6227020800.0;
+  p = p * u - 1.0 / 39916800.0;
+  p = p * u + 1.0 / 362880.0;
+  p = p * u - 1.0 / 5040.0;
+  p = p * u + 1.0 / 120.0;
+  p = p * u - 1.0 / 6.0;
+  return r + r * u * p;
+}
+
+// Taylor series of cos(r) for |r| <= pi/4.
+static inline double fastCosSeries(double r) {
+  const double u = r * r;
+  double p = 1.0 / 20922789888000.0;
+  p = p * u - 1.0 / 87178291200.0;
+  p = p * u + 1.0 / 479001600.0;
+  p = p * u - 1.0 / 3628800.0;
+  p = p * u + 1.0 / 40320.0;
+  p = p * u - 1.0 / 720.0;
+  p = p * u + 1.0 / 24.0;
+  p = p * u - 0.5;
+  return 1.0 + u * p;
+}
+
+// sin(x) from x = k * pi/2 + r: quadrant k mod 4 picks sin/cos of r and the sign.
+static inline double fastSinQuadrant(double k, double r) {
+  const double quadrant = k - 4.0 * std::floor(k * 0.25);
+  const double halfQuadrant = quadrant * 0.5;
+  const bool odd = halfQuadrant != std::floor(halfQuadrant);
+  const double value = odd ? fastCosSeries(r) : fastSinSeries(r);
+  return quadrant >= 2.0 ? -value : value;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Natural logarithm of a positive normal double.
+ * Zero, subnormal, negative, infinite and NaN inputs are outside the domain.
+ */
+static inline double fastLog(double x) {
+  const uint64_t bits = fastMathBits(x);
+  const double biasedExponent =
+      static_cast<double>((bits & FAST_MATH_EXPONENT_MASK) >> 52);
+  const double mantissa =
+      fastMathFromBits((bits & FAST_MATH_MANTISSA_MASK) | FAST_MATH_ONE_BITS);
+  const bool high = mantissa > FAST_MATH_SQRT2;
+  const double m = high ? mantissa * 0.5 : mantissa;
+  const double exponent = (biasedExponent - 1023.0) + (high ? 1.0 : 0.0);
+  return exponent * FAST_MATH_LN2 + fastLogSeries((m - 1.0) / (m + 1.0));
+}
+
+/**
+ * @brief Exponential. NaN passes through; the argument is clamped to
+ * [-FAST_MATH_EXP_LIMIT, FAST_MATH_EXP_LIMIT].
+ */
+static inline double fastExp(double x) {
+  if (std::isnan(x)) {
+    return x;
+  }
+  const double clamped =
+      x < -FAST_MATH_EXP_LIMIT ? -FAST_MATH_EXP_LIMIT
+                               : (x > FAST_MATH_EXP_LIMIT ? FAST_MATH_EXP_LIMIT : x);
+  const double k = std::nearbyint(clamped * FAST_MATH_LOG2E);
+  const double r = (clamped - k * FAST_MATH_LN2_HI) - k * FAST_MATH_LN2_LO;
+  const uint64_t scaleBits =
+      static_cast<uint64_t>(static_cast<int64_t>(k) + 1023) << 52;
+  return fastExpSeries(r) * fastMathFromBits(scaleBits);
+}
+
+/**
+ * @brief exp(x) - 1, accurate for arguments near zero. NaN passes through;
+ * larger arguments are clamped like `fastExp`.
+ */
+static inline double fastExpm1(double x) {
+  if (std::fabs(x) < FAST_MATH_LN2 * 0.5) {
+    return fastExpm1Series(x);
+  }
+  return fastExp(x) - 1.0;
+}
+
+/**
+ * @brief Tangent. Accurate for moderate arguments (|x| <= 1e4); the
+ * two-constant reduction loses precision for larger ones.
+ */
+static inline double fastTan(double x) {
+  const double k = std::nearbyint(x * FAST_MATH_2_OVER_PI);
+  const double r = (x - k * FAST_MATH_PIO2_HI) - k * FAST_MATH_PIO2_LO;
+  const double t = fastTanRational(r);
+  const double halfK = k * 0.5;
+  const bool odd = halfK != std::floor(halfK);
+  return odd ? -1.0 / t : t;
+}
+
+/**
+ * @brief Sine. Accurate for moderate arguments (|x| <= 1e4), like fastTan.
+ */
+static inline double fastSin(double x) {
+  const double k = std::nearbyint(x * FAST_MATH_2_OVER_PI);
+  const double r = (x - k * FAST_MATH_PIO2_HI) - k * FAST_MATH_PIO2_LO;
+  return fastSinQuadrant(k, r);
+}
+
+/**
+ * @brief Cosine, as the sine one quadrant ahead.
+ */
+static inline double fastCos(double x) {
+  const double k = std::nearbyint(x * FAST_MATH_2_OVER_PI);
+  const double r = (x - k * FAST_MATH_PIO2_HI) - k * FAST_MATH_PIO2_LO;
+  return fastSinQuadrant(k + 1.0, r);
+}
+
+/**
+ * @brief Arc tangent for every double, including infinities.
+ */
+static inline double fastAtan(double x) {
+  const double magnitude = std::fabs(x);
+  const bool inverted = magnitude > 1.0;
+  const double a = inverted ? 1.0 / magnitude : magnitude;
+  const bool shifted = a > FAST_MATH_TAN_PI_8;
+  const double t = shifted ? (a - 1.0) / (a + 1.0) : a;
+  const double base = fastAtanRational(t);
+  const double reduced = shifted ? FAST_MATH_PIO4 + base : base;
+  const double result = inverted ? FAST_MATH_PIO2 - reduced : reduced;
+  return fastMathFromBits((fastMathBits(result) & ~FAST_MATH_SIGN_BITS) |
+                          (fastMathBits(x) & FAST_MATH_SIGN_BITS));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef SIMD_ENABLED
+
+static inline v128_t fastLogSeriesX2(v128_t s) {
+  const v128_t s2 = wasm_f64x2_mul(s, s);
+  v128_t p = wasm_f64x2_splat(1.0 / 17.0);
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 15.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 13.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 11.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 9.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 7.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 5.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0 / 3.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, s2), wasm_f64x2_splat(1.0));
+  return wasm_f64x2_mul(wasm_f64x2_mul(wasm_f64x2_splat(2.0), s), p);
+}
+
+static inline v128_t fastExpSeriesX2(v128_t r) {
+  v128_t p = wasm_f64x2_splat(1.0 / 6227020800.0);
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 479001600.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 39916800.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 3628800.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 362880.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 40320.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 5040.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 720.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 120.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 24.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 6.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(0.5));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0));
+  return wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0));
+}
+
+static inline v128_t fastExpm1SeriesX2(v128_t r) {
+  v128_t p = wasm_f64x2_splat(1.0 / 6227020800.0);
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 479001600.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 39916800.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 3628800.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 362880.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 40320.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 5040.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 720.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 120.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 24.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0 / 6.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(0.5));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, r), wasm_f64x2_splat(1.0));
+  return wasm_f64x2_mul(p, r);
+}
+
+static inline v128_t fastTanRationalX2(v128_t r) {
+  const v128_t u = wasm_f64x2_mul(r, r);
+  v128_t numerator = wasm_f64x2_add(wasm_f64x2_neg(u), wasm_f64x2_splat(378.0));
+  numerator = wasm_f64x2_sub(wasm_f64x2_mul(numerator, u), wasm_f64x2_splat(17325.0));
+  numerator = wasm_f64x2_add(wasm_f64x2_mul(numerator, u), wasm_f64x2_splat(135135.0));
+  v128_t denominator = wasm_f64x2_add(
+      wasm_f64x2_mul(wasm_f64x2_splat(-28.0), u), wasm_f64x2_splat(3150.0));
+  denominator = wasm_f64x2_sub(wasm_f64x2_mul(denominator, u), wasm_f64x2_splat(62370.0));
+  denominator = wasm_f64x2_add(wasm_f64x2_mul(denominator, u), wasm_f64x2_splat(135135.0));
+  return wasm_f64x2_div(wasm_f64x2_mul(r, numerator), denominator);
+}
+
+static inline v128_t fastAtanRationalX2(v128_t t) {
+  const v128_t u = wasm_f64x2_mul(t, t);
+  v128_t numerator = wasm_f64x2_add(
+      wasm_f64x2_mul(wasm_f64x2_splat(147456.0), u), wasm_f64x2_splat(5742495.0));
+  numerator = wasm_f64x2_add(wasm_f64x2_mul(numerator, u), wasm_f64x2_splat(33648615.0));
+  numerator = wasm_f64x2_add(wasm_f64x2_mul(numerator, u), wasm_f64x2_splat(61486425.0));
+  numerator = wasm_f64x2_add(wasm_f64x2_mul(numerator, u), wasm_f64x2_splat(34459425.0));
+  v128_t denominator = wasm_f64x2_add(
+      wasm_f64x2_mul(wasm_f64x2_splat(893025.0), u), wasm_f64x2_splat(13097700.0));
+  denominator = wasm_f64x2_add(wasm_f64x2_mul(denominator, u), wasm_f64x2_splat(51081030.0));
+  denominator = wasm_f64x2_add(wasm_f64x2_mul(denominator, u), wasm_f64x2_splat(72972900.0));
+  denominator = wasm_f64x2_add(wasm_f64x2_mul(denominator, u), wasm_f64x2_splat(34459425.0));
+  return wasm_f64x2_div(wasm_f64x2_mul(t, numerator), denominator);
+}
+
+static inline v128_t fastSinSeriesX2(v128_t r) {
+  const v128_t u = wasm_f64x2_mul(r, r);
+  v128_t p = wasm_f64x2_splat(1.0 / 355687428096000.0);
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 1307674368000.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 6227020800.0));
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 39916800.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 362880.0));
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 5040.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 120.0));
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 6.0));
+  return wasm_f64x2_add(r, wasm_f64x2_mul(wasm_f64x2_mul(r, u), p));
+}
+
+static inline v128_t fastCosSeriesX2(v128_t r) {
+  const v128_t u = wasm_f64x2_mul(r, r);
+  v128_t p = wasm_f64x2_splat(1.0 / 20922789888000.0);
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 87178291200.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 479001600.0));
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 3628800.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 40320.0));
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 720.0));
+  p = wasm_f64x2_add(wasm_f64x2_mul(p, u), wasm_f64x2_splat(1.0 / 24.0));
+  p = wasm_f64x2_sub(wasm_f64x2_mul(p, u), wasm_f64x2_splat(0.5));
+  return wasm_f64x2_add(wasm_f64x2_splat(1.0), wasm_f64x2_mul(u, p));
+}
+
+static inline v128_t fastSinQuadrantX2(v128_t k, v128_t r) {
+  const v128_t quadrant = wasm_f64x2_sub(
+      k,
+      wasm_f64x2_mul(wasm_f64x2_splat(4.0),
+                     wasm_f64x2_floor(wasm_f64x2_mul(k, wasm_f64x2_splat(0.25)))));
+  const v128_t halfQuadrant = wasm_f64x2_mul(quadrant, wasm_f64x2_splat(0.5));
+  const v128_t odd = wasm_f64x2_ne(halfQuadrant, wasm_f64x2_floor(halfQuadrant));
+  const v128_t value =
+      wasm_v128_bitselect(fastCosSeriesX2(r), fastSinSeriesX2(r), odd);
+  return wasm_v128_bitselect(
+      wasm_f64x2_neg(value), value, wasm_f64x2_ge(quadrant, wasm_f64x2_splat(2.0)));
+}
+
+/**
+ * @brief Converts integral lanes (|k| < 2^51) to 64-bit integers.
+ */
+static inline v128_t fastIntegralToI64X2(v128_t k) {
+  const v128_t magic = wasm_f64x2_splat(FAST_MATH_INT_MAGIC);
+  return wasm_i64x2_sub(wasm_f64x2_add(k, magic), magic);
+}
+
+/** @brief Two-lane `fastLog`. */
+static inline v128_t fastLogX2(v128_t x) {
+  // The biased exponent (< 2^11) is placed in the mantissa of 2^52 and
+  // recovered by subtracting 2^52.
+  const v128_t twoPow52 = wasm_f64x2_splat(4503599627370496.0);
+  const v128_t biasedExponent = wasm_f64x2_sub(
+      wasm_v128_or(
+          wasm_u64x2_shr(
+              wasm_v128_and(x, wasm_i64x2_splat(static_cast<int64_t>(FAST_MATH_EXPONENT_MASK))),
+              52),
+          twoPow52),
+      twoPow52);
+  const v128_t mantissa = wasm_v128_or(
+      wasm_v128_and(x, wasm_i64x2_splat(static_cast<int64_t>(FAST_MATH_MANTISSA_MASK))),
+      wasm_i64x2_splat(static_cast<int64_t>(FAST_MATH_ONE_BITS)));
+  const v128_t high = wasm_f64x2_gt(mantissa, wasm_f64x2_splat(FAST_MATH_SQRT2));
+  const v128_t m = wasm_v128_bitselect(
+      wasm_f64x2_mul(mantissa, wasm_f64x2_splat(0.5)), mantissa, high);
+  const v128_t exponent = wasm_f64x2_add(
+      wasm_f64x2_sub(biasedExponent, wasm_f64x2_splat(1023.0)),
+      wasm_v128_and(wasm_f64x2_splat(1.0), high));
+  const v128_t one = wasm_f64x2_splat(1.0);
+  const v128_t s = wasm_f64x2_div(wasm_f64x2_sub(m, one), wasm_f64x2_add(m, one));
+  return wasm_f64x2_add(wasm_f64x2_mul(exponent, wasm_f64x2_splat(FAST_MATH_LN2)),
+                        fastLogSeriesX2(s));
+}
+
+/** @brief Two-lane `fastExp`. */
+static inline v128_t fastExpX2(v128_t x) {
+  // pmin/pmax return their first operand for NaN lanes, which the final
+  // select restores anyway.
+  const v128_t clamped = wasm_f64x2_pmax(
+      wasm_f64x2_pmin(x, wasm_f64x2_splat(FAST_MATH_EXP_LIMIT)),
+      wasm_f64x2_splat(-FAST_MATH_EXP_LIMIT));
+  const v128_t k =
+      wasm_f64x2_nearest(wasm_f64x2_mul(clamped, wasm_f64x2_splat(FAST_MATH_LOG2E)));
+  const v128_t r = wasm_f64x2_sub(
+      wasm_f64x2_sub(clamped, wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_LN2_HI))),
+      wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_LN2_LO)));
+  const v128_t scale = wasm_i64x2_shl(
+      wasm_i64x2_add(fastIntegralToI64X2(k), wasm_i64x2_splat(1023)), 52);
+  const v128_t result = wasm_f64x2_mul(fastExpSeriesX2(r), scale);
+  return wasm_v128_bitselect(x, result, wasm_f64x2_ne(x, x));
+}
+
+/** @brief Two-lane `fastExpm1`. */
+static inline v128_t fastExpm1X2(v128_t x) {
+  const v128_t small =
+      wasm_f64x2_lt(wasm_f64x2_abs(x), wasm_f64x2_splat(FAST_MATH_LN2 * 0.5));
+  return wasm_v128_bitselect(
+      fastExpm1SeriesX2(x),
+      wasm_f64x2_sub(fastExpX2(x), wasm_f64x2_splat(1.0)),
+      small);
+}
+
+/** @brief Two-lane `fastTan`. */
+static inline v128_t fastTanX2(v128_t x) {
+  const v128_t k =
+      wasm_f64x2_nearest(wasm_f64x2_mul(x, wasm_f64x2_splat(FAST_MATH_2_OVER_PI)));
+  const v128_t r = wasm_f64x2_sub(
+      wasm_f64x2_sub(x, wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_PIO2_HI))),
+      wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_PIO2_LO)));
+  const v128_t t = fastTanRationalX2(r);
+  const v128_t halfK = wasm_f64x2_mul(k, wasm_f64x2_splat(0.5));
+  const v128_t odd = wasm_f64x2_ne(halfK, wasm_f64x2_floor(halfK));
+  return wasm_v128_bitselect(
+      wasm_f64x2_div(wasm_f64x2_splat(-1.0), t), t, odd);
+}
+
+/** @brief Two-lane `fastSin`. */
+static inline v128_t fastSinX2(v128_t x) {
+  const v128_t k =
+      wasm_f64x2_nearest(wasm_f64x2_mul(x, wasm_f64x2_splat(FAST_MATH_2_OVER_PI)));
+  const v128_t r = wasm_f64x2_sub(
+      wasm_f64x2_sub(x, wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_PIO2_HI))),
+      wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_PIO2_LO)));
+  return fastSinQuadrantX2(k, r);
+}
+
+/** @brief Two-lane `fastCos`. */
+static inline v128_t fastCosX2(v128_t x) {
+  const v128_t k =
+      wasm_f64x2_nearest(wasm_f64x2_mul(x, wasm_f64x2_splat(FAST_MATH_2_OVER_PI)));
+  const v128_t r = wasm_f64x2_sub(
+      wasm_f64x2_sub(x, wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_PIO2_HI))),
+      wasm_f64x2_mul(k, wasm_f64x2_splat(FAST_MATH_PIO2_LO)));
+  return fastSinQuadrantX2(wasm_f64x2_add(k, wasm_f64x2_splat(1.0)), r);
+}
+
+/** @brief Two-lane `fastAtan`. */
+static inline v128_t fastAtanX2(v128_t x) {
+  const v128_t one = wasm_f64x2_splat(1.0);
+  const v128_t magnitude = wasm_f64x2_abs(x);
+  const v128_t inverted = wasm_f64x2_gt(magnitude, one);
+  const v128_t a =
+      wasm_v128_bitselect(wasm_f64x2_div(one, magnitude), magnitude, inverted);
+  const v128_t shifted = wasm_f64x2_gt(a, wasm_f64x2_splat(FAST_MATH_TAN_PI_8));
+  const v128_t t = wasm_v128_bitselect(
+      wasm_f64x2_div(wasm_f64x2_sub(a, one), wasm_f64x2_add(a, one)), a, shifted);
+  const v128_t base = fastAtanRationalX2(t);
+  const v128_t reduced = wasm_v128_bitselect(
+      wasm_f64x2_add(wasm_f64x2_splat(FAST_MATH_PIO4), base), base, shifted);
+  const v128_t result = wasm_v128_bitselect(
+      wasm_f64x2_sub(wasm_f64x2_splat(FAST_MATH_PIO2), reduced), reduced, inverted);
+  const v128_t sign = wasm_i64x2_splat(static_cast<int64_t>(FAST_MATH_SIGN_BITS));
+  return wasm_v128_or(wasm_v128_andnot(result, sign), wasm_v128_and(x, sign));
+}
+
+#endif
+
+#endif
@@ -0,0 +1,326 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _FRAME_ARENA_H
+#define _FRAME_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "worker_jobs.h"
+
+// Smallest block a slab allocates; later blocks double the reserved size.
+constexpr std::size_t FRAME_ARENA_MIN_BLOCK_BYTES = 64 * 1024;
+constexpr std::size_t FRAME_ARENA_ALIGNMENT = 16;
+
+/**
+ * @brief Bump allocator owned by one thread for the duration of a frame.
+ *
+ * Allocations are never freed individually; `reset` rewinds the slab at the
+ * start of the next frame. When a frame outgrows the current block, another
+ * block is chained, and on the following reset all blocks are coalesced into
+ * one large enough for the whole frame, so a steady workload stops touching
+ * the system allocator after its first few frames.
+ */
+class FrameSlab {
+public:
+  FrameSlab() = default;
+  FrameSlab(const FrameSlab&) = delete;
+  FrameSlab& operator=(const FrameSlab&) = delete;
+
+  FrameSlab(FrameSlab&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  FrameSlab& operator=(FrameSlab&& other) noexcept {
+    if (this != &other) {
+      release();
+      blocks_ = std::move(other.blocks_);
+      blockIndex_ = other.blockIndex_;
+      offset_ = other.offset_;
+      used_ = other.used_;
+      highWater_ = other.highWater_;
+      reserved_ = other.reserved_;
+      blockAllocations_ = other.blockAllocations_;
+      other.blocks_.clear();
+      other.blockIndex_ = 0;
+      other.offset_ = 0;
+      other.used_ = 0;
+      other.reserved_ = 0;
+    }
+    return *this;
+  }
+
+  ~FrameSlab() {
+    release();
+  }
+
+  /**
+   * @brief Returns `bytes` of storage aligned to `alignment` (a power of two
+   * no larger than FRAME_ARENA_ALIGNMENT), or nullptr when out of memory.
+   */
+  void* allocate(std::size_t bytes, std::size_t alignment) {
+    alignment = std::max<std::size_t>(1, alignment);
+    bytes = std::max<std::size_t>(1, bytes);
+    while (blockIndex_ < blocks_.size()) {
+      Block& block = blocks_[blockIndex_];
+      const std::size_t start = (offset_ + alignment - 1) & ~(alignment - 1);
+      if (start + bytes <= block.size) {
+        used_ += start + bytes - offset_;
+        offset_ = start + bytes;
+        highWater_ = std::max(highWater_, used_);
+        return block.data + start;
+      }
+      // Abandon the tail of this block; its bytes still count as used so the
+      // coalesced block is large enough next frame.
+      used_ += block.size - offset_;
+      ++blockIndex_;
+      offset_ = 0;
+    }
+    const std::size_t blockSize = std::max(
+        {FRAME_ARENA_MIN_BLOCK_BYTES, reserved_, bytes + alignment});
+    if (!appendBlock(blockSize)) {
+      return nullptr;
+    }
+    blockIndex_ = blocks_.size() - 1;
+    offset_ = bytes;
+    used_ += bytes;
+    highWater_ = std::max(highWater_, used_);
+    return blocks_.back().data;
+  }
+
+  /**
+   * @brief Rewinds the slab. Every pointer handed out so far becomes invalid.
+   */
+  void reset() {
+    if (blocks_.size() > 1) {
+      // highWater_ includes abandoned block tails, so one block of that size
+      // holds the largest frame seen so far.
+      const std::size_t total = highWater_;
+      release();
+      appendBlock(total);
+    }
+    blockIndex_ = 0;
+    offset_ = 0;
+    used_ = 0;
+  }
+
+  std::size_t used() const {
+    return used_;
+  }
+
+  std::size_t highWater() const {
+    return highWater_;
+  }
+
+  std::size_t reserved() const {
+    return reserved_;
+  }
+
+  std::size_t blockAllocations() const {
+    return blockAllocations_;
+  }
+
+private:
+  struct Block {
+    unsigned char* data = nullptr;
+    std::size_t size = 0;
+  };
+
+  bool appendBlock(std::size_t size) {
+    void* data = std::aligned_alloc(
+        FRAME_ARENA_ALIGNMENT,
+        (size + FRAME_ARENA_ALIGNMENT - 1) & ~(FRAME_ARENA_ALIGNMENT - 1));
+    if (data == nullptr) {
+      return false;
+    }
+    blocks_.push_back(Block{static_cast<unsigned char*>(data), size});
+    reserved_ += size;
+    ++blockAllocations_;
+    return true;
+  }
+
+  void release() {
+    for (const Block& block : blocks_) {
+      std::free(block.data);
+    }
+    blocks_.clear();
+    reserved_ = 0;
+  }
+
+  std::vector<Block> blocks_;
+  std::size_t blockIndex_ = 0;
+  std::size_t offset_ = 0;
+  std::size_t used_ = 0;
+  std::size_t highWater_ = 0;
+  std::size_t reserved_ = 0;
+  std::size_t blockAllocations_ = 0;
+};
+
+/**
+ * @brief STL allocator over a FrameSlab.
+ *
+ * A default-constructed allocator has no slab and uses the global heap, so
+ * the same container types also serve code that runs outside a frame.
+ * Deallocation is a no-op on slab memory: reserve containers up front where
+ * the size is known, since a reallocation abandons the old buffer until the
+ * next frame.
+ */
+template <typename T>
+struct FrameAllocator {
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  FrameSlab* slab = nullptr;
+
+  FrameAllocator() noexcept = default;
+  explicit FrameAllocator(FrameSlab* targetSlab) noexcept : slab(targetSlab) {}
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U>& other) noexcept : slab(other.slab) {}
+
+  T* allocate(std::size_t count) {
+    if (slab == nullptr) {
+      return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+    static_assert(alignof(T) <= FRAME_ARENA_ALIGNMENT,
+                  "FrameSlab cannot align this type.");
+    void* data = slab->allocate(count * sizeof(T), alignof(T));
+    if (data == nullptr) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(data);
+  }
+
+  void deallocate(T* data, std::size_t) noexcept {
+    if (slab == nullptr) {
+      ::operator delete(data);
+    }
+  }
+
+  template <typename U>
+  bool operator==(const FrameAllocator<U>& other) const noexcept {
+    return slab == other.slab;
+  }
+
+  template <typename U>
+  bool operator!=(const FrameAllocator<U>& other) const noexcept {
+    return slab != other.slab;
+  }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+/**
+ * @brief Module-level per-frame arena: one slab for the calling thread plus
+ * one per pool worker.
+ *
+ * Worker slabs are indexed by the `workerIndex` passed to runWorkerJobs /
+ * runChunkedWorkerJobs and must only be used from inside that job, so every
+ * slab is owned by exactly one thread at a time.
+ */
+class FrameArena {
+public:
+  /**
+   * @brief Starts a new frame. No container allocated from the previous frame
+   * may still be alive.
+   */
+  void beginFrame() {
+    recordFrame();
+    main_.reset();
+#if defined(__EMSCRIPTEN_PTHREADS__)
+    // Spawned dispatches are not bounded by the pool capacity.
+    const std::size_t workerSlots =
+        std::max(ensureWorkerPool().capacity(), resolveMaxWorkerCount());
+#else
+    const std::size_t workerSlots = 1;
+#endif
+    if (workers_.size() < workerSlots) {
+      workers_.resize(workerSlots);
+    }
+    for (FrameSlab& slab : workers_) {
+      slab.reset();
+    }
+  }
+
+  FrameSlab& main() {
+    return main_;
+  }
+
+  FrameSlab& worker(std::size_t workerIndex) {
+    return workerIndex < workers_.size() ? workers_[workerIndex] : main_;
+  }
+
+  template <typename T>
+  FrameAllocator<T> mainAllocator() {
+    return FrameAllocator<T>(&main_);
+  }
+
+  template <typename T>
+  FrameAllocator<T> workerAllocator(std::size_t workerIndex) {
+    return FrameAllocator<T>(&worker(workerIndex));
+  }
+
+  struct Stats {
+    uint64_t frames = 0;
+    uint64_t slabCount = 0;
+    uint64_t reservedBytes = 0;
+    // Sum of per-slab peaks: the most the arena has ever needed at once.
+    uint64_t highWaterBytes = 0;
+    uint64_t lastFrameBytes = 0;
+    // Largest total of a single frame across all slabs.
+    uint64_t peakFrameBytes = 0;
+    uint64_t blockAllocations = 0;
+  };
+
+  Stats stats() const {
+    Stats result = stats_;
+    result.slabCount = workers_.size() + 1;
+    result.reservedBytes = main_.reserved();
+    result.highWaterBytes = main_.highWater();
+    result.blockAllocations = main_.blockAllocations();
+    for (const FrameSlab& slab : workers_) {
+      result.reservedBytes += slab.reserved();
+      result.highWaterBytes += slab.highWater();
+      result.blockAllocations += slab.blockAllocations();
+    }
+    // Slabs are only rewound when the next frame begins, so what is in use
+    // now is what the last frame needed.
+    result.lastFrameBytes = currentFrameBytes();
+    result.peakFrameBytes =
+        std::max(result.peakFrameBytes, result.lastFrameBytes);
+    return result;
+  }
+
+private:
+  uint64_t currentFrameBytes() const {
+    uint64_t total = main_.used();
+    for (const FrameSlab& slab : workers_) {
+      total += slab.used();
+    }
+    return total;
+  }
+
+  void recordFrame() {
+    stats_.peakFrameBytes =
+        std::max<uint64_t>(stats_.peakFrameBytes, currentFrameBytes());
+    stats_.frames += 1;
+  }
+
+  FrameSlab main_;
+  std::vector<FrameSlab> workers_;
+  Stats stats_;
+};
+
+#endif
@@ -0,0 +1,413 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _INTERPOLATION_EASING_H
+#define _INTERPOLATION_EASING_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include <emscripten/emscripten.h>
+
+#include "calculation_host_common.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Easing and channel evaluation shared by the marshalled interpolation batches
+// (interpolation.cpp) and the resident interpolation table
+// (interpolation_store.h).
+
+constexpr double DISTANCE_EPSILON = 1e-6;
+constexpr double DEGREE_EPSILON = 1e-6;
+
+enum class DistanceInterpolationChannel : int32_t {
+  OffsetMeters = 0,
+  Opacity = 1,
+};
+
+enum class DegreeInterpolationChannel : int32_t {
+  Rotation = 0,
+  OffsetDeg = 1,
+};
+
+struct EasingPreset {
+  int32_t presetId = 0;
+  double param0 = 0.0;
+  double param1 = 0.0;
+  double param2 = 0.0;
+};
+
+static inline double clamp01(double value) {
+  if (!std::isfinite(value)) {
+    return 1.0;
+  }
+  if (value <= 0.0) {
+    return 0.0;
+  }
+  if (value >= 1.0) {
+    return 1.0;
+  }
+  return value;
+}
+
+static inline int decodeMode(double modeCode) {
+  if (modeCode == 1.0) {
+    return 1;  // in
+  }
+  if (modeCode == 2.0) {
+    return 2;  // out
+  }
+  return 0;  // in-out
+}
+
+static inline double applyEasingPreset(double progress,
+                                       int32_t presetId,
+                                       double param0,
+                                       double param1,
+                                       double param2) {
+  (void)param2;
+  constexpr double PI = 3.14159265358979323846;
+  const double t = clamp01(progress);
+  switch (presetId) {
+    case 0:  // linear
+    default:
+      return t;
+    case 1: {  // ease (power param0, mode param1)
+      const double power = param0 > 0.0 ? param0 : 3.0;
+      const int mode = decodeMode(param1);
+      if (mode == 1) {
+        return std::pow(t, power);
+      }
+      if (mode == 2) {
+        return 1.0 - std::pow(1.0 - t, power);
+      }
+      if (t < 0.5) {
+        const double x = t * 2.0;
+        return 0.5 * std::pow(x, power);
+      }
+      const double x = 2.0 - t * 2.0;
+      return 1.0 - 0.5 * std::pow(x, power);
+    }
+    case 4: {  // exponential (exponent param0, mode param1)
+      const double exponent = param0 > 0.0 ? param0 : 5.0;
+      const int mode = decodeMode(param1);
+      const double denom = std::expm1(exponent);
+      auto expIn = [&](double v) -> double {
+        if (v == 0.0) {
+          return 0.0;
+        }
+        if (v == 1.0) {
+          return 1.0;
+        }
+        return std::expm1(exponent * v) / denom;
+      };
+      auto expOut = [&](double v) -> double {
+        if (v == 0.0) {
+          return 0.0;
+        }
+        if (v == 1.0) {
+          return 1.0;
+        }
+        return 1.0 - std::expm1(exponent * (1.0 - v)) / denom;
+      };
+      switch (mode) {
+        case 1:  // in
+          return expIn(t);
+        case 2:  // out
+          return expOut(t);
+        default:  // in-out
+          if (t < 0.5) {
+            return 0.5 * expIn(t * 2.0);
+          }
+          return 0.5 + 0.5 * expOut(t * 2.0 - 1.0);
+      }
+    }
+    case 5: {  // quadratic (mode param0)
+      const int mode = decodeMode(param0);
+      if (mode == 1) {
+        return t * t;
+      }
+      if (mode == 2) {
+        return 1.0 - (1.0 - t) * (1.0 - t);
+      }
+      if (t < 0.5) {
+        const double x = t * 2.0;
+        return 0.5 * x * x;
+      }
+      const double x = 2.0 - t * 2.0;
+      return 1.0 - 0.5 * x * x;
+    }
+    case 6: {  // cubic (mode param0)
+      const int mode = decodeMode(param0);
+      if (mode == 1) {
+        return t * t * t;
+      }
+      if (mode == 2) {
+        const double inv = 1.0 - t;
+        return 1.0 - inv * inv * inv;
+      }
+      if (t < 0.5) {
+        const double x = t * 2.0;
+        return 0.5 * x * x * x;
+      }
+      const double x = 2.0 - t * 2.0;
+      return 1.0 - 0.5 * x * x * x;
+    }
+    case 7: {  // sine (mode param0, amplitude param1)
+      const int mode = decodeMode(param0);
+      const double amplitude = param1 > 0.0 ? param1 : 1.0;
+      if (mode == 1) {  // in
+        return amplitude * (1.0 - std::cos((PI / 2.0) * t));
+      }
+      if (mode == 2) {  // out
+        return amplitude * std::sin((PI / 2.0) * t);
+      }
+      return amplitude * 0.5 * (1.0 - std::cos(PI * t));
+    }
+    case 8: {  // bounce (bounces param0, decay param1)
+      const double bounces =
+          std::max(1.0, std::round(param0 > 0.0 ? param0 : 3.0));
+      const double decay =
+          param1 <= 0.0 ? 0.5 : (param1 > 1.0 ? 1.0 : param1);
+      const double oscillation = std::cos(PI * (bounces + 0.5) * t);
+      const double dampening = std::pow(decay, t * bounces);
+      return 1.0 - std::abs(oscillation) * dampening;
+    }
+    case 9: {  // back (overshoot param0)
+      const double overshoot =
+          (std::isfinite(param0) && param0 != 0.0) ? param0 : 1.70158;
+      const double c3 = overshoot + 1.0;
+      const double p = t - 1.0;
+      return 1.0 + c3 * p * p * p + overshoot * p * p;
+    }
+  }
+}
+
+static inline double applyEasingPreset(double progress,
+                                       const EasingPreset& easing) {
+  return applyEasingPreset(progress, easing.presetId, easing.param0,
+                           easing.param1, easing.param2);
+}
+
+static inline double resolveTimestamp(double timestamp) {
+  if (std::isfinite(timestamp)) {
+    return timestamp;
+  }
+  return emscripten_get_now();
+}
+
+static inline double resolveEffectiveStart(double startTimestamp,
+                                           double timestamp) {
+  return startTimestamp >= 0.0 ? startTimestamp : timestamp;
+}
+
+static inline double lerp(double from, double to, double ratio) {
+  return from + (to - from) * ratio;
+}
+
+static inline double clampOpacity(double value) {
+  if (!std::isfinite(value)) {
+    return 0.0;
+  }
+  if (value <= 0.0) {
+    return 0.0;
+  }
+  if (value >= 1.0) {
+    return 1.0;
+  }
+  return value;
+}
+
+/**
+ * @brief Unclamped progress of an animation at `timestamp`.
+ */
+static inline double resolveInterpolationProgress(double duration,
+                                                  double effectiveStart,
+                                                  double timestamp) {
+  const double elapsed = timestamp - effectiveStart;
+  return duration <= 0.0 ? 1.0 : elapsed / duration;
+}
+
+static inline bool requiresScalarInterpolation(double duration,
+                                               double from,
+                                               double pathTarget,
+                                               double epsilon) {
+  return duration > 0.0 && std::fabs(pathTarget - from) > epsilon;
+}
+
+/**
+ * @brief Completes a scalar channel from its progress and eased ratio.
+ * @return true once the animation completed; `outValue` is then `finalValue`.
+ */
+static inline bool finishScalarInterpolation(double from,
+                                             double pathTarget,
+                                             double finalValue,
+                                             double rawProgress,
+                                             double eased,
+                                             double& outValue) {
+  const double interpolated = lerp(from, pathTarget, eased);
+  const bool completed = rawProgress >= 1.0;
+  outValue = completed ? finalValue : interpolated;
+  return completed;
+}
+
+/**
+ * @brief Evaluates one scalar channel at `timestamp`.
+ * @return true once the animation completed; `outValue` is then `finalValue`.
+ */
+static inline bool evaluateScalarInterpolation(double duration,
+                                               double from,
+                                               double pathTarget,
+                                               double finalValue,
+                                               double epsilon,
+                                               double effectiveStart,
+                                               double timestamp,
+                                               const EasingPreset& easing,
+                                               double& outValue) {
+  outValue = finalValue;
+  if (!requiresScalarInterpolation(duration, from, pathTarget, epsilon)) {
+    return true;
+  }
+  const double rawProgress =
+      resolveInterpolationProgress(duration, effectiveStart, timestamp);
+  const double eased = applyEasingPreset(rawProgress, easing);
+  return finishScalarInterpolation(
+      from, pathTarget, finalValue, rawProgress, eased, outValue);
+}
+
+/**
+ * @brief Applies the per-channel normalization of distance channels.
+ */
+static inline double normalizeDistanceChannel(int32_t channel, double value) {
+  const bool isOpacity =
+      channel == static_cast<int32_t>(DistanceInterpolationChannel::Opacity);
+  return isOpacity ? clampOpacity(value) : value;
+}
+
+/**
+ * @brief Applies the per-channel normalization of degree channels.
+ */
+static inline double normalizeDegreeChannel(int32_t channel, double value) {
+  const bool normalize =
+      channel == static_cast<int32_t>(DegreeInterpolationChannel::Rotation);
+  return normalize ? normalizeAngleDeg(value) : value;
+}
+
+static inline bool requiresLocationInterpolation(double duration,
+                                                 const double (&from)[3],
+                                                 const double (&to)[3],
+                                                 bool hasZ) {
+  return duration > 0.0 &&
+         (std::fabs(to[0] - from[0]) > DISTANCE_EPSILON ||
+          std::fabs(to[1] - from[1]) > DISTANCE_EPSILON ||
+          (hasZ && std::fabs(to[2] - from[2]) > DISTANCE_EPSILON));
+}
+
+/**
+ * @brief Completes a sprite location from its progress and eased ratio.
+ * `outLocation` must hold the target location.
+ * @return true once the animation completed.
+ */
+static inline bool finishLocationInterpolation(const double (&from)[3],
+                                               const double (&to)[3],
+                                               bool hasZ,
+                                               double rawProgress,
+                                               double eased,
+                                               double (&outLocation)[3]) {
+  const bool completed = rawProgress >= 1.0;
+  if (!completed) {
+    outLocation[0] = lerp(from[0], to[0], eased);
+    outLocation[1] = lerp(from[1], to[1], eased);
+    if (hasZ) {
+      outLocation[2] = lerp(from[2], to[2], eased);
+    }
+  }
+  return completed;
+}
+
+/**
+ * @brief Evaluates a sprite location at `timestamp`. `outLocation` starts out
+ * as the target location.
+ * @return true once the animation completed.
+ */
+static inline bool evaluateLocationInterpolation(double duration,
+                                                 const double (&from)[3],
+                                                 const double (&to)[3],
+                                                 bool hasZ,
+                                                 double effectiveStart,
+                                                 double timestamp,
+                                                 const EasingPreset& easing,
+                                                 double (&outLocation)[3]) {
+  outLocation[0] = to[0];
+  outLocation[1] = to[1];
+  outLocation[2] = to[2];
+
+  if (!requiresLocationInterpolation(duration, from, to, hasZ)) {
+    return true;
+  }
+
+  const double rawProgress =
+      resolveInterpolationProgress(duration, effectiveStart, timestamp);
+  const double eased = applyEasingPreset(rawProgress, easing);
+  return finishLocationInterpolation(
+      from, to, hasZ, rawProgress, eased, outLocation);
+}
+
+static inline void writeSpriteInterpolationResult(double* target,
+                                                  double lng,
+                                                  double lat,
+                                                  double z,
+                                                  bool hasZ,
+                                                  bool completed,
+                                                  double effectiveStart) {
+  target[0] = lng;
+  target[1] = lat;
+  target[2] = hasZ ? z : 0.0;
+  target[3] = hasZ ? 1.0 : 0.0;
+  target[4] = completed ? 1.0 : 0.0;
+  target[5] = effectiveStart;
+}
+
+/**
+ * @brief Evaluates one marshalled sprite interpolation item
+ * (SPRITE_INTERPOLATION_ITEM_LENGTH) and writes its result record
+ * (SPRITE_INTERPOLATION_RESULT_LENGTH).
+ * @return true when the item carries an altitude (`outLocation[2]`).
+ */
+static inline bool evaluateSpriteInterpolationItem(const double* item,
+                                                   double* result,
+                                                   double (&outLocation)[3]) {
+  const double duration = item[0];
+  const double from[3] = {item[1], item[2], item[3]};
+  const double to[3] = {item[4], item[5], item[6]};
+  const bool hasZ = item[7] != 0.0;
+  const double startTimestamp = item[8];
+  const double timestampRaw = item[9];
+  const EasingPreset easing{static_cast<int32_t>(item[10]),
+                            item[11],
+                            item[12],
+                            item[13]};
+
+  const double timestamp = resolveTimestamp(timestampRaw);
+  const double effectiveStart =
+      resolveEffectiveStart(startTimestamp, timestamp);
+
+  const bool completed = evaluateLocationInterpolation(duration,
+                                                       from,
+                                                       to,
+                                                       hasZ,
+                                                       effectiveStart,
+                                                       timestamp,
+                                                       easing,
+                                                       outLocation);
+  writeSpriteInterpolationResult(result, outLocation[0], outLocation[1],
+                                 outLocation[2], hasZ, completed,
+                                 effectiveStart);
+  return hasZ;
+}
+
+#endif
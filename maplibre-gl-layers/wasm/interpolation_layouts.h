@@ -18,12 +18,20 @@ constexpr std::size_t DEGREE_INTERPOLATION_ITEM_LENGTH = 11;
 constexpr std::size_t DEGREE_INTERPOLATION_RESULT_LENGTH = 4;
 constexpr std::size_t SPRITE_INTERPOLATION_ITEM_LENGTH = 14;
 constexpr std::size_t SPRITE_INTERPOLATION_RESULT_LENGTH = 6;
-constexpr std::size_t PROCESS_INTERPOLATIONS_HEADER_LENGTH = 3;
+constexpr std::size_t PROCESS_INTERPOLATIONS_HEADER_LENGTH = 4;
+// processInterpolations header flags. The result header echoes the flags that
+// were applied.
+constexpr int PROCESS_INTERPOLATIONS_FLAG_EASING_TABLES = 1 << 0;
+// prepareInterpolatedSpriteImages: spriteHandle, then a sprite interpolation
+// item. Results use SPRITE_INTERPOLATION_RESULT_LENGTH.
+constexpr std::size_t PREPARE_SPRITE_INTERPOLATION_ITEM_LENGTH =
+    1 + SPRITE_INTERPOLATION_ITEM_LENGTH;
 
 struct ProcessInterpolationsHeader {
   double distanceCount;
   double degreeCount;
   double spriteCount;
+  double flags;
 };
 
 static_assert(sizeof(ProcessInterpolationsHeader) ==
@@ -0,0 +1,439 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _INTERPOLATION_STORE_H
+#define _INTERPOLATION_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "calculation_host_common.h"
+#include "calculation_host_layouts.h"
+#include "interpolation_easing.h"
+#include "sprite_store.h"
+#include "worker_jobs.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Resident interpolation batch layouts.
+//
+// Batches start with RESIDENT_BATCH_HEADER_LENGTH doubles (entry count), like
+// the sprite store batches:
+//   locations: spriteHandle, duration, fromLng, fromLat, fromZ, toLng, toLat,
+//              toZ, hasZ, startTimestamp, easingPresetId, easingParam0..2
+//              (RESIDENT_LOCATION_INTERPOLATION_STRIDE).
+//   channels:  spriteHandle, imageId, kind, channel, duration, from,
+//              pathTarget, finalValue, startTimestamp, easingPresetId,
+//              easingParam0..2 (RESIDENT_CHANNEL_INTERPOLATION_STRIDE).
+//   cancels:   interpolation keys.
+//
+// An interpolation key is spriteHandle, imageId, kind, channel
+// (RESIDENT_INTERPOLATION_KEY_STRIDE). Location keys use kind 2 and ignore
+// imageId/channel. Channel kinds are 0 (distance: offsetMeters, opacity) and
+// 1 (degree: rotation, offsetDeg), with the channel codes of the marshalled
+// interpolation batches. A negative startTimestamp starts the animation at the
+// first advance.
+//
+// Advancing writes the number of finished interpolations followed by their
+// keys. An interpolation finishes when it completes or when its sprite/image
+// is no longer stored.
+
+constexpr std::size_t RESIDENT_LOCATION_INTERPOLATION_STRIDE = 14;
+constexpr std::size_t RESIDENT_CHANNEL_INTERPOLATION_STRIDE = 13;
+constexpr std::size_t RESIDENT_INTERPOLATION_KEY_STRIDE = 4;
+// Channels per channel kind (both distance and degree kinds have two).
+constexpr int32_t RESIDENT_INTERPOLATION_CHANNEL_COUNT = 2;
+
+constexpr std::size_t RESIDENT_INTERPOLATION_PARALLEL_MIN_ITEMS = 512;
+constexpr std::size_t RESIDENT_INTERPOLATION_PARALLEL_SLICE = 256;
+
+enum class ResidentInterpolationKind : int32_t {
+  Distance = 0,
+  Degree = 1,
+  Location = 2,
+};
+
+/**
+ * @brief Animations registered once and advanced in the module every frame.
+ *
+ * Advancing evaluates every track in parallel, then writes the results into
+ * the ResidentSpriteStore (sprite locations, or the opacity, offset and
+ * rotation fields of images) so the next resident prepare picks them up. Only
+ * the keys of finished tracks go back to the caller.
+ *
+ * Batch entry points validate every entry before applying any, so a batch
+ * that returns false leaves the table unchanged.
+ */
+class ResidentInterpolationTable {
+public:
+  bool upsertLocations(const double* entriesPtr, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      int64_t handle = 0;
+      if (!convertToInt64(
+              entriesPtr[i * RESIDENT_LOCATION_INTERPOLATION_STRIDE], handle)) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry =
+          entriesPtr + i * RESIDENT_LOCATION_INTERPOLATION_STRIDE;
+      LocationTrack track;
+      convertToInt64(entry[0], track.spriteHandle);
+      track.duration = entry[1];
+      track.from[0] = entry[2];
+      track.from[1] = entry[3];
+      track.from[2] = entry[4];
+      track.to[0] = entry[5];
+      track.to[1] = entry[6];
+      track.to[2] = entry[7];
+      track.hasZ = entry[8] != 0.0;
+      track.startTimestamp = entry[9];
+      track.easing = readEasing(entry + 10);
+
+      const auto found = locationSlots_.find(track.spriteHandle);
+      if (found == locationSlots_.end()) {
+        locationSlots_.emplace(track.spriteHandle, locations_.size());
+        locations_.push_back(track);
+      } else {
+        locations_[found->second] = track;
+      }
+    }
+    return true;
+  }
+
+  bool upsertChannels(const double* entriesPtr, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      ChannelKey key;
+      std::size_t field = 0;
+      if (!readChannelKey(
+              entriesPtr + i * RESIDENT_CHANNEL_INTERPOLATION_STRIDE, key) ||
+          !resolveChannelField(key, field)) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry =
+          entriesPtr + i * RESIDENT_CHANNEL_INTERPOLATION_STRIDE;
+      ChannelTrack track;
+      readChannelKey(entry, track.key);
+      resolveChannelField(track.key, track.field);
+      track.duration = entry[4];
+      track.from = entry[5];
+      track.pathTarget = entry[6];
+      track.finalValue = entry[7];
+      track.startTimestamp = entry[8];
+      track.easing = readEasing(entry + 9);
+
+      const auto found = channelSlots_.find(track.key);
+      if (found == channelSlots_.end()) {
+        channelSlots_.emplace(track.key, channels_.size());
+        channels_.push_back(track);
+      } else {
+        channels_[found->second] = track;
+      }
+    }
+    return true;
+  }
+
+  bool cancel(const double* keysPtr, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      if (!isValidKey(keysPtr + i * RESIDENT_INTERPOLATION_KEY_STRIDE)) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry = keysPtr + i * RESIDENT_INTERPOLATION_KEY_STRIDE;
+      if (entry[2] == static_cast<double>(ResidentInterpolationKind::Location)) {
+        int64_t handle = 0;
+        convertToInt64(entry[0], handle);
+        const auto found = locationSlots_.find(handle);
+        if (found != locationSlots_.end()) {
+          removeLocationAt(found->second);
+        }
+        continue;
+      }
+      ChannelKey key;
+      readChannelKey(entry, key);
+      const auto found = channelSlots_.find(key);
+      if (found != channelSlots_.end()) {
+        removeChannelAt(found->second);
+      }
+    }
+    return true;
+  }
+
+  void clear() {
+    locations_.clear();
+    locationSlots_.clear();
+    channels_.clear();
+    channelSlots_.clear();
+  }
+
+  std::size_t trackCount() const {
+    return locations_.size() + channels_.size();
+  }
+
+  /**
+   * @brief Evaluates every track at `timestamp` and applies it to `store`.
+   * `finishedKeys` needs room for trackCount() keys.
+   * @return Number of keys written to `finishedKeys`.
+   */
+  std::size_t advance(double timestamp,
+                      ResidentSpriteStore& store,
+                      double* finishedKeys) {
+    const std::size_t locationCount = locations_.size();
+    parallelFor(locationCount + channels_.size(),
+                RESIDENT_INTERPOLATION_PARALLEL_MIN_ITEMS,
+                RESIDENT_INTERPOLATION_PARALLEL_SLICE,
+                [&](std::size_t start, std::size_t end, std::size_t) {
+                  for (std::size_t index = start; index < end; ++index) {
+                    if (index < locationCount) {
+                      evaluateLocation(locations_[index], timestamp);
+                    } else {
+                      evaluateChannel(channels_[index - locationCount],
+                                      timestamp);
+                    }
+                  }
+                });
+
+    // The store is not thread safe, so results are applied serially.
+    std::size_t finishedCount = 0;
+    for (std::size_t index = 0; index < locations_.size();) {
+      const LocationTrack& track = locations_[index];
+      const bool stored = store.moveSprite(track.spriteHandle,
+                                           track.value[0],
+                                           track.value[1],
+                                           track.hasZ,
+                                           track.value[2]);
+      if (stored && !track.completed) {
+        ++index;
+        continue;
+      }
+      writeKey(finishedKeys + finishedCount * RESIDENT_INTERPOLATION_KEY_STRIDE,
+               track.spriteHandle,
+               -1.0,
+               ResidentInterpolationKind::Location,
+               0);
+      ++finishedCount;
+      removeLocationAt(index);
+    }
+    for (std::size_t index = 0; index < channels_.size();) {
+      const ChannelTrack& track = channels_[index];
+      const bool stored = store.setImageField(track.key.spriteHandle,
+                                              track.key.imageId,
+                                              track.field,
+                                              track.value);
+      if (stored && !track.completed) {
+        ++index;
+        continue;
+      }
+      writeKey(finishedKeys + finishedCount * RESIDENT_INTERPOLATION_KEY_STRIDE,
+               track.key.spriteHandle,
+               static_cast<double>(track.key.imageId),
+               static_cast<ResidentInterpolationKind>(track.key.kind),
+               track.key.channel);
+      ++finishedCount;
+      removeChannelAt(index);
+    }
+    return finishedCount;
+  }
+
+private:
+  struct LocationTrack {
+    int64_t spriteHandle = 0;
+    double duration = 0.0;
+    double from[3] = {0.0, 0.0, 0.0};
+    double to[3] = {0.0, 0.0, 0.0};
+    bool hasZ = false;
+    double startTimestamp = -1.0;
+    EasingPreset easing;
+    // Result of the latest advance.
+    double value[3] = {0.0, 0.0, 0.0};
+    bool completed = false;
+  };
+
+  struct ChannelKey {
+    int64_t spriteHandle = 0;
+    std::size_t imageId = 0;
+    int32_t kind = 0;
+    int32_t channel = 0;
+    bool operator==(const ChannelKey& other) const {
+      return spriteHandle == other.spriteHandle && imageId == other.imageId &&
+             kind == other.kind && channel == other.channel;
+    }
+  };
+
+  struct ChannelKeyHash {
+    std::size_t operator()(const ChannelKey& key) const {
+      return std::hash<int64_t>()(key.spriteHandle) * 31u +
+             std::hash<std::size_t>()(key.imageId) * 17u +
+             static_cast<std::size_t>(key.kind * 2 + key.channel);
+    }
+  };
+
+  struct ChannelTrack {
+    ChannelKey key;
+    // InputItemEntry field written by this track.
+    std::size_t field = 0;
+    double duration = 0.0;
+    double from = 0.0;
+    double pathTarget = 0.0;
+    double finalValue = 0.0;
+    double startTimestamp = -1.0;
+    EasingPreset easing;
+    // Result of the latest advance.
+    double value = 0.0;
+    bool completed = false;
+  };
+
+  static inline std::size_t itemField(std::size_t byteOffset) {
+    return byteOffset / sizeof(double);
+  }
+
+  static inline EasingPreset readEasing(const double* entry) {
+    return EasingPreset{static_cast<int32_t>(entry[0]),
+                        entry[1],
+                        entry[2],
+                        entry[3]};
+  }
+
+  /**
+   * @brief Whether cancel() accepts an interpolation key.
+   */
+  static inline bool isValidKey(const double* entry) {
+    if (entry[2] == static_cast<double>(ResidentInterpolationKind::Location)) {
+      int64_t handle = 0;
+      return convertToInt64(entry[0], handle);
+    }
+    ChannelKey key;
+    return readChannelKey(entry, key);
+  }
+
+  /**
+   * @brief Reads an integral code in [0, count); fractional, negative or
+   * out-of-range values are rejected rather than truncated.
+   */
+  static inline bool readKeyCode(double value, int32_t count, int32_t& out) {
+    if (!std::isfinite(value) || value < 0.0 ||
+        value >= static_cast<double>(count) || value != std::floor(value)) {
+      return false;
+    }
+    out = static_cast<int32_t>(value);
+    return true;
+  }
+
+  static inline bool readChannelKey(const double* entry, ChannelKey& out) {
+    return convertToInt64(entry[0], out.spriteHandle) &&
+           convertToSizeT(entry[1], out.imageId) &&
+           readKeyCode(entry[2],
+                       static_cast<int32_t>(ResidentInterpolationKind::Location),
+                       out.kind) &&
+           readKeyCode(entry[3], RESIDENT_INTERPOLATION_CHANNEL_COUNT,
+                       out.channel);
+  }
+
+  static inline bool resolveChannelField(const ChannelKey& key,
+                                         std::size_t& out) {
+    switch (static_cast<ResidentInterpolationKind>(key.kind)) {
+      case ResidentInterpolationKind::Distance:
+        switch (static_cast<DistanceInterpolationChannel>(key.channel)) {
+          case DistanceInterpolationChannel::OffsetMeters:
+            out = itemField(offsetof(InputItemEntry, offsetMeters));
+            return true;
+          case DistanceInterpolationChannel::Opacity:
+            out = itemField(offsetof(InputItemEntry, opacity));
+            return true;
+        }
+        return false;
+      case ResidentInterpolationKind::Degree:
+        switch (static_cast<DegreeInterpolationChannel>(key.channel)) {
+          case DegreeInterpolationChannel::Rotation:
+            out = itemField(offsetof(InputItemEntry, displayedRotateDeg));
+            return true;
+          case DegreeInterpolationChannel::OffsetDeg:
+            out = itemField(offsetof(InputItemEntry, offsetDeg));
+            return true;
+        }
+        return false;
+      default:
+        return false;
+    }
+  }
+
+  static inline void writeKey(double* target,
+                              int64_t spriteHandle,
+                              double imageId,
+                              ResidentInterpolationKind kind,
+                              int32_t channel) {
+    target[0] = static_cast<double>(spriteHandle);
+    target[1] = imageId;
+    target[2] = static_cast<double>(kind);
+    target[3] = static_cast<double>(channel);
+  }
+
+  static inline void evaluateLocation(LocationTrack& track, double timestamp) {
+    // Pin a deferred start so later frames continue the same animation.
+    track.startTimestamp = resolveEffectiveStart(track.startTimestamp,
+                                                 timestamp);
+    track.completed = evaluateLocationInterpolation(track.duration,
+                                                    track.from,
+                                                    track.to,
+                                                    track.hasZ,
+                                                    track.startTimestamp,
+                                                    timestamp,
+                                                    track.easing,
+                                                    track.value);
+  }
+
+  static inline void evaluateChannel(ChannelTrack& track, double timestamp) {
+    track.startTimestamp = resolveEffectiveStart(track.startTimestamp,
+                                                 timestamp);
+    const bool isDegree =
+        track.key.kind == static_cast<int32_t>(ResidentInterpolationKind::Degree);
+    double value = track.finalValue;
+    track.completed = evaluateScalarInterpolation(
+        track.duration,
+        track.from,
+        track.pathTarget,
+        track.finalValue,
+        isDegree ? DEGREE_EPSILON : DISTANCE_EPSILON,
+        track.startTimestamp,
+        timestamp,
+        track.easing,
+        value);
+    track.value = isDegree ? normalizeDegreeChannel(track.key.channel, value)
+                           : normalizeDistanceChannel(track.key.channel, value);
+  }
+
+  void removeLocationAt(std::size_t index) {
+    locationSlots_.erase(locations_[index].spriteHandle);
+    const std::size_t last = locations_.size() - 1;
+    if (index != last) {
+      locations_[index] = locations_[last];
+      locationSlots_[locations_[index].spriteHandle] = index;
+    }
+    locations_.pop_back();
+  }
+
+  void removeChannelAt(std::size_t index) {
+    channelSlots_.erase(channels_[index].key);
+    const std::size_t last = channels_.size() - 1;
+    if (index != last) {
+      channels_[index] = channels_[last];
+      channelSlots_[channels_[index].key] = index;
+    }
+    channels_.pop_back();
+  }
+
+  std::vector<LocationTrack> locations_;
+  std::unordered_map<int64_t, std::size_t> locationSlots_;
+  std::vector<ChannelTrack> channels_;
+  std::unordered_map<ChannelKey, std::size_t, ChannelKeyHash> channelSlots_;
+};
+
+#endif
@@ -4,9 +4,325 @@
 // Under MIT
 
 #include "projection_host.h"
+#include "worker_jobs.h"
 
 #include <emscripten/emscripten.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#ifdef SIMD_ENABLED
+#include <wasm_simd128.h>
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+// Batches are split on whole validity mask words, so no two workers ever
+// write the same word.
+constexpr std::size_t BATCH_MASK_WORD_POINTS = 32;
+constexpr std::size_t BATCH_MIN_PARALLEL_POINTS = 8192;
+constexpr std::size_t BATCH_SLICE_POINTS = 4096;
+
+constexpr double BATCH_INVALID_VALUE = std::numeric_limits<double>::quiet_NaN();
+
+// Batch `flags` bits.
+constexpr int BATCH_FLAG_FAST_MERCATOR_MATH = 1 << 0;
+
+/**
+ * @brief Validates the common batch arguments. Empty batches accept any
+ * pointers.
+ * @return false when the batch cannot be processed at all.
+ */
+static inline bool validateBatchArguments(const double* input,
+                                          int count,
+                                          int stride,
+                                          int minStride,
+                                          double worldSize,
+                                          const double* matrix,
+                                          const double* out,
+                                          const uint32_t* validMask) {
+  if (count < 0 || stride < minStride) {
+    return false;
+  }
+  if (count == 0) {
+    return true;
+  }
+  if (input == nullptr || matrix == nullptr || out == nullptr ||
+      validMask == nullptr) {
+    return false;
+  }
+  return std::isfinite(worldSize) && worldSize > 0.0;
+}
+
+/**
+ * @brief Runs `fn(startPoint, endPoint, wordIndex)` for every mask word,
+ * spreading the words over the worker pool for large batches.
+ */
+template <typename Fn>
+static inline void runBatchByMaskWords(std::size_t count, Fn&& fn) {
+  const std::size_t wordCount =
+      (count + BATCH_MASK_WORD_POINTS - 1) / BATCH_MASK_WORD_POINTS;
+  parallelFor(wordCount,
+              BATCH_MIN_PARALLEL_POINTS / BATCH_MASK_WORD_POINTS,
+              BATCH_SLICE_POINTS / BATCH_MASK_WORD_POINTS,
+              [&](std::size_t startWord, std::size_t endWord, std::size_t) {
+                for (std::size_t word = startWord; word < endWord; ++word) {
+                  const std::size_t start = word * BATCH_MASK_WORD_POINTS;
+                  fn(start,
+                     std::min(count, start + BATCH_MASK_WORD_POINTS),
+                     word);
+                }
+              });
+}
+
+static inline uint32_t projectBatchPoint(const double* point,
+                                         double worldSize,
+                                         const double* matrix,
+                                         double* out) {
+  if (__project(point[0], point[1], point[2], worldSize, matrix, out)) {
+    return 1u;
+  }
+  out[0] = BATCH_INVALID_VALUE;
+  out[1] = BATCH_INVALID_VALUE;
+  return 0u;
+}
+
+static inline uint32_t unprojectBatchPoint(const double* point,
+                                           double worldSize,
+                                           const double* matrix,
+                                           double* out) {
+  if (__unproject(point[0], point[1], worldSize, matrix, out)) {
+    return 1u;
+  }
+  out[0] = BATCH_INVALID_VALUE;
+  out[1] = BATCH_INVALID_VALUE;
+  return 0u;
+}
+
+#ifdef SIMD_ENABLED
+// Lane-wise finite test: x - x is 0 only for finite values.
+static inline v128_t simdIsFinite(v128_t value) {
+  return wasm_f64x2_eq(wasm_f64x2_sub(value, value), wasm_f64x2_splat(0.0));
+}
+
+/**
+ * @brief Matrix row times (x, y, z, w) in two lanes, summed in the same order
+ * as the scalar path so both produce identical results.
+ */
+static inline v128_t simdMatrixRow(const double* matrix,
+                                   std::size_t row,
+                                   v128_t x,
+                                   v128_t y,
+                                   v128_t z,
+                                   v128_t w) {
+  return wasm_f64x2_add(
+      wasm_f64x2_add(
+          wasm_f64x2_add(wasm_f64x2_mul(wasm_f64x2_splat(matrix[row]), x),
+                         wasm_f64x2_mul(wasm_f64x2_splat(matrix[row + 4]), y)),
+          wasm_f64x2_mul(wasm_f64x2_splat(matrix[row + 8]), z)),
+      wasm_f64x2_mul(wasm_f64x2_splat(matrix[row + 12]), w));
+}
+
+/**
+ * @brief Writes two (x, y) pairs, replacing rejected lanes with NaN.
+ * @return Validity bits of both points.
+ */
+static inline uint32_t storeBatchPair(v128_t x, v128_t y, v128_t valid, double* out) {
+  const v128_t invalid = wasm_f64x2_splat(BATCH_INVALID_VALUE);
+  const v128_t maskedX = wasm_v128_bitselect(x, invalid, valid);
+  const v128_t maskedY = wasm_v128_bitselect(y, invalid, valid);
+  wasm_v128_store(out, wasm_i64x2_shuffle(maskedX, maskedY, 0, 2));
+  wasm_v128_store(out + 2, wasm_i64x2_shuffle(maskedX, maskedY, 1, 3));
+  return wasm_i64x2_bitmask(valid);
+}
+
+/**
+ * @brief SIMD counterpart of `__project` for two points. Mercator conversion
+ * stays scalar unless fast mercator math is enabled; the matrix transform and
+ * divide run in both lanes.
+ */
+static inline uint32_t projectBatchPair(const double* point0,
+                                        const double* point1,
+                                        double worldSize,
+                                        const double* matrix,
+                                        double* out) {
+  const v128_t size = wasm_f64x2_splat(worldSize);
+  const v128_t worldX = wasm_f64x2_mul(
+      wasm_f64x2_make(mercatorXfromLng(toFiniteOr(point0[0], 0.0)),
+                      mercatorXfromLng(toFiniteOr(point1[0], 0.0))),
+      size);
+  const double lat0 = toFiniteOr(point0[1], 0.0);
+  const double lat1 = toFiniteOr(point1[1], 0.0);
+  const v128_t worldY = wasm_f64x2_mul(
+      g_fastMercatorMath
+          ? fastMercatorYfromLatX2(wasm_f64x2_make(lat0, lat1))
+          : wasm_f64x2_make(mercatorYfromLat(lat0), mercatorYfromLat(lat1)),
+      size);
+  const v128_t elevation = wasm_f64x2_make(toFiniteOr(point0[2], 0.0),
+                                           toFiniteOr(point1[2], 0.0));
+  const v128_t one = wasm_f64x2_splat(1.0);
+
+  const v128_t clipX = simdMatrixRow(matrix, 0, worldX, worldY, elevation, one);
+  const v128_t clipY = simdMatrixRow(matrix, 1, worldX, worldY, elevation, one);
+  const v128_t clipW = simdMatrixRow(matrix, 3, worldX, worldY, elevation, one);
+
+  const v128_t valid = wasm_v128_and(
+      wasm_v128_and(simdIsFinite(clipX), simdIsFinite(clipY)),
+      wasm_v128_and(simdIsFinite(clipW),
+                    wasm_f64x2_gt(clipW, wasm_f64x2_splat(0.0))));
+
+  return storeBatchPair(wasm_f64x2_div(clipX, clipW),
+                        wasm_f64x2_div(clipY, clipW),
+                        valid,
+                        out);
+}
+
+/**
+ * @brief SIMD counterpart of `__unproject` for two points. The ray
+ * intersection runs in both lanes; the inverse mercator stays scalar unless
+ * fast mercator math is enabled.
+ */
+static inline uint32_t unprojectBatchPair(const double* point0,
+                                          const double* point1,
+                                          double worldSize,
+                                          const double* matrix,
+                                          double* out) {
+  const v128_t x = wasm_f64x2_make(toFiniteOr(point0[0], 0.0),
+                                   toFiniteOr(point1[0], 0.0));
+  const v128_t y = wasm_f64x2_make(toFiniteOr(point0[1], 0.0),
+                                   toFiniteOr(point1[1], 0.0));
+  const v128_t zero = wasm_f64x2_splat(0.0);
+  const v128_t one = wasm_f64x2_splat(1.0);
+
+  const v128_t coord0X = simdMatrixRow(matrix, 0, x, y, zero, one);
+  const v128_t coord0Y = simdMatrixRow(matrix, 1, x, y, zero, one);
+  const v128_t coord0Z = simdMatrixRow(matrix, 2, x, y, zero, one);
+  const v128_t coord0W = simdMatrixRow(matrix, 3, x, y, zero, one);
+  const v128_t coord1X = simdMatrixRow(matrix, 0, x, y, one, one);
+  const v128_t coord1Y = simdMatrixRow(matrix, 1, x, y, one, one);
+  const v128_t coord1Z = simdMatrixRow(matrix, 2, x, y, one, one);
+  const v128_t coord1W = simdMatrixRow(matrix, 3, x, y, one, one);
+
+  v128_t valid = wasm_v128_and(
+      wasm_v128_and(simdIsFinite(coord0W), simdIsFinite(coord1W)),
+      wasm_v128_and(wasm_f64x2_ne(coord0W, zero), wasm_f64x2_ne(coord1W, zero)));
+
+  const v128_t world0X = wasm_f64x2_div(coord0X, coord0W);
+  const v128_t world0Y = wasm_f64x2_div(coord0Y, coord0W);
+  const v128_t world0Z = wasm_f64x2_div(coord0Z, coord0W);
+  const v128_t world1X = wasm_f64x2_div(coord1X, coord1W);
+  const v128_t world1Y = wasm_f64x2_div(coord1Y, coord1W);
+  const v128_t world1Z = wasm_f64x2_div(coord1Z, coord1W);
+  valid = wasm_v128_and(
+      valid,
+      wasm_v128_and(
+          wasm_v128_and(simdIsFinite(world0X), simdIsFinite(world0Y)),
+          wasm_v128_and(simdIsFinite(world0Z),
+                        wasm_v128_and(simdIsFinite(world1X),
+                                      wasm_v128_and(simdIsFinite(world1Y),
+                                                    simdIsFinite(world1Z))))));
+
+  const v128_t denominator = wasm_f64x2_sub(world1Z, world0Z);
+  const v128_t t = wasm_v128_bitselect(
+      zero,
+      wasm_f64x2_div(wasm_f64x2_sub(zero, world0Z), denominator),
+      wasm_f64x2_eq(denominator, zero));
+
+  const v128_t worldX = wasm_f64x2_add(
+      world0X, wasm_f64x2_mul(wasm_f64x2_sub(world1X, world0X), t));
+  const v128_t worldY = wasm_f64x2_add(
+      world0Y, wasm_f64x2_mul(wasm_f64x2_sub(world1Y, world0Y), t));
+  const v128_t size = wasm_f64x2_splat(worldSize);
+  const v128_t mercatorX = wasm_f64x2_div(worldX, size);
+  const v128_t mercatorY = wasm_f64x2_div(worldY, size);
+  valid = wasm_v128_and(
+      valid,
+      wasm_v128_and(
+          wasm_v128_and(simdIsFinite(worldX), simdIsFinite(worldY)),
+          wasm_v128_and(simdIsFinite(mercatorX), simdIsFinite(mercatorY))));
+
+  uint32_t bits = wasm_i64x2_bitmask(valid);
+  const double mercatorXs[2] = {wasm_f64x2_extract_lane(mercatorX, 0),
+                                wasm_f64x2_extract_lane(mercatorX, 1)};
+  const double mercatorYs[2] = {wasm_f64x2_extract_lane(mercatorY, 0),
+                                wasm_f64x2_extract_lane(mercatorY, 1)};
+  double fastLats[2];
+  if (g_fastMercatorMath) {
+    wasm_v128_store(fastLats, fastLatFromMercatorYX2(mercatorY));
+  }
+  for (std::size_t lane = 0; lane < 2; ++lane) {
+    double* target = out + lane * 2;
+    if ((bits & (1u << lane)) != 0) {
+      const double lng = lngFromMercatorX(mercatorXs[lane]);
+      const double lat = clamp(g_fastMercatorMath
+                                   ? fastLats[lane]
+                                   : latFromMercatorY(mercatorYs[lane]),
+                               -MAX_MERCATOR_LATITUDE,
+                               MAX_MERCATOR_LATITUDE);
+      if (std::isfinite(lng) && std::isfinite(lat)) {
+        target[0] = lng;
+        target[1] = lat;
+        continue;
+      }
+      bits &= ~(1u << lane);
+    }
+    target[0] = BATCH_INVALID_VALUE;
+    target[1] = BATCH_INVALID_VALUE;
+  }
+  return bits;
+}
+#else
+static inline uint32_t projectBatchPair(const double* point0,
+                                        const double* point1,
+                                        double worldSize,
+                                        const double* matrix,
+                                        double* out) {
+  return projectBatchPoint(point0, worldSize, matrix, out) |
+         (projectBatchPoint(point1, worldSize, matrix, out + 2) << 1);
+}
+
+static inline uint32_t unprojectBatchPair(const double* point0,
+                                          const double* point1,
+                                          double worldSize,
+                                          const double* matrix,
+                                          double* out) {
+  return unprojectBatchPoint(point0, worldSize, matrix, out) |
+         (unprojectBatchPoint(point1, worldSize, matrix, out + 2) << 1);
+}
+#endif
+
+/**
+ * @brief Applies the kernels to `[start, end)` two points at a time and
+ * returns the mask word.
+ */
+template <typename PointFn, typename PairFn>
+static inline uint32_t processBatchRange(const double* input,
+                                         std::size_t stride,
+                                         double worldSize,
+                                         const double* matrix,
+                                         double* out,
+                                         std::size_t start,
+                                         std::size_t end,
+                                         PointFn&& pointFn,
+                                         PairFn&& pairFn) {
+  uint32_t bits = 0;
+  std::size_t index = start;
+  for (; index + 1 < end; index += 2) {
+    const uint32_t pair = pairFn(input + index * stride,
+                                 input + (index + 1) * stride,
+                                 worldSize,
+                                 matrix,
+                                 out + index * 2);
+    bits |= pair << (index - start);
+  }
+  for (; index < end; ++index) {
+    bits |= pointFn(input + index * stride, worldSize, matrix, out + index * 2)
+            << (index - start);
+  }
+  return bits;
+}
+
 extern "C" {
 
 //////////////////////////////////////////////////////////////////////////////////////
@@ -97,4 +413,103 @@ EMSCRIPTEN_KEEPALIVE bool calculatePerspectiveRatio(double lng,
                              out);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Batch form of `project`.
+ * @param input `count` points of `stride` doubles: lng, lat, altitude, ...
+ * @param count Point count.
+ * @param stride Doubles per input point (at least 3).
+ * @param worldSize World size in pixels.
+ * @param matrix Pixel matrix.
+ * @param out `count` pairs of projected x, y. Rejected points are NaN.
+ * @param validMask `ceil(count / 32)` words; bit `i % 32` of word `i / 32`
+ * is set when point `i` projected.
+ * @param flags `BATCH_FLAG_FAST_MERCATOR_MATH` selects the approximated
+ * mercator conversion (see fast_math.h for its error bounds).
+ * @return false when the arguments are unusable; per-point failures only
+ * clear their mask bit.
+ */
+EMSCRIPTEN_KEEPALIVE bool projectMany(const double* input,
+                                      int count,
+                                      int stride,
+                                      double worldSize,
+                                      const double* matrix,
+                                      double* out,
+                                      uint32_t* validMask,
+                                      int flags) {
+  // Input guards
+  if (!validateBatchArguments(
+          input, count, stride, 3, worldSize, matrix, out, validMask)) {
+    return false;
+  }
+
+  // Invoke main body
+  const ScopedFastMercatorMath fastMercatorMath(
+      (flags & BATCH_FLAG_FAST_MERCATOR_MATH) != 0);
+  const auto pointStride = static_cast<std::size_t>(stride);
+  runBatchByMaskWords(
+      static_cast<std::size_t>(count),
+      [&](std::size_t start, std::size_t end, std::size_t word) {
+        validMask[word] = processBatchRange(input,
+                                            pointStride,
+                                            worldSize,
+                                            matrix,
+                                            out,
+                                            start,
+                                            end,
+                                            projectBatchPoint,
+                                            projectBatchPair);
+      });
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief Batch form of `unproject`.
+ * @param input `count` points of `stride` doubles: x, y, ...
+ * @param count Point count.
+ * @param stride Doubles per input point (at least 2).
+ * @param worldSize World size in pixels.
+ * @param matrix Inverse pixel matrix.
+ * @param out `count` pairs of lng, lat. Rejected points are NaN.
+ * @param validMask Same layout as `projectMany`.
+ * @param flags Same bits as `projectMany`.
+ * @return false when the arguments are unusable.
+ */
+EMSCRIPTEN_KEEPALIVE bool unprojectMany(const double* input,
+                                        int count,
+                                        int stride,
+                                        double worldSize,
+                                        const double* matrix,
+                                        double* out,
+                                        uint32_t* validMask,
+                                        int flags) {
+  // Input guards
+  if (!validateBatchArguments(
+          input, count, stride, 2, worldSize, matrix, out, validMask)) {
+    return false;
+  }
+
+  // Invoke main body
+  const ScopedFastMercatorMath fastMercatorMath(
+      (flags & BATCH_FLAG_FAST_MERCATOR_MATH) != 0);
+  const auto pointStride = static_cast<std::size_t>(stride);
+  runBatchByMaskWords(
+      static_cast<std::size_t>(count),
+      [&](std::size_t start, std::size_t end, std::size_t word) {
+        validMask[word] = processBatchRange(input,
+                                            pointStride,
+                                            worldSize,
+                                            matrix,
+                                            out,
+                                            start,
+                                            end,
+                                            unprojectBatchPoint,
+                                            unprojectBatchPair);
+      });
+  return true;
+}
+
 }  // extern "C"
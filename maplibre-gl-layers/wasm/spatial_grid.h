@@ -0,0 +1,453 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _SPATIAL_GRID_H
+#define _SPATIAL_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// The grid has 2^SPATIAL_GRID_CELL_LEVEL cells per mercator axis
+// (about 2.4 km per cell at the equator).
+constexpr int SPATIAL_GRID_CELL_LEVEL = 14;
+constexpr double SPATIAL_GRID_CELLS_PER_AXIS =
+    static_cast<double>(1 << SPATIAL_GRID_CELL_LEVEL);
+
+/**
+ * @brief Zoom-independent size parameters of a group of images of one kind.
+ *
+ * Each field is the maximum over the group, so the frame can turn them into
+ * an upper bound of the image radius with its own constants.
+ */
+struct SpatialGridImageReach {
+  bool present = false;
+  // |scale|
+  double scale = 0.0;
+  // 0.5 * hypot(1 + |anchorX|, 1 + |anchorY|)
+  double anchorReach = 0.0;
+  // |offsetMeters|
+  double offsetMeters = 0.0;
+  // |offsetMeters * scale|
+  double scaledOffsetMeters = 0.0;
+
+  void merge(const SpatialGridImageReach& other) {
+    if (!other.present) {
+      return;
+    }
+    present = true;
+    scale = std::max(scale, other.scale);
+    anchorReach = std::max(anchorReach, other.anchorReach);
+    offsetMeters = std::max(offsetMeters, other.offsetMeters);
+    scaledOffsetMeters = std::max(scaledOffsetMeters, other.scaledOffsetMeters);
+  }
+};
+
+/**
+ * @brief Conservative extent of the images placed around one or more sprites.
+ *
+ * `unbounded` marks groups that cannot be bounded from their own parameters
+ * (for example images drawn relative to a surface origin); cells holding them
+ * are always visited.
+ */
+struct SpatialGridExtent {
+  SpatialGridImageReach billboards;
+  SpatialGridImageReach surfaces;
+  bool hasBillboardOrigins = false;
+  bool unbounded = false;
+  double minAltitude = std::numeric_limits<double>::infinity();
+  double maxAltitude = -std::numeric_limits<double>::infinity();
+
+  void merge(const SpatialGridExtent& other) {
+    billboards.merge(other.billboards);
+    surfaces.merge(other.surfaces);
+    hasBillboardOrigins = hasBillboardOrigins || other.hasBillboardOrigins;
+    unbounded = unbounded || other.unbounded;
+    minAltitude = std::min(minAltitude, other.minAltitude);
+    maxAltitude = std::max(maxAltitude, other.maxAltitude);
+  }
+};
+
+// Cell ranges at or below this many cells are looked up cell by cell instead
+// of being split further.
+constexpr double SPATIAL_GRID_LEAF_CELLS = 64.0;
+
+/**
+ * @brief Uniform mercator grid over sprite positions.
+ *
+ * Every member carries its extent and each cell keeps the merge of its
+ * members' extents. Cell extents only grow while members come and go; a cell
+ * is re-merged once more members have left or changed than it currently
+ * holds, so moving a sprite costs O(1) amortized. The occupied cell range and
+ * the merged extent of every bounded member follow the same rule grid-wide.
+ */
+class SpatialGridIndex {
+public:
+  struct Cell {
+    int32_t column = 0;
+    int32_t row = 0;
+    std::vector<int64_t> members;
+    SpatialGridExtent extent;
+    std::size_t staleMembers = 0;
+    // Members whose extent is open (see isOpenExtent).
+    std::size_t openMembers = 0;
+  };
+
+  void clear() {
+    entries_.clear();
+    cells_.clear();
+    openCells_.clear();
+    resetBounds();
+  }
+
+  std::size_t size() const {
+    return entries_.size();
+  }
+
+  std::size_t cellCount() const {
+    return cells_.size();
+  }
+
+  /**
+   * @brief Inserts or moves a member.
+   * @return false (and the member is left out of the index) when the
+   * position is not finite.
+   */
+  bool upsert(int64_t handle,
+              double mercatorX,
+              double mercatorY,
+              const SpatialGridExtent& extent) {
+    if (!std::isfinite(mercatorX) || !std::isfinite(mercatorY)) {
+      remove(handle);
+      return false;
+    }
+    const int32_t column = toCellCoordinate(mercatorX);
+    const int32_t row = toCellCoordinate(mercatorY);
+    const uint64_t cellKey = makeCellKey(column, row);
+
+    const auto found = entries_.find(handle);
+    if (found != entries_.end() && found->second.cellKey == cellKey) {
+      Cell& cell = cells_[cellKey];
+      releaseOpenMember(cellKey, cell, found->second.extent);
+      found->second.extent = extent;
+      addOpenMember(cellKey, cell, extent);
+      cell.extent.merge(extent);
+      growBounds(column, row, extent);
+      markStale(cell);
+      markBoundsStale();
+      return true;
+    }
+    if (found != entries_.end()) {
+      detach(found->second);
+      found->second.extent = extent;
+      attach(handle, found->second, cellKey, column, row);
+      markBoundsStale();
+    } else {
+      Entry entry;
+      entry.extent = extent;
+      attach(handle, entry, cellKey, column, row);
+      entries_.emplace(handle, entry);
+    }
+    return true;
+  }
+
+  void remove(int64_t handle) {
+    const auto found = entries_.find(handle);
+    if (found == entries_.end()) {
+      return;
+    }
+    detach(found->second);
+    entries_.erase(found);
+    markBoundsStale();
+  }
+
+  /**
+   * @brief Calls `fn(cell, minX, minY, maxX, maxY)` for every occupied cell,
+   * with the cell bounds in mercator coordinates.
+   */
+  template <typename Fn>
+  void forEachCell(Fn&& fn) const {
+    for (const auto& pair : cells_) {
+      visitCell(pair.second, fn);
+    }
+  }
+
+  /**
+   * @brief Calls `fn(cell)` for every occupied cell accepted by
+   * `isVisible(extent, minX, minY, maxX, maxY)`.
+   *
+   * The occupied cell range is halved recursively and each part is tested
+   * with the merged extent of the bounded members, so only cells under the
+   * accepted parts are looked up; cells holding open members are always
+   * tested. `isVisible` must accept a box whenever it accepts one of its
+   * cells under a smaller extent. When the accepted parts cover more cells
+   * than are occupied, every occupied cell is tested instead.
+   */
+  template <typename Predicate, typename Fn>
+  void forEachVisibleCell(Predicate&& isVisible, Fn&& fn) const {
+    const auto visitVisible = [&](const Cell& cell) {
+      visitCell(cell,
+                [&](const Cell& target,
+                    double minX,
+                    double minY,
+                    double maxX,
+                    double maxY) {
+                  if (isVisible(target.extent, minX, minY, maxX, maxY)) {
+                    fn(target);
+                  }
+                });
+    };
+    if (cells_.empty()) {
+      return;
+    }
+
+    std::vector<CellRange> ranges;
+    if (boundedMembers_ > 0) {
+      double budget = static_cast<double>(cells_.size());
+      const CellRange occupied{
+          boundsMinColumn_, boundsMinRow_, boundsMaxColumn_, boundsMaxRow_};
+      if (!collectVisibleRanges(isVisible, occupied, budget, ranges)) {
+        forEachCell([&](const Cell& cell, double, double, double, double) {
+          visitVisible(cell);
+        });
+        return;
+      }
+    }
+
+    for (const uint64_t cellKey : openCells_) {
+      const auto found = cells_.find(cellKey);
+      if (found != cells_.end()) {
+        visitVisible(found->second);
+      }
+    }
+    for (const CellRange& range : ranges) {
+      for (int64_t row = range.minRow; row <= range.maxRow; ++row) {
+        for (int64_t column = range.minColumn; column <= range.maxColumn;
+             ++column) {
+          const auto found = cells_.find(
+              makeCellKey(static_cast<int32_t>(column),
+                          static_cast<int32_t>(row)));
+          if (found != cells_.end() && found->second.openMembers == 0) {
+            visitVisible(found->second);
+          }
+        }
+      }
+    }
+  }
+
+private:
+  struct Entry {
+    uint64_t cellKey = 0;
+    std::size_t memberIndex = 0;
+    SpatialGridExtent extent;
+  };
+
+  // Inclusive cell coordinate range.
+  struct CellRange {
+    int64_t minColumn = 0;
+    int64_t minRow = 0;
+    int64_t maxColumn = 0;
+    int64_t maxRow = 0;
+
+    double cellCount() const {
+      return (static_cast<double>(maxColumn - minColumn) + 1.0) *
+             (static_cast<double>(maxRow - minRow) + 1.0);
+    }
+  };
+
+  /**
+   * @brief Open extents cannot be bounded from their parameters; the box
+   * test accepts them anywhere, so their cells are kept out of the range
+   * search and always tested.
+   */
+  static inline bool isOpenExtent(const SpatialGridExtent& extent) {
+    return extent.unbounded || !std::isfinite(extent.minAltitude) ||
+           !std::isfinite(extent.maxAltitude);
+  }
+
+  template <typename Fn>
+  static inline void visitCell(const Cell& cell, Fn&& fn) {
+    fn(cell,
+       cell.column / SPATIAL_GRID_CELLS_PER_AXIS,
+       cell.row / SPATIAL_GRID_CELLS_PER_AXIS,
+       (cell.column + 1.0) / SPATIAL_GRID_CELLS_PER_AXIS,
+       (cell.row + 1.0) / SPATIAL_GRID_CELLS_PER_AXIS);
+  }
+
+  /**
+   * @brief Appends the leaf ranges of `range` accepted under the bounded
+   * extent. Returns false once they exceed `budget` cells.
+   */
+  template <typename Predicate>
+  bool collectVisibleRanges(Predicate& isVisible,
+                            const CellRange& range,
+                            double& budget,
+                            std::vector<CellRange>& out) const {
+    if (!isVisible(bounded_,
+                   range.minColumn / SPATIAL_GRID_CELLS_PER_AXIS,
+                   range.minRow / SPATIAL_GRID_CELLS_PER_AXIS,
+                   (range.maxColumn + 1.0) / SPATIAL_GRID_CELLS_PER_AXIS,
+                   (range.maxRow + 1.0) / SPATIAL_GRID_CELLS_PER_AXIS)) {
+      return true;
+    }
+    const double cellCount = range.cellCount();
+    if (cellCount <= SPATIAL_GRID_LEAF_CELLS) {
+      budget -= cellCount;
+      if (budget < 0.0) {
+        return false;
+      }
+      out.push_back(range);
+      return true;
+    }
+    CellRange lower = range;
+    CellRange upper = range;
+    if (range.maxColumn - range.minColumn >= range.maxRow - range.minRow) {
+      const int64_t middle =
+          range.minColumn + (range.maxColumn - range.minColumn) / 2;
+      lower.maxColumn = middle;
+      upper.minColumn = middle + 1;
+    } else {
+      const int64_t middle = range.minRow + (range.maxRow - range.minRow) / 2;
+      lower.maxRow = middle;
+      upper.minRow = middle + 1;
+    }
+    return collectVisibleRanges(isVisible, lower, budget, out) &&
+           collectVisibleRanges(isVisible, upper, budget, out);
+  }
+
+  static inline int32_t toCellCoordinate(double mercator) {
+    const double scaled = std::floor(mercator * SPATIAL_GRID_CELLS_PER_AXIS);
+    const double limit = static_cast<double>(std::numeric_limits<int32_t>::max());
+    return static_cast<int32_t>(std::max(-limit, std::min(limit, scaled)));
+  }
+
+  static inline uint64_t makeCellKey(int32_t column, int32_t row) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(column)) << 32) |
+           static_cast<uint64_t>(static_cast<uint32_t>(row));
+  }
+
+  void attach(int64_t handle,
+              Entry& entry,
+              uint64_t cellKey,
+              int32_t column,
+              int32_t row) {
+    Cell& cell = cells_[cellKey];
+    if (cell.members.empty()) {
+      cell.column = column;
+      cell.row = row;
+      cell.extent = SpatialGridExtent{};
+      cell.staleMembers = 0;
+    }
+    entry.cellKey = cellKey;
+    entry.memberIndex = cell.members.size();
+    cell.members.push_back(handle);
+    cell.extent.merge(entry.extent);
+    addOpenMember(cellKey, cell, entry.extent);
+    growBounds(column, row, entry.extent);
+  }
+
+  void detach(const Entry& entry) {
+    const auto found = cells_.find(entry.cellKey);
+    if (found == cells_.end()) {
+      return;
+    }
+    Cell& cell = found->second;
+    releaseOpenMember(entry.cellKey, cell, entry.extent);
+    const std::size_t last = cell.members.size() - 1;
+    if (entry.memberIndex != last) {
+      const int64_t movedHandle = cell.members[last];
+      cell.members[entry.memberIndex] = movedHandle;
+      entries_[movedHandle].memberIndex = entry.memberIndex;
+    }
+    cell.members.pop_back();
+    if (cell.members.empty()) {
+      cells_.erase(found);
+      return;
+    }
+    markStale(cell);
+  }
+
+  void markStale(Cell& cell) {
+    if (++cell.staleMembers <= cell.members.size()) {
+      return;
+    }
+    cell.extent = SpatialGridExtent{};
+    for (const int64_t member : cell.members) {
+      cell.extent.merge(entries_[member].extent);
+    }
+    cell.staleMembers = 0;
+  }
+
+  void addOpenMember(uint64_t cellKey, Cell& cell, const SpatialGridExtent& extent) {
+    if (isOpenExtent(extent) && cell.openMembers++ == 0) {
+      openCells_.insert(cellKey);
+    }
+  }
+
+  void releaseOpenMember(uint64_t cellKey,
+                         Cell& cell,
+                         const SpatialGridExtent& extent) {
+    if (isOpenExtent(extent) && --cell.openMembers == 0) {
+      openCells_.erase(cellKey);
+    }
+  }
+
+  void growBounds(int32_t column, int32_t row, const SpatialGridExtent& extent) {
+    boundsMinColumn_ = std::min<int64_t>(boundsMinColumn_, column);
+    boundsMinRow_ = std::min<int64_t>(boundsMinRow_, row);
+    boundsMaxColumn_ = std::max<int64_t>(boundsMaxColumn_, column);
+    boundsMaxRow_ = std::max<int64_t>(boundsMaxRow_, row);
+    if (!isOpenExtent(extent)) {
+      bounded_.merge(extent);
+      ++boundedMembers_;
+    }
+  }
+
+  void resetBounds() {
+    boundsMinColumn_ = std::numeric_limits<int64_t>::max();
+    boundsMinRow_ = std::numeric_limits<int64_t>::max();
+    boundsMaxColumn_ = std::numeric_limits<int64_t>::min();
+    boundsMaxRow_ = std::numeric_limits<int64_t>::min();
+    bounded_ = SpatialGridExtent{};
+    boundedMembers_ = 0;
+    staleBounds_ = 0;
+  }
+
+  // boundedMembers_ counts merges since the last rebuild, so it is only
+  // ever used as "some bounded member may exist". Cells with open members
+  // are always tested, so the rebuild leaves their extents out.
+  void markBoundsStale() {
+    if (++staleBounds_ <= entries_.size()) {
+      return;
+    }
+    resetBounds();
+    for (const auto& pair : cells_) {
+      const Cell& cell = pair.second;
+      growBounds(cell.column,
+                 cell.row,
+                 cell.openMembers == 0 ? cell.extent : SpatialGridExtent{});
+    }
+  }
+
+  std::unordered_map<int64_t, Entry> entries_;
+  std::unordered_map<uint64_t, Cell> cells_;
+  std::unordered_set<uint64_t> openCells_;
+  int64_t boundsMinColumn_ = std::numeric_limits<int64_t>::max();
+  int64_t boundsMinRow_ = std::numeric_limits<int64_t>::max();
+  int64_t boundsMaxColumn_ = std::numeric_limits<int64_t>::min();
+  int64_t boundsMaxRow_ = std::numeric_limits<int64_t>::min();
+  SpatialGridExtent bounded_;
+  std::size_t boundedMembers_ = 0;
+  std::size_t staleBounds_ = 0;
+};
+
+#endif
@@ -0,0 +1,657 @@
+// maplibre-gl-layers - MapLibre's layer extension library enabling
+// the display, movement, and modification of large numbers of dynamic sprite images
+// Copyright (c) Kouji Matsui (@kekyo)
+// Under MIT
+
+#pragma once
+
+#ifndef _SPRITE_STORE_H
+#define _SPRITE_STORE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "calculation_host_common.h"
+#include "calculation_host_layouts.h"
+#include "projection_host.h"
+#include "spatial_grid.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// Resident sprite store batch layouts.
+//
+// Every mutation batch starts with RESIDENT_BATCH_HEADER_LENGTH doubles
+// (entry count) followed by the entries:
+//   resources: InputResourceEntry (RESOURCE_STRIDE), keyed by `handle`.
+//   sprites:   handle, lng, lat, altitude (RESIDENT_SPRITE_STRIDE).
+//   images:    InputItemEntry (ITEM_STRIDE), keyed by `spriteHandle` and
+//              `bucketIndex`, which acts as the caller-assigned image id and
+//              is echoed back as the result `imageIndex`.
+//   removals:  sprite handles, or spriteHandle/imageId pairs.
+//   patches:   spriteHandle, imageId, InputItemEntry field index, value.
+//
+// Every entry of a batch is validated before any is applied, so a batch that
+// returns false leaves the store unchanged. Patches must name stored images.
+
+constexpr std::size_t RESIDENT_BATCH_HEADER_LENGTH = 1;
+constexpr std::size_t RESIDENT_SPRITE_STRIDE = 4;
+constexpr std::size_t RESIDENT_IMAGE_KEY_STRIDE = 2;
+constexpr std::size_t RESIDENT_PATCH_STRIDE = 4;
+
+#define RESIDENT_ITEM_FIELD(name) \
+  (offsetof(InputItemEntry, name) / sizeof(double))
+
+/**
+ * @brief Sprite/image table that lives in the module between frames.
+ *
+ * Images are kept densely in `InputItemEntry` layout so the prepare pipeline
+ * can consume them exactly like a marshalled item span. Fields that refer to
+ * other entries (origin target index, sprite location) are derived by the
+ * store in `resolveImages()` instead of being supplied by the caller.
+ *
+ * Sprites are also kept in a SpatialGridIndex so visibility queries only walk
+ * the cells around the camera. Moving a known sprite updates its own images
+ * and grid entry; adding or removing images rebuilds the index.
+ */
+class ResidentSpriteStore {
+public:
+  bool upsertResources(const double* entriesPtr, std::size_t count) {
+    const auto* entries =
+        reinterpret_cast<const InputResourceEntry*>(entriesPtr);
+    // Handles are table indices, so a batch can grow the table by at most
+    // its own size; anything beyond is a stray handle, not a reason to
+    // allocate.
+    std::size_t tableSize = resources_.size();
+    for (std::size_t i = 0; i < count; ++i) {
+      std::size_t handle = 0;
+      if (!convertToSizeT(entries[i].handle, handle) ||
+          handle >= resources_.size() + count) {
+        return false;
+      }
+      tableSize = std::max(tableSize, handle + 1);
+    }
+    if (tableSize > resources_.size()) {
+      std::size_t index = resources_.size();
+      InputResourceEntry empty{};
+      empty.atlasPageIndex = -1.0;
+      empty.atlasU1 = 1.0;
+      empty.atlasV1 = 1.0;
+      resources_.resize(tableSize, empty);
+      for (; index < tableSize; ++index) {
+        resources_[index].handle = static_cast<double>(index);
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      std::size_t handle = 0;
+      convertToSizeT(entries[i].handle, handle);
+      resources_[handle] = entries[i];
+    }
+    return true;
+  }
+
+  bool upsertSprites(const double* entriesPtr, std::size_t count) {
+    if (!validateHandles(entriesPtr, RESIDENT_SPRITE_STRIDE, count)) {
+      return false;
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry = entriesPtr + i * RESIDENT_SPRITE_STRIDE;
+      int64_t handle = 0;
+      convertToInt64(entry[0], handle);
+      const SpriteRecord record{entry[1], entry[2], entry[3]};
+      const auto found = sprites_.find(handle);
+      if (found == sprites_.end()) {
+        // Images may already reference this sprite; place them all again.
+        sprites_.emplace(handle, record);
+        locationsDirty_ = true;
+      } else {
+        found->second = record;
+        movedSprites_.push_back(handle);
+      }
+    }
+    return true;
+  }
+
+  bool removeSprites(const double* handlesPtr, std::size_t count) {
+    if (!validateHandles(handlesPtr, 1, count)) {
+      return false;
+    }
+    std::unordered_set<int64_t> removed;
+    removed.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      int64_t handle = 0;
+      convertToInt64(handlesPtr[i], handle);
+      sprites_.erase(handle);
+      removed.insert(handle);
+    }
+    if (removed.empty()) {
+      return true;
+    }
+    compactImages([&removed](const ImageKey& key) {
+      return removed.count(key.spriteHandle) != 0;
+    });
+    return true;
+  }
+
+  bool upsertImages(const double* entriesPtr, std::size_t count) {
+    const auto* entries = reinterpret_cast<const InputItemEntry*>(entriesPtr);
+    for (std::size_t i = 0; i < count; ++i) {
+      ImageKey key;
+      if (!readImageKey(entries[i].spriteHandle, entries[i].bucketIndex, key)) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      ImageKey key;
+      readImageKey(entries[i].spriteHandle, entries[i].bucketIndex, key);
+      const auto found = slots_.find(key);
+      if (found == slots_.end()) {
+        slots_.emplace(key, images_.size());
+        images_.push_back(entries[i]);
+        keys_.push_back(key);
+      } else {
+        images_[found->second] = entries[i];
+      }
+    }
+    if (count > 0) {
+      layoutDirty_ = true;
+      locationsDirty_ = true;
+    }
+    return true;
+  }
+
+  bool removeImages(const double* keysPtr, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry = keysPtr + i * RESIDENT_IMAGE_KEY_STRIDE;
+      ImageKey key;
+      if (!readImageKey(entry[0], entry[1], key)) {
+        return false;
+      }
+    }
+    std::unordered_set<ImageKey, ImageKeyHash> removed;
+    removed.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry = keysPtr + i * RESIDENT_IMAGE_KEY_STRIDE;
+      ImageKey key;
+      readImageKey(entry[0], entry[1], key);
+      if (slots_.count(key) != 0) {
+        removed.insert(key);
+      }
+    }
+    if (removed.empty()) {
+      return true;
+    }
+    compactImages(
+        [&removed](const ImageKey& key) { return removed.count(key) != 0; });
+    return true;
+  }
+
+  bool patchImages(const double* patchesPtr, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry = patchesPtr + i * RESIDENT_PATCH_STRIDE;
+      ImageKey key;
+      std::size_t field = 0;
+      if (!readImageKey(entry[0], entry[1], key) ||
+          !convertToSizeT(entry[2], field) || !isPatchableField(field) ||
+          slots_.count(key) == 0) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+      const double* entry = patchesPtr + i * RESIDENT_PATCH_STRIDE;
+      ImageKey key;
+      std::size_t field = 0;
+      readImageKey(entry[0], entry[1], key);
+      convertToSizeT(entry[2], field);
+      setImageField(key, field, entry[3]);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Moves a known sprite in place.
+   * @return false when the handle is not stored.
+   */
+  bool moveSprite(int64_t handle,
+                  double lng,
+                  double lat,
+                  bool hasAltitude,
+                  double altitude) {
+    const auto found = sprites_.find(handle);
+    if (found == sprites_.end()) {
+      return false;
+    }
+    found->second.lng = lng;
+    found->second.lat = lat;
+    if (hasAltitude) {
+      found->second.altitude = altitude;
+    }
+    movedSprites_.push_back(handle);
+    return true;
+  }
+
+  /**
+   * @brief Writes one patchable image field, as patchImages() does.
+   * @return false when the image is not stored.
+   */
+  bool setImageField(int64_t spriteHandle,
+                     std::size_t imageId,
+                     std::size_t field,
+                     double value) {
+    return setImageField(ImageKey{spriteHandle, imageId}, field, value);
+  }
+
+  void clear() {
+    resources_.clear();
+    sprites_.clear();
+    images_.clear();
+    keys_.clear();
+    slots_.clear();
+    spriteImages_.clear();
+    unplacedSprites_.clear();
+    movedSprites_.clear();
+    patchedSprites_.clear();
+    grid_.clear();
+    layoutDirty_ = false;
+    locationsDirty_ = false;
+  }
+
+  std::size_t imageCount() const {
+    return images_.size();
+  }
+
+  const std::vector<InputResourceEntry>& resources() const {
+    return resources_;
+  }
+
+  const SpatialGridIndex& spatialIndex() const {
+    return grid_;
+  }
+
+  /**
+   * @brief Refreshes derived fields and returns the dense image table.
+   *
+   * Origin references are resolved to slots by (sprite, originSubLayer,
+   * originOrder) and sprite locations are copied from the sprite table. Both
+   * are skipped when nothing relevant changed since the previous call; when
+   * only sprites moved, just their images and grid entries are touched.
+   */
+  const std::vector<InputItemEntry>& resolveImages() {
+    const bool rebuildIndex = layoutDirty_ || locationsDirty_;
+    if (layoutDirty_) {
+      std::unordered_map<LayerKey, std::size_t, LayerKeyHash> layerSlots;
+      layerSlots.reserve(images_.size());
+      for (std::size_t slot = 0; slot < images_.size(); ++slot) {
+        layerSlots.emplace(LayerKey{keys_[slot].spriteHandle,
+                                    images_[slot].subLayer,
+                                    images_[slot].order},
+                           slot);
+      }
+      for (std::size_t slot = 0; slot < images_.size(); ++slot) {
+        InputItemEntry& image = images_[slot];
+        image.originTargetIndex = SPRITE_ORIGIN_REFERENCE_INDEX_NONE;
+        if (image.originSubLayer < 0.0 || image.originOrder < 0.0) {
+          continue;
+        }
+        const auto found = layerSlots.find(LayerKey{
+            keys_[slot].spriteHandle, image.originSubLayer, image.originOrder});
+        if (found != layerSlots.end()) {
+          image.originTargetIndex = static_cast<double>(found->second);
+        }
+      }
+      spriteImages_.clear();
+      for (std::size_t slot = 0; slot < images_.size(); ++slot) {
+        spriteImages_[keys_[slot].spriteHandle].slots.push_back(slot);
+      }
+      layoutDirty_ = false;
+    }
+    if (locationsDirty_) {
+      for (std::size_t slot = 0; slot < images_.size(); ++slot) {
+        const auto found = sprites_.find(keys_[slot].spriteHandle);
+        if (found == sprites_.end()) {
+          continue;
+        }
+        copySpriteLocation(found->second, images_[slot]);
+      }
+      locationsDirty_ = false;
+    } else {
+      for (const int64_t handle : movedSprites_) {
+        const auto group = spriteImages_.find(handle);
+        const auto record = sprites_.find(handle);
+        if (group == spriteImages_.end() || record == sprites_.end()) {
+          continue;
+        }
+        for (const std::size_t slot : group->second.slots) {
+          copySpriteLocation(record->second, images_[slot]);
+        }
+      }
+    }
+
+    if (rebuildIndex) {
+      rebuildSpatialIndex();
+    } else {
+      for (const int64_t handle : patchedSprites_) {
+        refreshSpatialEntry(handle, true);
+      }
+      for (const int64_t handle : movedSprites_) {
+        refreshSpatialEntry(handle, false);
+      }
+    }
+    movedSprites_.clear();
+    patchedSprites_.clear();
+    return images_;
+  }
+
+  /**
+   * @brief Appends, in ascending order, the slots of every image whose sprite
+   * lies in a cell accepted by
+   * `isCellVisible(extent, minX, minY, maxX, maxY)`, plus the images of
+   * sprites that are not indexed. The predicate is also applied to ranges of
+   * cells (see SpatialGridIndex::forEachVisibleCell). Call after
+   * resolveImages().
+   */
+  template <typename CellPredicate, typename SlotVector>
+  void collectSpatialCandidates(CellPredicate&& isCellVisible,
+                                SlotVector& out) const {
+    const auto appendSprite = [&](int64_t handle) {
+      const auto group = spriteImages_.find(handle);
+      if (group != spriteImages_.end()) {
+        out.insert(out.end(), group->second.slots.begin(),
+                   group->second.slots.end());
+      }
+    };
+    grid_.forEachVisibleCell(isCellVisible,
+                             [&](const SpatialGridIndex::Cell& cell) {
+                               for (const int64_t handle : cell.members) {
+                                 appendSprite(handle);
+                               }
+                             });
+    for (const int64_t handle : unplacedSprites_) {
+      appendSprite(handle);
+    }
+    std::sort(out.begin(), out.end());
+  }
+
+private:
+  struct SpriteRecord {
+    double lng = 0.0;
+    double lat = 0.0;
+    double altitude = 0.0;
+  };
+
+  struct SpriteImages {
+    std::vector<std::size_t> slots;
+    // Extent of the images alone; the altitude is added from the record.
+    SpatialGridExtent extent;
+    bool placed = false;
+  };
+
+  struct ImageKey {
+    int64_t spriteHandle = 0;
+    std::size_t imageId = 0;
+    bool operator==(const ImageKey& other) const {
+      return spriteHandle == other.spriteHandle && imageId == other.imageId;
+    }
+  };
+
+  struct ImageKeyHash {
+    std::size_t operator()(const ImageKey& key) const {
+      return std::hash<int64_t>()(key.spriteHandle) * 31u +
+             std::hash<std::size_t>()(key.imageId);
+    }
+  };
+
+  struct LayerKey {
+    int64_t spriteHandle = 0;
+    double subLayer = 0.0;
+    double order = 0.0;
+    bool operator==(const LayerKey& other) const {
+      return spriteHandle == other.spriteHandle &&
+             subLayer == other.subLayer && order == other.order;
+    }
+  };
+
+  struct LayerKeyHash {
+    std::size_t operator()(const LayerKey& key) const {
+      return std::hash<int64_t>()(key.spriteHandle) * 31u +
+             std::hash<double>()(key.subLayer) * 17u +
+             std::hash<double>()(key.order);
+    }
+  };
+
+  /**
+   * @brief Whether the first double of every `stride`-sized entry is a valid
+   * sprite handle.
+   */
+  static inline bool validateHandles(const double* entriesPtr,
+                                     std::size_t stride,
+                                     std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      int64_t handle = 0;
+      if (!convertToInt64(entriesPtr[i * stride], handle)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static inline bool readImageKey(double spriteHandle,
+                                  double imageId,
+                                  ImageKey& out) {
+    return convertToInt64(spriteHandle, out.spriteHandle) &&
+           convertToSizeT(imageId, out.imageId);
+  }
+
+  static inline void copySpriteLocation(const SpriteRecord& record,
+                                        InputItemEntry& image) {
+    image.spriteLng = record.lng;
+    image.spriteLat = record.lat;
+    image.spriteZ = record.altitude;
+  }
+
+  static inline bool hasOrigin(const InputItemEntry& image) {
+    return image.originTargetIndex != SPRITE_ORIGIN_REFERENCE_INDEX_NONE ||
+           (image.originSubLayer >= 0.0 && image.originOrder >= 0.0);
+  }
+
+  static inline bool isBillboard(const InputItemEntry& image) {
+    return std::lround(image.mode) != 0;
+  }
+
+  /**
+   * @brief Fields that feed SpatialGridExtent.
+   */
+  static inline bool isExtentField(std::size_t field) {
+    return field == RESIDENT_ITEM_FIELD(mode) ||
+           field == RESIDENT_ITEM_FIELD(scale) ||
+           field == RESIDENT_ITEM_FIELD(anchorX) ||
+           field == RESIDENT_ITEM_FIELD(anchorY) ||
+           field == RESIDENT_ITEM_FIELD(offsetMeters);
+  }
+
+  /**
+   * @brief Merges the size parameters of a sprite's images.
+   *
+   * A billboard drawn on another billboard's origin stays bounded (the
+   * prepare pipeline doubles the radius); any other origin reference makes
+   * the sprite unbounded.
+   */
+  SpatialGridExtent calculateImageExtent(
+      const std::vector<std::size_t>& slots) const {
+    SpatialGridExtent extent;
+    for (const std::size_t slot : slots) {
+      const InputItemEntry& image = images_[slot];
+      if (!std::isfinite(image.mode) || !std::isfinite(image.scale) ||
+          !std::isfinite(image.anchorX) || !std::isfinite(image.anchorY) ||
+          !std::isfinite(image.offsetMeters)) {
+        extent.unbounded = true;
+        continue;
+      }
+      const bool billboard = isBillboard(image);
+      const double scale = std::fabs(image.scale != 0.0 ? image.scale : 1.0);
+      const double offsetMeters = std::fabs(image.offsetMeters);
+      SpatialGridImageReach reach;
+      reach.present = true;
+      reach.scale = scale;
+      reach.anchorReach = 0.5 * std::hypot(1.0 + std::fabs(image.anchorX),
+                                           1.0 + std::fabs(image.anchorY));
+      reach.offsetMeters = offsetMeters;
+      reach.scaledOffsetMeters = offsetMeters * scale;
+      (billboard ? extent.billboards : extent.surfaces).merge(reach);
+
+      if (!hasOrigin(image)) {
+        continue;
+      }
+      std::size_t originSlot = 0;
+      if (!billboard || !convertToSizeT(image.originTargetIndex, originSlot) ||
+          originSlot >= images_.size()) {
+        extent.unbounded = true;
+        continue;
+      }
+      const InputItemEntry& origin = images_[originSlot];
+      if (!std::isfinite(origin.mode) || !isBillboard(origin) ||
+          hasOrigin(origin)) {
+        extent.unbounded = true;
+        continue;
+      }
+      extent.hasBillboardOrigins = true;
+    }
+    return extent;
+  }
+
+  /**
+   * @brief Places (or removes) one sprite in the grid after it moved or its
+   * images changed.
+   */
+  void refreshSpatialEntry(int64_t handle, bool imagesChanged) {
+    const auto group = spriteImages_.find(handle);
+    if (group == spriteImages_.end()) {
+      return;
+    }
+    SpriteImages& images = group->second;
+    if (imagesChanged) {
+      images.extent = calculateImageExtent(images.slots);
+    }
+    const bool wasPlaced = images.placed;
+    const auto record = sprites_.find(handle);
+    if (record == sprites_.end()) {
+      grid_.remove(handle);
+      images.placed = false;
+    } else {
+      SpatialGridExtent extent = images.extent;
+      const double altitude = record->second.altitude;
+      if (std::isfinite(altitude)) {
+        extent.minAltitude = altitude;
+        extent.maxAltitude = altitude;
+      } else {
+        extent.unbounded = true;
+      }
+      images.placed = grid_.upsert(handle,
+                                   mercatorXfromLng(record->second.lng),
+                                   mercatorYfromLat(record->second.lat),
+                                   extent);
+    }
+    if (images.placed == wasPlaced) {
+      return;
+    }
+    if (images.placed) {
+      unplacedSprites_.erase(handle);
+    } else {
+      unplacedSprites_.insert(handle);
+    }
+  }
+
+  void rebuildSpatialIndex() {
+    grid_.clear();
+    unplacedSprites_.clear();
+    for (auto& pair : spriteImages_) {
+      // Starting unplaced, refreshSpatialEntry only reports placements.
+      pair.second.placed = false;
+      refreshSpatialEntry(pair.first, true);
+      if (!pair.second.placed) {
+        unplacedSprites_.insert(pair.first);
+      }
+    }
+  }
+
+  bool setImageField(const ImageKey& key, std::size_t field, double value) {
+    const auto found = slots_.find(key);
+    if (found == slots_.end()) {
+      return false;
+    }
+    double* fields = reinterpret_cast<double*>(&images_[found->second]);
+    fields[field] = value;
+    if (field == RESIDENT_ITEM_FIELD(subLayer) ||
+        field == RESIDENT_ITEM_FIELD(order) ||
+        field == RESIDENT_ITEM_FIELD(originSubLayer) ||
+        field == RESIDENT_ITEM_FIELD(originOrder)) {
+      layoutDirty_ = true;
+    } else if (isExtentField(field)) {
+      patchedSprites_.push_back(key.spriteHandle);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Drops the images whose key matches `isRemoved`, compacting in
+   * place so the relative order of surviving images is kept. The item index
+   * breaks ties between equal depth keys, so a swap-remove would reorder
+   * images of unrelated sprites.
+   */
+  template <typename IsRemoved>
+  void compactImages(const IsRemoved& isRemoved) {
+    std::size_t writeIndex = 0;
+    for (std::size_t readIndex = 0; readIndex < images_.size(); ++readIndex) {
+      if (isRemoved(keys_[readIndex])) {
+        slots_.erase(keys_[readIndex]);
+        continue;
+      }
+      if (writeIndex != readIndex) {
+        images_[writeIndex] = images_[readIndex];
+        keys_[writeIndex] = keys_[readIndex];
+        slots_[keys_[writeIndex]] = writeIndex;
+      }
+      ++writeIndex;
+    }
+    images_.resize(writeIndex);
+    keys_.resize(writeIndex);
+    layoutDirty_ = true;
+  }
+
+  /**
+   * @brief Keys and store-derived fields cannot be patched directly.
+   */
+  static inline bool isPatchableField(std::size_t field) {
+    if (field >= ITEM_STRIDE) {
+      return false;
+    }
+    return field != RESIDENT_ITEM_FIELD(spriteHandle) &&
+           field != RESIDENT_ITEM_FIELD(bucketIndex) &&
+           field != RESIDENT_ITEM_FIELD(originTargetIndex) &&
+           field != RESIDENT_ITEM_FIELD(spriteLng) &&
+           field != RESIDENT_ITEM_FIELD(spriteLat) &&
+           field != RESIDENT_ITEM_FIELD(spriteZ);
+  }
+
+  std::vector<InputResourceEntry> resources_;
+  std::unordered_map<int64_t, SpriteRecord> sprites_;
+  std::vector<InputItemEntry> images_;
+  std::vector<ImageKey> keys_;
+  std::unordered_map<ImageKey, std::size_t, ImageKeyHash> slots_;
+  std::unordered_map<int64_t, SpriteImages> spriteImages_;
+  // Sprites outside the grid; candidates in every cull, in any order.
+  std::unordered_set<int64_t> unplacedSprites_;
+  std::vector<int64_t> movedSprites_;
+  std::vector<int64_t> patchedSprites_;
+  SpatialGridIndex grid_;
+  bool layoutDirty_ = false;
+  bool locationsDirty_ = false;
+};
+
+#undef RESIDENT_ITEM_FIELD
+
+#endif
@@ -11,22 +11,29 @@
 #include <algorithm>
 #include <cmath>
 #include <cstddef>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 #include <emscripten/emscripten.h>
 
 #if defined(__EMSCRIPTEN_PTHREADS__)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #endif
 
-#if defined(__EMSCRIPTEN_PTHREADS__)
-inline std::size_t g_threadPoolLimit = 0;
+inline std::size_t g_workerChunkItems = 0;  // 0: use the per-pass default
 
 extern "C" {
-EMSCRIPTEN_KEEPALIVE inline void setThreadPoolSize(double value) {
+/**
+ * @brief Overrides the chunk size used by the dynamic scheduler.
+ * @param value Items per chunk, or 0/NaN to restore the per-pass defaults.
+ */
+EMSCRIPTEN_KEEPALIVE inline void setWorkerChunkSize(double value) {
   if (std::isnan(value) || value <= 0.0) {
-    g_threadPoolLimit = 0;
+    g_workerChunkItems = 0;
     return;
   }
   const double floored = std::floor(value + 0.5);
@@ -34,25 +41,277 @@ EMSCRIPTEN_KEEPALIVE inline void setThreadPoolSize(double value) {
     return;
   }
   const auto converted = static_cast<std::size_t>(floored);
-  g_threadPoolLimit = converted > 0 ? converted : 0;
+  g_workerChunkItems = converted > 0 ? converted : 0;
 }
 }
 
-static inline std::size_t clampToAvailableThreads(std::size_t requested) {
-  if (g_threadPoolLimit > 0) {
-    return std::min<std::size_t>(requested, g_threadPoolLimit);
+static inline std::size_t resolveWorkerChunkItems(
+    std::size_t defaultChunkItems) {
+  if (g_workerChunkItems > 0) {
+    return g_workerChunkItems;
+  }
+  return std::max<std::size_t>(1, defaultChunkItems);
+}
+
+#if defined(__EMSCRIPTEN_PTHREADS__)
+#ifdef MAX_THREAD_POOL_SIZE
+constexpr std::size_t CONFIGURED_MAX_THREAD_POOL_SIZE = MAX_THREAD_POOL_SIZE;
+#else
+constexpr std::size_t CONFIGURED_MAX_THREAD_POOL_SIZE = 0;  // Unbounded
+#endif
+
+/**
+ * @brief Resident worker pool shared by every parallel pass in the module.
+ *
+ * The calling thread always participates as worker 0, so the pool keeps
+ * `threadCount - 1` resident threads. They are spawned lazily on the first
+ * dispatch and live for the lifetime of the module, which removes the
+ * per-call `std::thread` creation/join cost from every frame.
+ */
+class WorkerPool {
+public:
+  using Invoker = void (*)(void* context,
+                           std::size_t start,
+                           std::size_t end,
+                           std::size_t workerIndex);
+
+  /**
+   * @brief Resizes the pool. Only effective while no dispatch is running.
+   * @param threadCount Total worker count including the calling thread.
+   */
+  void resize(std::size_t threadCount) {
+    std::unique_lock<std::mutex> dispatchLock(dispatchMutex_, std::try_to_lock);
+    if (!dispatchLock.owns_lock()) {
+      return;
+    }
+    const std::size_t residentCount = threadCount > 1 ? threadCount - 1 : 0;
+    if (residentCount == threads_.size()) {
+      return;
+    }
+    stopThreads();
+    startThreads(residentCount);
+  }
+
+  /**
+   * @brief Total worker count available to a dispatch, including the caller.
+   */
+  std::size_t capacity() const {
+    return threads_.size() + 1;
+  }
+
+  /**
+   * @brief Runs `invoke` over `workerCount` contiguous slices of `totalItems`.
+   *
+   * Falls back to the calling thread when the pool is busy (nested or
+   * concurrent dispatch) so a dispatch never waits on itself.
+   */
+  void dispatch(std::size_t workerCount,
+                std::size_t totalItems,
+                Invoker invoke,
+                void* context) {
+    std::unique_lock<std::mutex> dispatchLock(dispatchMutex_, std::try_to_lock);
+    if (!dispatchLock.owns_lock() || threads_.empty()) {
+      invoke(context, 0, totalItems, 0);
+      return;
+    }
+
+    workerCount = std::min(workerCount, capacity());
+    const std::size_t sliceSize =
+        (totalItems + workerCount - 1) / workerCount;
+    // Slices past the end of the range would be empty; do not wake for them.
+    const std::size_t activeWorkers =
+        std::min(workerCount, (totalItems + sliceSize - 1) / sliceSize);
+
+    {
+      std::lock_guard<std::mutex> lock(stateMutex_);
+      invoke_ = invoke;
+      context_ = context;
+      totalItems_ = totalItems;
+      sliceSize_ = sliceSize;
+      activeWorkers_ = activeWorkers;
+      pending_.store(activeWorkers - 1, std::memory_order_relaxed);
+      generation_ += 1;
+    }
+    wakeCondition_.notify_all();
+
+    invoke(context, 0, std::min(totalItems, sliceSize), 0);
+
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    doneCondition_.wait(lock, [this]() {
+      return pending_.load(std::memory_order_acquire) == 0;
+    });
+    invoke_ = nullptr;
+    context_ = nullptr;
+  }
+
+private:
+  void startThreads(std::size_t residentCount) {
+    std::size_t generation = 0;
+    {
+      std::lock_guard<std::mutex> lock(stateMutex_);
+      stopping_ = false;
+      generation = generation_;
+    }
+    threads_.reserve(residentCount);
+    for (std::size_t index = 0; index < residentCount; ++index) {
+      threads_.emplace_back([this, index, generation]() {
+        workerMain(index + 1, generation);
+      });
+    }
   }
+
+  void stopThreads() {
+    if (threads_.empty()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(stateMutex_);
+      stopping_ = true;
+      generation_ += 1;
+    }
+    wakeCondition_.notify_all();
+    for (std::thread& thread : threads_) {
+      if (thread.joinable()) {
+        thread.join();
+      }
+    }
+    threads_.clear();
+  }
+
+  void workerMain(std::size_t workerIndex, std::size_t observedGeneration) {
+    for (;;) {
+      Invoker invoke = nullptr;
+      void* context = nullptr;
+      std::size_t start = 0;
+      std::size_t end = 0;
+      {
+        std::unique_lock<std::mutex> lock(stateMutex_);
+        wakeCondition_.wait(lock, [&]() {
+          return generation_ != observedGeneration;
+        });
+        observedGeneration = generation_;
+        if (stopping_) {
+          return;
+        }
+        if (workerIndex >= activeWorkers_) {
+          continue;
+        }
+        invoke = invoke_;
+        context = context_;
+        start = workerIndex * sliceSize_;
+        end = std::min(totalItems_, start + sliceSize_);
+      }
+
+      invoke(context, start, end, workerIndex);
+
+      if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        doneCondition_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex dispatchMutex_;
+  std::mutex stateMutex_;
+  std::condition_variable wakeCondition_;
+  std::condition_variable doneCondition_;
+  std::size_t generation_ = 0;
+  bool stopping_ = false;
+  Invoker invoke_ = nullptr;
+  void* context_ = nullptr;
+  std::size_t totalItems_ = 0;
+  std::size_t sliceSize_ = 0;
+  std::size_t activeWorkers_ = 0;
+  std::atomic<std::size_t> pending_{0};
+};
+
+inline std::size_t g_threadPoolLimit = 0;
+
+// false: every dispatch spawns and joins its own threads, as runWorkerJobs
+// did before the resident pool. Only kept to measure the pool against it.
+inline bool g_workerPoolEnabled = true;
+
+/**
+ * @brief Module-wide worker pool. Intentionally never destroyed.
+ *
+ * Not `static`: every translation unit including this header shares the
+ * same pool, so the fixed pthread pool is never split between them.
+ */
+inline WorkerPool& getWorkerPool() {
+  static WorkerPool* pool = new WorkerPool();
+  return *pool;
+}
+
+inline std::size_t resolveHardwareThreads() {
   unsigned int hw = std::thread::hardware_concurrency();
   if (hw == 0u) {
     hw = 4u;
   }
-  return std::min<std::size_t>(requested, static_cast<std::size_t>(hw));
+  return static_cast<std::size_t>(hw);
+}
+
+inline std::size_t clampToAvailableThreads(std::size_t requested) {
+  std::size_t limit =
+      g_threadPoolLimit > 0 ? g_threadPoolLimit : resolveHardwareThreads();
+  if (CONFIGURED_MAX_THREAD_POOL_SIZE > 0) {
+    limit = std::min(limit, CONFIGURED_MAX_THREAD_POOL_SIZE);
+  }
+  return std::min<std::size_t>(requested, std::max<std::size_t>(1, limit));
+}
+
+/**
+ * @brief Returns the pool, spawning resident threads on first use.
+ */
+inline WorkerPool& ensureWorkerPool() {
+  WorkerPool& pool = getWorkerPool();
+  static bool initialized = false;
+  if (!initialized) {
+    initialized = true;
+    pool.resize(clampToAvailableThreads(resolveHardwareThreads()));
+  }
+  return pool;
+}
+
+extern "C" {
+EMSCRIPTEN_KEEPALIVE inline void setThreadPoolSize(double value) {
+  if (std::isnan(value) || value <= 0.0) {
+    g_threadPoolLimit = 0;
+  } else {
+    const double floored = std::floor(value + 0.5);
+    if (!std::isfinite(floored)) {
+      return;
+    }
+    const auto converted = static_cast<std::size_t>(floored);
+    g_threadPoolLimit = converted > 0 ? converted : 0;
+  }
+  if (g_workerPoolEnabled) {
+    ensureWorkerPool().resize(
+        clampToAvailableThreads(resolveHardwareThreads()));
+  }
+}
+
+/**
+ * @brief Switches between the resident pool and per-dispatch spawn/join.
+ *
+ * Disabling releases the resident threads so the spawned ones can use the
+ * fixed pthread pool. Benchmark use only.
+ */
+EMSCRIPTEN_KEEPALIVE inline void setWorkerPoolEnabled(bool enabled) {
+  g_workerPoolEnabled = enabled;
+  ensureWorkerPool().resize(
+      enabled ? clampToAvailableThreads(resolveHardwareThreads()) : 1);
+}
 }
 #else
 extern "C" {
 EMSCRIPTEN_KEEPALIVE inline void setThreadPoolSize(double value) {
   (void)value;
 }
+
+EMSCRIPTEN_KEEPALIVE inline void setWorkerPoolEnabled(bool enabled) {
+  (void)enabled;
+}
 }
 
 static inline std::size_t clampToAvailableThreads(std::size_t requested) {
@@ -60,6 +319,22 @@ static inline std::size_t clampToAvailableThreads(std::size_t requested) {
 }
 #endif
 
+/**
+ * @brief Upper bound of the worker count a dispatch may use, and so of the
+ * per-worker slots callers have to provide.
+ */
+static inline std::size_t resolveMaxWorkerCount() {
+#if defined(__EMSCRIPTEN_PTHREADS__)
+  const std::size_t availableWorkers =
+      clampToAvailableThreads(resolveHardwareThreads());
+  return g_workerPoolEnabled
+             ? std::min(availableWorkers, ensureWorkerPool().capacity())
+             : availableWorkers;
+#else
+  return 1;
+#endif
+}
+
 static inline std::size_t determineWorkerCount(std::size_t totalItems,
                                                std::size_t minParallelItems,
                                                std::size_t sliceItems) {
@@ -67,12 +342,7 @@ static inline std::size_t determineWorkerCount(std::size_t totalItems,
   if (totalItems < minParallelItems) {
     return 1;
   }
-  unsigned int hw = std::thread::hardware_concurrency();
-  if (hw == 0u) {
-    hw = 4u;
-  }
-  const std::size_t maxWorkers =
-      clampToAvailableThreads(static_cast<std::size_t>(hw));
+  const std::size_t maxWorkers = resolveMaxWorkerCount();
   const std::size_t bySize =
       std::max<std::size_t>(1, sliceItems > 0 ? totalItems / sliceItems : 1);
   return std::min<std::size_t>(maxWorkers, bySize);
@@ -84,19 +354,17 @@ static inline std::size_t determineWorkerCount(std::size_t totalItems,
 #endif
 }
 
-template <typename Fn>
-static inline void runWorkerJobs(std::size_t workerCount,
-                                 std::size_t totalItems,
-                                 Fn&& fn) {
 #if defined(__EMSCRIPTEN_PTHREADS__)
-  Fn job = std::forward<Fn>(fn);
-  if (workerCount <= 1 || totalItems == 0) {
-    job(0, totalItems, 0);
-    return;
-  }
+/**
+ * @brief Runs every slice on its own `std::thread` and joins them all,
+ * used while the resident pool is disabled.
+ */
+template <typename Fn>
+static inline void runSpawnedWorkerJobs(std::size_t workerCount,
+                                        std::size_t totalItems,
+                                        Fn& fn) {
   const std::size_t sliceSize =
       (totalItems + workerCount - 1) / workerCount;
-
   std::vector<std::thread> workers;
   workers.reserve(workerCount);
   for (std::size_t workerIndex = 0; workerIndex < workerCount; ++workerIndex) {
@@ -106,20 +374,108 @@ static inline void runWorkerJobs(std::size_t workerCount,
     }
     const std::size_t end = std::min(totalItems, start + sliceSize);
     workers.emplace_back(
-        [start, end, workerIndex, job]() mutable {
-          job(start, end, workerIndex);
-        });
+        [start, end, workerIndex, &fn]() { fn(start, end, workerIndex); });
   }
   for (std::thread& worker : workers) {
     if (worker.joinable()) {
       worker.join();
     }
   }
+}
+#endif
+
+/**
+ * @brief Runs `fn(start, end, workerIndex)` over contiguous slices on the
+ * resident worker pool. `workerIndex` is always below `workerCount`.
+ */
+template <typename Fn>
+static inline void runWorkerJobs(std::size_t workerCount,
+                                 std::size_t totalItems,
+                                 Fn&& fn) {
+#if defined(__EMSCRIPTEN_PTHREADS__)
+  if (workerCount <= 1 || totalItems == 0) {
+    fn(0, totalItems, 0);
+    return;
+  }
+  if (!g_workerPoolEnabled) {
+    runSpawnedWorkerJobs(workerCount, totalItems, fn);
+    return;
+  }
+  using Job = std::remove_reference_t<Fn>;
+  ensureWorkerPool().dispatch(
+      workerCount,
+      totalItems,
+      [](void* context,
+         std::size_t start,
+         std::size_t end,
+         std::size_t workerIndex) {
+        (*static_cast<Job*>(context))(start, end, workerIndex);
+      },
+      const_cast<void*>(static_cast<const void*>(&fn)));
+#else
+  (void)workerCount;
+  fn(0, totalItems, 0);
+#endif
+}
+
+/**
+ * @brief Runs `fn(start, end, workerIndex)` once per `chunkItems`-sized chunk.
+ *
+ * Workers claim chunks from a shared atomic counter instead of owning a fixed
+ * slice, so uneven per-item cost (surface vs billboard) stays balanced.
+ * Chunks may complete in any order; callers that need ordered output should
+ * key it by `start / chunkItems`.
+ */
+template <typename Fn>
+static inline void runChunkedWorkerJobs(std::size_t workerCount,
+                                        std::size_t totalItems,
+                                        std::size_t chunkItems,
+                                        Fn&& fn) {
+  chunkItems = std::max<std::size_t>(1, chunkItems);
+  const std::size_t chunkCount = (totalItems + chunkItems - 1) / chunkItems;
+#if defined(__EMSCRIPTEN_PTHREADS__)
+  if (workerCount > 1 && chunkCount > 1) {
+    std::atomic<std::size_t> nextChunk{0};
+    runWorkerJobs(std::min(workerCount, chunkCount),
+                  std::min(workerCount, chunkCount),
+                  [&](std::size_t, std::size_t, std::size_t workerIndex) {
+                    for (;;) {
+                      const std::size_t chunk =
+                          nextChunk.fetch_add(1, std::memory_order_relaxed);
+                      if (chunk >= chunkCount) {
+                        break;
+                      }
+                      const std::size_t start = chunk * chunkItems;
+                      fn(start,
+                         std::min(totalItems, start + chunkItems),
+                         workerIndex);
+                    }
+                  });
+    return;
+  }
 #else
   (void)workerCount;
-  Fn job = std::forward<Fn>(fn);
-  job(0, totalItems, 0);
 #endif
+  for (std::size_t chunk = 0; chunk < chunkCount; ++chunk) {
+    const std::size_t start = chunk * chunkItems;
+    fn(start, std::min(totalItems, start + chunkItems), 0);
+  }
+}
+
+/**
+ * @brief Parallel-for over `[0, totalItems)`: decides the worker count from
+ * the thresholds and runs `fn(start, end, workerIndex)` on the pool.
+ * @return Worker count used, so callers can size per-worker outputs.
+ */
+template <typename Fn>
+static inline std::size_t parallelFor(std::size_t totalItems,
+                                      std::size_t minParallelItems,
+                                      std::size_t sliceItems,
+                                      Fn&& fn) {
+  const std::size_t workerCount =
+      determineWorkerCount(totalItems, minParallelItems, sliceItems);
+  runWorkerJobs(workerCount, totalItems, std::forward<Fn>(fn));
+  return workerCount;
 }
 
 #endif